@@ -1,20 +1,48 @@
 ﻿#include <windows.h>
 #include <commctrl.h>
+#include <commdlg.h>
+#include <deque>
+#include <fstream>
 #include <string>
 #include <sstream>
+#include <vector>
+
+#include "../batch_proto.h"
 
 #pragma comment(lib, "comctl32.lib")
+#pragma comment(lib, "comdlg32.lib")
 
 #define IDC_DATEPICKER 1001
 #define IDC_COMBOBOX   1002
 #define IDC_SEND_BTN   1003
+#define IDC_IMPORT_BTN 1004
+#define IDC_STATUS     1005
+
+#define WM_APP_STATUS  (WM_APP + 1)   // 发送线程通知界面刷新状态
 
 HANDLE hSerial = INVALID_HANDLE_VALUE;
+HWND hMainWnd = NULL;
+
+// 待发记录：界面线程追加，发送线程按窗口取走打成批次帧
+CRITICAL_SECTION queueLock;
+std::deque<bp_record> pendingRecords;
+HANDLE hWakeEvent = NULL;     // 有新记录或要退出
+HANDLE hSendThread = NULL;
+volatile LONG quitFlag = 0;
+
+// 发送统计，发送线程写，界面线程读
+volatile LONG statQueued = 0;
+volatile LONG statAcked = 0;
+volatile LONG statFrames = 0;
+volatile LONG statRetransmits = 0;
+volatile LONG statError = 0;
 
 LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
 
 bool InitSerialPort(const char* portName) {
-    hSerial = CreateFileA(portName, GENERIC_WRITE, 0, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    // 重叠方式打开：发送线程同时等写完成、ACK 和超时，不会卡在 WriteFile 上
+    hSerial = CreateFileA(portName, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING,
+                          FILE_FLAG_OVERLAPPED, NULL);
     if (hSerial == INVALID_HANDLE_VALUE) {
         MessageBoxA(NULL, "打开串口失败", "错误", MB_OK | MB_ICONERROR);
         return false;
@@ -40,17 +68,200 @@ bool InitSerialPort(const char* portName) {
         return false;
     }
 
+    // 读操作收到任意字节就完成，最长等一个重发超时
+    COMMTIMEOUTS timeouts = { 0 };
+    timeouts.ReadIntervalTimeout = MAXDWORD;
+    timeouts.ReadTotalTimeoutMultiplier = MAXDWORD;
+    timeouts.ReadTotalTimeoutConstant = BP_TIMEOUT_MS;
+    SetCommTimeouts(hSerial, &timeouts);
+    PurgeComm(hSerial, PURGE_RXCLEAR | PURGE_TXCLEAR);
+
     return true;
 }
 
-void SendData(const std::string& data) {
-    if (hSerial == INVALID_HANDLE_VALUE) {
-        MessageBoxA(NULL, "串口未打开", "错误", MB_OK | MB_ICONERROR);
+void PostStatus() {
+    if (hMainWnd != NULL) {
+        PostMessage(hMainWnd, WM_APP_STATUS, 0, 0);
+    }
+}
+
+// 发送线程：记录打成批次帧，重叠写出，收 ACK 推进窗口，超时重发
+DWORD WINAPI SendThread(LPVOID) {
+    bp_sender sender;
+    bp_decoder decoder;
+    OVERLAPPED ovRead = { 0 }, ovWrite = { 0 };
+    uint8_t rxBuf[64];
+    uint8_t txBuf[BP_WINDOW * BP_FRAME_MAX];
+    bool reading = false, writing = false;
+
+    ovRead.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    ovWrite.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    bp_sender_init(&sender, (uint16_t)GetTickCount(), BP_TIMEOUT_MS);
+    bp_decoder_init(&decoder);
+
+    while (!quitFlag) {
+        // 窗口有空位就从队列取记录
+        EnterCriticalSection(&queueLock);
+        while (!pendingRecords.empty() && bp_sender_window_free(&sender) > 0) {
+            bp_record batch[BP_RECORDS_MAX];
+            size_t n = 0;
+            while (n < BP_RECORDS_MAX && n < pendingRecords.size()) {
+                batch[n] = pendingRecords[n];
+                n++;
+            }
+            n = bp_sender_push(&sender, batch, n);
+            pendingRecords.erase(pendingRecords.begin(), pendingRecords.begin() + n);
+        }
+        LeaveCriticalSection(&queueLock);
+
+        // 上一次写完才取下一批字节，txBuf 在写完成前不能动
+        if (!writing) {
+            DWORD n = (DWORD)bp_sender_poll(&sender, GetTickCount(), txBuf, sizeof(txBuf));
+            if (n > 0) {
+                if (!WriteFile(hSerial, txBuf, n, NULL, &ovWrite) && GetLastError() != ERROR_IO_PENDING) {
+                    break;
+                }
+                writing = true;
+            }
+        }
+
+        if (!reading) {
+            if (!ReadFile(hSerial, rxBuf, sizeof(rxBuf), NULL, &ovRead) && GetLastError() != ERROR_IO_PENDING) {
+                break;
+            }
+            reading = true;
+        }
+
+        HANDLE events[3] = { ovRead.hEvent, hWakeEvent, ovWrite.hEvent };
+        uint32_t wait = bp_sender_next_timeout(&sender, GetTickCount());
+        DWORD r = WaitForMultipleObjects(writing ? 3 : 2, events, FALSE,
+                                         wait == UINT32_MAX ? INFINITE : (DWORD)wait);
+
+        if (r == WAIT_OBJECT_0) {
+            DWORD got = 0;
+            reading = false;
+            if (!GetOverlappedResult(hSerial, &ovRead, &got, FALSE)) {
+                break;
+            }
+            for (DWORD i = 0; i < got; i++) {
+                bp_frame frame;
+                if (bp_decoder_put(&decoder, rxBuf[i], &frame)) {
+                    bp_sender_on_frame(&sender, &frame);
+                }
+            }
+        } else if (r == WAIT_OBJECT_0 + 2) {
+            DWORD put = 0;
+            writing = false;
+            if (!GetOverlappedResult(hSerial, &ovWrite, &put, FALSE)) {
+                break;
+            }
+        }
+
+        if ((LONG)sender.records_acked != statAcked || (LONG)sender.retransmits != statRetransmits) {
+            InterlockedExchange(&statAcked, (LONG)sender.records_acked);
+            InterlockedExchange(&statFrames, (LONG)sender.frames);
+            InterlockedExchange(&statRetransmits, (LONG)sender.retransmits);
+            PostStatus();
+        }
+    }
+
+    if (!quitFlag) {
+        InterlockedExchange(&statError, (LONG)GetLastError());
+        PostStatus();
+    }
+
+    // 退出前收回挂着的读写，OVERLAPPED 在栈上
+    CancelIo(hSerial);
+    DWORD dummy;
+    if (reading) GetOverlappedResult(hSerial, &ovRead, &dummy, TRUE);
+    if (writing) GetOverlappedResult(hSerial, &ovWrite, &dummy, TRUE);
+    CloseHandle(ovRead.hEvent);
+    CloseHandle(ovWrite.hEvent);
+    return 0;
+}
+
+void QueueRecords(const std::vector<bp_record>& records) {
+    if (records.empty()) return;
+    EnterCriticalSection(&queueLock);
+    pendingRecords.insert(pendingRecords.end(), records.begin(), records.end());
+    LeaveCriticalSection(&queueLock);
+    InterlockedExchangeAdd(&statQueued, (LONG)records.size());
+    SetEvent(hWakeEvent);
+    PostStatus();
+}
+
+// CSV 一行："TYPE1,20250620,24"，依次为类型、生产日期（yyyyMMdd 或 yyyy-MM-dd）、件数（可省，默认 1）
+bool ParseCsvLine(const std::string& line, bp_record* record) {
+    std::string fields[3];
+    std::string field;
+    std::stringstream ss(line);
+    int n = 0;
+
+    while (n < 3 && std::getline(ss, field, ',')) {
+        size_t first = field.find_first_not_of(" \t\"");
+        size_t last = field.find_last_not_of(" \t\"\r");
+        fields[n++] = first == std::string::npos ? "" : field.substr(first, last - first + 1);
+    }
+    if (n < 2 || fields[0].compare(0, 4, "TYPE") != 0) return false;
+
+    int type = atoi(fields[0].c_str() + 4);
+    if (type < 1 || type > BP_TYPE_MAX) return false;
+
+    std::string digits;
+    for (char c : fields[1]) {
+        if (c >= '0' && c <= '9') digits += c;
+        else if (c != '-' && c != '/') return false;
+    }
+    if (digits.size() != 8) return false;
+
+    long count = n == 3 && !fields[2].empty() ? atol(fields[2].c_str()) : 1;
+    if (count < 1 || count > 65535) return false;
+
+    record->type = (uint8_t)type;
+    record->date = (uint32_t)strtoul(digits.c_str(), NULL, 10);
+    record->count = (uint16_t)count;
+    return true;
+}
+
+// 导入 CSV：不以 TYPE 开头的行（表头、注释、空行）跳过，格式不对的行计数后跳过
+void ImportCsv(HWND hwnd) {
+    wchar_t path[MAX_PATH] = L"";
+    OPENFILENAMEW ofn = { 0 };
+    ofn.lStructSize = sizeof(ofn);
+    ofn.hwndOwner = hwnd;
+    ofn.lpstrFilter = L"CSV 文件 (*.csv)\0*.csv\0所有文件 (*.*)\0*.*\0";
+    ofn.lpstrFile = path;
+    ofn.nMaxFile = MAX_PATH;
+    ofn.Flags = OFN_FILEMUSTEXIST | OFN_PATHMUSTEXIST;
+    if (!GetOpenFileNameW(&ofn)) return;
+
+    std::ifstream file(path);
+    if (!file) {
+        MessageBox(hwnd, L"无法打开文件", L"错误", MB_OK | MB_ICONERROR);
         return;
     }
-    DWORD bytesWritten;
-    std::string sendData = data + "\n";
-    WriteFile(hSerial, sendData.c_str(), (DWORD)sendData.length(), &bytesWritten, NULL);
+
+    std::vector<bp_record> records;
+    std::string line;
+    int bad = 0;
+    long units = 0;
+    while (std::getline(file, line)) {
+        bp_record record;
+        size_t start = line.compare(0, 3, "\xEF\xBB\xBF") == 0 ? 3 : 0;
+        if (line.compare(start, 4, "TYPE") != 0) continue;
+        if (ParseCsvLine(line.substr(start), &record)) {
+            records.push_back(record);
+            units += record.count;
+        } else {
+            bad++;
+        }
+    }
+
+    QueueRecords(records);
+
+    wchar_t msg[128];
+    swprintf(msg, 128, L"已导入 %d 条记录，共 %ld 件，跳过 %d 行格式错误", (int)records.size(), units, bad);
+    MessageBox(hwnd, msg, L"导入", MB_OK | (bad ? MB_ICONWARNING : MB_ICONINFORMATION));
 }
 
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow) {
@@ -71,7 +282,7 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow) {
         wc.lpszClassName,
         L"货物生产日期录入",
         WS_OVERLAPPEDWINDOW & ~WS_MAXIMIZEBOX & ~WS_SIZEBOX,
-        CW_USEDEFAULT, CW_USEDEFAULT, 350, 200,
+        CW_USEDEFAULT, CW_USEDEFAULT, 350, 280,
         NULL, NULL, hInstance, NULL);
 
     if (!hwnd) return 0;
@@ -83,12 +294,25 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow) {
         return 0;
     }
 
+    InitializeCriticalSection(&queueLock);
+    hWakeEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    hMainWnd = hwnd;
+    hSendThread = CreateThread(NULL, 0, SendThread, NULL, 0, NULL);
+
     MSG msg = {};
     while (GetMessage(&msg, NULL, 0, 0)) {
         TranslateMessage(&msg);
         DispatchMessage(&msg);
     }
 
+    hMainWnd = NULL;
+    InterlockedExchange(&quitFlag, 1);
+    SetEvent(hWakeEvent);
+    WaitForSingleObject(hSendThread, INFINITE);
+    CloseHandle(hSendThread);
+    CloseHandle(hWakeEvent);
+    DeleteCriticalSection(&queueLock);
+
     if (hSerial != INVALID_HANDLE_VALUE) {
         CloseHandle(hSerial);
     }
@@ -97,7 +321,7 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow) {
 }
 
 LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
-    static HWND hDatePicker, hComboBox, hButton;
+    static HWND hDatePicker, hComboBox, hButton, hImportButton, hStatus;
 
     switch (msg) {
     case WM_CREATE:
@@ -122,8 +346,31 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
             WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON,
             20, 100, 200, 30,
             hwnd, (HMENU)IDC_SEND_BTN, NULL, NULL);
+
+        hImportButton = CreateWindowEx(0, L"BUTTON", L"导入 CSV 批量发送",
+            WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON,
+            20, 140, 200, 30,
+            hwnd, (HMENU)IDC_IMPORT_BTN, NULL, NULL);
+
+        // 发送进度：排队、已确认、重发
+        hStatus = CreateWindowEx(0, L"STATIC", L"就绪",
+            WS_CHILD | WS_VISIBLE,
+            20, 185, 300, 40,
+            hwnd, (HMENU)IDC_STATUS, NULL, NULL);
         break;
 
+    case WM_APP_STATUS: {
+        wchar_t text[128];
+        if (statError != 0) {
+            swprintf(text, 128, L"串口错误 %ld，发送已停止", statError);
+        } else {
+            swprintf(text, 128, L"已确认 %ld/%ld 条记录\n共 %ld 帧，重发 %ld 帧",
+                     statAcked, statQueued, statFrames, statRetransmits);
+        }
+        SetWindowText(hStatus, text);
+        break;
+    }
+
     case WM_COMMAND:
         if (LOWORD(wParam) == IDC_SEND_BTN) {
             // 读取日期
@@ -134,10 +381,6 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
                 break;
             }
 
-            // 格式化日期 yyyyMMdd
-            wchar_t dateStr[16];
-            swprintf(dateStr, 16, L"%04d%02d%02d", st.wYear, st.wMonth, st.wDay);
-
             // 读取商品类型
             int sel = (int)SendMessage(hComboBox, CB_GETCURSEL, 0, 0);
             if (sel == CB_ERR) {
@@ -145,21 +388,14 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
                 break;
             }
 
-            // 商品类型编码
-            const wchar_t* typeCode = (sel == 0) ? L"TYPE1" : L"TYPE2";
-
-            // 拼接字符串，例如 "TYPE1-20250620"
-            wchar_t sendStr[64];
-            swprintf(sendStr, 64, L"%s-%s", typeCode, dateStr);
-
-            // 转为多字节
-            char sendBuf[64];
-            WideCharToMultiByte(CP_ACP, 0, sendStr, -1, sendBuf, sizeof(sendBuf), NULL, NULL);
-
-            // 发送串口
-            SendData(std::string(sendBuf));
-
-            MessageBox(hwnd, L"数据已发送", L"成功", MB_OK | MB_ICONINFORMATION);
+            // 一件货一条记录：TYPE1/TYPE2，日期 yyyyMMdd，由发送线程打帧发出，进度看状态栏
+            bp_record record;
+            record.type = (uint8_t)(sel + 1);
+            record.date = st.wYear * 10000u + st.wMonth * 100u + st.wDay;
+            record.count = 1;
+            QueueRecords(std::vector<bp_record>(1, record));
+        } else if (LOWORD(wParam) == IDC_IMPORT_BTN) {
+            ImportCsv(hwnd);
         }
         break;
 
@@ -5,26 +5,116 @@
 #include <board.h>
 #include <finsh.h>
 #include <drv_lcd.h>
+#include "slide_motion.h"
+#include "pusher.h"
+#include "key_input.h"
+#include "lcd_render.h"
+#include "batch_rx.h"
+#include "batch_proto.h"
+#include "inventory.h"
+#include "vend_trace.h"
+#include "vend_log.h"
+#include "slide_pos.h"
+#include "slide_cal.h"
+#include "mem_budget.h"
+#include <fal.h>
 
 /* 第一组滑台和推手定义 */
 #define PWM_DEV_NAME_1        "pwm2"
 #define PWM_DEV_CHANNEL_1     4
 #define DIR_PIN_1             GET_PIN(A, 0)
+#define SLIDE_HOME_PIN_1      GET_PIN(D, 12)  // 滑台零点开关（低有效）
 #define PUSH_IN1_PIN_1        GET_PIN(A, 1)
 #define PUSH_IN2_PIN_1        GET_PIN(A, 2)
+#define PUSH_FWD_LIMIT_PIN_1  GET_PIN(D, 8)   // 推手伸出到位开关
+#define PUSH_BACK_LIMIT_PIN_1 GET_PIN(D, 9)   // 推手缩回到位开关
+#define PUSH_ADC_CHANNEL_1    8               // 推手电流采样（adc1，PA3）
+#define PUSH_STALL_ADC_1      2000            // 堵转电流阈值（ADC 原始值）
 
 /* 第二组滑台和推手定义 */
 #define PWM_DEV_NAME_2        "pwm2"
 #define PWM_DEV_CHANNEL_2     3
 #define DIR_PIN_2             GET_PIN(A, 5)
+#define SLIDE_HOME_PIN_2      GET_PIN(D, 13)
 #define PUSH_IN3_PIN_2        GET_PIN(A, 7)
 #define PUSH_IN4_PIN_2        GET_PIN(A, 6)
+#define PUSH_FWD_LIMIT_PIN_2  GET_PIN(D, 10)
+#define PUSH_BACK_LIMIT_PIN_2 GET_PIN(D, 11)
+#define PUSH_ADC_CHANNEL_2    9               // PA4
+#define PUSH_STALL_ADC_2      2000
+
+#define PUSH_ADC_DEV_NAME     "adc1"
+#define PUSH_TIMEOUT_MS       5500    // 单程超时，原先每程固定走这么久
+
+/* 滑台运动参数：每转 400 步，原先恒定以 200 rpm 运行 */
+#define SLIDE_RPM             200
+#define SLIDE_STEPS_PER_REV   400
+#define SLIDE_RPM_TO_SPS(rpm) ((rt_uint32_t)(rpm) * SLIDE_STEPS_PER_REV / 60)
+
+/* 原先从零点出发的运行时间换算为步数 */
+#define SLIDE_MS_TO_STEPS(ms) ((rt_int32_t)((rt_int64_t)(ms) * SLIDE_RPM * SLIDE_STEPS_PER_REV / 60000))
+
+#define SLIDE_HOMING_STEPS    SLIDE_MS_TO_STEPS(60000)  // 回零时最多后退的步数，找不到开关时与原先一样顶在零点上
+
+/*
+ * 零点开关在机械零点前 SLIDE_HOME_OFFSET 步以内保持动作。回零时快速后退到
+ * 开关动作，刹车停下后快速前进到离释放点 SLIDE_HOME_CREEP 步处，最后以起停
+ * 速度前进到开关释放，该处即 SLIDE_HOME_OFFSET
+ */
+#define SLIDE_HOME_OFFSET     1000
+#define SLIDE_HOME_CREEP      100
+
+/* 第一组速度曲线：起停转速、巡航转速（rpm）、加速度（步/s²） */
+#define SLIDE1_START_RPM      200
+#define SLIDE1_MAX_RPM        800
+#define SLIDE1_HOMING_RPM     400   // 开关动作后要在零点前刹住，见下面的检查
+#define SLIDE1_ACCEL          4000
+
+/* 第二组速度曲线 */
+#define SLIDE2_START_RPM      200
+#define SLIDE2_MAX_RPM        800
+#define SLIDE2_HOMING_RPM     400
+#define SLIDE2_ACCEL          4000
+
+/*
+ * 从回零速度刹到起停速度走的步数，与 slide_axis_stop 的算法相同。回零后退时
+ * 开关一动作就刹车，刹住后离机械零点至少还要留 SLIDE_HOME_CREEP 步。
+ */
+#define SLIDE_BRAKE_STEPS(start_rpm, rpm, accel) \
+    ((((rpm) * SLIDE_STEPS_PER_REV / 60) * ((rpm) * SLIDE_STEPS_PER_REV / 60) - \
+      ((start_rpm) * SLIDE_STEPS_PER_REV / 60) * ((start_rpm) * SLIDE_STEPS_PER_REV / 60)) / (2 * (accel)) + 1)
+#if SLIDE_BRAKE_STEPS(SLIDE1_START_RPM, SLIDE1_HOMING_RPM, SLIDE1_ACCEL) + SLIDE_HOME_CREEP > SLIDE_HOME_OFFSET
+#error "SLIDE1_HOMING_RPM cannot brake before the mechanical zero"
+#endif
+#if SLIDE_BRAKE_STEPS(SLIDE2_START_RPM, SLIDE2_HOMING_RPM, SLIDE2_ACCEL) + SLIDE_HOME_CREEP > SLIDE_HOME_OFFSET
+#error "SLIDE2_HOMING_RPM cannot brake before the mechanical zero"
+#endif
+
+/* 第一组各目标位置（步，从机械零点算起；ENDPOINT 为回零后的位置） */
+#define SLIDE1_POS_EXHIBIT    SLIDE_MS_TO_STEPS(4360)
+#define SLIDE1_POS_TRANSPORT  SLIDE_MS_TO_STEPS(6000)
+#define SLIDE1_POS_OUT2       SLIDE_MS_TO_STEPS(17590)
+#define SLIDE1_POS_OUT1       SLIDE_MS_TO_STEPS(34020)
+
+/* 第二组各目标位置（步，从机械零点算起；ENDPOINT 为回零后的位置） */
+#define SLIDE2_POS_EXHIBIT    SLIDE_MS_TO_STEPS(4360)
+#define SLIDE2_POS_TRANSPORT  SLIDE_MS_TO_STEPS(6890)
+#define SLIDE2_POS_OUT2       SLIDE_MS_TO_STEPS(17590)
+#define SLIDE2_POS_OUT1       SLIDE_MS_TO_STEPS(28920)
+
+/* 上位机（Info）批次记录串口 */
+#define BATCH_UART_NAME       "uart2"
 
 /* 按键引脚定义 */
 #define KEY_UP_PIN    GET_PIN(C, 5)
 #define KEY_DOWN_PIN  GET_PIN(C, 1)
 #define KEY_SELECT_PIN GET_PIN(C, 3)  // 新增选择按键
 
+/* 按键编号，随按键事件送到界面线程 */
+#define KEY_ID_UP     1
+#define KEY_ID_DOWN   2
+#define KEY_ID_SELECT 3
+
 /* 颜色宏定义 */
 #ifndef WHITE
 #define WHITE 0xFFFF
@@ -39,596 +129,1907 @@
 #define GREEN 0x07E0
 #endif
 
+/*
+ * 货道命令表：名字与说明。命令编号、名字解析和 MSH 命令都由它生成；
+ * ENDPOINT 到 OUT1 为定位命令，顺序同 LaneConfig::positions。
+ */
+#define LANE_COMMAND_TABLE(X) \
+    X(ENDPOINT,  move slide to endpoint position) \
+    X(EXHIBIT,   move slide to exhibit position) \
+    X(TRANSPORT, move slide to transport position) \
+    X(OUT2,      move slide to output 2 position) \
+    X(OUT1,      move slide to output 1 position) \
+    X(EXIT,      stop slide movement) \
+    X(PUSH_CTRL, start pusher for one round trip)
+
+#define LANE_CMD_ENUM(name, desc)   LANE_CMD_##name,
+#define LANE_CMD_NAME(name, desc)   #name,
+
+typedef enum {
+    LANE_COMMAND_TABLE(LANE_CMD_ENUM)
+    LANE_CMD_COUNT
+} LaneCmd;
+
+/* 内部命令，不在命令表里：走到 Lane::move_target，校准时用 */
+#define LANE_CMD_MOVE   ((LaneCmd)LANE_CMD_COUNT)
+
+static const char *const lane_cmd_names[] = {
+    LANE_COMMAND_TABLE(LANE_CMD_NAME)
+    "MOVE",
+};
+
+#define LANE_POS_COUNT  LANE_CMD_EXIT   // 定位命令的个数
+
 /* 文本行结构体 */
 typedef struct {
     const char *text;
     int y;
-    int device_group;  // 1:第一组, 2:第二组
-    const char *command;  // 对应执行的命令
+    int device_group;  // 组号，从 1 开始
+    LaneCmd command;   // 对应执行的命令
 } TextLine;
 
 /* 商品信息与控制命令映射 */
 static TextLine text_lines[] = {
-    {"Snickers",          50, 1, "EXHIBIT_1"},
-    {"Fresh:3.50  ",      70, 1, "OUT1_1"},
-    {"Short:2.00  ",      90, 1, "OUT2_1"},
-    {"Halls Candies",     120, 2, "EXHIBIT_2"},
-    {"Fresh:4.00  ",      140, 2, "OUT1_2"},
-    {"Short:2.50  ",      160, 2, "OUT2_2"},
+    {"Snickers",          50, 1, LANE_CMD_EXHIBIT},
+    {"Fresh:3.50  ",      70, 1, LANE_CMD_OUT1},
+    {"Short:2.00  ",      90, 1, LANE_CMD_OUT2},
+    {"Halls Candies",     120, 2, LANE_CMD_EXHIBIT},
+    {"Fresh:4.00  ",      140, 2, LANE_CMD_OUT1},
+    {"Short:2.50  ",      160, 2, LANE_CMD_OUT2},
 };
 
 #define LINE_COUNT (sizeof(text_lines) / sizeof(text_lines[0]))
 static int cursor_idx = 0;  // 当前选中行索引
-static rt_bool_t operation_in_progress = RT_FALSE;  // 操作进行中标志
 
-/* 第一组相关全局变量 */
-static struct rt_device_pwm *pwm_dev_1 = RT_NULL;
-static rt_thread_t slide_thread_1 = RT_NULL;
-static rt_thread_t push_thread_1 = RT_NULL;
-static rt_bool_t push_completed_1 = RT_FALSE;
+/* 出货行：滑台到位后要推货，可以一次买多件 */
+#define TEXT_LINE_SELLS(line) ((line)->command == LANE_CMD_OUT1 || (line)->command == LANE_CMD_OUT2)
+
+#define VEND_QTY_MAX    5   // 一单最多几件
+
+/* 状态栏：空闲时显示提示语（较长，折成两行），出货时每组一行显示进度 */
+#define STATUS_Y        260
+#define STATUS_H        32
+#define STATUS_HINT     "Use Up/Down to select, Select to buy"
+#define STATUS_QTY_HINT "Up/Down: quantity  Select: buy  Hold: cancel"
+#define STATUS_CAL_HINT "Up/Down: jog  Select: confirm  Hold: abort"
+#define STATUS_HOLD_MS  2000    // 完成或失败信息保留的时间
+
+/* 出货进度，由执行线程报告给界面 */
+#define VEND_STAGE_NONE     0
+#define VEND_STAGE_SLIDE    1   // 滑台移动中
+#define VEND_STAGE_PUSH     2   // 推手伸出中
+#define VEND_STAGE_RETURN   3   // 推手缩回中
+#define VEND_STAGE_DONE     4
+#define VEND_STAGE_FAILED   5
+#define VEND_STAGE_QUEUED   6   // 已排队，本组正被手动命令占用
+
+static const char *vend_stage_text[] = {
+    "", "Slide moving", "Pushing", "Returning", "Done", "Failed", "Queued",
+};
 
-/* 第二组相关全局变量 */
-static struct rt_device_pwm *pwm_dev_2 = RT_NULL;
-static rt_thread_t slide_thread_2 = RT_NULL;
-static rt_thread_t push_thread_2 = RT_NULL;
-static rt_bool_t push_completed_2 = RT_FALSE;
+/* 界面线程的消息：按键事件，或提醒界面去取记下的状态变化 */
+#define UI_MSG_KEY      1
+#define UI_MSG_CHANGED  2
+#define UI_QUEUE_LEN    16
 
-/* 第一组推手控制线程 */
-static void push_control_thread_1(void *parameter)
+typedef struct {
+    rt_uint8_t type;    // UI_MSG_*
+    rt_uint8_t id;      // 按键编号
+    rt_uint8_t event;   // KEY_EVENT_*
+} UiMsg;
+
+static struct rt_messagequeue ui_mq;
+static rt_uint8_t ui_mq_pool[UI_QUEUE_LEN * (RT_ALIGN(sizeof(UiMsg), RT_ALIGN_SIZE) + sizeof(void *))];
+
+/*
+ * 出货进度、库存和校准的变化不排进队列，只在这几个字里按组号置位，界面
+ * 醒来后按各组当前的状态重画。队列里最多一条 UI_MSG_CHANGED，按键总给它
+ * 留一格，所以报告变化既不阻塞也不会丢。
+ */
+static volatile rt_uint32_t ui_vend_changes = 0;
+static volatile rt_uint32_t ui_stock_changes = 0;
+static volatile rt_uint32_t ui_cal_changes = 0;
+static rt_bool_t ui_change_sent = RT_FALSE;     // 已发出 UI_MSG_CHANGED，界面还没取
+static volatile rt_bool_t ui_keys_lost = RT_FALSE;  // 队列满时丢过按下、长按或松开
+
+static void ui_notify(volatile rt_uint32_t *changes, int group)
 {
-    rt_pin_mode(PUSH_IN1_PIN_1, PIN_MODE_OUTPUT);
-    rt_pin_mode(PUSH_IN2_PIN_1, PIN_MODE_OUTPUT);
+    UiMsg msg;
+    rt_bool_t send;
+    rt_base_t level = rt_hw_interrupt_disable();
 
-    rt_uint8_t direction = 0;
-    rt_uint8_t move_count = 0;
+    *changes |= 1u << group;
+    send = !ui_change_sent;
+    ui_change_sent = RT_TRUE;
+    rt_hw_interrupt_enable(level);
 
-    while (1)
+    if (send)
     {
-        if (direction == 0)
-        {
-            rt_pin_write(PUSH_IN1_PIN_1, PIN_HIGH);
-            rt_pin_write(PUSH_IN2_PIN_1, PIN_LOW);
-            rt_kprintf("Pusher 1 moving forward\n");
-        }
-        else
-        {
-            rt_pin_write(PUSH_IN1_PIN_1, PIN_LOW);
-            rt_pin_write(PUSH_IN2_PIN_1, PIN_HIGH);
-            rt_kprintf("Pusher 1 moving backward\n");
-            move_count++;
-        }
+        msg.type = UI_MSG_CHANGED;
+        msg.id = 0;
+        msg.event = 0;
+        rt_mq_send(&ui_mq, &msg, sizeof(msg));
+    }
+}
 
-        direction = !direction;
-        rt_thread_mdelay(5500);
+/* 每组滑台+推手的工作状态，各组互不影响 */
+typedef enum {
+    GROUP_IDLE = 0,     // 空闲
+    GROUP_SLIDE,        // 滑台运动中
+    GROUP_PUSH,         // 推手运动中
+    GROUP_VEND,         // 出货流水线占用，各段动作结束时不释放
+    GROUP_CAL,          // 位置校准占用，校准结束时释放
+} GroupState;
+
+/* 出货流水线各段的完成事件 */
+#define VEND_EVENT_SLIDE_DONE   (1 << 0)    // 滑台到位
+#define VEND_EVENT_PUSH_DONE    (1 << 1)    // 推手伸出到位
+#define VEND_EVENT_RETURN_DONE  (1 << 2)    // 推手缩回到位
+#define VEND_EVENT_FAILED       (1 << 3)    // 本段失败，流水线中止
+
+/* 出货执行线程的消息 */
+#define VEND_MSG_REQUEST        1   // 界面下发的一行命令
+#define VEND_MSG_STAGE          2   // 某组一段动作结束，set 为 VEND_EVENT_*；为 0 时表示本组已空闲
+#define VEND_QUEUE_LEN          8
 
-        if (move_count >= 1)
-        {
-            rt_kprintf("Pusher 1 completed one round trip\n");
-            push_completed_1 = RT_TRUE;
+typedef struct {
+    rt_uint8_t type;        // VEND_MSG_*
+    rt_uint8_t group;
+    rt_uint8_t quantity;    // 下单的件数
+    rt_uint32_t set;
+    const TextLine *line;
+} VendMsg;
 
-            rt_thread_t self = rt_thread_self();
-            self->stat = RT_THREAD_CLOSE;
-            operation_in_progress = RT_FALSE;
-            return;
-        }
+static struct rt_messagequeue vend_mq;
+static rt_uint8_t vend_mq_pool[VEND_QUEUE_LEN * (RT_ALIGN(sizeof(VendMsg), RT_ALIGN_SIZE) + sizeof(void *))];
+
+/* 每组（货道）的硬件描述：滑台轴、推手和目标位置表 */
+typedef struct {
+    const char *pwm_name;           // 滑台步进脉冲，各组须共用同一个 PWM 设备
+    int pwm_channel;
+    rt_base_t dir_pin;              // 滑台方向
+    rt_base_t home_pin;             // 零点开关，低有效
+    rt_uint32_t start_rpm;          // 速度曲线：起停、巡航、回零转速（rpm）
+    rt_uint32_t max_rpm;
+    rt_uint32_t homing_rpm;
+    rt_uint32_t accel;              // 加速度，步/s²
+    PusherConfig pusher;
+    rt_int32_t positions[LANE_POS_COUNT];   // 各定位命令的目标位置（步），ENDPOINT 为回零后的位置
+} LaneConfig;
+
+static const LaneConfig lane_configs[] = {
+    {
+        PWM_DEV_NAME_1, PWM_DEV_CHANNEL_1, DIR_PIN_1, SLIDE_HOME_PIN_1,
+        SLIDE1_START_RPM, SLIDE1_MAX_RPM, SLIDE1_HOMING_RPM, SLIDE1_ACCEL,
+        { PUSH_IN1_PIN_1, PUSH_IN2_PIN_1, PUSH_FWD_LIMIT_PIN_1, PUSH_BACK_LIMIT_PIN_1,
+          PUSH_ADC_DEV_NAME, PUSH_ADC_CHANNEL_1, PUSH_STALL_ADC_1, PUSH_TIMEOUT_MS },
+        { SLIDE_HOME_OFFSET, SLIDE1_POS_EXHIBIT, SLIDE1_POS_TRANSPORT, SLIDE1_POS_OUT2, SLIDE1_POS_OUT1 },
+    },
+    {
+        PWM_DEV_NAME_2, PWM_DEV_CHANNEL_2, DIR_PIN_2, SLIDE_HOME_PIN_2,
+        SLIDE2_START_RPM, SLIDE2_MAX_RPM, SLIDE2_HOMING_RPM, SLIDE2_ACCEL,
+        { PUSH_IN3_PIN_2, PUSH_IN4_PIN_2, PUSH_FWD_LIMIT_PIN_2, PUSH_BACK_LIMIT_PIN_2,
+          PUSH_ADC_DEV_NAME, PUSH_ADC_CHANNEL_2, PUSH_STALL_ADC_2, PUSH_TIMEOUT_MS },
+        { SLIDE_HOME_OFFSET, SLIDE2_POS_EXHIBIT, SLIDE2_POS_TRANSPORT, SLIDE2_POS_OUT2, SLIDE2_POS_OUT1 },
+    },
+};
+
+#define LANE_COUNT ((int)(sizeof(lane_configs) / sizeof(lane_configs[0])))
+
+#define LANE_WORKER_STACK   1024    // 每组工作线程的栈（字节）
+#define LANE_WORKER_PRIO    20
+#define LANE_MAILBOX_LEN    2       // 组占用保证同组最多一条命令在途，留一格余量
+
+#define LANE_ORDER_MAX      8       // 每组最多排队的订单
+#define LANE_ORDER_BYPASS   3       // 一单最多被后到的订单插队几次，到了就先做它
+
+/* 排队中的订单 */
+typedef struct {
+    const TextLine *line;
+    rt_uint8_t quantity;
+    rt_uint8_t bypassed;            // 已被后到的订单插队的次数
+} LaneOrder;
+
+/* 报告给界面的出货进度：执行线程在 vend_report 里整份写入，界面整份读出，都关中断 */
+typedef struct {
+    rt_uint8_t stage;
+    rt_uint8_t pending;             // 排队的订单数
+    rt_uint8_t unit;
+    rt_uint8_t quantity;
+} VendProgress;
+
+/* 每组的运行状态 */
+typedef struct {
+    const LaneConfig *cfg;
+    int id;                         // 组号，从 1 开始
+    volatile GroupState state;
+    SlideAxis axis;
+    Pusher pusher;
+    char pusher_name[RT_NAME_MAX];
+    rt_int32_t pos;                 // 滑台当前位置（步），上电时取闪存里停稳时的位置
+    rt_int32_t positions[LANE_POS_COUNT];   // 各定位命令的目标位置：有校准表时取校准值，否则取 cfg
+    volatile rt_int32_t move_target;        // LANE_CMD_MOVE 的目标位置
+    volatile int home_wait;         // 回零时等待的开关电平
+    const TextLine *vend_line;      // 流水线正在执行的命令，空闲为 RT_NULL
+    rt_uint8_t vend_stage;          // 最近报告给界面的进度
+    rt_uint8_t vend_quantity;       // 这一单的件数，滑台只走一趟，推手推这么多次
+    rt_uint8_t vend_unit;           // 正在推第几件，从 1 开始
+    VendProgress progress;          // 界面只读这一份，不读上面几项
+
+    /* 订单队列，按到达顺序存放，只由出货执行线程访问 */
+    LaneOrder orders[LANE_ORDER_MAX];
+    int order_count;
+    int sweep;                      // 扫描方向：1 朝远端，-1 朝零点
+
+    /* 常驻工作线程：滑台和推手的命令都从邮箱取，同组同时只有一条在执行 */
+    struct rt_thread worker;
+    struct rt_mailbox mailbox;
+    rt_ubase_t mailbox_pool[LANE_MAILBOX_LEN];
+    char worker_name[RT_NAME_MAX];
+} Lane;
+
+static Lane lanes[LANE_COUNT];
+static ALIGN(RT_ALIGN_SIZE) rt_uint8_t lane_stacks[LANE_COUNT][LANE_WORKER_STACK];
+
+/* 占用一组：仅在空闲时切换到 next，检查与赋值在关中断下完成 */
+static rt_bool_t group_claim(volatile GroupState *state, GroupState next)
+{
+    rt_bool_t claimed = RT_FALSE;
+    rt_base_t level = rt_hw_interrupt_disable();
+
+    if (*state == GROUP_IDLE)
+    {
+        *state = next;
+        claimed = RT_TRUE;
     }
+
+    rt_hw_interrupt_enable(level);
+    return claimed;
 }
 
-/* 第一组滑台控制线程 */
-static void slide_control_thread_1(void *parameter)
+/* 释放一组，由持有者在动作结束时调用 */
+static void group_release(volatile GroupState *state)
 {
-    const char *cmd = (const char *)parameter;
-    rt_uint32_t period, pulse;
-    rt_uint8_t dir = 1;
-    rt_int32_t delay_ms = 0;
+    rt_base_t level = rt_hw_interrupt_disable();
+    *state = GROUP_IDLE;
+    rt_hw_interrupt_enable(level);
+}
 
-    if (pwm_dev_1 == RT_NULL)
+static void vend_notify(Lane *lane, rt_uint32_t set)
+{
+    VendMsg msg;
+
+    msg.type = VEND_MSG_STAGE;
+    msg.group = lane->id;
+    msg.quantity = 0;
+    msg.set = set;
+    msg.line = RT_NULL;
+    rt_mq_send_wait(&vend_mq, &msg, sizeof(msg), RT_WAITING_FOREVER);
+}
+
+/* 一段动作完成：本组在流水线中时通知执行线程，由它排下一段 */
+static void lane_progress(Lane *lane, rt_uint32_t set)
+{
+    if (lane->state == GROUP_VEND)
+        vend_notify(lane, set);
+}
+
+static void cal_move_done(Lane *lane);
+
+/*
+ * 一段动作结束：通知流水线；不在流水线中时释放本组，再告诉执行线程
+ * 本组已空闲，手动命令期间排下的订单由它接着做
+ */
+static void lane_finish(Lane *lane, rt_uint32_t set)
+{
+    if (lane->state == GROUP_VEND)
     {
-        pwm_dev_1 = (struct rt_device_pwm *)rt_device_find(PWM_DEV_NAME_1);
-        if (pwm_dev_1 == RT_NULL)
-        {
-            rt_kprintf("PWM device %s not found!\n", PWM_DEV_NAME_1);
-            operation_in_progress = RT_FALSE;
-            return;
-        }
+        lane_progress(lane, set);
+    }
+    else if (lane->state == GROUP_CAL)
+    {
+        cal_move_done(lane);
+    }
+    else
+    {
+        group_release(&lane->state);
+        vend_notify(lane, 0);
     }
+}
 
-    rt_pin_mode(DIR_PIN_1, PIN_MODE_OUTPUT);
+/* 推手：伸出、缩回一次；伸出没到位时先缩回，这一件不算推出，流水线停在这里 */
+static void lane_push(Lane *lane)
+{
+    rt_err_t result;
 
-    if (!strcmp(cmd, "ENDPOINT_1"))
+    VLOG_D("Pusher %d moving forward\n", lane->id);
+    result = pusher_stroke(&lane->pusher, PUSHER_FORWARD);
+    if (result != RT_EOK)
     {
-        rt_kprintf("Command: ENDPOINT_1\n");
-        dir = 0;
-        delay_ms = 60000;
+        VLOG_E("Pusher %d forward stroke failed (%d)\n", lane->id, (int)result);
+        pusher_stroke(&lane->pusher, PUSHER_BACKWARD);
+        lane_finish(lane, VEND_EVENT_FAILED);
+        return;
     }
-    else if (!strcmp(cmd, "EXHIBIT_1"))
+    lane_progress(lane, VEND_EVENT_PUSH_DONE);
+
+    VLOG_D("Pusher %d moving backward\n", lane->id);
+    result = pusher_stroke(&lane->pusher, PUSHER_BACKWARD);
+    if (result != RT_EOK)
     {
-        rt_kprintf("Command: EXHIBIT_1\n");
-        dir = 1;
-        delay_ms = 4360;
+        VLOG_E("Pusher %d backward stroke failed (%d)\n", lane->id, (int)result);
+        lane_finish(lane, VEND_EVENT_FAILED);
+        return;
     }
-    else if (!strcmp(cmd, "OUT1_1"))
+
+    VLOG_I("Pusher %d completed one round trip\n", lane->id);
+    lane_finish(lane, VEND_EVENT_RETURN_DONE);
+}
+
+/* 零点开关中断：变到等待的电平时让滑台刹车停下 */
+static void lane_home_irq(void *args)
+{
+    Lane *lane = (Lane *)args;
+
+    if (rt_pin_read(lane->cfg->home_pin) == lane->home_wait)
+        slide_axis_stop(&lane->axis);
+}
+
+/*
+ * 回零：快速后退到零点开关动作，再前进到开关释放，之后位置即为
+ * SLIDE_HOME_OFFSET 加上释放后刹车多走的步数。已在开关上时直接前进。
+ */
+static rt_err_t lane_home(Lane *lane)
+{
+    const LaneConfig *cfg = lane->cfg;
+    SlideAxis *axis = &lane->axis;
+    rt_int32_t moved, back;
+
+    rt_pin_irq_enable(cfg->home_pin, PIN_IRQ_ENABLE);
+    if (rt_pin_read(cfg->home_pin) == PIN_HIGH)
     {
-        rt_kprintf("Command: OUT1_1\n");
-        dir = 1;
-        delay_ms = 34020;
+        lane->home_wait = PIN_LOW;
+        rt_pin_write(cfg->dir_pin, 0);
+        moved = slide_axis_move(axis, SLIDE_HOMING_STEPS, SLIDE_RPM_TO_SPS(cfg->homing_rpm));
+        if (axis->stopped_at < 0)
+        {
+            /* 没有开关：已和原先一样后退满全程，顶在零点上 */
+            rt_pin_irq_enable(cfg->home_pin, PIN_IRQ_DISABLE);
+            VLOG_W("Slide %d home switch not found\n", lane->id);
+            lane->pos = 0;
+            return RT_EOK;
+        }
+
+        /* 开关动作后刹车走的步数，超出 SLIDE_HOME_OFFSET 的部分顶在零点上没有走 */
+        back = moved - axis->stopped_at;
+        if (back > SLIDE_HOME_OFFSET)
+            back = SLIDE_HOME_OFFSET;
+
+        /* 刹车没走出 SLIDE_HOME_CREEP 步时不用快进，直接慢速前进 */
+        if (back > SLIDE_HOME_CREEP)
+        {
+            lane->home_wait = PIN_HIGH;
+            rt_pin_write(cfg->dir_pin, 1);
+            moved = slide_axis_move(axis, back - SLIDE_HOME_CREEP, 0);
+            if (axis->stopped_at >= 0)
+            {
+                rt_pin_irq_enable(cfg->home_pin, PIN_IRQ_DISABLE);
+                lane->pos = SLIDE_HOME_OFFSET + moved - axis->stopped_at;
+                return RT_EOK;
+            }
+        }
     }
-    else if (!strcmp(cmd, "TRANSPORT_1"))
+
+    /* 以起停速度前进，开关一释放下一步即停 */
+    lane->home_wait = PIN_HIGH;
+    rt_pin_write(cfg->dir_pin, 1);
+    moved = slide_axis_move(axis, SLIDE_HOME_OFFSET + SLIDE_HOME_CREEP, axis->profile.start_speed);
+    rt_pin_irq_enable(cfg->home_pin, PIN_IRQ_DISABLE);
+    if (axis->stopped_at < 0)
     {
-        rt_kprintf("Command: TRANSPORT_1\n");
-        dir = 1;
-        delay_ms = 6000;
+        VLOG_E("Slide %d home switch stuck\n", lane->id);
+        return -RT_ERROR;
     }
-    else if (!strcmp(cmd, "OUT2_1"))
+    lane->pos = SLIDE_HOME_OFFSET + moved - axis->stopped_at;
+    return RT_EOK;
+}
+
+/*
+ * 开始运动前作废闪存里的位置。写不进去时不能动：断电后启动会信任一个
+ * 滑台已经离开的位置。
+ */
+static rt_bool_t lane_pos_begin(Lane *lane)
+{
+    if (slide_pos_begin(lane->id) == RT_EOK)
+        return RT_TRUE;
+    VLOG_E("Slide %d position log write failed, not moving\n", lane->id);
+    lane_finish(lane, VEND_EVENT_FAILED);
+    return RT_FALSE;
+}
+
+/* 滑台：执行一条位置命令；开始运动前作废闪存里的位置，停稳后再记下 */
+static void lane_slide(Lane *lane, LaneCmd cmd)
+{
+    rt_uint8_t dir = 1;
+    rt_int32_t steps = 0;
+    rt_int32_t moved = 0;
+    rt_int32_t target = 0;
+
+    if (lane->axis.pwm == RT_NULL)
     {
-        rt_kprintf("Command: OUT2_1\n");
-        dir = 1;
-        delay_ms = 17590;
+        VLOG_E("PWM device %s not found!\n", lane->cfg->pwm_name);
+        lane_finish(lane, VEND_EVENT_FAILED);
+        return;
     }
-    else if (!strcmp(cmd, "EXIT_1"))
+
+    rt_pin_mode(lane->cfg->dir_pin, PIN_MODE_OUTPUT);
+    VLOG_I("Command: %s_%d\n", lane_cmd_names[cmd], lane->id);
+
+    if (cmd == LANE_CMD_EXIT)
     {
-        rt_kprintf("Command: EXIT_1\n");
-        rt_pwm_disable(pwm_dev_1, PWM_DEV_CHANNEL_1);
-        rt_kprintf("Slide 1 stopped\n");
-        operation_in_progress = RT_FALSE;
+        rt_pwm_disable(lane->axis.pwm, lane->cfg->pwm_channel);
+        VLOG_I("Slide %d stopped\n", lane->id);
+        lane_finish(lane, VEND_EVENT_SLIDE_DONE);
         return;
     }
-    else
+    if (cmd >= LANE_POS_COUNT && cmd != LANE_CMD_MOVE)
     {
-        rt_kprintf("Unknown command for Slide 1: %s\n", cmd);
-        operation_in_progress = RT_FALSE;
+        VLOG_E("Unknown command for Slide %d: %s\n", lane->id, lane_cmd_names[cmd]);
+        lane_finish(lane, VEND_EVENT_FAILED);
         return;
     }
 
-    rt_pin_write(DIR_PIN_1, dir);
+    if (cmd == LANE_CMD_ENDPOINT)
+    {
+        /* 回零：位置未知，找零点开关 */
+        if (!lane_pos_begin(lane))
+            return;
+        if (lane_home(lane) != RT_EOK)
+        {
+            lane_finish(lane, VEND_EVENT_FAILED);
+            return;
+        }
+    }
+    else
+    {
+        /* 从当前位置走到目标位置，只走剩余距离 */
+        rt_int32_t distance;
 
-    rt_uint32_t rpm = 200;
-    period = 60 * 1000000000ULL / (rpm * 400);
-    pulse = period / 2;
-    rt_pwm_set(pwm_dev_1, PWM_DEV_CHANNEL_1, period, pulse);
-    rt_pwm_enable(pwm_dev_1, PWM_DEV_CHANNEL_1);
+        target = cmd == LANE_CMD_MOVE ? lane->move_target : lane->positions[cmd];
+        distance = target - lane->pos;
+        if (distance == 0)
+        {
+            VLOG_I("Slide %d already at %s\n", lane->id, lane_cmd_names[cmd]);
+            lane_finish(lane, VEND_EVENT_SLIDE_DONE);
+            return;
+        }
+        dir = distance > 0 ? 1 : 0;
+        steps = distance > 0 ? distance : -distance;
 
-    rt_thread_mdelay(delay_ms);
+        if (!lane_pos_begin(lane))
+            return;
+        rt_pin_write(lane->cfg->dir_pin, dir);
 
-    rt_pwm_disable(pwm_dev_1, PWM_DEV_CHANNEL_1);
-    rt_kprintf("Slide 1 movement complete, ready for next command\n");
+        /* 加减速和到位停止由 slide_motion 在定时器中断里完成；中途被停下时按实际走的步数记位置 */
+        moved = slide_axis_move(&lane->axis, steps, 0);
+        lane->pos += dir ? moved : -moved;
+    }
 
-    if (slide_thread_1)
+    slide_pos_commit(lane->id, lane->pos);
+    if (moved != steps)
     {
-        slide_thread_1 = RT_NULL;
+        VLOG_E("Slide %d stopped at %d, %d of %d steps\n", lane->id, lane->pos, moved, steps);
+        lane_finish(lane, VEND_EVENT_FAILED);
+        return;
     }
-
-    rt_kprintf("\nmsh > ");
-    operation_in_progress = RT_FALSE;
+    VLOG_I("Slide %d movement complete, ready for next command\n", lane->id);
+    lane_finish(lane, VEND_EVENT_SLIDE_DONE);
 }
 
-/* 第一组推手控制命令 */
-static int push_sample_1(int argc, char *argv[])
+/* 本组工作线程：上电即启动，之后一直等邮箱里的命令 */
+static void lane_worker_thread(void *parameter)
 {
-    if (push_thread_1 && (push_thread_1->stat != RT_THREAD_CLOSE) || operation_in_progress)
+    Lane *lane = (Lane *)parameter;
+    rt_ubase_t cmd;
+
+    while (1)
     {
-        rt_kprintf("Pusher 1 operation in progress\n");
-        return RT_ERROR;
+        if (rt_mb_recv(&lane->mailbox, &cmd, RT_WAITING_FOREVER) != RT_EOK)
+            continue;
+
+        vend_trace(TRACE_THREAD, (rt_uint8_t)lane->id, (rt_uint16_t)cmd);
+        if (cmd == LANE_CMD_PUSH_CTRL)
+            lane_push(lane);
+        else
+            lane_slide(lane, (LaneCmd)cmd);
+        vend_trace(TRACE_DONE, (rt_uint8_t)lane->id, (rt_uint16_t)cmd);
     }
+}
+
+/* 按描述表初始化各组：速度曲线发生器、滑台轴、推手和工作线程 */
+static void lane_setup(void)
+{
+    rt_bool_t motion = slide_motion_init() == RT_EOK;
 
-    push_completed_1 = RT_FALSE;
-    operation_in_progress = RT_TRUE;
-    push_thread_1 = rt_thread_create("push_ctrl_1",
-                                     push_control_thread_1,
-                                     RT_NULL,
-                                     1024,
-                                     20,
-                                     10);
-    if (push_thread_1 != RT_NULL)
+    for (int i = 0; i < LANE_COUNT; i++)
     {
-        rt_thread_startup(push_thread_1);
-        return RT_EOK;
+        Lane *lane = &lanes[i];
+        const LaneConfig *cfg = &lane_configs[i];
+
+        lane->cfg = cfg;
+        lane->id = i + 1;
+        lane->state = GROUP_IDLE;
+        lane->pos = 0;
+        memcpy(lane->positions, cfg->positions, sizeof(lane->positions));
+        if (slide_cal_get(lane->id, lane->positions, LANE_POS_COUNT))
+            VLOG_I("Slide %d using calibrated positions\n", lane->id);
+        lane->move_target = 0;
+        lane->vend_line = RT_NULL;
+        lane->vend_stage = VEND_STAGE_NONE;
+        memset(&lane->progress, 0, sizeof(lane->progress));
+        lane->order_count = 0;
+        lane->sweep = 1;
+
+        if (motion)
+        {
+            SlideProfile profile;
+
+            profile.start_speed = SLIDE_RPM_TO_SPS(cfg->start_rpm);
+            profile.max_speed = SLIDE_RPM_TO_SPS(cfg->max_rpm);
+            profile.accel = cfg->accel;
+            slide_axis_init(&lane->axis, cfg->pwm_name, cfg->pwm_channel, &profile);
+        }
+
+        /* 零点开关只在回零时打开中断 */
+        rt_pin_mode(cfg->home_pin, PIN_MODE_INPUT_PULLUP);
+        rt_pin_attach_irq(cfg->home_pin, PIN_IRQ_MODE_RISING_FALLING, lane_home_irq, lane);
+
+        /* 到位开关和堵转电流任一触发即停 */
+        rt_snprintf(lane->pusher_name, sizeof(lane->pusher_name), "pusher%d", lane->id);
+        pusher_init(&lane->pusher, lane->pusher_name, &cfg->pusher);
+
+        /* 控制块、栈和邮箱都是静态的，出货路径上不再申请堆内存 */
+        rt_snprintf(lane->worker_name, sizeof(lane->worker_name), "lane_%d", lane->id);
+        rt_mb_init(&lane->mailbox, lane->worker_name, lane->mailbox_pool,
+                   LANE_MAILBOX_LEN, RT_IPC_FLAG_FIFO);
+        if (rt_thread_init(&lane->worker, lane->worker_name, lane_worker_thread, lane,
+                           lane_stacks[i], sizeof(lane_stacks[i]),
+                           LANE_WORKER_PRIO, 10) != RT_EOK)
+        {
+            rt_kprintf("Failed to start %s thread.\n", lane->worker_name);
+            lane->worker.entry = RT_NULL;
+            continue;
+        }
+        rt_thread_startup(&lane->worker);
     }
-    else
+}
+
+/* 把命令投给本组工作线程，不等待；本组的占用由调用者负责 */
+static int lane_post(Lane *lane, LaneCmd cmd)
+{
+    vend_trace(TRACE_DISPATCH, (rt_uint8_t)lane->id, (rt_uint16_t)cmd);
+    if (lane->worker.entry == RT_NULL ||
+        rt_mb_send(&lane->mailbox, (rt_ubase_t)cmd) != RT_EOK)
     {
-        rt_kprintf("Failed to start Pusher 1 thread.\n");
-        operation_in_progress = RT_FALSE;
+        rt_kprintf("Failed to post %s_%d.\n", lane_cmd_names[cmd], lane->id);
         return RT_ERROR;
     }
+    return RT_EOK;
 }
 
-/* 第一组统一的滑台控制命令实现 */
-static int slide_command_1(const char *cmd)
+static int push_start(Lane *lane)
 {
-    if (slide_thread_1 && (slide_thread_1->stat != RT_THREAD_CLOSE) || operation_in_progress)
+    return lane_post(lane, LANE_CMD_PUSH_CTRL);
+}
+
+static int slide_start(Lane *lane, LaneCmd cmd)
+{
+    return lane_post(lane, cmd);
+}
+
+/* 单独执行一条命令，占用本组直到动作结束 */
+static int lane_command(Lane *lane, LaneCmd cmd)
+{
+    rt_bool_t push = cmd == LANE_CMD_PUSH_CTRL;
+
+    if (!group_claim(&lane->state, push ? GROUP_PUSH : GROUP_SLIDE))
     {
-        rt_kprintf("Previous Slide 1 operation still running.\n");
+        if (push)
+            rt_kprintf("Pusher %d operation in progress\n", lane->id);
+        else
+            rt_kprintf("Previous Slide %d operation still running.\n", lane->id);
         return RT_ERROR;
     }
 
-    operation_in_progress = RT_TRUE;
-    slide_thread_1 = rt_thread_create("slide_ctrl_1",
-                                      slide_control_thread_1,
-                                      (void *)cmd,
-                                      1024,
-                                      20,
-                                      10);
-    if (slide_thread_1 != RT_NULL)
+    if ((push ? push_start(lane) : slide_start(lane, cmd)) != RT_EOK)
     {
-        rt_thread_startup(slide_thread_1);
-        return RT_EOK;
+        group_release(&lane->state);
+        return RT_ERROR;
     }
-    else
+    return RT_EOK;
+}
+
+/*
+ * 位置校准：先回零，再依次把滑台走到各定位命令原来的位置，由操作者用
+ * 上下键（或 SLIDE_CAL jog）点动对准后用选择键（或 SLIDE_CAL ok）确认。
+ * 全部确认后写进闪存的校准表，立即生效。校准期间本组被占用，下的单排
+ * 队等校准结束。
+ */
+#define CAL_JOG_FINE        10      // 点按一次走的步数
+#define CAL_JOG_COARSE      200     // 长按连发时每次走的步数
+
+/*
+ * 校准会话：同一时刻只校准一组。按键在界面线程、SLIDE_CAL 在 shell 线程、
+ * 移动结束在工作线程，会话状态都在 cal_lock 下读写；cal_moves 还要在
+ * 中断保护下计数，见 cal_move。
+ */
+static struct rt_semaphore cal_lock;
+static Lane *cal_lane = RT_NULL;
+static int cal_point;                               // 正在对准的定位命令
+static rt_int32_t cal_positions[LANE_POS_COUNT];    // 已确认的位置
+static volatile int cal_moves = 0;                  // 已投出、尚未走完的移动
+static rt_bool_t cal_closing = RT_FALSE;            // 会话已结束，在途移动走完即释放本组
+
+static void cal_report(Lane *lane)
+{
+    ui_notify(&ui_cal_changes, lane->id);
+}
+
+/* 释放本组，告诉执行线程可以做排着的单；持有 cal_lock 时调用 */
+static void cal_release(Lane *lane)
+{
+    cal_lane = RT_NULL;
+    group_release(&lane->state);
+    vend_notify(lane, 0);
+}
+
+/* 工作线程：校准中的一段移动走完 */
+static void cal_move_done(Lane *lane)
+{
+    rt_bool_t release;
+    rt_base_t level = rt_hw_interrupt_disable();
+
+    release = --cal_moves == 0 && cal_closing;
+    rt_hw_interrupt_enable(level);
+
+    cal_report(lane);
+    if (release)
     {
-        rt_kprintf("Failed to start Slide 1 thread.\n");
-        operation_in_progress = RT_FALSE;
-        return RT_ERROR;
+        rt_sem_take(&cal_lock, RT_WAITING_FOREVER);
+        cal_release(lane);
+        rt_sem_release(&cal_lock);
+    }
+}
+
+/* 走到 target；已有一条在排队时只改目标，排着的那条会走到最新的目标 */
+static void cal_move(Lane *lane, rt_int32_t target)
+{
+    rt_bool_t post;
+    rt_base_t level;
+
+    if (target < 0)
+        target = 0;
+    if (target > SLIDE_HOMING_STEPS)
+        target = SLIDE_HOMING_STEPS;
+
+    level = rt_hw_interrupt_disable();
+    lane->move_target = target;
+    post = cal_moves < LANE_MAILBOX_LEN;
+    if (post)
+        cal_moves++;
+    rt_hw_interrupt_enable(level);
+
+    if (post && lane_post(lane, LANE_CMD_MOVE) != RT_EOK)
+    {
+        level = rt_hw_interrupt_disable();
+        cal_moves--;
+        rt_hw_interrupt_enable(level);
     }
 }
 
-/* 第二组推手控制线程 */
-static void push_control_thread_2(void *parameter)
+/* 结束会话：没有在途移动时立即释放本组，否则由最后一段移动释放；持有 cal_lock 时调用 */
+static void cal_close(Lane *lane)
 {
-    rt_pin_mode(PUSH_IN3_PIN_2, PIN_MODE_OUTPUT);
-    rt_pin_mode(PUSH_IN4_PIN_2, PIN_MODE_OUTPUT);
+    rt_bool_t release;
+    rt_base_t level = rt_hw_interrupt_disable();
 
-    rt_uint8_t direction = 0;
-    rt_uint8_t move_count = 0;
+    cal_closing = RT_TRUE;
+    release = cal_moves == 0;
+    rt_hw_interrupt_enable(level);
 
-    while (1)
+    if (release)
+        cal_release(lane);
+    cal_report(lane);
+}
+
+/* 正在校准的组，没有会话或会话已结束时为 RT_NULL；持有 cal_lock 时调用 */
+static Lane *cal_open_lane(void)
+{
+    return cal_closing ? RT_NULL : cal_lane;
+}
+
+static rt_bool_t cal_active(void)
+{
+    rt_bool_t active;
+
+    rt_sem_take(&cal_lock, RT_WAITING_FOREVER);
+    active = cal_open_lane() != RT_NULL;
+    rt_sem_release(&cal_lock);
+    return active;
+}
+
+/* 界面和 shell 显示用：会话的一份快照，没有进行中的会话时返回 RT_FALSE */
+static rt_bool_t cal_status(int *id, int *point, rt_int32_t *target)
+{
+    Lane *lane;
+
+    rt_sem_take(&cal_lock, RT_WAITING_FOREVER);
+    lane = cal_open_lane();
+    if (lane != RT_NULL)
+    {
+        *id = lane->id;
+        *point = cal_point;
+        *target = lane->move_target;
+    }
+    rt_sem_release(&cal_lock);
+    return lane != RT_NULL;
+}
+
+static rt_err_t cal_start(int id)
+{
+    Lane *lane = &lanes[id - 1];
+    rt_err_t result = RT_EOK;
+
+    rt_sem_take(&cal_lock, RT_WAITING_FOREVER);
+    if (cal_lane != RT_NULL)
+    {
+        rt_kprintf("Slide %d calibration in progress\n", cal_lane->id);
+        result = -RT_EBUSY;
+    }
+    else if (!group_claim(&lane->state, GROUP_CAL))
+    {
+        rt_kprintf("Slide %d busy\n", id);
+        result = -RT_EBUSY;
+    }
+    else
     {
-        if (direction == 0)
+        cal_lane = lane;
+        cal_closing = RT_FALSE;
+        cal_moves = 1;
+        cal_point = LANE_CMD_EXHIBIT;
+        memcpy(cal_positions, lane->positions, sizeof(cal_positions));
+        if (lane_post(lane, LANE_CMD_ENDPOINT) != RT_EOK)
         {
-            rt_pin_write(PUSH_IN3_PIN_2, PIN_HIGH);
-            rt_pin_write(PUSH_IN4_PIN_2, PIN_LOW);
-            rt_kprintf("Pusher 2 moving forward\n");
+            cal_moves = 0;
+            cal_release(lane);
+            result = -RT_ERROR;
         }
         else
         {
-            rt_pin_write(PUSH_IN3_PIN_2, PIN_LOW);
-            rt_pin_write(PUSH_IN4_PIN_2, PIN_HIGH);
-            rt_kprintf("Pusher 2 moving backward\n");
-            move_count++;
+            cal_move(lane, lane->positions[cal_point]);
+            rt_kprintf("Calibrating slide %d: jog to %s, then confirm\n", id, lane_cmd_names[cal_point]);
         }
+    }
+    rt_sem_release(&cal_lock);
+    return result;
+}
 
-        direction = !direction;
-        rt_thread_mdelay(5500);
+/* 点动；没有进行中的会话时返回 RT_FALSE */
+static rt_bool_t cal_jog(rt_int32_t steps)
+{
+    Lane *lane;
+
+    rt_sem_take(&cal_lock, RT_WAITING_FOREVER);
+    lane = cal_open_lane();
+    if (lane != RT_NULL)
+        cal_move(lane, lane->move_target + steps);
+    rt_sem_release(&cal_lock);
+    return lane != RT_NULL;
+}
 
-        if (move_count >= 1)
-        {
-            rt_kprintf("Pusher 2 completed one round trip\n");
-            push_completed_2 = RT_TRUE;
+/*
+ * 确认滑台停下的位置，走到下一个；全部确认后存表生效。点动还没走完时
+ * 不确认，返回 -RT_EBUSY，免得记下一个滑台还没到的目标。
+ */
+static rt_err_t cal_confirm(void)
+{
+    Lane *lane;
 
-            rt_thread_t self = rt_thread_self();
-            self->stat = RT_THREAD_CLOSE;
-            operation_in_progress = RT_FALSE;
-            return;
+    rt_sem_take(&cal_lock, RT_WAITING_FOREVER);
+    lane = cal_open_lane();
+    if (lane == RT_NULL || cal_moves != 0)
+    {
+        rt_sem_release(&cal_lock);
+        return lane == RT_NULL ? -RT_ERROR : -RT_EBUSY;
+    }
+
+    cal_positions[cal_point] = lane->pos;
+    rt_kprintf("Slide %d %s = %d steps\n", lane->id, lane_cmd_names[cal_point],
+               (int)cal_positions[cal_point]);
+    if (++cal_point < LANE_POS_COUNT)
+    {
+        cal_move(lane, lane->positions[cal_point]);
+        rt_kprintf("Jog to %s, then confirm\n", lane_cmd_names[cal_point]);
+    }
+    else
+    {
+        if (slide_cal_save(lane->id, cal_positions, LANE_POS_COUNT) == RT_EOK)
+        {
+            memcpy(lane->positions, cal_positions, sizeof(lane->positions));
+            rt_kprintf("Slide %d calibration saved\n", lane->id);
         }
+        else
+        {
+            rt_kprintf("Slide %d calibration save failed\n", lane->id);
+        }
+        cal_close(lane);
     }
+    rt_sem_release(&cal_lock);
+    return RT_EOK;
 }
 
-/* 第二组滑台控制线程 */
-static void slide_control_thread_2(void *parameter)
+static void cal_abort(void)
 {
-    const char *cmd = (const char *)parameter;
-    rt_uint32_t period, pulse;
-    rt_uint8_t dir = 1;
-    rt_int32_t delay_ms = 0;
+    Lane *lane;
 
-    if (pwm_dev_2 == RT_NULL)
+    rt_sem_take(&cal_lock, RT_WAITING_FOREVER);
+    lane = cal_open_lane();
+    if (lane != RT_NULL)
     {
-        pwm_dev_2 = (struct rt_device_pwm *)rt_device_find(PWM_DEV_NAME_2);
-        if (pwm_dev_2 == RT_NULL)
-        {
-            rt_kprintf("PWM device %s not found!\n", PWM_DEV_NAME_2);
-            operation_in_progress = RT_FALSE;
-            return;
-        }
+        rt_kprintf("Slide %d calibration aborted\n", lane->id);
+        cal_close(lane);
+    }
+    rt_sem_release(&cal_lock);
+}
+
+/* 通知界面某组库存有变化；补货时一条接一条地到，合并成一次 */
+static void stock_report(int group)
+{
+    ui_notify(&ui_stock_changes, group);
+}
+
+/* 向界面报告进度和排队数：界面取的是本组最新的状态，中间经过的进度可能不画 */
+static void vend_report(Lane *lane, rt_uint8_t stage)
+{
+    rt_base_t level;
+
+    lane->vend_stage = stage;
+    level = rt_hw_interrupt_disable();
+    lane->progress.stage = stage;
+    lane->progress.pending = (rt_uint8_t)lane->order_count;
+    lane->progress.unit = lane->vend_unit;
+    lane->progress.quantity = lane->vend_quantity;
+    rt_hw_interrupt_enable(level);
+    ui_notify(&ui_vend_changes, lane->id);
+}
+
+/* 结束本组的流水线：先释放本组，再由执行线程从队列里取下一单 */
+static void vend_end(Lane *lane, rt_uint8_t stage)
+{
+    lane->vend_line = RT_NULL;
+    group_release(&lane->state);
+    vend_report(lane, stage);
+    lane->vend_unit = 0;
+    lane->vend_quantity = 0;
+}
+
+/* 开始一单：先走滑台，出货命令到位后再推 */
+static void vend_begin(const TextLine *line, rt_uint8_t quantity)
+{
+    Lane *lane = &lanes[line->device_group - 1];
+
+    lane->vend_line = line;
+    lane->vend_quantity = quantity;
+    lane->vend_unit = 0;
+    if (slide_start(lane, line->command) != RT_EOK)
+    {
+        vend_end(lane, VEND_STAGE_FAILED);
+        return;
     }
+    vend_report(lane, VEND_STAGE_SLIDE);
+}
 
-    rt_pin_mode(DIR_PIN_2, PIN_MODE_OUTPUT);
+/* 推下一件，滑台留在原位 */
+static void vend_push_next(Lane *lane)
+{
+    lane->vend_unit++;
+    if (push_start(lane) != RT_EOK)
+        vend_end(lane, VEND_STAGE_FAILED);
+    else
+        vend_report(lane, VEND_STAGE_PUSH);
+}
+
+/* 某组一段动作结束，排下一段 */
+static void vend_step(Lane *lane, rt_uint32_t set)
+{
+    const TextLine *line = lane->vend_line;
 
-    if (!strcmp(cmd, "ENDPOINT_2"))
+    if (line == RT_NULL)
+        return;
+
+    if (set & VEND_EVENT_FAILED)
+    {
+        VLOG_W("Vend %s_%d aborted\n", lane_cmd_names[line->command], lane->id);
+        vend_end(lane, VEND_STAGE_FAILED);
+    }
+    else if (set & VEND_EVENT_SLIDE_DONE)
+    {
+        if (!TEXT_LINE_SELLS(line))
+            vend_end(lane, VEND_STAGE_DONE);
+        else
+            vend_push_next(lane);
+    }
+    else if (set & VEND_EVENT_PUSH_DONE)
     {
-        rt_kprintf("Command: ENDPOINT_2\n");
-        dir = 0;
-        delay_ms = 60000;
+        /* 伸出碰到到位开关才报 PUSH_DONE，这时才记账，记在本组最老的批次上 */
+        if (inventory_vend(lane->id) == RT_EOK)
+            stock_report(lane->id);
+        vend_report(lane, VEND_STAGE_RETURN);
     }
-    else if (!strcmp(cmd, "EXHIBIT_2"))
+    else if ((set & VEND_EVENT_RETURN_DONE) && lane->vend_unit < lane->vend_quantity)
     {
-        rt_kprintf("Command: EXHIBIT_2\n");
-        dir = 1;
-        delay_ms = 4360;
+        VLOG_I("Vend %s_%d unit %d/%d delivered\n", lane_cmd_names[line->command], lane->id,
+               lane->vend_unit, lane->vend_quantity);
+        vend_push_next(lane);
     }
-    else if (!strcmp(cmd, "OUT1_2"))
+    else if (set & VEND_EVENT_RETURN_DONE)
     {
-        rt_kprintf("Command: OUT1_2\n");
-        dir = 1;
-        delay_ms = 28920;
+        VLOG_I("Vend %s_%d complete\n", lane_cmd_names[line->command], lane->id);
+        vend_end(lane, VEND_STAGE_DONE);
     }
-    else if (!strcmp(cmd, "TRANSPORT_2"))
+}
+
+/* 订单的目标位置；不是定位命令的按原地处理 */
+static rt_int32_t lane_order_target(const Lane *lane, const LaneOrder *order)
+{
+    LaneCmd cmd = order->line->command;
+
+    return cmd < LANE_POS_COUNT ? lane->positions[cmd] : lane->pos;
+}
+
+static int lane_order_bypass = LANE_ORDER_BYPASS;
+
+/*
+ * 选下一单（电梯算法）：沿当前扫描方向取最近的目标，同一位置先到先做，
+ * 这个方向上没有了再掉头。被插队次数到上限的订单优先，按到达顺序取，
+ * 所以每单最多等 LANE_ORDER_BYPASS 次插队加上排在它前面的订单数。
+ */
+static int lane_order_pick(Lane *lane)
+{
+    int best = -1;
+    rt_int32_t best_distance = 0;
+
+    for (int i = 0; i < lane->order_count; i++)
     {
-        rt_kprintf("Command: TRANSPORT_2\n");
-        dir = 1;
-        delay_ms = 6890;
+        if (lane->orders[i].bypassed >= lane_order_bypass)
+            return i;
     }
-    else if (!strcmp(cmd, "OUT2_2"))
+
+    for (int pass = 0; pass < 2 && best < 0; pass++)
     {
-        rt_kprintf("Command: OUT2_2\n");
-        dir = 1;
-        delay_ms = 17590;
+        if (pass == 1)
+            lane->sweep = -lane->sweep;
+
+        for (int i = 0; i < lane->order_count; i++)
+        {
+            rt_int32_t distance = (lane_order_target(lane, &lane->orders[i]) - lane->pos) * lane->sweep;
+
+            if (distance >= 0 && (best < 0 || distance < best_distance))
+            {
+                best = i;
+                best_distance = distance;
+            }
+        }
     }
-    else if (!strcmp(cmd, "EXIT_2"))
+    return best;
+}
+
+/* 本组空闲且有订单时取一单开始；手动命令占着本组时先留在队列里 */
+static void vend_dispatch(Lane *lane)
+{
+    const TextLine *line;
+    rt_uint8_t quantity;
+    int pick;
+
+    if (lane->vend_line != RT_NULL || lane->order_count == 0)
+        return;
+    if (!group_claim(&lane->state, GROUP_VEND))
     {
-        rt_kprintf("Command: EXIT_2\n");
-        rt_pwm_disable(pwm_dev_2, PWM_DEV_CHANNEL_2);
-        rt_kprintf("Slide 2 stopped\n");
-        operation_in_progress = RT_FALSE;
+        vend_report(lane, VEND_STAGE_QUEUED);
         return;
     }
-    else
+
+    pick = lane_order_pick(lane);
+    line = lane->orders[pick].line;
+    quantity = lane->orders[pick].quantity;
+    for (int i = 0; i < pick; i++)
+        lane->orders[i].bypassed++;
+    for (int i = pick; i < lane->order_count - 1; i++)
+        lane->orders[i] = lane->orders[i + 1];
+    lane->order_count--;
+
+    vend_begin(line, quantity);
+}
+
+/* 订单入队；队列满时拒绝，界面上的排队数停在上限 */
+static void vend_enqueue(const TextLine *line, rt_uint8_t quantity)
+{
+    Lane *lane = &lanes[line->device_group - 1];
+
+    if (lane->order_count >= LANE_ORDER_MAX)
     {
-        rt_kprintf("Unknown command for Slide 2: %s\n", cmd);
-        operation_in_progress = RT_FALSE;
+        rt_kprintf("Lane %d order queue full\n", lane->id);
         return;
     }
+    lane->orders[lane->order_count].line = line;
+    lane->orders[lane->order_count].quantity = quantity;
+    lane->orders[lane->order_count].bypassed = 0;
+    lane->order_count++;
 
-    rt_pin_write(DIR_PIN_2, dir);
+    if (lane->vend_line != RT_NULL)
+        vend_report(lane, lane->vend_stage);
+}
 
-    rt_uint32_t rpm = 200;
-    period = 60 * 1000000000ULL / (rpm * 400);
-    pulse = period / 2;
-    rt_pwm_set(pwm_dev_2, PWM_DEV_CHANNEL_2, period, pulse);
-    rt_pwm_enable(pwm_dev_2, PWM_DEV_CHANNEL_2);
+/*
+ * 出货执行线程：从队列取界面的订单和各段的完成通知，两组的订单队列和
+ * 流水线都在这里推进。每一步只是向工作线程投递命令或发消息，不会阻塞，
+ * 一组在运动时另一组的订单照样立即开始；每条消息处理完都看一眼本组
+ * 能否接着做下一单。
+ */
+static void vend_exec_thread(void *parameter)
+{
+    VendMsg msg;
 
-    rt_thread_mdelay(delay_ms);
+    while (1)
+    {
+        if (rt_mq_recv(&vend_mq, &msg, sizeof(msg), RT_WAITING_FOREVER) != RT_EOK)
+            continue;
 
-    rt_pwm_disable(pwm_dev_2, PWM_DEV_CHANNEL_2);
-    rt_kprintf("Slide 2 movement complete, ready for next command\n");
+        if (msg.type == VEND_MSG_REQUEST)
+            vend_enqueue(msg.line, msg.quantity);
+        else
+            vend_step(&lanes[msg.group - 1], msg.set);
+        vend_dispatch(&lanes[msg.group - 1]);
+    }
+}
 
-    if (slide_thread_2)
+/* 下单：交给执行线程排队，本组忙时也不丢；只有出货行才按件数推多次 */
+static int vend_command(const TextLine *line, int quantity)
+{
+    VendMsg msg;
+
+    if (!TEXT_LINE_SELLS(line) || quantity < 1)
+        quantity = 1;
+    if (quantity > VEND_QTY_MAX)
+        quantity = VEND_QTY_MAX;
+
+    msg.type = VEND_MSG_REQUEST;
+    msg.group = line->device_group;
+    msg.quantity = quantity;
+    msg.set = 0;
+    msg.line = line;
+    if (rt_mq_send(&vend_mq, &msg, sizeof(msg)) != RT_EOK)
     {
-        slide_thread_2 = RT_NULL;
+        rt_kprintf("Vend queue full\n");
+        return RT_ERROR;
     }
+    return RT_EOK;
+}
+
+static struct rt_thread vend_thread;
+static ALIGN(RT_ALIGN_SIZE) rt_uint8_t vend_thread_stack[1024];
 
-    rt_kprintf("\nmsh > ");
-    operation_in_progress = RT_FALSE;
+/* 初始化出货队列并启动执行线程 */
+static void vend_setup(void)
+{
+    rt_mq_init(&vend_mq, "vend", vend_mq_pool, sizeof(VendMsg),
+               sizeof(vend_mq_pool), RT_IPC_FLAG_FIFO);
+
+    if (rt_thread_init(&vend_thread,
+                       "vend_exec",
+                       vend_exec_thread,
+                       RT_NULL,
+                       vend_thread_stack,
+                       sizeof(vend_thread_stack),
+                       15,
+                       10) != RT_EOK)
+    {
+        rt_kprintf("Failed to start vend thread.\n");
+        return;
+    }
+    rt_thread_startup(&vend_thread);
 }
 
-/* 第二组推手控制命令 */
-static int push_sample_2(int argc, char *argv[])
+/*
+ * 上电：上次停稳时记下的位置可信就直接用，否则回零。零点开关动作着说明
+ * 滑台不在记下的位置上（断电后被推动过），同样回零。回零期间本组被占用，
+ * 下的单排队等它做完。
+ */
+static void lane_boot(void)
 {
-    if (push_thread_2 && (push_thread_2->stat != RT_THREAD_CLOSE) || operation_in_progress)
+    for (int i = 0; i < LANE_COUNT; i++)
     {
-        rt_kprintf("Pusher 2 operation in progress\n");
-        return RT_ERROR;
+        Lane *lane = &lanes[i];
+
+        if (slide_pos_saved(lane->id, &lane->pos) &&
+            rt_pin_read(lane->cfg->home_pin) == PIN_HIGH)
+        {
+            VLOG_I("Slide %d at %d steps, no homing needed\n", lane->id, lane->pos);
+            continue;
+        }
+        lane->pos = 0;
+        lane_command(lane, LANE_CMD_ENDPOINT);
+    }
+}
+
+static rt_uint8_t lane_stage[LANE_COUNT];       // 每组当前显示的进度
+static rt_uint8_t lane_pending[LANE_COUNT];     // 每组还在排队的订单数
+static rt_uint8_t lane_unit[LANE_COUNT];        // 每组正在出第几件
+static rt_uint8_t lane_quantity[LANE_COUNT];    // 每组这一单的件数
+
+/* 商品名行右侧的库存数 */
+#define STOCK_X             150
+#define STOCK_REFRESH_MS    200     // 库存数最快的重画间隔
+
+static rt_uint32_t stock_stale = 0;     // 库存数待重画的组（按组号的位图）
+static rt_tick_t stock_refresh_tick;    // 下次允许重画的时刻
+
+static int order_quantity = 0;          // 正在选数量时为当前件数，0 表示没在选
+static rt_bool_t select_held = RT_FALSE;    // 选择键本次按下已触发长按
+static void show_cal(void);
+static rt_tick_t lane_clear_tick[LANE_COUNT];   // 完成或失败信息到期的时刻
+
+/* 重绘回调：按当前状态画出整个界面，渲染层只取落在脏区域里的部分 */
+static void ui_paint(void) {
+    lcd_render_text(10, 10, 24, WHITE, "Vending Machine");
+    lcd_render_fill(0, 40, LCD_W - 1, 40, WHITE);
+
+    for (int i = 0; i < LINE_COUNT; i++) {
+        int y = text_lines[i].y;
+        rt_bool_t selected = i == cursor_idx;
+
+        lcd_render_text(10, y, 16, selected ? RED : WHITE, text_lines[i].text);
+        if (text_lines[i].command == LANE_CMD_EXHIBIT) {
+            char stock[12];
+            rt_snprintf(stock, sizeof(stock), "%d left", (int)inventory_stock(text_lines[i].device_group));
+            lcd_render_text(STOCK_X, y, 16, selected ? RED : WHITE, stock);
+        }
+        if (selected && order_quantity > 0) {
+            char qty[8];
+            rt_snprintf(qty, sizeof(qty), "x%d", order_quantity);
+            lcd_render_text(190, y, 16, RED, qty);
+        }
+        if (selected) {
+            lcd_render_rect(10, y - 2, 230, y + 18, RED); // 光标框：文字整格画出，框放最后以免被盖住
+        }
+    }
+
+    /* 校准时状态栏只显示正在对准的位置 */
+    int cal_id, cal_at;
+    rt_int32_t cal_target;
+    if (cal_status(&cal_id, &cal_at, &cal_target)) {
+        char text[32];
+        rt_snprintf(text, sizeof(text), "Cal %d %s: %d", cal_id, lane_cmd_names[cal_at], (int)cal_target);
+        lcd_render_text(10, STATUS_Y, 16, RED, text);
+        lcd_render_text(10, STATUS_Y + 16, 16, WHITE, STATUS_CAL_HINT);
+        return;
+    }
+
+    /* 有进度的组依次各占一行，放不下的不显示；都没有时显示提示语 */
+    int y = STATUS_Y;
+    for (int i = 0; i < LANE_COUNT && y + 16 <= STATUS_Y + STATUS_H; i++) {
+        char text[32];
+
+        if (lane_stage[i] == VEND_STAGE_NONE) {
+            continue;
+        }
+        int n = rt_snprintf(text, sizeof(text), "Lane %d: %s", i + 1, vend_stage_text[lane_stage[i]]);
+        if (lane_quantity[i] > 1 && lane_unit[i] > 0 && lane_stage[i] != VEND_STAGE_DONE) {
+            n += rt_snprintf(text + n, sizeof(text) - n, " %d/%d", lane_unit[i], lane_quantity[i]);
+        }
+        if (lane_pending[i] > 0) {
+            rt_snprintf(text + n, sizeof(text) - n, " (+%d)", lane_pending[i]);
+        }
+        lcd_render_text(10, y, 16, lane_stage[i] == VEND_STAGE_FAILED ? RED : WHITE, text);
+        y += 16;
     }
+    if (y == STATUS_Y) {
+        lcd_render_text(10, STATUS_Y, 16, WHITE, order_quantity > 0 ? STATUS_QTY_HINT : STATUS_HINT);
+    }
+}
+
+/* 标记单行（含光标框）需要重画 */
+static void invalidate_line(int idx) {
+    int y = text_lines[idx].y;
+    lcd_render_invalidate(10, y - 2, 230, y + 18);
+}
+
+/* 移动光标：只重画新旧两行 */
+void move_cursor(int idx) {
+    invalidate_line(cursor_idx);
+    cursor_idx = idx;
+    invalidate_line(cursor_idx);
+    lcd_render_flush();
+}
+
+/* 显示某组的出货进度、件数和排队数：只重画状态栏 */
+void show_vend_progress(int group, rt_uint8_t stage, rt_uint8_t pending,
+                        rt_uint8_t unit, rt_uint8_t quantity) {
+    lane_stage[group - 1] = stage;
+    lane_pending[group - 1] = pending;
+    lane_unit[group - 1] = unit;
+    lane_quantity[group - 1] = quantity;
+    if (stage == VEND_STAGE_DONE || stage == VEND_STAGE_FAILED) {
+        lane_clear_tick[group - 1] = rt_tick_get() + rt_tick_from_millisecond(STATUS_HOLD_MS);
+    }
+    lcd_render_invalidate(0, STATUS_Y, LCD_W - 1, STATUS_Y + STATUS_H - 1);
+    lcd_render_flush();
+}
+
+/* 重画有变化的库存数，距上次重画不到 STOCK_REFRESH_MS 时留到以后 */
+static void stock_refresh(void) {
+    if (stock_stale == 0 || (rt_int32_t)(rt_tick_get() - stock_refresh_tick) < 0) {
+        return;
+    }
+    for (int i = 0; i < LINE_COUNT; i++) {
+        if ((stock_stale & (1u << text_lines[i].device_group)) &&
+            text_lines[i].command == LANE_CMD_EXHIBIT) {
+            lcd_render_invalidate(STOCK_X, text_lines[i].y, 229, text_lines[i].y + 15);
+        }
+    }
+    lcd_render_flush();
+    stock_stale = 0;
+    stock_refresh_tick = rt_tick_get() + rt_tick_from_millisecond(STOCK_REFRESH_MS);
+}
+
+/* 取走记下的变化：出货进度按各组当前的状态重画，库存数合并起来按间隔重画 */
+static void show_changes(void) {
+    rt_base_t level = rt_hw_interrupt_disable();
+    rt_uint32_t vend = ui_vend_changes;
+    rt_uint32_t stock = ui_stock_changes;
+    rt_uint32_t cal = ui_cal_changes;
+
+    ui_vend_changes = 0;
+    ui_stock_changes = 0;
+    ui_cal_changes = 0;
+    ui_change_sent = RT_FALSE;
+    rt_hw_interrupt_enable(level);
+
+    for (int i = 0; i < LANE_COUNT; i++) {
+        const Lane *lane = &lanes[i];
+        if (vend & (1u << lane->id)) {
+            VendProgress progress;
+
+            level = rt_hw_interrupt_disable();
+            progress = lane->progress;
+            rt_hw_interrupt_enable(level);
+            show_vend_progress(lane->id, progress.stage, progress.pending,
+                               progress.unit, progress.quantity);
+        }
+    }
+    if (stock != 0) {
+        stock_stale |= stock;
+        stock_refresh();
+    }
+    if (cal != 0) {
+        show_cal();
+    }
+}
+
+/* 到下一条完成信息过期或库存数该重画还有多久，都没有则一直等 */
+static rt_int32_t status_timeout(void) {
+    rt_int32_t timeout = RT_WAITING_FOREVER;
+
+    for (int i = 0; i < LANE_COUNT; i++) {
+        if (lane_stage[i] == VEND_STAGE_DONE || lane_stage[i] == VEND_STAGE_FAILED) {
+            rt_int32_t left = (rt_int32_t)(lane_clear_tick[i] - rt_tick_get());
+            if (left < 0) {
+                left = 0;
+            }
+            if (timeout == RT_WAITING_FOREVER || left < timeout) {
+                timeout = left;
+            }
+        }
+    }
+    if (stock_stale != 0) {
+        rt_int32_t left = (rt_int32_t)(stock_refresh_tick - rt_tick_get());
+        if (left < 0) {
+            left = 0;
+        }
+        if (timeout == RT_WAITING_FOREVER || left < timeout) {
+            timeout = left;
+        }
+    }
+    return timeout;
+}
 
-    push_completed_2 = RT_FALSE;
-    operation_in_progress = RT_TRUE;
-    push_thread_2 = rt_thread_create("push_ctrl_2",
-                                     push_control_thread_2,
-                                     RT_NULL,
-                                     1024,
-                                     20,
-                                     10);
-    if (push_thread_2 != RT_NULL)
+/* 撤下已过期的完成信息，重画积攒的库存数 */
+static void status_expire(void) {
+    stock_refresh();
+    for (int i = 0; i < LANE_COUNT; i++) {
+        if ((lane_stage[i] == VEND_STAGE_DONE || lane_stage[i] == VEND_STAGE_FAILED) &&
+            (rt_int32_t)(rt_tick_get() - lane_clear_tick[i]) >= 0) {
+            show_vend_progress(i + 1, VEND_STAGE_NONE, lane_pending[i], 0, 0);
+        }
+    }
+}
+
+/* 初始化显示界面 */
+void init_display(void) {
+    lcd_render_init(BLACK, ui_paint);
+    lcd_render_invalidate_all();
+    lcd_render_flush();
+}
+
+/* 执行选择的商品对应的命令：交给出货执行线程排队，界面不等待 */
+void execute_selected_command(int quantity) {
+    const TextLine *line = &text_lines[cursor_idx];
+
+    rt_kprintf("Executing command: %s_%d x%d\n", lane_cmd_names[line->command],
+               line->device_group, quantity);
+    vend_command(line, quantity);
+}
+
+/* 进入或退出数量选择：重画当前行和状态栏 */
+static void set_order_quantity(int quantity) {
+    order_quantity = quantity;
+    invalidate_line(cursor_idx);
+    lcd_render_invalidate(0, STATUS_Y, LCD_W - 1, STATUS_Y + STATUS_H - 1);
+    lcd_render_flush();
+}
+
+/* 这次选择键松开不算数：本次按下已触发长按，或者之前丢过按键事件 */
+static rt_bool_t select_release_void(void) {
+    rt_bool_t void_release = select_held || ui_keys_lost;
+
+    select_held = RT_FALSE;
+    ui_keys_lost = RT_FALSE;
+    return void_release;
+}
+
+/*
+ * 选择键：松开时下单，选数量时按选好的件数下单；在出货行上长按进入
+ * 数量选择，选数量时长按取消。长按之后的松开不再下单。
+ */
+static void select_key(rt_uint8_t event) {
+    if (event == KEY_EVENT_LONG) {
+        select_held = RT_TRUE;
+        if (order_quantity > 0) {
+            set_order_quantity(0);
+        } else if (TEXT_LINE_SELLS(&text_lines[cursor_idx])) {
+            set_order_quantity(1);
+        }
+    } else if (event == KEY_EVENT_RELEASE) {
+        if (select_release_void()) {
+            // 长按之后的松开
+        } else if (order_quantity > 0) {
+            execute_selected_command(order_quantity);
+            set_order_quantity(0);
+        } else {
+            execute_selected_command(1);
+        }
+    }
+}
+
+/* 校准状态有变化：只重画状态栏 */
+static void show_cal(void) {
+    lcd_render_invalidate(0, STATUS_Y, LCD_W - 1, STATUS_Y + STATUS_H - 1);
+    lcd_render_flush();
+}
+
+/*
+ * 校准时的按键：上下键点按走 CAL_JOG_FINE 步，长按连发每次走
+ * CAL_JOG_COARSE 步；选择键松开确认当前位置（滑台还在走时不算），
+ * 长按放弃本次校准。
+ */
+static void cal_key(rt_uint8_t key, rt_uint8_t event) {
+    rt_int32_t steps;
+
+    if (key == KEY_ID_SELECT) {
+        if (event == KEY_EVENT_LONG) {
+            select_held = RT_TRUE;
+            cal_abort();
+        } else if (event == KEY_EVENT_RELEASE && !select_release_void()) {
+            cal_confirm();
+        }
+        return;
+    }
+
+    if (event == KEY_EVENT_PRESS) {
+        steps = CAL_JOG_FINE;
+    } else if (event == KEY_EVENT_REPEAT) {
+        steps = CAL_JOG_COARSE;
+    } else {
+        return;
+    }
+    cal_jog(key == KEY_ID_UP ? steps : -steps);
+    show_cal();
+}
+
+/*
+ * 按键转进界面队列，总给 UI_MSG_CHANGED 留一格；连发只在队列不到半满时转，
+ * 界面处理不过来时多余的连发没有意义。其他事件丢了就记下来，下一次选择键
+ * 松开不再下单（丢的可能正是长按）。
+ */
+static void ui_key_handler(const KeyEvent *event) {
+    UiMsg msg;
+    rt_uint16_t queued;
+    rt_base_t level;
+
+    /* 队列里的条数由内核在关中断时改，这里也关中断读 */
+    level = rt_hw_interrupt_disable();
+    queued = ui_mq.entry;
+    rt_hw_interrupt_enable(level);
+
+    if (event->type == KEY_EVENT_REPEAT && queued >= UI_QUEUE_LEN / 2) {
+        return;
+    }
+    msg.type = UI_MSG_KEY;
+    msg.id = event->key;
+    msg.event = event->type;
+    if (queued >= UI_QUEUE_LEN - 1 || rt_mq_send(&ui_mq, &msg, sizeof(msg)) != RT_EOK) {
+        ui_keys_lost = RT_TRUE;
+    }
+}
+
+/* 命令名解析：NAME 或 NAME_<组>，没有组号时 lane 为 0；命令表很短，与组数无关 */
+static rt_err_t lane_cmd_parse(const char *text, LaneCmd *cmd, int *lane)
+{
+    const char *sep = strrchr(text, '_');
+    size_t len = strlen(text);
+
+    *lane = 0;
+    if (sep != RT_NULL && sep[1] >= '0' && sep[1] <= '9')
     {
-        rt_thread_startup(push_thread_2);
-        return RT_EOK;
+        *lane = atoi(sep + 1);
+        len = sep - text;
     }
-    else
+
+    for (int i = 0; i < LANE_CMD_COUNT; i++)
     {
-        rt_kprintf("Failed to start Pusher 2 thread.\n");
-        operation_in_progress = RT_FALSE;
-        return RT_ERROR;
+        if (strlen(lane_cmd_names[i]) == len && !strncmp(lane_cmd_names[i], text, len))
+        {
+            *cmd = (LaneCmd)i;
+            return RT_EOK;
+        }
     }
+    return -RT_ERROR;
 }
 
-/* 第二组统一的滑台控制命令实现 */
-static int slide_command_2(const char *cmd)
+/* 所有货道命令共用一个入口：NAME <组>，或原有的 NAME_<组> 写法 */
+static int lane_msh(int argc, char *argv[])
 {
-    if (slide_thread_2 && (slide_thread_2->stat != RT_THREAD_CLOSE) || operation_in_progress)
+    LaneCmd cmd;
+    int lane;
+
+    if (lane_cmd_parse(argv[0], &cmd, &lane) != RT_EOK)
+        return RT_ERROR;
+    if (lane == 0 && argc > 1)
+        lane = atoi(argv[1]);
+    if (lane < 1 || lane > LANE_COUNT)
     {
-        rt_kprintf("Previous Slide 2 operation still running.\n");
+        rt_kprintf("Usage: %s <1-%d>\n", lane_cmd_names[cmd], LANE_COUNT);
         return RT_ERROR;
     }
+    return lane_command(&lanes[lane - 1], cmd);
+}
 
-    operation_in_progress = RT_TRUE;
-    slide_thread_2 = rt_thread_create("slide_ctrl_2",
-                                      slide_control_thread_2,
-                                      (void *)cmd,
-                                      1024,
-                                      20,
-                                      10);
-    if (slide_thread_2 != RT_NULL)
+/* 由命令表注册 MSH 命令：每条命令一个带组号参数的入口，前两组另保留原有名字 */
+#define LANE_MSH_EXPORT(name, desc)     MSH_CMD_EXPORT_ALIAS(lane_msh, name, desc);
+#define LANE_MSH_EXPORT_1(name, desc)   MSH_CMD_EXPORT_ALIAS(lane_msh, name##_1, desc);
+#define LANE_MSH_EXPORT_2(name, desc)   MSH_CMD_EXPORT_ALIAS(lane_msh, name##_2, desc);
+
+LANE_COMMAND_TABLE(LANE_MSH_EXPORT)
+LANE_COMMAND_TABLE(LANE_MSH_EXPORT_1)
+LANE_COMMAND_TABLE(LANE_MSH_EXPORT_2)
+
+/*
+ * 新曲线下回零能否在零点前刹住，同 SLIDE_BRAKE_STEPS 的编译期检查。各组共用
+ * 一个定时器，同时运动时按最小的加速度刹车，所以新加速度要对每组都检查；
+ * 回零速度不超过巡航速度。
+ */
+static rt_bool_t slide_profile_safe(int group, rt_uint32_t accel, rt_uint32_t max_speed)
+{
+    for (int i = 0; i < LANE_COUNT; i++)
     {
-        rt_thread_startup(slide_thread_2);
-        return RT_EOK;
+        const LaneConfig *cfg = lanes[i].cfg;
+        rt_uint64_t start = SLIDE_RPM_TO_SPS(cfg->start_rpm);
+        rt_uint64_t homing = SLIDE_RPM_TO_SPS(cfg->homing_rpm);
+        rt_uint64_t limit = i == group - 1 ? max_speed : lanes[i].axis.profile.max_speed;
+
+        if (homing > limit)
+            homing = limit;
+        if (homing < start)
+            homing = start;
+        if ((homing * homing - start * start) / (2 * accel) + 1 + SLIDE_HOME_CREEP > SLIDE_HOME_OFFSET)
+            return RT_FALSE;
     }
-    else
+    return RT_TRUE;
+}
+
+/* 查看或修改滑台速度曲线：SLIDE_PROFILE <组> [加速度 步/s²] [巡航转速 rpm] */
+static int SLIDE_PROFILE(int argc, char *argv[])
+{
+    SlideAxis *axis;
+    rt_base_t level;
+    int group;
+
+    group = argc > 1 ? atoi(argv[1]) : 0;
+    if (group < 1 || group > LANE_COUNT)
     {
-        rt_kprintf("Failed to start Slide 2 thread.\n");
-        operation_in_progress = RT_FALSE;
+        rt_kprintf("Usage: SLIDE_PROFILE <1-%d> [accel] [max_rpm]\n", LANE_COUNT);
         return RT_ERROR;
     }
+    axis = &lanes[group - 1].axis;
+
+    if (argc > 2)
+    {
+        int accel = atoi(argv[2]);
+        int max_rpm = argc > 3 ? atoi(argv[3]) : 0;
+        rt_uint32_t max_speed = max_rpm > 0 ? SLIDE_RPM_TO_SPS(max_rpm) : axis->profile.max_speed;
+
+        if (accel <= 0 || max_rpm < 0)
+        {
+            rt_kprintf("Invalid profile\n");
+            return RT_ERROR;
+        }
+        if (max_speed < axis->profile.start_speed)
+            max_speed = axis->profile.start_speed;
+        if (!slide_profile_safe(group, accel, max_speed))
+        {
+            rt_kprintf("Accel %d cannot brake homing within %d steps\n", accel,
+                       SLIDE_HOME_OFFSET - SLIDE_HOME_CREEP);
+            return RT_ERROR;
+        }
+
+        level = rt_hw_interrupt_disable();
+        axis->profile.accel = accel;
+        axis->profile.max_speed = max_speed;
+        rt_hw_interrupt_enable(level);
+    }
+
+    rt_kprintf("Slide %d: start %d steps/s, max %d steps/s, accel %d steps/s^2\n",
+               group, (int)axis->profile.start_speed, (int)axis->profile.max_speed,
+               (int)axis->profile.accel);
+    return RT_EOK;
 }
+MSH_CMD_EXPORT(SLIDE_PROFILE, show or set slide accel and max rpm);
+
+/*
+ * 滑台位置校准：SLIDE_CAL 列出各组的定位位置；SLIDE_CAL <组> 开始校准，
+ * 之后 SLIDE_CAL jog <步数> 点动，SLIDE_CAL ok 确认当前位置，
+ * SLIDE_CAL abort 放弃
+ */
+static int SLIDE_CAL(int argc, char *argv[])
+{
+    SlideCalInfo info;
 
-/* 绘制单行文本 */
-void draw_line(int idx, rt_bool_t selected) {
-    int y = text_lines[idx].y;
+    if (argc > 1 && !strcmp(argv[1], "jog"))
+    {
+        int id, point;
+        rt_int32_t target;
 
-    /* 清除该行区域 */
-    lcd_set_color(BLACK, BLACK);
-    for (int i = 0; i < 16; i++) {
-        lcd_draw_line(10, y + i, 230, y + i);
+        if (argc < 3 || !cal_jog(atoi(argv[2])))
+        {
+            rt_kprintf("Usage: SLIDE_CAL jog <steps> during calibration\n");
+            return -RT_ERROR;
+        }
+        if (cal_status(&id, &point, &target))
+        {
+            rt_kprintf("Slide %d %s target %d\n", id, lane_cmd_names[point], (int)target);
+            cal_report(&lanes[id - 1]);
+        }
+        return RT_EOK;
     }
+    if (argc > 1 && !strcmp(argv[1], "ok"))
+    {
+        rt_err_t result = cal_confirm();
 
-    /* 绘制光标框 */
-    if (selected) {
-        lcd_set_color(RED, BLACK);
-        lcd_draw_line(10, y - 2, 230, y - 2);
-        lcd_draw_line(10, y + 18, 230, y + 18);
-        lcd_draw_line(10, y - 2, 10, y + 18);
-        lcd_draw_line(230, y - 2, 230, y + 18);
+        if (result == -RT_EBUSY)
+            rt_kprintf("Slide still moving, confirm again when it stops\n");
+        else if (result != RT_EOK)
+            rt_kprintf("No calibration in progress\n");
+        return result;
+    }
+    if (argc > 1 && !strcmp(argv[1], "abort"))
+    {
+        cal_abort();
+        return RT_EOK;
+    }
+    if (argc > 1)
+    {
+        int group = atoi(argv[1]);
+
+        if (group < 1 || group > LANE_COUNT)
+        {
+            rt_kprintf("Usage: SLIDE_CAL [<1-%d>|jog <steps>|ok|abort]\n", LANE_COUNT);
+            return -RT_ERROR;
+        }
+        if (cal_start(group) != RT_EOK)
+            return -RT_ERROR;
+        cal_report(&lanes[group - 1]);
+        return RT_EOK;
     }
 
-    /* 绘制文本内容 */
-    lcd_set_color(selected ? RED : WHITE, BLACK);
-    lcd_show_string(10, y, 16, text_lines[idx].text);
+    slide_cal_get_info(&info);
+    rt_kprintf("Calibration table v%d, saved %d times\n", info.version, (int)info.generation);
+    for (int i = 0; i < LANE_COUNT; i++)
+    {
+        rt_kprintf("Slide %d (%s):", i + 1,
+                   info.lanes & (1u << i) ? "calibrated" : "default");
+        for (int c = 0; c < LANE_POS_COUNT; c++)
+            rt_kprintf(" %s=%d", lane_cmd_names[c], (int)lanes[i].positions[c]);
+        rt_kprintf("\n");
+    }
+    return RT_EOK;
 }
+MSH_CMD_EXPORT(SLIDE_CAL, calibrate slide positions with jog and confirm);
 
-/* 绘制全部行内容 */
-void draw_all_lines(void) {
-    for (int i = 0; i < LINE_COUNT; i++) {
-        draw_line(i, i == cursor_idx);
+/* 上位机按 BP_TYPE_MAX 挡掉的类型号，这边也存不进去 */
+#if BP_TYPE_MAX != INV_TYPE_MAX
+#error "BP_TYPE_MAX must match INV_TYPE_MAX"
+#endif
+
+/* 批次记录处理：在串口接收线程中调用，每条记录是同一批的若干件货，TYPE<n> 装在第 n 组 */
+static rt_err_t batch_record_handler(const BatchRecord *record) {
+    rt_err_t result = inventory_load(record->type, record->type, record->date, record->count);
+
+    if (result == RT_EOK) {
+        stock_report(record->type);
+    } else {
+        rt_kprintf("Batch TYPE%d-%08d rejected (%d)\n", record->type, (int)record->date, (int)result);
     }
+    return result;
 }
 
-/* 显示操作提示 */
-void show_operation_status(const char *status) {
-    lcd_set_color(WHITE, BLACK);
-    lcd_show_string(10, 260, 16, "                "); // 先清除原有内容
-    lcd_show_string(10, 260, 16, status);
+/* 查看批次串口的接收统计 */
+static int BATCH_STAT(int argc, char *argv[])
+{
+    BatchRxStats stats;
+
+    batch_rx_get_stats(&stats);
+    rt_kprintf("Batch: %d bytes, %d records, %d errors, %d rejected, %d deferred\n",
+               (int)stats.bytes, (int)stats.records, (int)stats.errors, (int)stats.rejected,
+               (int)stats.deferred);
+    rt_kprintf("Frames: %d ok, %d bad, %d duplicate\n",
+               (int)stats.frames, (int)stats.crc_errors, (int)stats.duplicates);
+    return RT_EOK;
 }
+MSH_CMD_EXPORT(BATCH_STAT, show batch record receive statistics);
 
-/* 初始化显示界面 */
-void init_display(void) {
-    lcd_clear(BLACK);
-    lcd_set_color(WHITE, BLACK);
-    lcd_show_string(10, 10, 24, "Vending Machine");
-    lcd_draw_line(0, 40, 240, 40);
-    draw_all_lines();
-    lcd_show_string(10, 260, 16, "Use Up/Down to select, Select to buy");
+/* 查看各组库存批次和日志占用 */
+static int INVENTORY(int argc, char *argv[])
+{
+    InventoryBatch batches[INV_BATCH_MAX];
+    InventoryInfo info;
+
+    for (int lane = 1; lane <= LANE_COUNT; lane++)
+    {
+        int n = inventory_batches(lane, batches, INV_BATCH_MAX);
+
+        rt_kprintf("Lane %d: %d in stock\n", lane, (int)inventory_stock(lane));
+        for (int i = 0; i < n; i++)
+            rt_kprintf("  TYPE%d-%08d x%d\n", batches[i].type, (int)batches[i].date, batches[i].count);
+    }
+
+    inventory_get_info(&info);
+    rt_kprintf("Log: block %d/%d, generation %d, %d/%d records\n", info.block, info.blocks,
+               (int)info.generation, (int)info.used, (int)info.capacity);
+    return RT_EOK;
 }
+MSH_CMD_EXPORT(INVENTORY, list stock batches per lane);
 
-/* 按键检测函数 */
-int get_key_value(void) {
-    if (rt_pin_read(KEY_UP_PIN) == PIN_LOW) {
-        rt_thread_mdelay(20);
-        if (rt_pin_read(KEY_UP_PIN) == PIN_LOW) return 1; // 上键
+/* 以毫秒打印微秒数，保留三位小数（rt_kprintf 不支持浮点） */
+static void print_ms(rt_uint32_t us)
+{
+    rt_kprintf(" %6d.%03d", (int)(us / 1000), (int)(us % 1000));
+}
+
+/* 各阶段耗时统计：vendstat [reset] */
+static int vendstat(int argc, char *argv[])
+{
+    if (argc > 1 && !strcmp(argv[1], "reset"))
+    {
+        vend_trace_reset();
+        rt_kprintf("vendstat cleared\n");
+        return RT_EOK;
     }
-    if (rt_pin_read(KEY_DOWN_PIN) == PIN_LOW) {
-        rt_thread_mdelay(20);
-        if (rt_pin_read(KEY_DOWN_PIN) == PIN_LOW) return 2; // 下键
+
+    rt_kprintf("phase      count     min(ms)    avg(ms)    p50(ms)    p99(ms)    max(ms)\n");
+    for (int i = 0; i < TRACE_PHASE_COUNT; i++)
+    {
+        VendTraceStat stat;
+
+        vend_trace_get_stat((VendTracePhase)i, &stat);
+        rt_kprintf("%-8s %7d", vend_trace_phase_name(i), (int)stat.count);
+        if (stat.count > 0)
+        {
+            print_ms(stat.min_us);
+            print_ms(stat.avg_us);
+            print_ms(stat.p50_us);
+            print_ms(stat.p99_us);
+            print_ms(stat.max_us);
+        }
+        rt_kprintf("\n");
     }
-    if (rt_pin_read(KEY_SELECT_PIN) == PIN_LOW) {
-        rt_thread_mdelay(20);
-        if (rt_pin_read(KEY_SELECT_PIN) == PIN_LOW) return 3; // 选择键
+    return RT_EOK;
+}
+MSH_CMD_EXPORT(vendstat, show vend phase latency min/avg/p99 or reset);
+
+#define VENDTRACE_DEFAULT   32      // vendtrace 默认列出的事件数
+
+/* 列出最近的跟踪事件：vendtrace [条数]；时间从第一条算起，按周期计数，间隔超过计数器回绕周期时不准 */
+static int vendtrace(int argc, char *argv[])
+{
+    static VendTraceRecord records[VEND_TRACE_DEPTH];  // 放不进 MSH 线程的栈
+    int max = argc > 1 ? atoi(argv[1]) : VENDTRACE_DEFAULT;
+    int n;
+
+    if (max <= 0 || max > VEND_TRACE_DEPTH)
+        max = VEND_TRACE_DEPTH;
+    n = vend_trace_snapshot(records, max);
+
+    rt_kprintf("     seq    time(ms)   +delta(ms)  event     id    arg\n");
+    for (int i = 0; i < n; i++)
+    {
+        const VendTraceRecord *r = &records[i];
+
+        rt_kprintf("%8d", (int)r->seq);
+        print_ms(vend_trace_cycles_to_us(r->cycles - records[0].cycles));
+        rt_kprintf("  ");
+        print_ms(i > 0 ? vend_trace_cycles_to_us(r->cycles - records[i - 1].cycles) : 0);
+        rt_kprintf("  %-8s %3d %6d\n", vend_trace_event_name(r->event), r->id, r->arg);
     }
-    return 0;
+    return RT_EOK;
 }
+MSH_CMD_EXPORT(vendtrace, dump recent vend trace events);
 
-/* 执行选择的商品对应的命令 */
-void execute_selected_command(void) {
-    const char *cmd = text_lines[cursor_idx].command;
-    int group = text_lines[cursor_idx].device_group;
-    
-    show_operation_status("Processing...      ");
-    rt_kprintf("Executing command: %s for group %d\n", cmd, group);
-    
-    if (group == 1) {
-        if (strstr(cmd, "EXHIBIT")) {
-            slide_command_1(cmd);
-        } else if (strstr(cmd, "OUT")) {
-            slide_command_1(cmd);
-            rt_thread_mdelay(2000); // 等待滑台到位
-            push_sample_1(0, NULL);
-        }
-    } else if (group == 2) {
-        if (strstr(cmd, "EXHIBIT")) {
-            slide_command_2(cmd);
-        } else if (strstr(cmd, "OUT")) {
-            slide_command_2(cmd);
-            rt_thread_mdelay(2000); // 等待滑台到位
-            push_sample_2(0, NULL);
+/* 查看或设置延后日志的级别：vendlog [error|warn|info|debug] */
+static int vendlog(int argc, char *argv[])
+{
+    VendLogStats stats;
+
+    if (argc > 1)
+    {
+        int level;
+
+        for (level = VEND_LOG_ERROR; level <= VEND_LOG_DEBUG; level++)
+        {
+            if (!strcmp(argv[1], vend_log_level_name(level)))
+                break;
+        }
+        if (level > VEND_LOG_DEBUG)
+        {
+            rt_kprintf("Usage: vendlog [error|warn|info|debug]\n");
+            return -RT_ERROR;
         }
+        vend_log_set_level((rt_uint8_t)level);
     }
-    
-    show_operation_status("Operation complete ");
-    rt_thread_mdelay(2000); // 显示操作完成信息
-}
-
-/* 第一组命令封装 */
-static int ENDPOINT_1(int argc, char *argv[]) { return slide_command_1("ENDPOINT_1"); }
-static int EXHIBIT_1(int argc, char *argv[]) { return slide_command_1("EXHIBIT_1"); }
-static int OUT1_1(int argc, char *argv[]) { return slide_command_1("OUT1_1"); }
-static int TRANSPORT_1(int argc, char *argv[]) { return slide_command_1("TRANSPORT_1"); }
-static int OUT2_1(int argc, char *argv[]) { return slide_command_1("OUT2_1"); }
-static int EXIT_1(int argc, char *argv[]) { return slide_command_1("EXIT_1"); }
-static int PUSH_CTRL_1(int argc, char *argv[]) { return push_sample_1(argc, argv); }
-
-/* 第二组命令封装 */
-static int ENDPOINT_2(int argc, char *argv[]) { return slide_command_2("ENDPOINT_2"); }
-static int EXHIBIT_2(int argc, char *argv[]) { return slide_command_2("EXHIBIT_2"); }
-static int OUT1_2(int argc, char *argv[]) { return slide_command_2("OUT1_2"); }
-static int TRANSPORT_2(int argc, char *argv[]) { return slide_command_2("TRANSPORT_2"); }
-static int OUT2_2(int argc, char *argv[]) { return slide_command_2("OUT2_2"); }
-static int EXIT_2(int argc, char *argv[]) { return slide_command_2("EXIT_2"); }
-static int PUSH_CTRL_2(int argc, char *argv[]) { return push_sample_2(argc, argv); }
-
-/* 注册MSH命令 */
-MSH_CMD_EXPORT(ENDPOINT_1, move Slide 1 to endpoint position);
-MSH_CMD_EXPORT(EXHIBIT_1, move Slide 1 to exhibit position);
-MSH_CMD_EXPORT(OUT1_1, move Slide 1 to output 1 position);
-MSH_CMD_EXPORT(TRANSPORT_1, move Slide 1 to transport position);
-MSH_CMD_EXPORT(OUT2_1, move Slide 1 to output 2 position);
-MSH_CMD_EXPORT(EXIT_1, stop Slide 1 movement);
-MSH_CMD_EXPORT(PUSH_CTRL_1, start Pusher 1 for one round trip);
-
-MSH_CMD_EXPORT(ENDPOINT_2, move Slide 2 to endpoint position);
-MSH_CMD_EXPORT(EXHIBIT_2, move Slide 2 to exhibit position);
-MSH_CMD_EXPORT(OUT1_2, move Slide 2 to output 1 position);
-MSH_CMD_EXPORT(TRANSPORT_2, move Slide 2 to transport position);
-MSH_CMD_EXPORT(OUT2_2, move Slide 2 to output 2 position);
-MSH_CMD_EXPORT(EXIT_2, stop Slide 2 movement);
-MSH_CMD_EXPORT(PUSH_CTRL_2, start Pusher 2 for one round trip);
+
+    vend_log_get_stats(&stats);
+    rt_kprintf("Log level %s: %d written, %d filtered, %d dropped, %d shared\n",
+               vend_log_level_name(vend_log_get_level()), (int)stats.written,
+               (int)stats.filtered, (int)stats.dropped, (int)stats.shared);
+    return RT_EOK;
+}
+MSH_CMD_EXPORT(vendlog, show or set deferred log level);
+
+/* 内存预算：各线程栈峰值、栈的富余，以及堆的用量和峰值 */
+static int membudget(int argc, char *argv[])
+{
+    MemThreadUsage threads[MEM_BUDGET_THREADS];
+    MemHeapUsage heap;
+    rt_uint32_t reserved = 0, peak = 0;
+    int count;
+
+    count = mem_budget_threads(threads, MEM_BUDGET_THREADS);
+    rt_kprintf("thread    pri  stack   peak  use\n");
+    for (int i = 0; i < count; i++)
+    {
+        int use = threads[i].stack_size > 0 ?
+                  (int)(threads[i].stack_peak * 100 / threads[i].stack_size) : 0;
+
+        rt_kprintf("%-8s %4d %6d %6d %3d%%%s\n", threads[i].name, threads[i].priority,
+                   (int)threads[i].stack_size, (int)threads[i].stack_peak, use,
+                   use >= MEM_BUDGET_WARN_PCT ? " !" : "");
+        reserved += threads[i].stack_size;
+        peak += threads[i].stack_peak;
+    }
+    rt_kprintf("stacks: %d bytes reserved, %d peak, %d spare\n",
+               (int)reserved, (int)peak, (int)(reserved - peak));
+
+    mem_budget_heap(&heap);
+    rt_kprintf("heap: %d/%d bytes used, peak %d, %d free\n",
+               (int)heap.used, (int)heap.total, (int)heap.max_used, (int)(heap.total - heap.used));
+    rt_kprintf("heap calls: %d allocs, %d frees, %d live\n",
+               (int)heap.allocs, (int)heap.frees, (int)(heap.allocs - heap.frees));
+    return RT_EOK;
+}
+MSH_CMD_EXPORT(membudget, show thread stack peaks and heap usage);
 
 /* 主函数 */
 int main(void) {
     rt_device_t lcd_dev;
     
+    /* 跟踪点最先打开，之后各模块的事件都带周期计数 */
+    vend_trace_init();
+    
+    /* 内存预算：从这里起统计堆的申请和释放次数 */
+    mem_budget_init();
+    
+    /* 日志输出线程：运动控制线程里的日志先记进缓冲，由它稍后打印 */
+    vend_log_init();
+    
     /* 初始化LCD设备 */
     lcd_dev = rt_device_find("lcd");
     if (lcd_dev) {
         rt_device_init(lcd_dev);
-        lcd_clear(BLACK);
     } else {
         rt_kprintf("LCD device not found!\n");
     }
     
-    /* 初始化按键输入 */
-    rt_pin_mode(KEY_UP_PIN, PIN_MODE_INPUT_PULLUP);
-    rt_pin_mode(KEY_DOWN_PIN, PIN_MODE_INPUT_PULLUP);
-    rt_pin_mode(KEY_SELECT_PIN, PIN_MODE_INPUT_PULLUP);
+    /* 初始化按键输入：上下键长按连发，事件进界面队列 */
+    rt_mq_init(&ui_mq, "ui", ui_mq_pool, sizeof(UiMsg), sizeof(ui_mq_pool), RT_IPC_FLAG_FIFO);
+    key_input_init(ui_key_handler);
+    key_input_add(KEY_ID_UP, KEY_UP_PIN, RT_TRUE);
+    key_input_add(KEY_ID_DOWN, KEY_DOWN_PIN, RT_TRUE);
+    key_input_add(KEY_ID_SELECT, KEY_SELECT_PIN, RT_FALSE);
     
-    /* 初始化PWM设备（提前查找，避免运行时查找失败） */
-    pwm_dev_1 = (struct rt_device_pwm *)rt_device_find(PWM_DEV_NAME_1);
-    pwm_dev_2 = (struct rt_device_pwm *)rt_device_find(PWM_DEV_NAME_2);
+    /* 滑台位置日志：上次停稳时的位置，有就不必回零 */
+    fal_init();
+    slide_pos_init(SLIDE_POS_PARTITION);
     
-    if (pwm_dev_1 == RT_NULL) {
-        rt_kprintf("PWM device %s not found!\n", PWM_DEV_NAME_1);
-    }
-    if (pwm_dev_2 == RT_NULL) {
-        rt_kprintf("PWM device %s not found!\n", PWM_DEV_NAME_2);
-    }
+    /* 滑台位置校准表：各组有校准值时替换默认的定位位置 */
+    slide_cal_init(SLIDE_CAL_PARTITION);
+    rt_sem_init(&cal_lock, "cal", 1, RT_IPC_FLAG_FIFO);
+    
+    lane_setup();
+    vend_setup();
+    lane_boot();
+    
+    /* 库存：从闪存日志重建内存索引，之后的查询都不访问闪存 */
+    inventory_init(INVENTORY_PARTITION, LANE_COUNT);
+    
+    /* 上位机批次记录：DMA 接收，解析后的记录交给 batch_record_handler */
+    batch_rx_set_handler(batch_record_handler);
+    batch_rx_init(BATCH_UART_NAME);
     
     /* 初始化显示界面 */
     init_display();
     
-    /* 主循环 */
+    /* 主循环：阻塞在界面队列上，处理按键和出货进度 */
     while (1) {
-        int key = get_key_value();
+        UiMsg msg;
         
-        if (key == 1 && cursor_idx > 0) {
-            draw_line(cursor_idx, RT_FALSE);
-            cursor_idx--;
-            draw_line(cursor_idx, RT_TRUE);
-        } else if (key == 2 && cursor_idx < LINE_COUNT - 1) {
-            draw_line(cursor_idx, RT_FALSE);
-            cursor_idx++;
-            draw_line(cursor_idx, RT_TRUE);
-        } else if (key == 3 && !operation_in_progress) {
-            execute_selected_command();
-            init_display(); // 操作完成后刷新显示
+        if (rt_mq_recv(&ui_mq, &msg, sizeof(msg), status_timeout()) != RT_EOK) {
+            status_expire();
+            continue;
         }
         
-        rt_thread_mdelay(100);
+        if (msg.type == UI_MSG_KEY) {
+            vend_trace(TRACE_UI_KEY, msg.id, msg.event);
+        }
+        if (msg.type == UI_MSG_CHANGED) {
+            show_changes();
+        } else if (cal_active()) {
+            cal_key(msg.id, msg.event);
+        } else if (msg.id == KEY_ID_SELECT) {
+            select_key(msg.event);
+        } else if (msg.event != KEY_EVENT_PRESS && msg.event != KEY_EVENT_REPEAT) {
+            // 上下键的长按与松开不需要处理
+        } else if (order_quantity > 0) {
+            /* 选数量：上键加一件，下键减一件 */
+            if (msg.id == KEY_ID_UP && order_quantity < VEND_QTY_MAX) {
+                set_order_quantity(order_quantity + 1);
+            } else if (msg.id == KEY_ID_DOWN && order_quantity > 1) {
+                set_order_quantity(order_quantity - 1);
+            }
+        } else if (msg.id == KEY_ID_UP && cursor_idx > 0) {
+            move_cursor(cursor_idx - 1);
+        } else if (msg.id == KEY_ID_DOWN && cursor_idx < LINE_COUNT - 1) {
+            move_cursor(cursor_idx + 1);
+        }
+        status_expire();
     }
 
     return 0;
@@ -0,0 +1,374 @@
+﻿#include "batch_proto.h"
+
+#include <string.h>
+
+enum {
+    BP_HUNT = 0,    // 找帧头
+    BP_HEADER,      // 收 LEN SEQ KIND
+    BP_BODY,        // 收载荷和 CRC
+};
+
+/* 序号按 8 位回绕，a 在 b 之后（或相等）且相距小于半圈 */
+static int seq_after_eq(uint8_t a, uint8_t b)
+{
+    return (uint8_t)(a - b) < 0x80;
+}
+
+uint16_t bp_crc16(const uint8_t *data, size_t len)
+{
+    uint16_t crc = 0xFFFF;
+    size_t i;
+    int bit;
+
+    for (i = 0; i < len; i++)
+    {
+        crc ^= (uint16_t)data[i] << 8;
+        for (bit = 0; bit < 8; bit++)
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+    return crc;
+}
+
+size_t bp_encode(uint8_t *out, size_t cap, uint8_t kind, uint8_t seq,
+                 const uint8_t *payload, size_t len)
+{
+    size_t size = BP_HEADER_SIZE + len + 2;
+    uint16_t crc;
+
+    if (len > BP_PAYLOAD_MAX || size > cap)
+        return 0;
+
+    out[0] = BP_SOF;
+    out[1] = (uint8_t)len;
+    out[2] = seq;
+    out[3] = kind;
+    if (len > 0)
+        memcpy(out + BP_HEADER_SIZE, payload, len);
+    crc = bp_crc16(out + 1, BP_HEADER_SIZE - 1 + len);
+    out[BP_HEADER_SIZE + len] = (uint8_t)crc;
+    out[BP_HEADER_SIZE + len + 1] = (uint8_t)(crc >> 8);
+    return size;
+}
+
+void bp_record_put(uint8_t *out, const bp_record *record)
+{
+    out[0] = record->type;
+    out[1] = (uint8_t)record->date;
+    out[2] = (uint8_t)(record->date >> 8);
+    out[3] = (uint8_t)(record->date >> 16);
+    out[4] = (uint8_t)(record->date >> 24);
+    out[5] = (uint8_t)record->count;
+    out[6] = (uint8_t)(record->count >> 8);
+}
+
+void bp_record_get(const uint8_t *in, bp_record *record)
+{
+    record->type = in[0];
+    record->date = (uint32_t)in[1] | ((uint32_t)in[2] << 8) |
+                   ((uint32_t)in[3] << 16) | ((uint32_t)in[4] << 24);
+    record->count = (uint16_t)(in[5] | (in[6] << 8));
+}
+
+int bp_frame_records(const bp_frame *frame)
+{
+    if (frame->kind != BP_KIND_DATA)
+        return 0;
+    return frame->len / BP_RECORD_SIZE;
+}
+
+/* ---------------------------------------------------------------- 解码 */
+
+void bp_decoder_init(bp_decoder *decoder)
+{
+    decoder->state = BP_HUNT;
+    decoder->pos = 0;
+    decoder->need = 0;
+    decoder->crc_errors = 0;
+}
+
+int bp_decoder_busy(const bp_decoder *decoder)
+{
+    return decoder->state != BP_HUNT;
+}
+
+/*
+ * 逐字节收帧。长度或 CRC 不对就丢掉这一帧回去找帧头，载荷里碰巧出现的
+ * 0x7E 会被当成帧头再试一次，CRC 会把它筛掉；丢掉的帧由发送端超时重发。
+ */
+int bp_decoder_put(bp_decoder *decoder, uint8_t byte, bp_frame *frame)
+{
+    uint16_t crc;
+
+    switch (decoder->state)
+    {
+    case BP_HUNT:
+        if (byte == BP_SOF)
+        {
+            decoder->buf[0] = byte;
+            decoder->pos = 1;
+            decoder->state = BP_HEADER;
+        }
+        return 0;
+
+    case BP_HEADER:
+        decoder->buf[decoder->pos++] = byte;
+        if (decoder->pos == 2 && byte > BP_PAYLOAD_MAX)
+        {
+            decoder->crc_errors++;
+            decoder->state = BP_HUNT;
+            return 0;
+        }
+        if (decoder->pos == BP_HEADER_SIZE)
+        {
+            decoder->need = BP_HEADER_SIZE + decoder->buf[1] + 2;
+            decoder->state = BP_BODY;
+        }
+        return 0;
+
+    default:
+        decoder->buf[decoder->pos++] = byte;
+        if (decoder->pos < decoder->need)
+            return 0;
+
+        decoder->state = BP_HUNT;
+        crc = bp_crc16(decoder->buf + 1, decoder->need - 3);
+        if (decoder->buf[decoder->need - 2] != (uint8_t)crc ||
+            decoder->buf[decoder->need - 1] != (uint8_t)(crc >> 8))
+        {
+            decoder->crc_errors++;
+            return 0;
+        }
+        frame->len = decoder->buf[1];
+        frame->seq = decoder->buf[2];
+        frame->kind = decoder->buf[3];
+        frame->payload = decoder->buf + BP_HEADER_SIZE;
+        return 1;
+    }
+}
+
+/* ---------------------------------------------------------------- 发送 */
+
+static bp_slot *sender_slot(bp_sender *sender, uint8_t seq)
+{
+    return &sender->slots[seq % BP_WINDOW];
+}
+
+/* 会话的 SYNC 帧，seq 为它之后第一个数据帧的前一个 */
+static size_t sender_sync(const bp_sender *sender, uint8_t *out, size_t cap, uint8_t seq)
+{
+    uint8_t payload[2];
+
+    payload[0] = (uint8_t)sender->session;
+    payload[1] = (uint8_t)(sender->session >> 8);
+    return bp_encode(out, cap, BP_KIND_SYNC, seq, payload, sizeof(payload));
+}
+
+void bp_sender_init(bp_sender *sender, uint16_t session, uint32_t timeout_ms)
+{
+    bp_slot *slot;
+
+    memset(sender, 0, sizeof(*sender));
+    sender->session = session;
+    sender->timeout_ms = timeout_ms ? timeout_ms : BP_TIMEOUT_MS;
+
+    /* SYNC 占窗口里的第一个位置，和数据帧一样等确认、超时重发 */
+    slot = sender_slot(sender, 0);
+    slot->size = (uint16_t)sender_sync(sender, slot->frame, sizeof(slot->frame), 0);
+    sender->next = 1;
+}
+
+int bp_sender_window_free(const bp_sender *sender)
+{
+    return BP_WINDOW - (uint8_t)(sender->next - sender->base);
+}
+
+int bp_sender_idle(const bp_sender *sender)
+{
+    return sender->next == sender->base;
+}
+
+/* 把最多 BP_RECORDS_MAX 条记录打成一帧放进窗口，返回用掉的记录数；窗口满时返回 0 */
+size_t bp_sender_push(bp_sender *sender, const bp_record *records, size_t count)
+{
+    uint8_t payload[BP_PAYLOAD_MAX];
+    bp_slot *slot;
+    size_t i;
+
+    if (count == 0 || bp_sender_window_free(sender) == 0)
+        return 0;
+    if (count > BP_RECORDS_MAX)
+        count = BP_RECORDS_MAX;
+
+    for (i = 0; i < count; i++)
+        bp_record_put(payload + i * BP_RECORD_SIZE, &records[i]);
+
+    slot = sender_slot(sender, sender->next);
+    slot->size = (uint16_t)bp_encode(slot->frame, sizeof(slot->frame), BP_KIND_DATA,
+                                     sender->next, payload, count * BP_RECORD_SIZE);
+    slot->records = (uint8_t)count;
+    slot->sent = 0;
+    sender->next++;
+    return count;
+}
+
+/*
+ * 取出此刻该发的字节：没发过的新帧，或者最老的帧已超时时从它起的整个窗口
+ * （回退 N 帧）；要补发 SYNC 时放在最前面，随后同样重发整个窗口。返回写进
+ * out 的字节数，out 至少要能放下一帧。
+ */
+size_t bp_sender_poll(bp_sender *sender, uint32_t now_ms, uint8_t *out, size_t cap)
+{
+    size_t used = 0;
+    uint8_t seq;
+    int resend = 0;
+
+    if (bp_sender_idle(sender))
+        return 0;
+
+    {
+        const bp_slot *oldest = sender_slot(sender, sender->base);
+        if (oldest->sent && now_ms - oldest->sent_ms >= sender->timeout_ms)
+        {
+            resend = 1;
+            if (++sender->timeouts >= BP_RESYNC_TIMEOUTS)
+                sender->resync = 1;
+        }
+        /* 开头的 SYNC 还没确认时，重发的就是它本身 */
+        if (oldest->frame[3] == BP_KIND_SYNC)
+            sender->resync = 0;
+    }
+
+    if (sender->resync)
+    {
+        used = sender_sync(sender, out, cap, (uint8_t)(sender->base - 1));
+        if (used == 0)
+            return 0;
+        sender->resync = 0;
+        sender->timeouts = 0;
+        sender->resyncs++;
+        sender->frames++;
+        resend = 1;
+    }
+
+    for (seq = sender->base; seq != sender->next; seq++)
+    {
+        bp_slot *slot = sender_slot(sender, seq);
+
+        if (slot->sent && !resend)
+            continue;
+        if (used + slot->size > cap)
+            break;
+        memcpy(out + used, slot->frame, slot->size);
+        used += slot->size;
+        if (slot->sent)
+            sender->retransmits++;
+        slot->sent = 1;
+        slot->sent_ms = now_ms;
+        sender->frames++;
+    }
+    return used;
+}
+
+/* 距下一次可能要重发还有多少毫秒，窗口空时返回 UINT32_MAX */
+uint32_t bp_sender_next_timeout(const bp_sender *sender, uint32_t now_ms)
+{
+    const bp_slot *oldest;
+    uint32_t elapsed;
+
+    if (bp_sender_idle(sender))
+        return UINT32_MAX;
+    if (sender->resync)
+        return 0;
+    oldest = &sender->slots[sender->base % BP_WINDOW];
+    if (!oldest->sent)
+        return 0;
+    elapsed = now_ms - oldest->sent_ms;
+    return elapsed >= sender->timeout_ms ? 0 : sender->timeout_ms - elapsed;
+}
+
+/*
+ * 处理对端回来的帧：累计确认，窗口前移。RESYNC 只认针对最老那一帧的，
+ * 同一轮发出的其余帧引起的 RESYNC 不再重复补发。
+ */
+void bp_sender_on_frame(bp_sender *sender, const bp_frame *frame)
+{
+    if (frame->kind == BP_KIND_RESYNC)
+    {
+        if (!bp_sender_idle(sender) && frame->seq == sender->base)
+            sender->resync = 1;
+        return;
+    }
+    if (frame->kind != BP_KIND_ACK)
+        return;
+    if (bp_sender_idle(sender) || !seq_after_eq(frame->seq, sender->base) ||
+        seq_after_eq(frame->seq, sender->next))
+        return;
+
+    while (sender->base != (uint8_t)(frame->seq + 1))
+    {
+        sender->records_acked += sender_slot(sender, sender->base)->records;
+        sender->base++;
+    }
+    sender->timeouts = 0;
+}
+
+/* ---------------------------------------------------------------- 接收 */
+
+void bp_receiver_init(bp_receiver *receiver)
+{
+    memset(receiver, 0, sizeof(*receiver));
+}
+
+size_t bp_receiver_on_frame(bp_receiver *receiver, const bp_frame *frame,
+                            uint8_t *ack, size_t cap, int *deliver)
+{
+    *deliver = 0;
+    receiver->frames++;
+
+    if (frame->kind == BP_KIND_SYNC)
+    {
+        uint16_t session;
+
+        if (frame->len != 2)
+            return 0;
+        session = (uint16_t)(frame->payload[0] | (frame->payload[1] << 8));
+        /* 同一会话的 SYNC 是重发，只补 ACK，不能把已收的序号清掉 */
+        if (!receiver->synced || session != receiver->session)
+        {
+            receiver->session = session;
+            receiver->synced = 1;
+            receiver->last = frame->seq;
+        }
+        else
+        {
+            receiver->duplicates++;
+        }
+        return bp_encode(ack, cap, BP_KIND_ACK, receiver->last, NULL, 0);
+    }
+
+    if (frame->kind != BP_KIND_DATA || frame->len % BP_RECORD_SIZE != 0)
+        return 0;
+    if (!receiver->synced)
+    {
+        /* 没有会话（比如刚重启）：不知道序号从哪接起，请发送端补发 SYNC */
+        receiver->resyncs++;
+        return bp_encode(ack, cap, BP_KIND_RESYNC, frame->seq, NULL, 0);
+    }
+
+    if (frame->seq == (uint8_t)(receiver->last + 1))
+    {
+        receiver->last = frame->seq;
+        *deliver = 1;
+    }
+    else
+    {
+        receiver->duplicates++;
+    }
+    return bp_encode(ack, cap, BP_KIND_ACK, receiver->last, NULL, 0);
+}
+
+void bp_receiver_unaccept(bp_receiver *receiver, const bp_frame *frame)
+{
+    if (receiver->synced && frame->kind == BP_KIND_DATA && frame->seq == receiver->last)
+        receiver->last--;
+}
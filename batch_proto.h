@@ -0,0 +1,128 @@
+﻿#ifndef __BATCH_PROTO_H__
+#define __BATCH_PROTO_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * 上位机与售货机之间的批次协议，两端共用，不依赖操作系统。
+ *
+ * 帧格式（多字节字段均为小端）：
+ *   SOF(0x7E) | LEN | SEQ | KIND | PAYLOAD[LEN] | CRC16
+ * CRC 为 CRC-16/CCITT-FALSE，覆盖 LEN 到 PAYLOAD 末尾。
+ *
+ * 发送端先发 SYNC（载荷为 2 字节会话号）建立会话，之后 DATA 帧的序号从
+ * SYNC 的下一个开始逐帧加一。接收端只收下一个期望的序号，并对收到的最后
+ * 一个按序帧回 ACK（累计确认）；乱序、重复的帧丢弃并重发上次的 ACK。
+ * 发送端最多有 BP_WINDOW 帧未确认，超时后从最老的未确认帧起全部重发。
+ *
+ * 接收端没有会话（比如重启过）时收到 DATA 回 RESYNC，发送端随即补发 SYNC，
+ * 序号取最老的未确认帧的前一个，再从最老的未确认帧起重发；RESYNC 也可能
+ * 丢，连续 BP_RESYNC_TIMEOUTS 次超时确认没有前进时同样先补发 SYNC。
+ */
+
+#define BP_SOF              0x7E
+
+#define BP_KIND_SYNC        0x01    // 建立会话，载荷为会话号
+#define BP_KIND_DATA        0x02    // 若干条批次记录
+#define BP_KIND_ACK         0x03    // 累计确认到 SEQ，无载荷
+#define BP_KIND_RESYNC      0x04    // 接收端没有会话，请补发 SYNC；SEQ 为收到的数据帧，无载荷
+
+#define BP_RECORD_SIZE      7       // 类型 1 + 日期 4 + 件数 2
+#define BP_TYPE_MAX         8       // 类型号 1~BP_TYPE_MAX，与售货机的 INV_TYPE_MAX 相同
+#define BP_RECORDS_MAX      32      // 每帧最多几条记录
+#define BP_PAYLOAD_MAX      (BP_RECORDS_MAX * BP_RECORD_SIZE)
+#define BP_HEADER_SIZE      4
+#define BP_FRAME_MAX        (BP_HEADER_SIZE + BP_PAYLOAD_MAX + 2)
+
+#define BP_WINDOW           4       // 未确认帧的上限
+#define BP_TIMEOUT_MS       200     // 默认重发超时
+#define BP_RESYNC_TIMEOUTS  3       // 连续这么多次超时，重发前先补发 SYNC
+
+/* 一条批次记录：某类型、某生产日期的货若干件 */
+typedef struct {
+    uint8_t type;
+    uint32_t date;                  // 十进制 yyyyMMdd
+    uint16_t count;
+} bp_record;
+
+/* 解出的一帧，payload 指向解码器内部缓冲，下次喂数据前有效 */
+typedef struct {
+    uint8_t kind;
+    uint8_t seq;
+    uint8_t len;
+    const uint8_t *payload;
+} bp_frame;
+
+uint16_t bp_crc16(const uint8_t *data, size_t len);
+
+/* 编码一帧，返回帧长，cap 不够时返回 0 */
+size_t bp_encode(uint8_t *out, size_t cap, uint8_t kind, uint8_t seq,
+                 const uint8_t *payload, size_t len);
+
+/* 记录与载荷互转 */
+void bp_record_put(uint8_t *out, const bp_record *record);
+void bp_record_get(const uint8_t *in, bp_record *record);
+int bp_frame_records(const bp_frame *frame);
+
+/* 流式解码：逐字节喂入，凑齐一帧且 CRC 正确时返回 1 */
+typedef struct {
+    uint8_t state;
+    uint16_t pos;
+    uint16_t need;
+    uint32_t crc_errors;
+    uint8_t buf[BP_FRAME_MAX];
+} bp_decoder;
+
+void bp_decoder_init(bp_decoder *decoder);
+int bp_decoder_put(bp_decoder *decoder, uint8_t byte, bp_frame *frame);
+int bp_decoder_busy(const bp_decoder *decoder);
+
+/* 发送端：保存未确认的帧以便重发，时间由调用者给出（毫秒） */
+typedef struct {
+    uint8_t frame[BP_FRAME_MAX];
+    uint16_t size;
+    uint8_t records;
+    uint8_t sent;                   // 已发出过
+    uint32_t sent_ms;
+} bp_slot;
+
+typedef struct {
+    uint16_t session;
+    uint8_t base;                   // 最老的未确认序号
+    uint8_t next;                   // 下一个要分配的序号
+    uint32_t timeout_ms;
+    bp_slot slots[BP_WINDOW];
+    uint8_t timeouts;               // 确认没有前进的连续超时次数
+    uint8_t resync;                 // 下次发送前先补发 SYNC
+    uint32_t frames;                // 发出的帧数（含重发）
+    uint32_t retransmits;           // 重发的帧数
+    uint32_t resyncs;               // 补发 SYNC 的次数
+    uint32_t records_acked;
+} bp_sender;
+
+void bp_sender_init(bp_sender *sender, uint16_t session, uint32_t timeout_ms);
+int bp_sender_window_free(const bp_sender *sender);
+int bp_sender_idle(const bp_sender *sender);
+size_t bp_sender_push(bp_sender *sender, const bp_record *records, size_t count);
+size_t bp_sender_poll(bp_sender *sender, uint32_t now_ms, uint8_t *out, size_t cap);
+uint32_t bp_sender_next_timeout(const bp_sender *sender, uint32_t now_ms);
+void bp_sender_on_frame(bp_sender *sender, const bp_frame *frame);
+
+/* 接收端：处理一帧，需要回 ACK 或 RESYNC 时写进 ack 并返回长度；新的按序数据帧 *deliver 置 1 */
+typedef struct {
+    uint16_t session;
+    uint8_t synced;
+    uint8_t last;                   // 最后一个按序收下的序号
+    uint32_t frames;
+    uint32_t duplicates;            // 重复或乱序而丢弃的帧
+    uint32_t resyncs;               // 没有会话时收到、回了 RESYNC 的数据帧
+} bp_receiver;
+
+void bp_receiver_init(bp_receiver *receiver);
+size_t bp_receiver_on_frame(bp_receiver *receiver, const bp_frame *frame,
+                            uint8_t *ack, size_t cap, int *deliver);
+/* 交出的帧没能处理完：不回它的 ACK 并调用此函数，上位机重发来时再交出一次 */
+void bp_receiver_unaccept(bp_receiver *receiver, const bp_frame *frame);
+
+#endif
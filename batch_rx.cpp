@@ -0,0 +1,297 @@
+﻿#include "batch_rx.h"
+#include "batch_proto.h"
+
+/*
+ * 上位机批次记录的串口接收。
+ *
+ * 串口以 DMA 方式接收，驱动在 DMA 半满、满和线路空闲时回调 rx_indicate，
+ * 回调里只释放信号量。接收线程醒来后把驱动缓冲里的数据直接读进解析环
+ * 形缓冲的空闲段（读指针之前的部分），随即就地解析：解析器是逐字节的
+ * 状态机，类型号和日期边读边累加成数值，不拷贝、不缓存整行，也不申请
+ * 内存，跨越环形缓冲回绕处的记录同样处理。解析出的记录交给处理函数。
+ *
+ * 记录格式为 "TYPE<1~255>-yyyyMMdd"，以 '\n' 结尾，'\r' 忽略；一行里任何
+ * 不符合格式的字符都使整行作废，直到下一个 '\n' 再重新开始。
+ *
+ * 行首出现 0x7E 时改按 batch_proto.h 的批次帧解析，一帧带多条记录，带
+ * 序号和 CRC。按序收到的帧把记录逐条交给处理函数，全部入库或拒收后才
+ * 从同一串口回 ACK；有一条暂时没能入库就不回 ACK，上位机超时重发这一帧
+ * 时跳过已处理的记录，从失败的那条接着交。处理函数拒收的记录（类型不对、
+ * 本组批次已满）重发也没用，计数后跳过。坏帧和重复帧不交出，由上位机
+ * 超时重发。
+ * 两种格式可以混在一个串口上。
+ */
+
+#define BATCH_RX_RING_MASK    (BATCH_RX_RING_SIZE - 1)
+
+/* 解析状态 */
+typedef enum {
+    BATCH_PARSE_PREFIX = 0,         // 匹配 "TYPE"
+    BATCH_PARSE_TYPE,               // 类型号
+    BATCH_PARSE_DATE,               // 日期的 8 位数字
+    BATCH_PARSE_END,                // 等待行尾
+    BATCH_PARSE_SKIP,               // 本行作废，跳到行尾
+} BatchParseState;
+
+static const char batch_prefix[] = "TYPE";
+
+static rt_device_t batch_dev = RT_NULL;
+static struct rt_semaphore batch_rx_sem;
+static struct rt_thread batch_thread;
+static ALIGN(RT_ALIGN_SIZE) rt_uint8_t batch_thread_stack[BATCH_RX_STACK];
+static batch_handler_t batch_handler = RT_NULL;
+
+static rt_uint8_t batch_ring[BATCH_RX_RING_SIZE];
+static rt_uint32_t batch_head = 0;  // 写指针，只增不减，取模后为下标
+static rt_uint32_t batch_tail = 0;  // 解析指针
+
+static BatchParseState parse_state = BATCH_PARSE_PREFIX;
+static int parse_count = 0;         // 当前字段已读的字符数
+static BatchRecord parse_record;
+
+static bp_decoder frame_decoder;
+static bp_receiver frame_receiver;
+static rt_uint16_t frame_stored_session; // 上次没存完的帧所在的会话和序号
+static rt_uint8_t frame_stored_seq;
+static int frame_stored = 0;        // 这一帧已入库的记录数，0 为没有存了一半的帧
+
+static BatchRxStats batch_stats;
+
+static rt_err_t batch_rx_indicate(rt_device_t dev, rt_size_t size)
+{
+    rt_sem_release(&batch_rx_sem);
+    return RT_EOK;
+}
+
+/* 记录本身存不进去，重发也一样，见 batch_handler_t */
+static rt_bool_t batch_rejected(rt_err_t result)
+{
+    return result == -RT_EINVAL || result == -RT_EFULL;
+}
+
+/* 一行结束：格式完整就交出去，然后从头开始 */
+static void batch_parse_line_end(void)
+{
+    if (parse_state == BATCH_PARSE_END)
+    {
+        batch_stats.records++;
+        if (batch_handler != RT_NULL && batch_handler(&parse_record) != RT_EOK)
+            batch_stats.rejected++;
+    }
+    else if (parse_state != BATCH_PARSE_PREFIX || parse_count != 0)
+    {
+        batch_stats.errors++;
+    }
+    parse_state = BATCH_PARSE_PREFIX;
+    parse_count = 0;
+}
+
+/* 一个完好的批次帧：按序的新帧先把记录交出去再回 ACK，上位机收到 ACK 即表示已入库 */
+static void batch_frame_received(const bp_frame *frame)
+{
+    rt_uint8_t ack[BP_HEADER_SIZE + 2];
+    rt_size_t ack_len;
+    rt_err_t result;
+    int deliver, i = 0;
+
+    batch_stats.frames++;
+    ack_len = bp_receiver_on_frame(&frame_receiver, frame, ack, sizeof(ack), &deliver);
+    batch_stats.duplicates = frame_receiver.duplicates;
+
+    /*
+     * 上次存了一半的帧重发来了，已入库的不再交。撤回后下一个按序交出的
+     * 只能是这一帧，除非换了会话；窗口里跟在后面的帧乱序到达，不交出，
+     * 也不动续存点。
+     */
+    if (deliver && frame_stored > 0)
+    {
+        if (frame->seq == frame_stored_seq && frame_receiver.session == frame_stored_session)
+            i = frame_stored;
+        frame_stored = 0;
+    }
+
+    for (; deliver && i < bp_frame_records(frame); i++)
+    {
+        bp_record wire;
+        BatchRecord record;
+
+        bp_record_get(frame->payload + i * BP_RECORD_SIZE, &wire);
+        if (wire.type == 0 || wire.count == 0)
+        {
+            batch_stats.errors++;
+            continue;
+        }
+        record.type = wire.type;
+        record.date = wire.date;
+        record.count = wire.count;
+        batch_stats.records++;
+        if (batch_handler == RT_NULL)
+            continue;
+        result = batch_handler(&record);
+        if (batch_rejected(result))
+        {
+            batch_stats.rejected++;
+        }
+        else if (result != RT_EOK)
+        {
+            batch_stats.deferred++;
+            frame_stored_session = frame_receiver.session;
+            frame_stored_seq = frame->seq;
+            frame_stored = i;
+            bp_receiver_unaccept(&frame_receiver, frame);
+            return;
+        }
+    }
+    if (ack_len > 0)
+        rt_device_write(batch_dev, 0, ack, ack_len);
+}
+
+static void batch_parse_byte(rt_uint8_t c)
+{
+    rt_bool_t digit = c >= '0' && c <= '9';
+    bp_frame frame;
+
+    /* 帧只从行首开始，帧内的任何字节都不当文本看 */
+    if (bp_decoder_busy(&frame_decoder) ||
+        (c == BP_SOF && parse_state == BATCH_PARSE_PREFIX && parse_count == 0))
+    {
+        if (bp_decoder_put(&frame_decoder, c, &frame))
+            batch_frame_received(&frame);
+        batch_stats.crc_errors = frame_decoder.crc_errors;
+        return;
+    }
+
+    if (c == '\n')
+    {
+        batch_parse_line_end();
+        return;
+    }
+    if (c == '\r')
+        return;
+
+    switch (parse_state)
+    {
+    case BATCH_PARSE_PREFIX:
+        if (c != (rt_uint8_t)batch_prefix[parse_count])
+            break;
+        if (++parse_count == sizeof(batch_prefix) - 1)
+        {
+            parse_state = BATCH_PARSE_TYPE;
+            parse_count = 0;
+            parse_record.type = 0;
+            parse_record.count = 1;
+        }
+        return;
+
+    case BATCH_PARSE_TYPE:
+        if (digit && parse_count < 3)
+        {
+            rt_uint32_t type = parse_record.type * 10 + (c - '0');
+            if (type > 255)
+                break;
+            parse_record.type = (rt_uint8_t)type;
+            parse_count++;
+            return;
+        }
+        if (c != '-' || parse_count == 0 || parse_record.type == 0)
+            break;
+        parse_state = BATCH_PARSE_DATE;
+        parse_count = 0;
+        parse_record.date = 0;
+        return;
+
+    case BATCH_PARSE_DATE:
+        if (!digit)
+            break;
+        parse_record.date = parse_record.date * 10 + (c - '0');
+        if (++parse_count == 8)
+            parse_state = BATCH_PARSE_END;
+        return;
+
+    case BATCH_PARSE_END:
+    case BATCH_PARSE_SKIP:
+        break;
+    }
+    parse_state = BATCH_PARSE_SKIP;
+}
+
+/* 把驱动缓冲里的数据读进环形缓冲的空闲段，返回读到的字节数 */
+static rt_size_t batch_rx_fill(void)
+{
+    rt_uint32_t used = batch_head - batch_tail;
+    rt_uint32_t offset = batch_head & BATCH_RX_RING_MASK;
+    rt_uint32_t space = BATCH_RX_RING_SIZE - used;
+    rt_size_t n;
+
+    /* 只读到缓冲末尾，回绕部分下一轮再读 */
+    if (space > BATCH_RX_RING_SIZE - offset)
+        space = BATCH_RX_RING_SIZE - offset;
+    if (space == 0)
+        return 0;
+
+    n = rt_device_read(batch_dev, 0, &batch_ring[offset], space);
+    batch_head += n;
+    batch_stats.bytes += n;
+    return n;
+}
+
+static void batch_rx_thread(void *parameter)
+{
+    while (1)
+    {
+        rt_sem_take(&batch_rx_sem, RT_WAITING_FOREVER);
+
+        /* 驱动缓冲读空为止，边读边解析，信号量多释放几次无妨 */
+        while (batch_rx_fill() > 0)
+        {
+            while (batch_tail != batch_head)
+                batch_parse_byte(batch_ring[batch_tail++ & BATCH_RX_RING_MASK]);
+        }
+    }
+}
+
+rt_err_t batch_rx_init(const char *uart_name)
+{
+    struct serial_configure config = RT_SERIAL_CONFIG_DEFAULT;
+
+    batch_dev = rt_device_find(uart_name);
+    if (batch_dev == RT_NULL)
+    {
+        rt_kprintf("Batch UART %s not found!\n", uart_name);
+        return -RT_ERROR;
+    }
+
+    config.baud_rate = BATCH_RX_BAUD;
+    config.bufsz = BATCH_RX_DMA_BUFSZ;
+    rt_device_control(batch_dev, RT_DEVICE_CTRL_CONFIG, &config);
+
+    bp_decoder_init(&frame_decoder);
+    bp_receiver_init(&frame_receiver);
+    rt_sem_init(&batch_rx_sem, "batch_rx", 0, RT_IPC_FLAG_FIFO);
+    if (rt_device_open(batch_dev, RT_DEVICE_FLAG_DMA_RX) != RT_EOK)
+    {
+        rt_kprintf("Failed to open %s\n", uart_name);
+        return -RT_ERROR;
+    }
+    rt_device_set_rx_indicate(batch_dev, batch_rx_indicate);
+
+    if (rt_thread_init(&batch_thread, "batch_rx", batch_rx_thread, RT_NULL,
+                       batch_thread_stack, sizeof(batch_thread_stack),
+                       BATCH_RX_THREAD_PRIO, 10) != RT_EOK)
+    {
+        rt_kprintf("Failed to start batch_rx thread.\n");
+        return -RT_ERROR;
+    }
+    rt_thread_startup(&batch_thread);
+    return RT_EOK;
+}
+
+void batch_rx_set_handler(batch_handler_t handler)
+{
+    batch_handler = handler;
+}
+
+void batch_rx_get_stats(BatchRxStats *stats)
+{
+    *stats = batch_stats;
+}
@@ -0,0 +1,43 @@
+﻿#ifndef __BATCH_RX_H__
+#define __BATCH_RX_H__
+
+#include <rtthread.h>
+#include <rtdevice.h>
+
+#define BATCH_RX_BAUD         BAUD_RATE_115200
+#define BATCH_RX_DMA_BUFSZ    1024  // 驱动的 DMA 接收缓冲（字节），处理函数写闪存擦块时（约 45 ms）要能接住
+#define BATCH_RX_RING_SIZE    512   // 解析环形缓冲（字节），须为 2 的幂
+#define BATCH_RX_THREAD_PRIO  22    // 低于各组工作线程，不抢运动控制
+#define BATCH_RX_STACK        768
+
+/* 一条批次记录：文本行 "TYPE<n>-yyyyMMdd"（一件），或批次帧里的一条 */
+typedef struct {
+    rt_uint8_t type;                // 商品类型编号 n
+    rt_uint32_t date;               // 生产日期，十进制 yyyyMMdd
+    rt_uint16_t count;              // 件数
+} BatchRecord;
+
+typedef struct {
+    rt_uint32_t bytes;              // 收到的字节数
+    rt_uint32_t records;            // 解析出的记录数
+    rt_uint32_t errors;             // 格式不对、被丢弃的行数
+    rt_uint32_t rejected;           // 处理函数拒收、跳过的记录
+    rt_uint32_t deferred;           // 暂时没能入库、等上位机重发的记录
+    rt_uint32_t frames;             // 收到的完好批次帧（含重发）
+    rt_uint32_t crc_errors;         // 长度或 CRC 不对的帧
+    rt_uint32_t duplicates;         // 重发来的重复帧
+} BatchRxStats;
+
+/*
+ * 记录处理函数，在接收线程中调用，可以阻塞，但阻塞期间不再取数据。
+ * 返回 RT_EOK 表示已入库；-RT_EINVAL、-RT_EFULL 表示这条记录重发也存不
+ * 进去，跳过它照样回 ACK；其他错误（如闪存写失败）不回这一帧的 ACK，
+ * 等上位机重发。
+ */
+typedef rt_err_t (*batch_handler_t)(const BatchRecord *record);
+
+rt_err_t batch_rx_init(const char *uart_name);
+void batch_rx_set_handler(batch_handler_t handler);
+void batch_rx_get_stats(BatchRxStats *stats);
+
+#endif
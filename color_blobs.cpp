@@ -0,0 +1,341 @@
+﻿#include "color_blobs.h"
+
+#include <math.h>
+#include <string.h>
+
+/*
+ * 单趟多阈值色块检测。
+ *
+ * 逐行处理：先按查找表把一行 RGB565 拆成 L、A、B 三个 int8 数组，再对每个
+ * 阈值在整行上做一遍区间比较，结果按位或进每像素一个字节的掩码。比较循环
+ * 没有分支、数据连续，按 COLOR_BLOB_LANES 个像素一块处理，编译器可以向量化
+ * （x86 上是 SSE，ARM 上是 NEON/Helium）。
+ *
+ * 掩码按阈值拆成行程，每段行程只和上一行同一阈值的行程比较，x 区间相交
+ * 就在并查集里合并（即 4 连通）。两行的行程都按 x 有序，双指针一遍扫完。
+ * 合并时总把后来的根挂到先来的根下，整帧扫完后按行程顺序累计，根上的统计
+ * 量一定先于其余成员建立。
+ */
+
+static int8_t lab_l[65536];
+static int8_t lab_a[65536];
+static int8_t lab_b[65536];
+static int lab_ready = 0;
+
+static float lab_linear(int c)
+{
+    float v = c / 255.0f;
+    return v <= 0.04045f ? v / 12.92f : powf((v + 0.055f) / 1.055f, 2.4f);
+}
+
+static float lab_f(float t)
+{
+    return t > 0.008856f ? cbrtf(t) : 7.787f * t + 16.0f / 116.0f;
+}
+
+static int8_t lab_clamp(float v, int lo, int hi)
+{
+    int n = (int)floorf(v + 0.5f);
+    return (int8_t)(n < lo ? lo : (n > hi ? hi : n));
+}
+
+/* sRGB（D65）到 CIE LAB，与 OpenMV 的换算相同 */
+void color_lab_init(void)
+{
+    float linear5[32], linear6[64];
+    int i;
+
+    if (lab_ready)
+        return;
+
+    for (i = 0; i < 32; i++)
+        linear5[i] = lab_linear((i * 255 + 15) / 31);
+    for (i = 0; i < 64; i++)
+        linear6[i] = lab_linear((i * 255 + 31) / 63);
+
+    for (i = 0; i < 65536; i++)
+    {
+        float r = linear5[i >> 11];
+        float g = linear6[(i >> 5) & 0x3F];
+        float b = linear5[i & 0x1F];
+        float x = lab_f((r * 0.4124f + g * 0.3576f + b * 0.1805f) / 0.95047f);
+        float y = lab_f(r * 0.2126f + g * 0.7152f + b * 0.0722f);
+        float z = lab_f((r * 0.0193f + g * 0.1192f + b * 0.9505f) / 1.08883f);
+
+        lab_l[i] = lab_clamp(116.0f * y - 16.0f, 0, 100);
+        lab_a[i] = lab_clamp(500.0f * (x - y), -128, 127);
+        lab_b[i] = lab_clamp(200.0f * (y - z), -128, 127);
+    }
+    lab_ready = 1;
+}
+
+void color_lab_get(uint16_t rgb565, int8_t *l, int8_t *a, int8_t *b)
+{
+    *l = lab_l[rgb565];
+    *a = lab_a[rgb565];
+    *b = lab_b[rgb565];
+}
+
+int color_lab_match(const LabThreshold *threshold, uint16_t rgb565)
+{
+    int8_t l = lab_l[rgb565], a = lab_a[rgb565], b = lab_b[rgb565];
+
+    return l >= threshold->l_min && l <= threshold->l_max &&
+           a >= threshold->a_min && a <= threshold->a_max &&
+           b >= threshold->b_min && b <= threshold->b_max;
+}
+
+/* 一行分类，返回整行掩码的按位或，为 0 时这一行没有任何命中 */
+static uint8_t classify_row(ColorBlobWork *work, const uint16_t *row, int width,
+                            const LabThreshold *thresholds, int count)
+{
+    int8_t *__restrict l = work->l;
+    int8_t *__restrict a = work->a;
+    int8_t *__restrict b = work->b;
+    uint8_t *__restrict mask = work->mask;
+    int padded = (width + COLOR_BLOB_LANES - 1) & ~(COLOR_BLOB_LANES - 1);
+    uint8_t any = 0;
+    int x, k, t;
+
+    /* 查表是逐点取数，向量化不了，单独一个循环 */
+    for (x = 0; x < width; x++)
+    {
+        uint16_t p = row[x];
+        l[x] = lab_l[p];
+        a[x] = lab_a[p];
+        b[x] = lab_b[p];
+    }
+
+    /* 块长是常数，-O2 下编译器也肯把内层循环展开成向量比较；末块多出的像素最后清掉 */
+    for (x = 0; x < padded; x += COLOR_BLOB_LANES)
+    {
+        uint8_t m[COLOR_BLOB_LANES] = { 0 };
+
+        for (t = 0; t < count; t++)
+        {
+            const int8_t l0 = thresholds[t].l_min, l1 = thresholds[t].l_max;
+            const int8_t a0 = thresholds[t].a_min, a1 = thresholds[t].a_max;
+            const int8_t b0 = thresholds[t].b_min, b1 = thresholds[t].b_max;
+            const uint8_t bit = (uint8_t)(1 << t);
+
+            for (k = 0; k < COLOR_BLOB_LANES; k++)
+            {
+                uint8_t hit = (uint8_t)((l[x + k] >= l0) & (l[x + k] <= l1) &
+                                        (a[x + k] >= a0) & (a[x + k] <= a1) &
+                                        (b[x + k] >= b0) & (b[x + k] <= b1));
+                m[k] |= (uint8_t)(-hit & bit);
+            }
+        }
+        for (k = 0; k < COLOR_BLOB_LANES; k++)
+            mask[x + k] = m[k];
+    }
+    for (x = width; x < padded; x++)
+        mask[x] = 0;
+
+    for (x = 0; x < padded; x += COLOR_BLOB_LANES)
+    {
+        for (k = 0; k < COLOR_BLOB_LANES; k++)
+            any |= mask[x + k];
+    }
+    return any;
+}
+
+static int run_find(ColorBlobWork *work, int i)
+{
+    while (work->parent[i] != i)
+    {
+        work->parent[i] = work->parent[work->parent[i]];
+        i = work->parent[i];
+    }
+    return i;
+}
+
+static void run_union(ColorBlobWork *work, int i, int j)
+{
+    i = run_find(work, i);
+    j = run_find(work, j);
+    if (i < j)
+        work->parent[j] = (uint16_t)i;
+    else if (j < i)
+        work->parent[i] = (uint16_t)j;
+}
+
+/* 把本行某阈值的行程 [cur, cur_end) 与上一行的 [prev, prev_end) 按 x 相交合并 */
+static void run_connect(ColorBlobWork *work, int prev, int prev_end, int cur, int cur_end)
+{
+    const ColorBlobRun *runs = work->runs;
+
+    while (prev < prev_end && cur < cur_end)
+    {
+        if (runs[prev].x2 < runs[cur].x1)
+        {
+            prev++;
+        }
+        else if (runs[cur].x2 < runs[prev].x1)
+        {
+            cur++;
+        }
+        else
+        {
+            run_union(work, prev, cur);
+            if (runs[prev].x2 < runs[cur].x2)
+                prev++;
+            else
+                cur++;
+        }
+    }
+}
+
+static int rect_overlap(const ColorBlob *p, const ColorBlob *q)
+{
+    return p->x < q->x + q->w && q->x < p->x + p->w &&
+           p->y < q->y + q->h && q->y < p->y + p->h;
+}
+
+int color_blobs_merge(ColorBlob *blobs, int count)
+{
+    int i, j, merged = 1;
+
+    /* 合并后矩形变大，可能又碰到别的色块，直到一轮里没有可合并的为止 */
+    while (merged)
+    {
+        merged = 0;
+        for (i = 0; i < count; i++)
+        {
+            for (j = i + 1; j < count; j++)
+            {
+                ColorBlob *p = &blobs[i];
+                const ColorBlob *q = &blobs[j];
+                int x2, y2;
+                uint32_t pixels;
+
+                if (p->code != q->code || !rect_overlap(p, q))
+                    continue;
+
+                x2 = p->x + p->w > q->x + q->w ? p->x + p->w : q->x + q->w;
+                y2 = p->y + p->h > q->y + q->h ? p->y + p->h : q->y + q->h;
+                pixels = p->pixels + q->pixels;
+                p->cx = (int16_t)((p->cx * p->pixels + q->cx * q->pixels + pixels / 2) / pixels);
+                p->cy = (int16_t)((p->cy * p->pixels + q->cy * q->pixels + pixels / 2) / pixels);
+                p->x = p->x < q->x ? p->x : q->x;
+                p->y = p->y < q->y ? p->y : q->y;
+                p->w = (int16_t)(x2 - p->x);
+                p->h = (int16_t)(y2 - p->y);
+                p->pixels = pixels;
+
+                blobs[j--] = blobs[--count];
+                merged = 1;
+            }
+        }
+    }
+    return count;
+}
+
+int color_blobs_find(const uint16_t *image, int width, int height,
+                     const LabThreshold *thresholds, int count,
+                     uint32_t pixels_threshold, uint32_t area_threshold, int merge,
+                     ColorBlob *blobs, int max, ColorBlobWork *work)
+{
+    int prev_first[COLOR_BLOB_THRESHOLDS_MAX], prev_end[COLOR_BLOB_THRESHOLDS_MAX];
+    int x, y, t, i, found = 0;
+
+    if (width <= 0 || width > COLOR_BLOB_WIDTH_MAX || height <= 0 ||
+        count <= 0 || count > COLOR_BLOB_THRESHOLDS_MAX)
+        return -1;
+
+    color_lab_init();
+    work->run_count = 0;
+    for (t = 0; t < count; t++)
+        prev_first[t] = prev_end[t] = 0;
+
+    for (y = 0; y < height; y++)
+    {
+        uint8_t any = classify_row(work, image + y * width, width, thresholds, count);
+
+        for (t = 0; t < count; t++)
+        {
+            const uint8_t bit = (uint8_t)(1 << t);
+            int first = work->run_count;
+
+            x = 0;
+            while ((any & bit) && x < width)
+            {
+                ColorBlobRun *run;
+                int start;
+
+                if (!(work->mask[x] & bit))
+                {
+                    x++;
+                    continue;
+                }
+                start = x;
+                while (x < width && (work->mask[x] & bit))
+                    x++;
+
+                if (work->run_count == COLOR_BLOB_RUNS_MAX)
+                    return -1;
+                run = &work->runs[work->run_count];
+                run->x1 = (int16_t)start;
+                run->x2 = (int16_t)(x - 1);
+                run->y = (int16_t)y;
+                run->threshold = (uint8_t)t;
+                work->parent[work->run_count] = (uint16_t)work->run_count;
+                work->run_count++;
+            }
+
+            run_connect(work, prev_first[t], prev_end[t], first, work->run_count);
+            prev_first[t] = first;
+            prev_end[t] = work->run_count;
+        }
+    }
+
+    /* 根在前，按行程顺序一遍累计完 */
+    for (i = 0; i < work->run_count; i++)
+    {
+        const ColorBlobRun *run = &work->runs[i];
+        int root = run_find(work, i);
+        ColorBlobStats *s = &work->stats[root];
+        uint32_t n = (uint32_t)(run->x2 - run->x1 + 1);
+
+        if (root == i)
+        {
+            s->x1 = run->x1;
+            s->x2 = run->x2;
+            s->y1 = s->y2 = run->y;
+            s->pixels = 0;
+            s->sum_x = s->sum_y = 0;
+        }
+        if (run->x1 < s->x1) s->x1 = run->x1;
+        if (run->x2 > s->x2) s->x2 = run->x2;
+        s->y2 = run->y;
+        s->pixels += n;
+        s->sum_x += (uint32_t)(run->x1 + run->x2) * n / 2;
+        s->sum_y += (uint32_t)run->y * n;
+    }
+
+    for (i = 0; i < work->run_count && found < max; i++)
+    {
+        const ColorBlobStats *s = &work->stats[i];
+        ColorBlob *blob;
+        uint32_t w, h;
+
+        if (work->parent[i] != i)
+            continue;
+        w = (uint32_t)(s->x2 - s->x1 + 1);
+        h = (uint32_t)(s->y2 - s->y1 + 1);
+        if (s->pixels < pixels_threshold || w * h < area_threshold)
+            continue;
+
+        blob = &blobs[found++];
+        blob->x = s->x1;
+        blob->y = s->y1;
+        blob->w = (int16_t)w;
+        blob->h = (int16_t)h;
+        blob->cx = (int16_t)((s->sum_x + s->pixels / 2) / s->pixels);
+        blob->cy = (int16_t)((s->sum_y + s->pixels / 2) / s->pixels);
+        blob->pixels = s->pixels;
+        blob->code = (uint8_t)(1 << work->runs[i].threshold);
+    }
+
+    return merge ? color_blobs_merge(blobs, found) : found;
+}
@@ -0,0 +1,79 @@
+﻿#ifndef __COLOR_BLOBS_H__
+#define __COLOR_BLOBS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * RGB565 图像的多阈值 LAB 色块检测，不依赖操作系统。
+ *
+ * 与 OpenMV 的 find_blobs 对应：阈值为 (L_min, L_max, A_min, A_max, B_min,
+ * B_max)，每个阈值各自找 4 连通的色块，色块的 code 为 1 << 阈值下标，
+ * pixels_threshold / area_threshold / merge 的含义相同，merge 只合并同一
+ * 阈值下外接矩形相交的色块。区别在于所有阈值一趟扫完，不再每个阈值各扫
+ * 一遍图像。
+ */
+
+#define COLOR_BLOB_THRESHOLDS_MAX   8       // 阈值个数上限，每个像素的分类结果占一个字节
+#define COLOR_BLOB_WIDTH_MAX        320     // 行缓冲宽度（QVGA），须为 COLOR_BLOB_LANES 的倍数
+#define COLOR_BLOB_LANES            16      // 分类时一块的像素数，即一条 128 位向量
+#define COLOR_BLOB_RUNS_MAX         4096    // 一帧里最多记录的行程数，所有阈值合计
+
+/* LAB 阈值，闭区间，L 为 0~100，A、B 为 -128~127 */
+typedef struct {
+    int8_t l_min, l_max;
+    int8_t a_min, a_max;
+    int8_t b_min, b_max;
+} LabThreshold;
+
+typedef struct {
+    int16_t x, y, w, h;             // 外接矩形
+    int16_t cx, cy;                 // 重心，四舍五入到像素
+    uint32_t pixels;
+    uint8_t code;                   // 1 << 阈值下标
+} ColorBlob;
+
+/* 一段行程：同一行里同一阈值下连续命中的像素 */
+typedef struct {
+    int16_t x1, x2;                 // 含端点
+    int16_t y;
+    uint8_t threshold;
+} ColorBlobRun;
+
+/* 一个连通域的累计量，挂在它的根行程上 */
+typedef struct {
+    int16_t x1, y1, x2, y2;
+    uint32_t pixels;
+    uint32_t sum_x, sum_y;
+} ColorBlobStats;
+
+/* 检测用的工作区，体积较大，应静态分配；同一时刻只能给一次检测用 */
+typedef struct {
+    int8_t l[COLOR_BLOB_WIDTH_MAX];
+    int8_t a[COLOR_BLOB_WIDTH_MAX];
+    int8_t b[COLOR_BLOB_WIDTH_MAX];
+    uint8_t mask[COLOR_BLOB_WIDTH_MAX];     // 每像素一位一个阈值
+    ColorBlobRun runs[COLOR_BLOB_RUNS_MAX];
+    uint16_t parent[COLOR_BLOB_RUNS_MAX];   // 并查集，根总是集合里最早的行程
+    ColorBlobStats stats[COLOR_BLOB_RUNS_MAX];
+    int run_count;
+} ColorBlobWork;
+
+/* 生成 RGB565 到 LAB 的查找表（每表 64K 项），首次检测前调用一次 */
+void color_lab_init(void);
+void color_lab_get(uint16_t rgb565, int8_t *l, int8_t *a, int8_t *b);
+int color_lab_match(const LabThreshold *threshold, uint16_t rgb565);
+
+/*
+ * 找色块，结果写进 blobs（最多 max 个），返回找到的个数。
+ * 行程数超过 COLOR_BLOB_RUNS_MAX 或参数不对时返回 -1。
+ */
+int color_blobs_find(const uint16_t *image, int width, int height,
+                     const LabThreshold *thresholds, int count,
+                     uint32_t pixels_threshold, uint32_t area_threshold, int merge,
+                     ColorBlob *blobs, int max, ColorBlobWork *work);
+
+/* 把同一 code 下外接矩形相交的色块合并，返回剩下的个数 */
+int color_blobs_merge(ColorBlob *blobs, int count);
+
+#endif
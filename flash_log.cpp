@@ -0,0 +1,173 @@
+﻿#include "flash_log.h"
+#include "batch_proto.h"
+#include <string.h>
+
+/* 块头：第 0 条记录 */
+typedef struct {
+    rt_uint8_t kind;                    // FLASH_LOG_HEADER
+    rt_uint8_t reserved[3];
+    rt_uint32_t generation;
+    rt_uint32_t magic;
+    rt_uint16_t reserved2;
+    rt_uint16_t crc;
+} FlashLogHeader;
+
+#define FLASH_LOG_CRC_SIZE      (FLASH_LOG_RECORD_SIZE - 2)
+
+static rt_uint32_t flash_log_offset(const FlashLog *log, int block, rt_uint32_t slot)
+{
+    return block * log->block_size + slot * FLASH_LOG_RECORD_SIZE;
+}
+
+rt_err_t flash_log_open(FlashLog *log, const char *partition, rt_uint32_t magic)
+{
+    const struct fal_partition *part;
+    const struct fal_flash_dev *flash;
+
+    memset(log, 0, sizeof(*log));
+    part = fal_partition_find(partition);
+    if (part == RT_NULL)
+    {
+        rt_kprintf("Partition %s not found!\n", partition);
+        return -RT_ERROR;
+    }
+    flash = fal_flash_device_find(part->flash_name);
+    if (flash == RT_NULL)
+        return -RT_ERROR;
+    if (part->len / flash->blk_size < 2)
+    {
+        rt_kprintf("Partition %s needs at least 2 blocks\n", partition);
+        return -RT_ERROR;
+    }
+
+    log->part = part;
+    log->magic = magic;
+    log->block_size = flash->blk_size;
+    log->blocks = part->len / flash->blk_size;
+    return RT_EOK;
+}
+
+rt_uint32_t flash_log_slots(const FlashLog *log)
+{
+    return log->block_size / FLASH_LOG_RECORD_SIZE;
+}
+
+rt_err_t flash_log_write(const FlashLog *log, int block, rt_uint32_t slot, void *rec)
+{
+    rt_uint8_t *bytes = (rt_uint8_t *)rec;
+    rt_uint16_t crc = bp_crc16(bytes, FLASH_LOG_CRC_SIZE);
+
+    bytes[FLASH_LOG_CRC_SIZE] = (rt_uint8_t)crc;
+    bytes[FLASH_LOG_CRC_SIZE + 1] = (rt_uint8_t)(crc >> 8);
+    if (fal_partition_write(log->part, flash_log_offset(log, block, slot), bytes,
+                            FLASH_LOG_RECORD_SIZE) != FLASH_LOG_RECORD_SIZE)
+        return -RT_EIO;
+    return RT_EOK;
+}
+
+rt_err_t flash_log_read(const FlashLog *log, int block, rt_uint32_t slot, void *rec)
+{
+    static const rt_uint8_t blank[FLASH_LOG_RECORD_SIZE] = {
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    };
+    rt_uint8_t *bytes = (rt_uint8_t *)rec;
+
+    if (fal_partition_read(log->part, flash_log_offset(log, block, slot), bytes,
+                           FLASH_LOG_RECORD_SIZE) != FLASH_LOG_RECORD_SIZE)
+        return -RT_EIO;
+    if (!memcmp(bytes, blank, FLASH_LOG_RECORD_SIZE))
+        return -RT_EEMPTY;
+    if ((bytes[FLASH_LOG_CRC_SIZE] | (bytes[FLASH_LOG_CRC_SIZE + 1] << 8)) !=
+        bp_crc16(bytes, FLASH_LOG_CRC_SIZE))
+        return -RT_ERROR;
+    return RT_EOK;
+}
+
+/* 每轮只在排在上一次取过的块之后的块里找最新的，块数不受限制 */
+rt_bool_t flash_log_older(const FlashLog *log, int *block, rt_uint32_t *generation)
+{
+    int best = -1;
+    rt_uint32_t best_gen = 0;
+    FlashLogHeader header;
+
+    for (int b = 0; b < log->blocks; b++)
+    {
+        if (flash_log_read(log, b, 0, &header) != RT_EOK ||
+            header.kind != FLASH_LOG_HEADER || header.magic != log->magic)
+            continue;
+        if (*block >= 0 &&
+            (header.generation > *generation || (header.generation == *generation && b >= *block)))
+            continue;
+        if (best < 0 || header.generation >= best_gen)
+        {
+            best = b;
+            best_gen = header.generation;
+        }
+    }
+    if (best < 0)
+        return RT_FALSE;
+    *block = best;
+    *generation = best_gen;
+    return RT_TRUE;
+}
+
+rt_uint32_t flash_log_replay(const FlashLog *log, int block, flash_log_apply_t apply, rt_bool_t *torn)
+{
+    rt_uint8_t rec[FLASH_LOG_RECORD_SIZE];
+    rt_uint32_t slot;
+
+    *torn = RT_FALSE;
+    for (slot = 1; slot < flash_log_slots(log); slot++)
+    {
+        rt_err_t result = flash_log_read(log, block, slot, rec);
+
+        if (result == -RT_EEMPTY)
+            break;
+        if (result != RT_EOK)
+        {
+            *torn = RT_TRUE;
+            break;
+        }
+        apply(rec);
+    }
+    return slot;
+}
+
+rt_err_t flash_log_compact(FlashLog *log, flash_log_snapshot_t snapshot)
+{
+    int next = (log->block + 1) % log->blocks;
+    rt_uint32_t slot = 0;
+    FlashLogHeader rec;                 // 块头和快照共用一条缓冲
+
+    if (fal_partition_erase(log->part, next * log->block_size, log->block_size) < 0)
+        return -RT_EIO;
+
+    memset(&rec, 0, sizeof(rec));
+    rec.kind = FLASH_LOG_HEADER;
+    rec.generation = log->generation + 1;
+    rec.magic = log->magic;
+    if (flash_log_write(log, next, slot++, &rec) != RT_EOK)
+        return -RT_EIO;
+
+    while (snapshot(slot - 1, &rec))
+    {
+        if (slot >= flash_log_slots(log) || flash_log_write(log, next, slot++, &rec) != RT_EOK)
+            return -RT_EIO;
+    }
+
+    log->block = next;
+    log->generation++;
+    log->slot = slot;
+    return RT_EOK;
+}
+
+rt_err_t flash_log_append(FlashLog *log, void *rec, rt_uint32_t reserve, flash_log_snapshot_t snapshot)
+{
+    if (log->slot + reserve >= flash_log_slots(log) && flash_log_compact(log, snapshot) != RT_EOK)
+        return -RT_EIO;
+    if (flash_log_write(log, log->block, log->slot, rec) != RT_EOK)
+        return -RT_EIO;
+    log->slot++;
+    return RT_EOK;
+}
@@ -0,0 +1,56 @@
+﻿#ifndef __FLASH_LOG_H__
+#define __FLASH_LOG_H__
+
+#include <rtthread.h>
+#include <fal.h>
+
+/*
+ * 闪存分区上只追加的记录日志，库存日志和滑台位置日志共用。
+ *
+ * 分区按擦除块轮流使用，同一时刻只有一块在写。每条记录 16 字节，第 0
+ * 字节为类型，最后 2 字节为前 14 字节的 CRC-16/CCITT（bp_crc16）。每块
+ * 第 0 条是块头（FLASH_LOG_HEADER，带代数和魔数），之后是调用者写的
+ * 快照，再逐条追加。写满时擦除下一块，写代数加一的块头和快照后再接着
+ * 写；旧块要等轮到它时才擦，新块的快照写完之前断电，启动时仍可用旧块。
+ */
+
+#define FLASH_LOG_RECORD_SIZE   16
+#define FLASH_LOG_HEADER        0x01    // 块头的记录类型，各日志自己的类型不能用它
+
+typedef struct {
+    const struct fal_partition *part;   // RT_NULL 为没有挂载
+    rt_uint32_t magic;
+    rt_uint32_t block_size;
+    int blocks;
+    int block;                          // 当前写入的块
+    rt_uint32_t generation;             // 当前块的代数
+    rt_uint32_t slot;                   // 当前块下一条记录的位置（0 为块头）
+} FlashLog;
+
+/* 换块时取快照的第 index 条填进 rec（不用填 CRC），超出末尾时返回 RT_FALSE */
+typedef rt_bool_t (*flash_log_snapshot_t)(rt_uint32_t index, void *rec);
+/* 重放时逐条交出块头之后的记录 */
+typedef void (*flash_log_apply_t)(const void *rec);
+
+/* 挂载分区，至少要有 2 块；不读日志 */
+rt_err_t flash_log_open(FlashLog *log, const char *partition, rt_uint32_t magic);
+rt_uint32_t flash_log_slots(const FlashLog *log);
+
+/* 写一条，填好 CRC；读一条：空白返回 -RT_EEMPTY，CRC 不对返回 -RT_ERROR */
+rt_err_t flash_log_write(const FlashLog *log, int block, rt_uint32_t slot, void *rec);
+rt_err_t flash_log_read(const FlashLog *log, int block, rt_uint32_t slot, void *rec);
+
+/*
+ * 启动时按（代数，块号）从新到旧逐个取块头完好的块：*block 为 -1 时取
+ * 最新的，否则取排在 (*generation, *block) 之后的；没有了返回 RT_FALSE
+ */
+rt_bool_t flash_log_older(const FlashLog *log, int *block, rt_uint32_t *generation);
+/* 重放一块直到空白记录，遇到残缺记录时 *torn 置位；返回下一条的位置 */
+rt_uint32_t flash_log_replay(const FlashLog *log, int block, flash_log_apply_t apply, rt_bool_t *torn);
+
+/* 换到下一块：擦除，写块头和快照，快照写完才算切换成功 */
+rt_err_t flash_log_compact(FlashLog *log, flash_log_snapshot_t snapshot);
+/* 追加一条，当前块剩余不足 reserve 条时先换块 */
+rt_err_t flash_log_append(FlashLog *log, void *rec, rt_uint32_t reserve, flash_log_snapshot_t snapshot);
+
+#endif
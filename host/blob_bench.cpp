@@ -0,0 +1,71 @@
+﻿/*
+ * 色块检测的帧率对比：OpenMV 脚本现在的做法（粉、棕两个阈值各调一次
+ * find_blobs，各扫一遍整帧）与单趟多阈值检测，在存下来的 QQVGA 托盘帧上
+ * 各跑若干轮，参数与脚本相同（pixels/area_threshold=100，merge=True）。
+ * 两种做法都用 color_blobs_find，只差在一趟带几个阈值，对比的就是趟数。
+ */
+
+#include "blob_reference.h"
+
+#include <chrono>
+#include <cstdio>
+
+#define BENCH_ROUNDS    300     /* 每帧每种做法跑的次数 */
+
+namespace
+{
+
+const LabThreshold thresholds[2] = {
+    { 30, 60, 20, 50, 10, 40 },     /* 粉色 */
+    { 20, 50, 10, 30, 20, 50 },     /* 棕色 */
+};
+
+ColorBlobWork work;
+volatile uint32_t sink;             /* 防止结果被优化掉 */
+
+template <typename F>
+double frames_per_second(F detect)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < BENCH_ROUNDS; i++)
+        sink = sink + detect();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return BENCH_ROUNDS / seconds;
+}
+
+} // namespace
+
+int main()
+{
+    std::vector<Frame> frames = frame_load_dir(BLOB_FRAMES_DIR);
+
+    if (frames.empty())
+    {
+        std::printf("no frames in %s\n", BLOB_FRAMES_DIR);
+        return 1;
+    }
+    color_lab_init();
+
+    for (const Frame &frame : frames)
+    {
+        double two_pass = frames_per_second([&] {
+            /* 与脚本一样：每个阈值单独一次 */
+            ColorBlob blobs[32];
+            uint32_t found = 0;
+            for (const LabThreshold &threshold : thresholds)
+                found += (uint32_t)color_blobs_find(frame.pixels.data(), frame.width, frame.height,
+                                                    &threshold, 1, 100, 100, 1, blobs, 32, &work);
+            return found;
+        });
+        double one_pass = frames_per_second([&] {
+            ColorBlob blobs[32];
+            return (uint32_t)color_blobs_find(frame.pixels.data(), frame.width, frame.height,
+                                              thresholds, 2, 100, 100, 1, blobs, 32, &work);
+        });
+
+        std::printf("%-18s %dx%d  two-pass %7.0f fps  single-pass %7.0f fps  x%.1f\n",
+                    frame.name.c_str(), frame.width, frame.height, two_pass, one_pass,
+                    one_pass / two_pass);
+    }
+    return 0;
+}
@@ -0,0 +1,141 @@
+﻿#include "blob_reference.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include <dirent.h>
+
+uint16_t rgb565(int r, int g, int b)
+{
+    return (uint16_t)(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+}
+
+bool frame_load_ppm(const std::string &path, Frame *frame)
+{
+    FILE *f = std::fopen(path.c_str(), "rb");
+    int maxval = 0;
+
+    if (f == nullptr)
+        return false;
+    if (std::fscanf(f, "P6 %d %d %d", &frame->width, &frame->height, &maxval) != 3 ||
+        maxval != 255 || std::fgetc(f) == EOF)
+    {
+        std::fclose(f);
+        return false;
+    }
+
+    std::vector<uint8_t> rgb((size_t)frame->width * frame->height * 3);
+    bool ok = std::fread(rgb.data(), 1, rgb.size(), f) == rgb.size();
+    std::fclose(f);
+
+    frame->pixels.resize((size_t)frame->width * frame->height);
+    for (size_t i = 0; i < frame->pixels.size(); i++)
+        frame->pixels[i] = rgb565(rgb[i * 3], rgb[i * 3 + 1], rgb[i * 3 + 2]);
+
+    size_t slash = path.find_last_of('/');
+    frame->name = path.substr(slash == std::string::npos ? 0 : slash + 1);
+    return ok;
+}
+
+std::vector<Frame> frame_load_dir(const std::string &dir)
+{
+    std::vector<std::string> names;
+    std::vector<Frame> frames;
+    DIR *d = opendir(dir.c_str());
+
+    if (d == nullptr)
+        return frames;
+    while (struct dirent *e = readdir(d))
+    {
+        std::string name = e->d_name;
+        if (name.size() > 4 && name.compare(name.size() - 4, 4, ".ppm") == 0)
+            names.push_back(name);
+    }
+    closedir(d);
+    std::sort(names.begin(), names.end());
+
+    for (const std::string &name : names)
+    {
+        Frame frame;
+        if (frame_load_ppm(dir + "/" + name, &frame))
+            frames.push_back(frame);
+    }
+    return frames;
+}
+
+std::vector<ColorBlob> reference_find_blobs(const Frame &frame, const LabThreshold *thresholds,
+                                            int count, uint32_t pixels_threshold,
+                                            uint32_t area_threshold, bool merge)
+{
+    const int w = frame.width, h = frame.height;
+    std::vector<ColorBlob> blobs;
+    std::vector<uint8_t> visited((size_t)w * h);
+    std::vector<int> stack;
+
+    color_lab_init();
+    for (int t = 0; t < count; t++)
+    {
+        std::fill(visited.begin(), visited.end(), 0);
+
+        for (int y = 0; y < h; y++)
+        {
+            for (int x = 0; x < w; x++)
+            {
+                if (visited[y * w + x] || !color_lab_match(&thresholds[t], frame.pixels[y * w + x]))
+                    continue;
+
+                int x1 = x, x2 = x, y1 = y, y2 = y;
+                uint64_t pixels = 0, sum_x = 0, sum_y = 0;
+
+                visited[y * w + x] = 1;
+                stack.push_back(y * w + x);
+                while (!stack.empty())
+                {
+                    int p = stack.back(), px = p % w, py = p / w;
+                    stack.pop_back();
+
+                    pixels++;
+                    sum_x += px;
+                    sum_y += py;
+                    x1 = std::min(x1, px);
+                    x2 = std::max(x2, px);
+                    y1 = std::min(y1, py);
+                    y2 = std::max(y2, py);
+
+                    const int nx[4] = { px - 1, px + 1, px, px };
+                    const int ny[4] = { py, py, py - 1, py + 1 };
+                    for (int k = 0; k < 4; k++)
+                    {
+                        if (nx[k] < 0 || nx[k] >= w || ny[k] < 0 || ny[k] >= h)
+                            continue;
+                        int q = ny[k] * w + nx[k];
+                        if (!visited[q] && color_lab_match(&thresholds[t], frame.pixels[q]))
+                        {
+                            visited[q] = 1;
+                            stack.push_back(q);
+                        }
+                    }
+                }
+
+                uint32_t bw = x2 - x1 + 1, bh = y2 - y1 + 1;
+                if (pixels < pixels_threshold || bw * bh < area_threshold)
+                    continue;
+
+                ColorBlob blob;
+                blob.x = (int16_t)x1;
+                blob.y = (int16_t)y1;
+                blob.w = (int16_t)bw;
+                blob.h = (int16_t)bh;
+                blob.cx = (int16_t)((sum_x + pixels / 2) / pixels);
+                blob.cy = (int16_t)((sum_y + pixels / 2) / pixels);
+                blob.pixels = (uint32_t)pixels;
+                blob.code = (uint8_t)(1 << t);
+                blobs.push_back(blob);
+            }
+        }
+    }
+
+    if (merge)
+        blobs.resize(color_blobs_merge(blobs.data(), (int)blobs.size()));
+    return blobs;
+}
@@ -0,0 +1,36 @@
+﻿#ifndef __BLOB_REFERENCE_H__
+#define __BLOB_REFERENCE_H__
+
+#include "color_blobs.h"
+
+#include <string>
+#include <vector>
+
+/*
+ * 色块检测的对照实现和测试帧读取，供 blob_test 和 blob_bench 共用。
+ *
+ * 对照实现照 OpenMV 现在的用法：每个阈值单独扫一遍整帧，每个像素查表
+ * 比较，遇到未访问的命中像素就 4 连通漫水填充出整个色块。
+ */
+
+struct Frame
+{
+    std::string name;
+    int width = 0;
+    int height = 0;
+    std::vector<uint16_t> pixels;   /* RGB565 */
+};
+
+/* 读二进制 PPM（P6，8 位），转成 RGB565 */
+bool frame_load_ppm(const std::string &path, Frame *frame);
+
+/* 目录下的 *.ppm，按文件名排序 */
+std::vector<Frame> frame_load_dir(const std::string &dir);
+
+uint16_t rgb565(int r, int g, int b);
+
+std::vector<ColorBlob> reference_find_blobs(const Frame &frame, const LabThreshold *thresholds,
+                                            int count, uint32_t pixels_threshold,
+                                            uint32_t area_threshold, bool merge);
+
+#endif
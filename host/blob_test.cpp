@@ -0,0 +1,228 @@
+﻿/*
+ * 色块检测的单元测试：查找表、连通性、多阈值重叠、溢出，以及对存下来的
+ * 托盘帧逐帧与两趟对照实现比对结果。
+ */
+
+#include "blob_reference.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <tuple>
+
+#define FRAME_W     160     /* QQVGA */
+#define FRAME_H     120
+
+namespace
+{
+
+/* 与 OpenMV 脚本里的阈值相同 */
+const LabThreshold pink_threshold = { 30, 60, 20, 50, 10, 40 };
+const LabThreshold brown_threshold = { 20, 50, 10, 30, 20, 50 };
+const LabThreshold script_thresholds[2] = { pink_threshold, brown_threshold };
+
+const uint16_t tray = rgb565(200, 200, 190);
+const uint16_t pink = rgb565(180, 80, 80);
+const uint16_t brown = rgb565(110, 70, 20);
+const uint16_t both = rgb565(130, 75, 35);     /* 两个阈值都命中 */
+
+ColorBlobWork work;
+int failures = 0;
+
+void check(bool ok, const char *what)
+{
+    if (!ok)
+    {
+        std::printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+Frame blank_frame()
+{
+    Frame frame;
+    frame.name = "synthetic";
+    frame.width = FRAME_W;
+    frame.height = FRAME_H;
+    frame.pixels.assign(FRAME_W * FRAME_H, tray);
+    return frame;
+}
+
+void fill(Frame *frame, int x, int y, int w, int h, uint16_t color)
+{
+    for (int j = y; j < y + h; j++)
+        for (int i = x; i < x + w; i++)
+            frame->pixels[j * frame->width + i] = color;
+}
+
+std::vector<ColorBlob> find(const Frame &frame, uint32_t pixels_threshold, uint32_t area_threshold,
+                            bool merge)
+{
+    std::vector<ColorBlob> blobs(COLOR_BLOB_RUNS_MAX);
+    int n = color_blobs_find(frame.pixels.data(), frame.width, frame.height, script_thresholds, 2,
+                             pixels_threshold, area_threshold, merge, blobs.data(), (int)blobs.size(),
+                             &work);
+    blobs.resize(n < 0 ? 0 : n);
+    return blobs;
+}
+
+void sort_blobs(std::vector<ColorBlob> *blobs)
+{
+    std::sort(blobs->begin(), blobs->end(), [](const ColorBlob &p, const ColorBlob &q) {
+        return std::make_tuple(p.code, p.y, p.x) < std::make_tuple(q.code, q.y, q.x);
+    });
+}
+
+int count_code(const std::vector<ColorBlob> &blobs, uint8_t code)
+{
+    return (int)std::count_if(blobs.begin(), blobs.end(), [code](const ColorBlob &b) {
+        return b.code == code;
+    });
+}
+
+void test_lab()
+{
+    int8_t l, a, b;
+
+    color_lab_init();
+    color_lab_get(rgb565(255, 255, 255), &l, &a, &b);
+    check(l == 100 && std::abs(a) <= 1 && std::abs(b) <= 1, "white is L100 a0 b0");
+    color_lab_get(0, &l, &a, &b);
+    check(l == 0 && a == 0 && b == 0, "black is L0 a0 b0");
+    check(color_lab_match(&pink_threshold, pink) && !color_lab_match(&brown_threshold, pink),
+          "pink sample matches pink only");
+    check(color_lab_match(&brown_threshold, brown) && !color_lab_match(&pink_threshold, brown),
+          "brown sample matches brown only");
+    check(!color_lab_match(&pink_threshold, tray) && !color_lab_match(&brown_threshold, tray),
+          "tray matches nothing");
+}
+
+void test_shapes()
+{
+    Frame frame = blank_frame();
+
+    /* U 形：两条竖杠到最底下一行才连上，考并查集的后期合并 */
+    fill(&frame, 10, 10, 4, 30, pink);
+    fill(&frame, 30, 10, 4, 30, pink);
+    fill(&frame, 10, 40, 24, 3, pink);
+    /* 只有对角相接的两块，4 连通下是两个 */
+    fill(&frame, 60, 10, 10, 10, brown);
+    fill(&frame, 70, 20, 10, 10, brown);
+    /* 两个阈值都命中的一块，两边各算一个色块 */
+    fill(&frame, 100, 60, 12, 8, both);
+    /* 不到 pixels_threshold 的小点 */
+    fill(&frame, 150, 110, 2, 2, pink);
+
+    std::vector<ColorBlob> blobs = find(frame, 10, 10, false);
+    sort_blobs(&blobs);
+
+    check(blobs.size() == 5, "shapes: five blobs");
+    if (blobs.size() != 5)
+        return;
+    check(blobs[0].code == 1 && blobs[0].x == 10 && blobs[0].y == 10 && blobs[0].w == 24 &&
+          blobs[0].h == 33 && blobs[0].pixels == 4 * 30 * 2 + 24 * 3,
+          "shapes: U is one pink blob");
+    check(blobs[1].code == 1 && blobs[1].x == 100 && blobs[1].pixels == 96, "shapes: overlap counts as pink");
+    check(blobs[2].code == 2 && blobs[2].x == 60 && blobs[2].w == 10 && blobs[2].pixels == 100,
+          "shapes: first diagonal square");
+    check(blobs[3].code == 2 && blobs[3].x == 70 && blobs[3].y == 20, "shapes: second diagonal square");
+    check(blobs[4].code == 2 && blobs[4].x == 100 && blobs[4].pixels == 96, "shapes: overlap counts as brown");
+    check(blobs[0].cx == 22 && blobs[2].cx == 65 && blobs[2].cy == 15, "shapes: centroids");
+
+    /* merge 把外接矩形相交的同色块并起来：U 里面的一块并进 U，对角两块的矩形只是相接，不并 */
+    fill(&frame, 20, 15, 6, 6, pink);
+    blobs = find(frame, 10, 10, true);
+    check(count_code(blobs, 1) == 2 && count_code(blobs, 2) == 3, "merge: only overlapping rectangles");
+    check(blobs.size() == 5 && find(frame, 10, 10, false).size() == 6, "merge: inner square absorbed");
+    fill(&frame, 20, 15, 6, 6, tray);
+    fill(&frame, 0, 43, 10, 5, pink);
+    blobs = find(frame, 10, 10, true);
+    check(count_code(blobs, 1) == 3, "merge: touching rectangles stay apart");
+}
+
+void test_limits()
+{
+    Frame frame = blank_frame();
+    std::vector<ColorBlob> blobs(8);
+
+    /* 隔列条纹：每行 80 段行程，一帧超出 COLOR_BLOB_RUNS_MAX */
+    for (int x = 0; x < FRAME_W; x += 2)
+        fill(&frame, x, 0, 1, FRAME_H, pink);
+    check(color_blobs_find(frame.pixels.data(), FRAME_W, FRAME_H, script_thresholds, 2, 1, 1, 0,
+                           blobs.data(), 8, &work) == -1, "run overflow is reported");
+    check(color_blobs_find(frame.pixels.data(), COLOR_BLOB_WIDTH_MAX + 1, 1, script_thresholds, 2, 1, 1,
+                           0, blobs.data(), 8, &work) == -1, "over-wide image is rejected");
+
+    /* max 只截断输出 */
+    check(color_blobs_find(frame.pixels.data(), FRAME_W, 1, script_thresholds, 2, 1, 1, 0,
+                           blobs.data(), 8, &work) == 8, "output is capped at max");
+}
+
+bool same_blobs(std::vector<ColorBlob> p, std::vector<ColorBlob> q)
+{
+    sort_blobs(&p);
+    sort_blobs(&q);
+    if (p.size() != q.size())
+        return false;
+    for (size_t i = 0; i < p.size(); i++)
+    {
+        if (p[i].code != q[i].code || p[i].x != q[i].x || p[i].y != q[i].y || p[i].w != q[i].w ||
+            p[i].h != q[i].h || p[i].pixels != q[i].pixels ||
+            std::abs(p[i].cx - q[i].cx) > 1 || std::abs(p[i].cy - q[i].cy) > 1)
+            return false;
+    }
+    return true;
+}
+
+/* 存下来的托盘帧：脚本参数下的粉、棕色块数，以及各参数组合下与对照实现一致 */
+void test_frames()
+{
+    struct Expect { const char *name; int pink; int brown; };
+    const Expect expect[] = {
+        { "tray_dim.ppm", 1, 1 },
+        { "tray_mixed.ppm", 2, 2 },
+        { "tray_touching.ppm", 1, 2 },
+    };
+    std::vector<Frame> frames = frame_load_dir(BLOB_FRAMES_DIR);
+
+    check(frames.size() == sizeof(expect) / sizeof(expect[0]), "all stored frames load");
+    for (const Frame &frame : frames)
+    {
+        std::vector<ColorBlob> blobs = find(frame, 100, 100, true);
+        char what[96];
+
+        for (const Expect &e : expect)
+        {
+            if (frame.name != e.name)
+                continue;
+            std::snprintf(what, sizeof(what), "%s: %d pink, %d brown (got %d, %d)", e.name, e.pink,
+                          e.brown, count_code(blobs, 1), count_code(blobs, 2));
+            check(count_code(blobs, 1) == e.pink && count_code(blobs, 2) == e.brown, what);
+        }
+
+        for (int merge = 0; merge < 2; merge++)
+        {
+            for (uint32_t min_pixels : { 1u, 100u })
+            {
+                std::snprintf(what, sizeof(what), "%s: matches two-pass (merge %d, pixels %u)",
+                              frame.name.c_str(), merge, (unsigned)min_pixels);
+                check(same_blobs(find(frame, min_pixels, min_pixels, merge),
+                                 reference_find_blobs(frame, script_thresholds, 2, min_pixels,
+                                                      min_pixels, merge)), what);
+            }
+        }
+    }
+}
+
+} // namespace
+
+int main()
+{
+    test_lab();
+    test_shapes();
+    test_limits();
+    test_frames();
+
+    std::printf("blob_test: %s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,90 @@
+﻿#ifndef __BOARD_H__
+#define __BOARD_H__
+
+#include <rtthread.h>
+
+/* 主机仿真的 GPIO 编号：与 STM32 BSP 相同，每个端口 16 个引脚 */
+enum
+{
+    SIM_PORT_A = 0,
+    SIM_PORT_B,
+    SIM_PORT_C,
+    SIM_PORT_D,
+    SIM_PORT_E,
+};
+
+#define GET_PIN(PORTx, PIN)     (rt_base_t)((16 * (SIM_PORT_##PORTx)) + (PIN))
+
+/*
+ * 内核时钟与 DWT 周期计数器（CMSIS 的同名定义）：CYCCNT 按 SystemCoreClock
+ * 由虚拟时钟折算，TRCENA 与 CYCCNTENA 都打开后才计数；可以写入清零。
+ */
+extern rt_uint32_t SystemCoreClock;
+
+struct sim_cyccnt
+{
+    operator rt_uint32_t() const;
+    sim_cyccnt &operator=(rt_uint32_t value);
+};
+
+struct sim_dwt_regs
+{
+    volatile rt_uint32_t CTRL;
+    sim_cyccnt CYCCNT;
+};
+
+struct sim_core_debug_regs
+{
+    volatile rt_uint32_t DEMCR;
+};
+
+extern sim_dwt_regs sim_dwt;
+extern sim_core_debug_regs sim_core_debug;
+
+#define DWT                             (&sim_dwt)
+#define CoreDebug                       (&sim_core_debug)
+#define DWT_CTRL_CYCCNTENA_Msk          (1UL << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk      (1UL << 24)
+
+/*
+ * 通用定时器寄存器（CMSIS 的 TIM_TypeDef 中用到的部分，CCR1~CCR4 同样连续）：
+ * 都是普通变量，由 PWM 替身在更新事件时读取。ARR、CCRx 写入后对当前周期生效
+ * （ARPE、OCxPE 为 0 时的行为），PSC 只由 rt_pwm_set 改写。
+ */
+struct sim_tim_regs
+{
+    volatile rt_uint32_t CR1;
+    volatile rt_uint32_t DIER;
+    volatile rt_uint32_t SR;
+    volatile rt_uint32_t EGR;
+    volatile rt_uint32_t CCMR1;
+    volatile rt_uint32_t CCMR2;
+    volatile rt_uint32_t CCER;
+    volatile rt_uint32_t CNT;
+    volatile rt_uint32_t PSC;
+    volatile rt_uint32_t ARR;
+    volatile rt_uint32_t CCR1;
+    volatile rt_uint32_t CCR2;
+    volatile rt_uint32_t CCR3;
+    volatile rt_uint32_t CCR4;
+};
+
+extern sim_tim_regs sim_tim2;
+
+#define TIM2                            (&sim_tim2)
+#define TIM_CR1_ARPE                    (1UL << 7)
+#define TIM_DIER_UIE                    (1UL << 0)
+#define TIM_SR_UIF                      (1UL << 0)
+#define TIM_CCMR1_OC1PE                 (1UL << 3)
+#define TIM_CCMR1_OC1M                  (7UL << 4)
+
+/* NVIC：只有 TIM2 的更新中断接到了替身上 */
+typedef enum
+{
+    TIM2_IRQn = 28,
+} IRQn_Type;
+
+void NVIC_EnableIRQ(IRQn_Type irq);
+void NVIC_DisableIRQ(IRQn_Type irq);
+
+#endif
@@ -0,0 +1,48 @@
+﻿#ifndef __DRV_LCD_H__
+#define __DRV_LCD_H__
+
+#include <rtthread.h>
+
+#define LCD_W 240
+#define LCD_H 320
+
+/* 颜色 */
+#define WHITE            0xFFFF
+#define BLACK            0x0000
+#define BLUE             0x001F
+#define BRED             0xF81F
+#define GRED             0xFFE0
+#define GBLUE            0x07FF
+#define RED              0xF800
+#define MAGENTA          0xF81F
+#define GREEN            0x07E0
+#define CYAN             0x7FFF
+#define YELLOW           0xFFE0
+#define BROWN            0xBC40
+#define BRRED            0xFC07
+#define GRAY             0x8430
+#define GRAY175          0xAD75
+#define GRAY151          0x94B2
+#define GRAY187          0xBDD7
+#define GRAY240          0xF79E
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void lcd_clear(rt_uint16_t color);
+void lcd_address_set(rt_uint16_t x1, rt_uint16_t y1, rt_uint16_t x2, rt_uint16_t y2);
+void lcd_set_color(rt_uint16_t fore, rt_uint16_t back);
+void lcd_draw_point(rt_uint16_t x, rt_uint16_t y);
+void lcd_draw_point_color(rt_uint16_t x, rt_uint16_t y, rt_uint16_t color);
+void lcd_draw_line(rt_uint16_t x1, rt_uint16_t y1, rt_uint16_t x2, rt_uint16_t y2);
+void lcd_draw_rectangle(rt_uint16_t x1, rt_uint16_t y1, rt_uint16_t x2, rt_uint16_t y2);
+void lcd_fill(rt_uint16_t x_start, rt_uint16_t y_start, rt_uint16_t x_end, rt_uint16_t y_end, rt_uint16_t color);
+void lcd_fill_array(rt_uint16_t x_start, rt_uint16_t y_start, rt_uint16_t x_end, rt_uint16_t y_end, void *pcolor);
+rt_err_t lcd_show_string(rt_uint16_t x, rt_uint16_t y, rt_uint32_t size, const char *fmt, ...);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
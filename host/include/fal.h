@@ -0,0 +1,46 @@
+﻿#ifndef _FAL_H_
+#define _FAL_H_
+
+#include <rtthread.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/* FAL（Flash 抽象层）替身：只有分区读写擦除和设备查询 */
+
+#define FAL_DEV_NAME_MAX        24
+
+struct fal_flash_dev
+{
+    char name[FAL_DEV_NAME_MAX];
+    uint32_t addr;
+    size_t len;
+    size_t blk_size;            /* 擦除块大小 */
+    size_t write_gran;          /* 写粒度（位），NOR 为 1 */
+};
+
+struct fal_partition
+{
+    uint32_t magic_word;
+    char name[FAL_DEV_NAME_MAX];
+    char flash_name[FAL_DEV_NAME_MAX];
+    long offset;
+    size_t len;
+    uint32_t reserved;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int fal_init(void);
+const struct fal_flash_dev *fal_flash_device_find(const char *name);
+const struct fal_partition *fal_partition_find(const char *name);
+int fal_partition_read(const struct fal_partition *part, uint32_t addr, uint8_t *buf, size_t size);
+int fal_partition_write(const struct fal_partition *part, uint32_t addr, const uint8_t *buf, size_t size);
+int fal_partition_erase(const struct fal_partition *part, uint32_t addr, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,19 @@
+﻿#ifndef __FINSH_H__
+#define __FINSH_H__
+
+#include <rtthread.h>
+
+/* 主机仿真中 MSH 命令登记到一张运行时表，供基准程序按名字调用 */
+typedef int (*sim_msh_func_t)(int argc, char **argv);
+
+struct sim_msh_cmd
+{
+    sim_msh_cmd(const char *name, const char *desc, sim_msh_func_t func);
+};
+
+#define MSH_CMD_EXPORT(command, desc) \
+    static sim_msh_cmd __msh_cmd_##command(#command, #desc, command)
+#define MSH_CMD_EXPORT_ALIAS(command, alias, desc) \
+    static sim_msh_cmd __msh_cmd_##alias(#alias, #desc, command)
+
+#endif
@@ -0,0 +1,21 @@
+﻿#ifndef RT_CONFIG_H__
+#define RT_CONFIG_H__
+
+/* 主机仿真用的内核配置，对应板级工程 rtconfig.h 中用到的部分 */
+
+#define RT_NAME_MAX                 8
+#define RT_ALIGN_SIZE               4
+#define RT_THREAD_PRIORITY_MAX      32
+#define RT_TICK_PER_SECOND          1000
+#define RT_MAIN_THREAD_PRIORITY     10
+#define RT_MAIN_THREAD_STACK_SIZE   2048
+
+#define RT_USING_HOOK
+#define RT_USING_HEAP
+#define RT_USING_DEVICE
+#define RT_USING_PIN
+#define RT_USING_PWM
+#define RT_USING_FINSH
+#define FINSH_USING_MSH
+
+#endif
@@ -0,0 +1,308 @@
+﻿#ifndef __RT_DEF_H__
+#define __RT_DEF_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include "rtconfig.h"
+
+/* 基本数据类型，与 32 位目标板保持同样宽度 */
+typedef int8_t                          rt_int8_t;
+typedef int16_t                         rt_int16_t;
+typedef int32_t                         rt_int32_t;
+typedef uint8_t                         rt_uint8_t;
+typedef uint16_t                        rt_uint16_t;
+typedef uint32_t                        rt_uint32_t;
+typedef int64_t                         rt_int64_t;
+typedef uint64_t                        rt_uint64_t;
+
+typedef int                             rt_bool_t;
+typedef long                            rt_base_t;
+typedef unsigned long                   rt_ubase_t;
+
+typedef rt_base_t                       rt_err_t;
+typedef rt_uint32_t                     rt_time_t;
+typedef rt_uint32_t                     rt_tick_t;
+typedef rt_base_t                       rt_flag_t;
+typedef rt_ubase_t                      rt_size_t;
+typedef rt_ubase_t                      rt_dev_t;
+typedef rt_base_t                       rt_off_t;
+
+#define RT_TRUE                         1
+#define RT_FALSE                        0
+#define RT_NULL                         (0)
+
+#define RT_UINT32_MAX                   0xffffffff
+#define RT_TICK_MAX                     RT_UINT32_MAX
+
+/* 错误码 */
+#define RT_EOK                          0
+#define RT_ERROR                        1
+#define RT_ETIMEOUT                     2
+#define RT_EFULL                        3
+#define RT_EEMPTY                       4
+#define RT_ENOMEM                       5
+#define RT_ENOSYS                       6
+#define RT_EBUSY                        7
+#define RT_EIO                          8
+#define RT_EINTR                        9
+#define RT_EINVAL                       10
+
+#define RT_WAITING_FOREVER              -1
+#define RT_WAITING_NO                   0
+
+#define RT_ALIGN(size, align)           (((size) + (align) - 1) & ~((align) - 1))
+#define RT_ALIGN_DOWN(size, align)      ((size) & ~((align) - 1))
+
+#define rt_inline                       static inline
+#define ALIGN(n)                        __attribute__((aligned(n)))
+#define RT_UNUSED(x)                    ((void)(x))
+
+/* 双向链表 */
+struct rt_list_node
+{
+    struct rt_list_node *next;
+    struct rt_list_node *prev;
+};
+typedef struct rt_list_node rt_list_t;
+
+/* 内核对象 */
+struct rt_object
+{
+    char       name[RT_NAME_MAX];
+    rt_uint8_t type;
+    rt_uint8_t flag;
+    rt_list_t  list;
+};
+typedef struct rt_object *rt_object_t;
+
+enum rt_object_class_type
+{
+    RT_Object_Class_Null          = 0x00,
+    RT_Object_Class_Thread        = 0x01,
+    RT_Object_Class_Semaphore     = 0x02,
+    RT_Object_Class_Mutex         = 0x03,
+    RT_Object_Class_Event         = 0x04,
+    RT_Object_Class_MailBox       = 0x05,
+    RT_Object_Class_MessageQueue  = 0x06,
+    RT_Object_Class_MemHeap       = 0x07,
+    RT_Object_Class_MemPool       = 0x08,
+    RT_Object_Class_Device        = 0x09,
+    RT_Object_Class_Timer         = 0x0a,
+    RT_Object_Class_Static        = 0x80
+};
+
+/* 某一类内核对象的容器 */
+struct rt_object_information
+{
+    enum rt_object_class_type type;
+    rt_list_t  object_list;
+    rt_size_t  object_size;
+};
+
+/* 线程状态 */
+#define RT_THREAD_INIT                  0x00
+#define RT_THREAD_READY                 0x01
+#define RT_THREAD_SUSPEND               0x02
+#define RT_THREAD_RUNNING               0x03
+#define RT_THREAD_BLOCK                 RT_THREAD_SUSPEND
+#define RT_THREAD_CLOSE                 0x04
+#define RT_THREAD_STAT_MASK             0x07
+
+struct rt_thread
+{
+    char        name[RT_NAME_MAX];
+    rt_uint8_t  type;
+    rt_uint8_t  flags;
+    rt_list_t   list;
+    rt_list_t   tlist;
+
+    void       *sp;
+    void       *entry;
+    void       *parameter;
+    void       *stack_addr;
+    rt_uint32_t stack_size;
+
+    rt_err_t    error;
+    rt_uint8_t  stat;
+
+    rt_uint8_t  current_priority;
+    rt_uint8_t  init_priority;
+
+    rt_ubase_t  init_tick;
+    rt_ubase_t  remaining_tick;
+
+    rt_uint32_t event_set;
+    rt_uint8_t  event_info;
+
+    rt_ubase_t  user_data;
+
+    void       *sim;                    /* 仅主机仿真使用：对应的宿主线程上下文 */
+};
+typedef struct rt_thread *rt_thread_t;
+
+/* IPC 对象 */
+#define RT_IPC_FLAG_FIFO                0x00
+#define RT_IPC_FLAG_PRIO                0x01
+
+#define RT_IPC_CMD_UNKNOWN              0x00
+#define RT_IPC_CMD_RESET                0x01
+
+struct rt_ipc_object
+{
+    struct rt_object parent;
+    rt_list_t        suspend_thread;
+};
+
+struct rt_semaphore
+{
+    struct rt_ipc_object parent;
+    rt_uint16_t          value;
+    rt_uint16_t          reserved;
+};
+typedef struct rt_semaphore *rt_sem_t;
+
+/* 定时器 */
+#define RT_TIMER_FLAG_DEACTIVATED       0x0
+#define RT_TIMER_FLAG_ACTIVATED         0x1
+#define RT_TIMER_FLAG_ONE_SHOT          0x0
+#define RT_TIMER_FLAG_PERIODIC          0x2
+#define RT_TIMER_FLAG_HARD_TIMER        0x0
+#define RT_TIMER_FLAG_SOFT_TIMER        0x4
+
+#define RT_TIMER_CTRL_SET_TIME          0x0
+#define RT_TIMER_CTRL_GET_TIME          0x1
+#define RT_TIMER_CTRL_SET_ONESHOT       0x2
+#define RT_TIMER_CTRL_SET_PERIODIC      0x3
+#define RT_TIMER_CTRL_GET_STATE         0x4
+
+struct rt_timer
+{
+    struct rt_object parent;
+    rt_list_t        row[1];
+
+    void (*timeout_func)(void *parameter);
+    void            *parameter;
+
+    rt_tick_t        init_tick;
+    rt_tick_t        timeout_tick;
+};
+typedef struct rt_timer *rt_timer_t;
+
+#define RT_EVENT_FLAG_AND               0x01
+#define RT_EVENT_FLAG_OR                0x02
+#define RT_EVENT_FLAG_CLEAR             0x04
+
+struct rt_event
+{
+    struct rt_ipc_object parent;
+    rt_uint32_t          set;
+};
+typedef struct rt_event *rt_event_t;
+
+/* 消息队列：每条消息占 RT_ALIGN(msg_size) 加一个指针大小的头部，与内核相同 */
+struct rt_messagequeue
+{
+    struct rt_ipc_object parent;
+
+    void        *msg_pool;
+    rt_uint16_t  msg_size;
+    rt_uint16_t  max_msgs;
+    rt_uint16_t  entry;
+    rt_uint16_t  head;                  /* 仅主机仿真使用：环形下标 */
+    rt_uint16_t  tail;
+
+    rt_list_t    suspend_sender_thread;
+};
+typedef struct rt_messagequeue *rt_mq_t;
+
+/* 邮箱：每封邮件一个 rt_ubase_t */
+struct rt_mailbox
+{
+    struct rt_ipc_object parent;
+
+    rt_ubase_t  *msg_pool;
+    rt_uint16_t  size;
+    rt_uint16_t  entry;
+    rt_uint16_t  in_offset;
+    rt_uint16_t  out_offset;
+
+    rt_list_t    suspend_sender_thread;
+};
+typedef struct rt_mailbox *rt_mailbox_t;
+
+/* 设备 */
+enum rt_device_class_type
+{
+    RT_Device_Class_Char = 0,
+    RT_Device_Class_Block,
+    RT_Device_Class_NetIf,
+    RT_Device_Class_MTD,
+    RT_Device_Class_CAN,
+    RT_Device_Class_RTC,
+    RT_Device_Class_Sound,
+    RT_Device_Class_Graphic,
+    RT_Device_Class_I2CBUS,
+    RT_Device_Class_USBDevice,
+    RT_Device_Class_USBHost,
+    RT_Device_Class_SPIBUS,
+    RT_Device_Class_SPIDevice,
+    RT_Device_Class_SDIO,
+    RT_Device_Class_PM,
+    RT_Device_Class_Pipe,
+    RT_Device_Class_Portal,
+    RT_Device_Class_Timer,
+    RT_Device_Class_Miscellaneous,
+    RT_Device_Class_Sensor,
+    RT_Device_Class_Touch,
+    RT_Device_Class_Unknown
+};
+
+#define RT_DEVICE_FLAG_DEACTIVATE       0x000
+#define RT_DEVICE_FLAG_RDONLY           0x001
+#define RT_DEVICE_FLAG_WRONLY           0x002
+#define RT_DEVICE_FLAG_RDWR             0x003
+#define RT_DEVICE_FLAG_STANDALONE       0x008
+#define RT_DEVICE_FLAG_ACTIVATED        0x010
+#define RT_DEVICE_FLAG_INT_RX           0x100
+#define RT_DEVICE_FLAG_DMA_RX           0x200
+#define RT_DEVICE_FLAG_INT_TX           0x400
+#define RT_DEVICE_FLAG_DMA_TX           0x800
+
+#define RT_DEVICE_OFLAG_CLOSE           0x000
+#define RT_DEVICE_OFLAG_RDONLY          0x001
+#define RT_DEVICE_OFLAG_WRONLY          0x002
+#define RT_DEVICE_OFLAG_RDWR            0x003
+#define RT_DEVICE_OFLAG_OPEN            0x008
+
+#define RT_DEVICE_CTRL_RESUME           0x01
+#define RT_DEVICE_CTRL_SUSPEND          0x02
+#define RT_DEVICE_CTRL_CONFIG           0x03
+#define RT_DEVICE_CTRL_CLOSE            0x04
+
+typedef struct rt_device *rt_device_t;
+
+struct rt_device
+{
+    struct rt_object          parent;
+
+    enum rt_device_class_type type;
+    rt_uint16_t               flag;
+    rt_uint16_t               open_flag;
+    rt_uint8_t                ref_count;
+    rt_uint8_t                device_id;
+
+    rt_err_t (*rx_indicate)(rt_device_t dev, rt_size_t size);
+    rt_err_t (*tx_complete)(rt_device_t dev, void *buffer);
+
+    rt_err_t  (*init)   (rt_device_t dev);
+    rt_err_t  (*open)   (rt_device_t dev, rt_uint16_t oflag);
+    rt_err_t  (*close)  (rt_device_t dev);
+    rt_size_t (*read)   (rt_device_t dev, rt_off_t pos, void *buffer, rt_size_t size);
+    rt_size_t (*write)  (rt_device_t dev, rt_off_t pos, const void *buffer, rt_size_t size);
+    rt_err_t  (*control)(rt_device_t dev, int cmd, void *args);
+
+    void     *user_data;
+};
+
+#endif
@@ -0,0 +1,142 @@
+﻿#ifndef __RT_DEVICE_H__
+#define __RT_DEVICE_H__
+
+#include <rtthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* PIN 设备 */
+#define PIN_LOW                 0x00
+#define PIN_HIGH                0x01
+
+#define PIN_MODE_OUTPUT         0x00
+#define PIN_MODE_INPUT          0x01
+#define PIN_MODE_INPUT_PULLUP   0x02
+#define PIN_MODE_INPUT_PULLDOWN 0x03
+#define PIN_MODE_OUTPUT_OD      0x04
+
+#define PIN_IRQ_MODE_RISING         0x00
+#define PIN_IRQ_MODE_FALLING        0x01
+#define PIN_IRQ_MODE_RISING_FALLING 0x02
+#define PIN_IRQ_MODE_HIGH_LEVEL     0x03
+#define PIN_IRQ_MODE_LOW_LEVEL      0x04
+
+#define PIN_IRQ_DISABLE         0x00
+#define PIN_IRQ_ENABLE          0x01
+
+void rt_pin_mode(rt_base_t pin, rt_base_t mode);
+void rt_pin_write(rt_base_t pin, rt_base_t value);
+int  rt_pin_read(rt_base_t pin);
+rt_err_t rt_pin_attach_irq(rt_int32_t pin, rt_uint32_t mode,
+                           void (*hdr)(void *args), void *args);
+rt_err_t rt_pin_detach_irq(rt_int32_t pin);
+rt_err_t rt_pin_irq_enable(rt_base_t pin, rt_uint32_t enabled);
+
+/* PWM 设备 */
+struct rt_pwm_configuration
+{
+    rt_uint32_t channel;
+    rt_uint32_t period;     /* 单位 ns */
+    rt_uint32_t pulse;      /* 单位 ns */
+};
+
+struct rt_device_pwm;
+struct rt_pwm_ops
+{
+    rt_err_t (*control)(struct rt_device_pwm *device, int cmd, void *arg);
+};
+
+struct rt_device_pwm
+{
+    struct rt_device parent;
+    const struct rt_pwm_ops *ops;
+};
+
+rt_err_t rt_pwm_enable(struct rt_device_pwm *device, int channel);
+rt_err_t rt_pwm_disable(struct rt_device_pwm *device, int channel);
+rt_err_t rt_pwm_set(struct rt_device_pwm *device, int channel, rt_uint32_t period, rt_uint32_t pulse);
+
+/* 硬件定时器设备 */
+typedef struct rt_hwtimerval
+{
+    rt_int32_t sec;
+    rt_int32_t usec;
+} rt_hwtimerval_t;
+
+typedef enum
+{
+    HWTIMER_CTRL_FREQ_SET = 0x21,
+    HWTIMER_CTRL_STOP,
+    HWTIMER_CTRL_INFO_GET,
+    HWTIMER_CTRL_MODE_SET
+} rt_hwtimer_ctrl_t;
+
+typedef enum
+{
+    HWTIMER_MODE_ONESHOT = 0x01,
+    HWTIMER_MODE_PERIOD
+} rt_hwtimer_mode_t;
+
+/* 串口设备：只有驱动配置需要的部分 */
+#define BAUD_RATE_9600          9600
+#define BAUD_RATE_115200        115200
+
+#define DATA_BITS_8             8
+#define STOP_BITS_1             0
+#define PARITY_NONE             0
+#define BIT_ORDER_LSB           0
+#define NRZ_NORMAL              0
+
+#define RT_SERIAL_RB_BUFSZ      64
+
+struct serial_configure
+{
+    rt_uint32_t baud_rate;
+
+    rt_uint32_t data_bits               :4;
+    rt_uint32_t stop_bits               :2;
+    rt_uint32_t parity                  :2;
+    rt_uint32_t bit_order               :1;
+    rt_uint32_t invert                  :1;
+    rt_uint32_t bufsz                   :16;
+    rt_uint32_t reserved                :6;
+};
+
+#define RT_SERIAL_CONFIG_DEFAULT           \
+{                                          \
+    BAUD_RATE_115200,                      \
+    DATA_BITS_8,                           \
+    STOP_BITS_1,                           \
+    PARITY_NONE,                           \
+    BIT_ORDER_LSB,                         \
+    NRZ_NORMAL,                            \
+    RT_SERIAL_RB_BUFSZ,                    \
+    0                                      \
+}
+
+/* ADC 设备 */
+struct rt_adc_device;
+struct rt_adc_ops
+{
+    rt_err_t (*enabled)(struct rt_adc_device *device, rt_uint32_t channel, rt_bool_t enabled);
+    rt_err_t (*convert)(struct rt_adc_device *device, rt_uint32_t channel, rt_uint32_t *value);
+};
+
+struct rt_adc_device
+{
+    struct rt_device parent;
+    const struct rt_adc_ops *ops;
+};
+typedef struct rt_adc_device *rt_adc_device_t;
+
+rt_uint32_t rt_adc_read(rt_adc_device_t dev, rt_uint32_t channel);
+rt_err_t rt_adc_enable(rt_adc_device_t dev, rt_uint32_t channel);
+rt_err_t rt_adc_disable(rt_adc_device_t dev, rt_uint32_t channel);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,115 @@
+﻿/*
+ * snack_infer 的延迟测试：在存下来的托盘帧上用色块检测找出商品，按色块
+ * 裁成 96x96 输入，每个输入跑 BENCH_ROUNDS 次取平均和最小耗时，并与浮点
+ * 对照实现比较耗时和结果，报告 arena 用量和分类与颜色判断是否一致。
+ *
+ * 类别顺序按 SNACK_CLASS_PINK/BROWN 假定，合成帧不是实拍照片，一致率只
+ * 作参考。
+ */
+
+#include "infer_reference.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#define BENCH_ROUNDS    50      /* 每个输入跑的次数 */
+
+namespace
+{
+
+const LabThreshold thresholds[2] = {
+    { 30, 60, 20, 50, 10, 40 },     /* 粉色 */
+    { 20, 50, 10, 30, 20, 50 },     /* 棕色 */
+};
+
+ColorBlobWork work;
+float input[SNACK_INPUT_H * SNACK_INPUT_W * SNACK_INPUT_C];
+
+double seconds_since(std::chrono::steady_clock::time_point t0)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+} // namespace
+
+int main()
+{
+    std::vector<uint32_t> storage;
+    size_t size;
+    SnackInfo info;
+    int result, inputs = 0, agree = 0;
+    double total = 0, best = 1e9, reference_total = 0;
+    float worst = 0;
+
+    if (!model_load(SNACK_MODEL_PATH, &storage, &size))
+    {
+        std::printf("cannot read %s\n", SNACK_MODEL_PATH);
+        return 1;
+    }
+    result = snack_infer_init((const uint8_t *)storage.data(), size);
+    snack_infer_get_info(&info);
+    std::printf("model %zu bytes: %d tensors, %d ops, %d conv+pool fused; weights %u bytes read in place\n",
+                size, info.tensors, info.ops, info.fused, (unsigned)info.weight_bytes);
+    std::printf("arena %u / %u bytes (%u persistent)\n", (unsigned)info.arena_used,
+                (unsigned)SNACK_ARENA_SIZE, (unsigned)info.arena_persistent);
+    if (result != SNACK_EOK)
+    {
+        std::printf("init failed: %d\n", result);
+        return 1;
+    }
+
+    color_lab_init();
+    for (const Frame &frame : frame_load_dir(BLOB_FRAMES_DIR))
+    {
+        ColorBlob blobs[16];
+        int n = color_blobs_find(frame.pixels.data(), frame.width, frame.height,
+                                 thresholds, 2, 100, 100, 1, blobs, 16, &work);
+
+        for (int i = 0; i < n; i++)
+        {
+            int side = (blobs[i].w > blobs[i].h ? blobs[i].w : blobs[i].h) * 5 / 4;
+            int expected = blobs[i].code == 1 ? SNACK_CLASS_PINK : SNACK_CLASS_BROWN;
+            float probs[SNACK_CLASSES], ref[SNACK_CLASSES];
+
+            crop_input(frame, blobs[i].cx, blobs[i].cy, side, input);
+
+            auto t0 = std::chrono::steady_clock::now();
+            reference_infer(input, ref);
+            reference_total += seconds_since(t0);
+
+            for (int r = 0; r < BENCH_ROUNDS; r++)
+            {
+                /* 输入缓冲跑完就被复用了，每次重新拷入，不计时 */
+                std::memcpy(snack_infer_input(), input, sizeof(input));
+                t0 = std::chrono::steady_clock::now();
+                snack_infer_run(probs);
+                double s = seconds_since(t0);
+                total += s;
+                best = s < best ? s : best;
+            }
+
+            int got = probs[SNACK_CLASS_PINK] > probs[SNACK_CLASS_BROWN] ? SNACK_CLASS_PINK : SNACK_CLASS_BROWN;
+            for (int k = 0; k < SNACK_CLASSES; k++)
+                worst = std::fmax(worst, std::fabs(probs[k] - ref[k]));
+            agree += got == expected;
+            inputs++;
+            std::printf("%-20s blob %d (%s, %dx%d)  p = [%.3f %.3f]  ref = [%.3f %.3f]\n",
+                        frame.name.c_str(), i, expected == SNACK_CLASS_PINK ? "pink" : "brown",
+                        blobs[i].w, blobs[i].h, probs[0], probs[1], ref[0], ref[1]);
+        }
+    }
+
+    if (inputs == 0)
+    {
+        std::printf("no blobs in %s\n", BLOB_FRAMES_DIR);
+        return 1;
+    }
+    std::printf("int8 engine: %.3f ms mean, %.3f ms best over %d runs\n",
+                total * 1000 / (inputs * BENCH_ROUNDS), best * 1000, inputs * BENCH_ROUNDS);
+    std::printf("float reference: %.3f ms mean\n", reference_total * 1000 / inputs);
+    std::printf("max |p - p_ref| = %.5f; class agrees with colour on %d / %d blobs\n",
+                worst, agree, inputs);
+    return 0;
+}
@@ -0,0 +1,161 @@
+﻿#include "infer_reference.h"
+
+#include <cmath>
+#include <cstdio>
+
+bool model_load(const std::string &path, std::vector<uint32_t> *storage, size_t *size)
+{
+    FILE *f = std::fopen(path.c_str(), "rb");
+    long len;
+
+    if (f == NULL)
+        return false;
+    std::fseek(f, 0, SEEK_END);
+    len = std::ftell(f);
+    std::fseek(f, 0, SEEK_SET);
+    storage->assign((size_t)(len + 15) / 4 + 4, 0);
+    *size = std::fread(storage->data(), 1, (size_t)len, f);
+    std::fclose(f);
+    return *size == (size_t)len;
+}
+
+void crop_input(const Frame &frame, int cx, int cy, int side, float *input)
+{
+    int x0 = cx - side / 2, y0 = cy - side / 2;
+
+    for (int y = 0; y < SNACK_INPUT_H; y++)
+    {
+        for (int x = 0; x < SNACK_INPUT_W; x++)
+        {
+            int sx = x0 + x * side / SNACK_INPUT_W;
+            int sy = y0 + y * side / SNACK_INPUT_H;
+            float *dst = input + (y * SNACK_INPUT_W + x) * SNACK_INPUT_C;
+            uint16_t p;
+
+            sx = sx < 0 ? 0 : (sx >= frame.width ? frame.width - 1 : sx);
+            sy = sy < 0 ? 0 : (sy >= frame.height ? frame.height - 1 : sy);
+            p = frame.pixels[sy * frame.width + sx];
+            dst[0] = ((p >> 11) * 255 / 31) / 255.0f;
+            dst[1] = (((p >> 5) & 0x3F) * 255 / 63) / 255.0f;
+            dst[2] = ((p & 0x1F) * 255 / 31) / 255.0f;
+        }
+    }
+}
+
+namespace
+{
+
+std::vector<float> weights_of(const SnackTensor *t)
+{
+    size_t n = t->bytes / (t->type == SNACK_I8 ? 1 : 4);
+    std::vector<float> w(n);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        if (t->type == SNACK_I8)
+        {
+            size_t per = n / t->scale_count;
+            w[i] = ((const int8_t *)t->data)[i] * t->scales[i / per];
+        }
+        else
+        {
+            w[i] = ((const float *)t->data)[i];
+        }
+    }
+    return w;
+}
+
+} // namespace
+
+void reference_infer(const float *input, float *probs)
+{
+    std::vector<std::vector<float>> values(SNACK_TENSORS_MAX);
+    int last = -1;
+
+    values[snack_infer_op(0)->input].assign(input, input + SNACK_INPUT_H * SNACK_INPUT_W * SNACK_INPUT_C);
+
+    for (int i = 0; i < snack_infer_op_count(); i++)
+    {
+        const SnackOp *op = snack_infer_op(i);
+        const SnackTensor *in = snack_infer_tensor(op->input);
+        const SnackTensor *out = snack_infer_tensor(op->output);
+        const std::vector<float> &x = values[op->input];
+        std::vector<float> &y = values[op->output];
+
+        y.assign(out->bytes / 4, 0);
+        switch (op->kind)
+        {
+        case SNACK_OP_CONV:
+        {
+            const SnackTensor *wt = snack_infer_tensor(op->weights);
+            std::vector<float> w = weights_of(wt);
+            const float *bias = (const float *)snack_infer_tensor(op->bias)->data;
+            int iw = in->shape[2], ic = in->shape[3], kh = wt->shape[1], kw = wt->shape[2];
+
+            for (int oy = 0; oy < out->shape[1]; oy++)
+                for (int ox = 0; ox < out->shape[2]; ox++)
+                    for (int c = 0; c < out->shape[3]; c++)
+                    {
+                        double v = bias[c];
+                        for (int ky = 0; ky < kh; ky++)
+                            for (int kx = 0; kx < kw; kx++)
+                                for (int k = 0; k < ic; k++)
+                                    v += x[((oy * op->stride_h + ky) * iw + ox * op->stride_w + kx) * ic + k] *
+                                         w[((c * kh + ky) * kw + kx) * ic + k];
+                        y[(oy * out->shape[2] + ox) * out->shape[3] + c] = op->relu && v < 0 ? 0 : (float)v;
+                    }
+            break;
+        }
+        case SNACK_OP_MAX_POOL:
+        {
+            int iw = in->shape[2], ch = in->shape[3];
+
+            for (int oy = 0; oy < out->shape[1]; oy++)
+                for (int ox = 0; ox < out->shape[2]; ox++)
+                    for (int c = 0; c < ch; c++)
+                    {
+                        float m = -INFINITY;
+                        for (int ky = 0; ky < op->filter_h; ky++)
+                            for (int kx = 0; kx < op->filter_w; kx++)
+                                m = std::fmax(m, x[((oy * op->stride_h + ky) * iw + ox * op->stride_w + kx) * ch + c]);
+                        y[(oy * out->shape[2] + ox) * ch + c] = op->relu && m < 0 ? 0 : m;
+                    }
+            break;
+        }
+        case SNACK_OP_RESHAPE:
+            y = x;
+            break;
+        case SNACK_OP_FC:
+        {
+            const SnackTensor *wt = snack_infer_tensor(op->weights);
+            std::vector<float> w = weights_of(wt);
+            const float *bias = op->bias >= 0 ? (const float *)snack_infer_tensor(op->bias)->data : NULL;
+            int n = wt->shape[1];
+
+            for (int o = 0; o < wt->shape[0]; o++)
+            {
+                double v = bias ? bias[o] : 0;
+                for (int k = 0; k < n; k++)
+                    v += x[k] * w[o * n + k];
+                y[o] = op->relu && v < 0 ? 0 : (float)v;
+            }
+            break;
+        }
+        case SNACK_OP_SOFTMAX:
+        {
+            double max = x[0], sum = 0;
+            for (float v : x)
+                max = std::fmax(max, v);
+            for (size_t k = 0; k < x.size(); k++)
+                sum += y[k] = (float)std::exp((x[k] - max) * op->beta);
+            for (float &v : y)
+                v = (float)(v / sum);
+            break;
+        }
+        }
+        last = op->output;
+    }
+
+    for (int k = 0; k < SNACK_CLASSES; k++)
+        probs[k] = values[last][k];
+}
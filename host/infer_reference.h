@@ -0,0 +1,26 @@
+﻿#ifndef __INFER_REFERENCE_H__
+#define __INFER_REFERENCE_H__
+
+#include "blob_reference.h"
+#include "snack_infer.h"
+
+#include <string>
+#include <vector>
+
+/*
+ * 推理的浮点对照实现和测试输入，供 infer_test 和 infer_bench 共用。
+ *
+ * 对照实现按 snack_infer 解析出的算子表逐个执行，int8 权重先反量化成
+ * 浮点，激活全程浮点，不融合、不复用缓冲，结果即模型的“理想”输出。
+ */
+
+/* 读整个模型文件，按 16 字节对齐存放 */
+bool model_load(const std::string &path, std::vector<uint32_t> *storage, size_t *size);
+
+/* 以 (cx, cy) 为中心裁出边长 side 的方块，最近邻缩放到 96x96，归一化到 [0, 1] */
+void crop_input(const Frame &frame, int cx, int cy, int side, float *input);
+
+/* 在 snack_infer_init 成功之后调用 */
+void reference_infer(const float *input, float *probs);
+
+#endif
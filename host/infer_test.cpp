@@ -0,0 +1,99 @@
+﻿/*
+ * snack_infer 单元测试：在存下来的托盘帧上按色块裁出输入，int8 混合量化
+ * 的结果与浮点对照实现的概率差不超过 INFER_TOLERANCE，softmax 和为 1，
+ * arena 放得下；截断或不对齐的模型初始化失败。
+ */
+
+#include "infer_reference.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#define INFER_TOLERANCE     0.05f   /* 与对照实现的概率最大允许差 */
+
+namespace
+{
+
+const LabThreshold thresholds[2] = {
+    { 30, 60, 20, 50, 10, 40 },     /* 粉色 */
+    { 20, 50, 10, 30, 20, 50 },     /* 棕色 */
+};
+
+ColorBlobWork work;
+float input[SNACK_INPUT_H * SNACK_INPUT_W * SNACK_INPUT_C];
+int failures = 0;
+
+void expect(bool ok, const char *what)
+{
+    if (!ok)
+    {
+        std::printf("FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+} // namespace
+
+int main()
+{
+    std::vector<uint32_t> storage;
+    const uint8_t *model;
+    size_t size;
+    SnackInfo info;
+    float probs[SNACK_CLASSES], again[SNACK_CLASSES], ref[SNACK_CLASSES];
+    float worst = 0;
+    int inputs = 0;
+
+    if (!model_load(SNACK_MODEL_PATH, &storage, &size))
+    {
+        std::printf("cannot read %s\n", SNACK_MODEL_PATH);
+        return 1;
+    }
+    model = (const uint8_t *)storage.data();
+
+    expect(snack_infer_run(probs) == SNACK_ESTATE, "run before init");
+    expect(snack_infer_init(model, size / 2) == SNACK_EFORMAT, "truncated model rejected");
+    expect(snack_infer_input() == NULL, "no input after failed init");
+    expect(snack_infer_init(model + 1, size) == SNACK_EFORMAT, "unaligned model rejected");
+    if (snack_infer_init(model, size) != SNACK_EOK)
+    {
+        std::printf("FAILED: init\n");
+        return 1;
+    }
+
+    snack_infer_get_info(&info);
+    expect(info.arena_used <= SNACK_ARENA_SIZE, "arena fits");
+    expect(info.fused == 3, "three conv + pool pairs fused");
+
+    color_lab_init();
+    for (const Frame &frame : frame_load_dir(BLOB_FRAMES_DIR))
+    {
+        ColorBlob blobs[16];
+        int n = color_blobs_find(frame.pixels.data(), frame.width, frame.height,
+                                 thresholds, 2, 100, 100, 1, blobs, 16, &work);
+
+        for (int i = 0; i < n; i++)
+        {
+            int side = (blobs[i].w > blobs[i].h ? blobs[i].w : blobs[i].h) * 5 / 4;
+
+            crop_input(frame, blobs[i].cx, blobs[i].cy, side, input);
+            reference_infer(input, ref);
+            std::memcpy(snack_infer_input(), input, sizeof(input));
+            expect(snack_infer_run(probs) == SNACK_EOK, "run");
+            std::memcpy(snack_infer_input(), input, sizeof(input));
+            expect(snack_infer_run(again) == SNACK_EOK && std::memcmp(probs, again, sizeof(probs)) == 0,
+                   "repeatable");
+            expect(std::fabs(probs[0] + probs[1] - 1.0f) < 1e-5f, "softmax sums to 1");
+            for (int k = 0; k < SNACK_CLASSES; k++)
+                worst = std::fmax(worst, std::fabs(probs[k] - ref[k]));
+            inputs++;
+        }
+    }
+
+    expect(inputs > 0, "blobs found in frames");
+    expect(worst <= INFER_TOLERANCE, "int8 close to float reference");
+    std::printf("%d inputs, max |p - p_ref| = %.5f, arena %u bytes\n", inputs, worst,
+                (unsigned)info.arena_used);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,97 @@
+﻿#ifndef SIM_H__
+#define SIM_H__
+
+/*
+ * 主机仿真层的测试接口。
+ *
+ * 固件照常调用 rt_thread_* / rt_pin_* / rt_pwm_* / lcd_*，这些调用由 host/ 下的
+ * 替身实现在虚拟时钟上执行：任一时刻只有一个仿真线程在跑，时间只在线程阻塞或
+ * sim_busy() 时推进，因此 60 s 的电机动作在主机上瞬间完成且结果可复现。
+ */
+
+#include <rtthread.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+#define SIM_NEVER       UINT64_MAX
+#define SIM_MS(ms)      ((rt_uint64_t)(ms) * 1000000ULL)
+
+/* 虚拟时钟与调度 */
+rt_uint64_t sim_now_ns(void);
+int sim_run(void (*entry)(void *parameter), void *parameter);
+void sim_busy(rt_uint64_t ns);
+rt_uint64_t sim_at(rt_uint64_t t_ns, std::function<void()> fn);
+void sim_cancel(rt_uint64_t id);
+rt_err_t sim_wait_quiescent(rt_uint64_t timeout_ns);
+
+/* 控制台 */
+void sim_console_echo(bool on);
+std::string &sim_console(void);
+
+/* 堆：rt_malloc / rt_calloc 的累计调用次数 */
+rt_uint64_t sim_heap_allocs(void);
+
+/* MSH 命令 */
+int sim_msh_exec(const char *cmdline);
+
+/* 引脚与 PWM 边沿记录 */
+enum sim_edge_kind
+{
+    SIM_EDGE_PIN = 0,
+    SIM_EDGE_PWM_SET,
+    SIM_EDGE_PWM_ENABLE,
+    SIM_EDGE_PWM_DISABLE,
+};
+
+struct sim_edge
+{
+    rt_uint64_t    t_ns;
+    sim_edge_kind  kind;
+    std::string    id;         /* 引脚号或 "pwm2.4" */
+    rt_uint64_t    value;      /* 电平或周期(ns) */
+};
+
+const std::vector<sim_edge> &sim_edges(void);
+void sim_pin_input(rt_base_t pin, int level, rt_uint64_t at_ns);
+
+/* 串口：data 从 at_ns 起按波特率逐字节到达，排在线路上尚未发完的数据之后 */
+void sim_uart_input(const char *name, const void *data, size_t len, rt_uint64_t at_ns);
+rt_uint64_t sim_uart_overruns(const char *name);
+std::string &sim_uart_output(const char *name);
+
+/* 闪存：分区内每个擦除块的累计擦除次数 */
+std::vector<rt_uint32_t> sim_flash_erase_counts(const char *partition);
+
+/* 机械模型：滑台按脉冲计步，推手按行程时间运动 */
+void sim_axis_add(const char *name, const char *pwm_name, int channel,
+                  rt_base_t dir_pin, rt_int32_t travel_steps);
+double sim_axis_position(const char *name);
+void sim_axis_home(const char *name, rt_base_t pin, rt_int32_t width_steps);
+void sim_pusher_add(const char *name, rt_base_t fwd_pin, rt_base_t back_pin,
+                    rt_uint32_t stroke_ms);
+void sim_pusher_sense(const char *name, rt_base_t fwd_limit, rt_base_t back_limit,
+                      const char *adc_name, int adc_channel);
+int sim_pusher_strokes(const char *name);
+
+struct sim_motion
+{
+    std::string actor;
+    rt_uint64_t start_ns;
+    rt_uint64_t end_ns;        /* 仍在运动时为 SIM_NEVER */
+};
+
+const std::vector<sim_motion> &sim_motion_log(void);
+
+/* LCD 帧缓冲与总线开销 */
+struct sim_lcd_stats
+{
+    rt_uint64_t bus_ns;        /* 建模的 SPI 占用时间 */
+    rt_uint64_t bytes;         /* 写入显存的字节数 */
+    rt_uint64_t windows;       /* 地址窗口设置次数 */
+};
+
+const rt_uint16_t *sim_lcd_framebuffer(void);
+sim_lcd_stats &sim_lcd_stats_get(void);
+
+#endif
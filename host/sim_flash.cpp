@@ -0,0 +1,129 @@
+﻿/*
+ * FAL 替身：一片 SPI NOR 闪存及其分区表。
+ *
+ * 按 NOR 的行为建模：编程只能把 1 变成 0，擦除按块把整块置回 0xFF。
+ * 编程和擦除按下列参数折算成调用线程的忙等时间（驱动轮询状态寄存器），
+ * 每块的擦除次数记下来供磨损统计。
+ */
+
+#include "sim_internal.h"
+#include <fal.h>
+
+#include <cstring>
+#include <map>
+
+#define NOR_NAME            "norflash0"
+#define NOR_SIZE            (1024 * 1024)
+#define NOR_BLOCK_SIZE      4096
+#define NOR_PAGE_SIZE       256
+#define NOR_PAGE_PROG_NS    700000ULL       /* 页编程 */
+#define NOR_BLOCK_ERASE_NS  45000000ULL     /* 4 KB 块擦除 */
+
+namespace
+{
+
+struct sim_nor
+{
+    struct fal_flash_dev dev;
+    std::vector<rt_uint8_t> data;
+    std::vector<rt_uint32_t> erases;
+};
+
+sim_nor nor = []
+{
+    sim_nor n;
+    std::memset(&n.dev, 0, sizeof(n.dev));
+    std::strncpy(n.dev.name, NOR_NAME, FAL_DEV_NAME_MAX);
+    n.dev.len = NOR_SIZE;
+    n.dev.blk_size = NOR_BLOCK_SIZE;
+    n.dev.write_gran = 1;
+    n.data.assign(NOR_SIZE, 0xFF);
+    n.erases.assign(NOR_SIZE / NOR_BLOCK_SIZE, 0);
+    return n;
+}();
+
+/* 分区表，与板级工程 fal_cfg.h 一致 */
+const struct fal_partition partitions[] =
+{
+    { 0x45503130, "inventory", NOR_NAME, 0, 16 * 1024, 0 },
+    { 0x45503130, "slidepos", NOR_NAME, 16 * 1024, 8 * 1024, 0 },
+    { 0x45503130, "slidecal", NOR_NAME, 24 * 1024, 8 * 1024, 0 },
+};
+
+bool in_range(const struct fal_partition *part, uint32_t addr, size_t size)
+{
+    return part != RT_NULL && addr <= part->len && size <= part->len - addr;
+}
+
+} // namespace
+
+int fal_init(void)
+{
+    return (int)(sizeof(partitions) / sizeof(partitions[0]));
+}
+
+const struct fal_flash_dev *fal_flash_device_find(const char *name)
+{
+    return std::strcmp(name, NOR_NAME) == 0 ? &nor.dev : RT_NULL;
+}
+
+const struct fal_partition *fal_partition_find(const char *name)
+{
+    for (const struct fal_partition &part : partitions)
+    {
+        if (std::strcmp(part.name, name) == 0)
+            return &part;
+    }
+    return RT_NULL;
+}
+
+int fal_partition_read(const struct fal_partition *part, uint32_t addr, uint8_t *buf, size_t size)
+{
+    if (!in_range(part, addr, size))
+        return -1;
+    std::memcpy(buf, &nor.data[part->offset + addr], size);
+    return (int)size;
+}
+
+int fal_partition_write(const struct fal_partition *part, uint32_t addr, const uint8_t *buf, size_t size)
+{
+    if (!in_range(part, addr, size))
+        return -1;
+
+    size_t base = part->offset + addr;
+    for (size_t i = 0; i < size; i++)
+        nor.data[base + i] &= buf[i];
+
+    /* 跨页的写入分成多次页编程 */
+    size_t pages = (base + size - 1) / NOR_PAGE_SIZE - base / NOR_PAGE_SIZE + 1;
+    sim_busy(pages * NOR_PAGE_PROG_NS);
+    return (int)size;
+}
+
+int fal_partition_erase(const struct fal_partition *part, uint32_t addr, size_t size)
+{
+    if (!in_range(part, addr, size))
+        return -1;
+
+    size_t first = (part->offset + addr) / NOR_BLOCK_SIZE;
+    size_t last = (part->offset + addr + size - 1) / NOR_BLOCK_SIZE;
+    for (size_t b = first; b <= last; b++)
+    {
+        std::memset(&nor.data[b * NOR_BLOCK_SIZE], 0xFF, NOR_BLOCK_SIZE);
+        nor.erases[b]++;
+        sim_busy(NOR_BLOCK_ERASE_NS);
+    }
+    return (int)size;
+}
+
+std::vector<rt_uint32_t> sim_flash_erase_counts(const char *partition)
+{
+    const struct fal_partition *part = fal_partition_find(partition);
+    std::vector<rt_uint32_t> counts;
+
+    if (part == RT_NULL)
+        return counts;
+    for (size_t b = part->offset / NOR_BLOCK_SIZE; b < (part->offset + part->len) / NOR_BLOCK_SIZE; b++)
+        counts.push_back(nor.erases[b]);
+    return counts;
+}
@@ -0,0 +1,792 @@
+﻿/*
+ * 设备框架、PIN、PWM、硬件定时器、ADC、串口、MSH 与 DWT 周期计数器的替身。
+ *
+ * 所有输出边沿都带虚拟时间戳记录下来；PWM 按 STM32 驱动和定时器的行为建模：
+ * 同一定时器的各通道共用 PSC 与 ARR，脉宽按通道独立（CCRx）；有通道使能时
+ * 计数器运行，每个更新事件各使能的通道发完一个脉冲，随后置 UIF，按 DIER 与
+ * NVIC 进 TIM2 的更新中断，再按此时的 ARR 排下一次更新。串口按 DMA
+ * 接收建模：字节按波特率落进驱动的接收缓冲，DMA 半满、满和线路空闲时
+ * 在中断上下文里通知上层，缓冲里没读走的数据被覆盖时记为溢出。
+ */
+
+#include "sim_internal.h"
+#include <board.h>
+#include <finsh.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <map>
+
+namespace
+{
+
+struct pin_state
+{
+    rt_uint8_t mode = PIN_MODE_INPUT;
+    int out = PIN_LOW;
+    int in = -1;                        /* -1: 无外部驱动，按上下拉决定 */
+    rt_uint32_t irq_mode = 0;
+    void (*irq_hdr)(void *args) = nullptr;
+    void *irq_args = nullptr;
+    bool irq_enabled = false;
+};
+
+#define SIM_PWM_CHANNELS    4
+#define SIM_TIM_CLOCK_MHZ   84      /* APB1 定时器时钟，与 STM32F407 相同 */
+#define SIM_PWM_MAX_PERIOD  65535   /* drv_pwm 选预分频的上限 */
+#define SIM_PWM_MIN_PERIOD  3
+#define SIM_PWM_MIN_PULSE   2
+
+struct sim_pwm
+{
+    struct rt_device_pwm dev;
+    sim_tim_regs own;
+    sim_tim_regs *tim = &own;           /* pwm2 指向 TIM2，其余用自己的寄存器 */
+    bool enabled[SIM_PWM_CHANNELS + 1];
+    rt_uint64_t pulses[SIM_PWM_CHANNELS + 1];
+    bool counting = false;
+    rt_uint64_t update_event = 0;
+};
+
+bool tim2_irq_enabled = false;
+
+std::map<rt_base_t, pin_state> &pins(void)
+{
+    static std::map<rt_base_t, pin_state> *p = new std::map<rt_base_t, pin_state>;
+    return *p;
+}
+
+std::map<std::string, rt_device_t> &devices(void)
+{
+    static std::map<std::string, rt_device_t> *d = new std::map<std::string, rt_device_t>;
+    return *d;
+}
+
+struct msh_entry
+{
+    const char *name;
+    const char *desc;
+    sim_msh_func_t func;
+};
+
+std::vector<msh_entry> &msh_table(void)
+{
+    static std::vector<msh_entry> *t = new std::vector<msh_entry>;
+    return *t;
+}
+
+std::vector<sim_edge> edges;
+
+void record(sim_edge_kind kind, const std::string &id, rt_uint64_t value)
+{
+    edges.push_back(sim_edge{ sim_now_ns(), kind, id, value });
+}
+
+std::string pwm_id(struct rt_device_pwm *device, int channel)
+{
+    return std::string(device->parent.parent.name) + "." + std::to_string(channel);
+}
+
+int input_level(const pin_state &p)
+{
+    if (p.in >= 0)
+        return p.in;
+    return p.mode == PIN_MODE_INPUT_PULLUP ? PIN_HIGH : PIN_LOW;
+}
+
+sim_pwm *pwm_of(struct rt_device_pwm *device)
+{
+    return reinterpret_cast<sim_pwm *>(device);
+}
+
+void register_pwm(const char *name, sim_tim_regs *tim)
+{
+    sim_pwm *pwm = new sim_pwm();
+    if (tim != nullptr)
+        pwm->tim = tim;
+    rt_device_register(&pwm->dev.parent, name, RT_DEVICE_FLAG_RDWR);
+}
+
+rt_uint64_t tim_period_ns(const sim_pwm *pwm)
+{
+    return (rt_uint64_t)(pwm->tim->ARR + 1) * (pwm->tim->PSC + 1) * 1000 / SIM_TIM_CLOCK_MHZ;
+}
+
+volatile rt_uint32_t *tim_ccr(sim_pwm *pwm, int channel)
+{
+    return &pwm->tim->CCR1 + (channel - 1);
+}
+
+/* 更新中断：只有 TIM2 接到了固件的中断服务函数上 */
+void tim_irq(sim_pwm *pwm)
+{
+    if (pwm->tim == &sim_tim2 && tim2_irq_enabled && (sim_tim2.DIER & TIM_DIER_UIE)
+        && (sim_tim2.SR & TIM_SR_UIF) && TIM2_IRQHandler != nullptr)
+        TIM2_IRQHandler();
+}
+
+void tim_update(sim_pwm *pwm);
+
+void tim_arm(sim_pwm *pwm)
+{
+    pwm->update_event = sim_at(sim_now_ns() + tim_period_ns(pwm), [pwm] { tim_update(pwm); });
+}
+
+/*
+ * 更新事件：使能的通道各发完一个脉冲（比较值不超过 ARR 时才有高电平），
+ * 机械模型随即走一步；中断服务函数可以改写 ARR、开关通道，之后计数器仍在
+ * 运行时按新的 ARR 排下一次更新。
+ */
+void tim_update(sim_pwm *pwm)
+{
+    pwm->update_event = 0;
+    sim_plant_sync();
+    for (int ch = 1; ch <= SIM_PWM_CHANNELS; ch++)
+    {
+        if (pwm->enabled[ch] && *tim_ccr(pwm, ch) <= pwm->tim->ARR)
+            pwm->pulses[ch]++;
+    }
+    sim_plant_sync();
+    sim_plant_changed();
+
+    pwm->tim->SR |= TIM_SR_UIF;
+    tim_irq(pwm);
+    if (pwm->counting && pwm->update_event == 0)
+        tim_arm(pwm);
+}
+
+/* ADC：读数即机械模型最近一次给出的值，未使能的通道读 0 */
+#define SIM_ADC_CHANNELS    16
+
+struct sim_adc
+{
+    struct rt_adc_device dev;
+    rt_uint32_t value[SIM_ADC_CHANNELS];
+    bool enabled[SIM_ADC_CHANNELS];
+};
+
+sim_adc *adc_of(rt_adc_device_t device)
+{
+    return reinterpret_cast<sim_adc *>(device);
+}
+
+void register_adc(const char *name)
+{
+    sim_adc *adc = new sim_adc();
+    adc->dev.parent.type = RT_Device_Class_Miscellaneous;
+    rt_device_register(&adc->dev.parent, name, RT_DEVICE_FLAG_RDWR);
+}
+
+/* 硬件定时器：超时回调在中断上下文中执行 */
+struct sim_hwtimer
+{
+    struct rt_device parent;
+    rt_hwtimer_mode_t mode;
+    rt_uint64_t period_ns;
+    rt_uint64_t start_ns;
+    rt_uint64_t event;
+};
+
+void hwtimer_arm(sim_hwtimer *timer)
+{
+    timer->start_ns = sim_now_ns();
+    timer->event = sim_at(timer->start_ns + timer->period_ns, [timer] {
+        timer->event = 0;
+        if (timer->mode == HWTIMER_MODE_PERIOD)
+            hwtimer_arm(timer);
+        if (timer->parent.rx_indicate)
+            timer->parent.rx_indicate(&timer->parent, sizeof(rt_hwtimerval_t));
+    });
+}
+
+void hwtimer_stop(sim_hwtimer *timer)
+{
+    sim_cancel(timer->event);
+    timer->event = 0;
+}
+
+rt_err_t hwtimer_control(rt_device_t dev, int cmd, void *args)
+{
+    sim_hwtimer *timer = reinterpret_cast<sim_hwtimer *>(dev);
+    switch (cmd)
+    {
+    case HWTIMER_CTRL_MODE_SET:
+        timer->mode = *static_cast<rt_hwtimer_mode_t *>(args);
+        return RT_EOK;
+    case HWTIMER_CTRL_FREQ_SET:
+        return RT_EOK;
+    case HWTIMER_CTRL_STOP:
+        hwtimer_stop(timer);
+        return RT_EOK;
+    default:
+        return -RT_ENOSYS;
+    }
+}
+
+rt_size_t hwtimer_write(rt_device_t dev, rt_off_t pos, const void *buffer, rt_size_t size)
+{
+    sim_hwtimer *timer = reinterpret_cast<sim_hwtimer *>(dev);
+    const rt_hwtimerval_t *tv = static_cast<const rt_hwtimerval_t *>(buffer);
+    RT_UNUSED(pos);
+    if (size != sizeof(rt_hwtimerval_t))
+        return 0;
+
+    hwtimer_stop(timer);
+    timer->period_ns = (rt_uint64_t)tv->sec * 1000000000ULL + (rt_uint64_t)tv->usec * 1000ULL;
+    if (timer->period_ns == 0)
+        return 0;
+    hwtimer_arm(timer);
+    return size;
+}
+
+rt_size_t hwtimer_read(rt_device_t dev, rt_off_t pos, void *buffer, rt_size_t size)
+{
+    sim_hwtimer *timer = reinterpret_cast<sim_hwtimer *>(dev);
+    rt_hwtimerval_t *tv = static_cast<rt_hwtimerval_t *>(buffer);
+    RT_UNUSED(pos);
+    if (size != sizeof(rt_hwtimerval_t))
+        return 0;
+
+    rt_uint64_t elapsed = timer->event ? sim_now_ns() - timer->start_ns : 0;
+    tv->sec = (rt_int32_t)(elapsed / 1000000000ULL);
+    tv->usec = (rt_int32_t)(elapsed % 1000000000ULL / 1000);
+    return size;
+}
+
+void register_hwtimer(const char *name)
+{
+    sim_hwtimer *timer = new sim_hwtimer();
+    timer->parent.type = RT_Device_Class_Timer;
+    timer->parent.control = hwtimer_control;
+    timer->parent.write = hwtimer_write;
+    timer->parent.read = hwtimer_read;
+    timer->mode = HWTIMER_MODE_ONESHOT;
+    rt_device_register(&timer->parent, name, RT_DEVICE_FLAG_RDWR);
+}
+
+/* 串口：接收缓冲即驱动的 DMA 环形缓冲，大小取 serial_configure::bufsz */
+struct sim_uart
+{
+    struct rt_device parent;
+    rt_uint32_t baud = BAUD_RATE_115200;
+    rt_uint32_t bufsz = RT_SERIAL_RB_BUFSZ;
+    std::deque<rt_uint8_t> rx;          /* 已落进缓冲、尚未读走的字节 */
+    rt_uint32_t dma_pos = 0;            /* DMA 写指针，用来判断半满和满 */
+    rt_uint64_t line_free_ns = 0;       /* 线路上正在发送的数据何时发完 */
+    rt_uint64_t overruns = 0;
+    std::string tx;
+};
+
+sim_uart *uart_of(rt_device_t dev)
+{
+    return reinterpret_cast<sim_uart *>(dev);
+}
+
+/* 一帧 10 位：起始位、8 个数据位、停止位 */
+rt_uint64_t uart_byte_ns(const sim_uart *uart)
+{
+    return 10ULL * 1000000000ULL / uart->baud;
+}
+
+/* DMA 事件：把这段字节放进接收缓冲并通知上层 */
+void uart_dma_event(sim_uart *uart, const std::string &chunk)
+{
+    for (char c : chunk)
+    {
+        if (uart->rx.size() >= uart->bufsz)
+        {
+            uart->rx.pop_front();
+            uart->overruns++;
+        }
+        uart->rx.push_back((rt_uint8_t)c);
+    }
+    if (uart->parent.rx_indicate && !uart->rx.empty())
+        uart->parent.rx_indicate(&uart->parent, uart->rx.size());
+}
+
+rt_err_t uart_control(rt_device_t dev, int cmd, void *args)
+{
+    sim_uart *uart = uart_of(dev);
+    if (cmd != RT_DEVICE_CTRL_CONFIG)
+        return -RT_ENOSYS;
+
+    const struct serial_configure *config = static_cast<const struct serial_configure *>(args);
+    uart->baud = config->baud_rate;
+    uart->bufsz = config->bufsz;
+    return RT_EOK;
+}
+
+rt_size_t uart_read(rt_device_t dev, rt_off_t pos, void *buffer, rt_size_t size)
+{
+    sim_uart *uart = uart_of(dev);
+    rt_uint8_t *out = static_cast<rt_uint8_t *>(buffer);
+    rt_size_t n = 0;
+    RT_UNUSED(pos);
+
+    rt_base_t level = rt_hw_interrupt_disable();
+    while (n < size && !uart->rx.empty())
+    {
+        out[n++] = uart->rx.front();
+        uart->rx.pop_front();
+    }
+    rt_hw_interrupt_enable(level);
+    return n;
+}
+
+rt_size_t uart_write(rt_device_t dev, rt_off_t pos, const void *buffer, rt_size_t size)
+{
+    RT_UNUSED(pos);
+    uart_of(dev)->tx.append(static_cast<const char *>(buffer), size);
+    return size;
+}
+
+void register_uart(const char *name)
+{
+    sim_uart *uart = new sim_uart();
+    uart->parent.type = RT_Device_Class_Char;
+    uart->parent.control = uart_control;
+    uart->parent.read = uart_read;
+    uart->parent.write = uart_write;
+    rt_device_register(&uart->parent, name,
+                       RT_DEVICE_FLAG_RDWR | RT_DEVICE_FLAG_INT_RX | RT_DEVICE_FLAG_DMA_RX);
+}
+
+struct board_init
+{
+    board_init()
+    {
+        register_pwm("pwm2", &sim_tim2);
+        register_pwm("pwm3", nullptr);
+        register_hwtimer("timer3");
+        register_hwtimer("timer4");
+        register_adc("adc1");
+        register_uart("uart2");
+    }
+} board;
+
+} // namespace
+
+/* ---------------- 设备框架 ---------------- */
+
+rt_device_t rt_device_find(const char *name)
+{
+    auto it = devices().find(name);
+    return it == devices().end() ? RT_NULL : it->second;
+}
+
+rt_err_t rt_device_register(rt_device_t dev, const char *name, rt_uint16_t flags)
+{
+    if (rt_device_find(name) != RT_NULL)
+        return -RT_ERROR;
+    std::strncpy(dev->parent.name, name, RT_NAME_MAX);
+    dev->parent.type = RT_Object_Class_Device;
+    dev->flag = flags;
+    devices()[name] = dev;
+    return RT_EOK;
+}
+
+rt_err_t rt_device_init(rt_device_t dev)
+{
+    if (dev->init && !(dev->flag & RT_DEVICE_FLAG_ACTIVATED))
+    {
+        rt_err_t result = dev->init(dev);
+        if (result != RT_EOK)
+            return result;
+    }
+    dev->flag |= RT_DEVICE_FLAG_ACTIVATED;
+    return RT_EOK;
+}
+
+rt_err_t rt_device_open(rt_device_t dev, rt_uint16_t oflag)
+{
+    rt_err_t result = rt_device_init(dev);
+    if (result != RT_EOK)
+        return result;
+    if (dev->open)
+    {
+        result = dev->open(dev, oflag);
+        if (result != RT_EOK)
+            return result;
+    }
+    dev->open_flag = oflag | RT_DEVICE_OFLAG_OPEN;
+    dev->ref_count++;
+    return RT_EOK;
+}
+
+rt_err_t rt_device_close(rt_device_t dev)
+{
+    if (dev->ref_count == 0)
+        return -RT_ERROR;
+    if (--dev->ref_count == 0)
+    {
+        if (dev->close)
+            dev->close(dev);
+        dev->open_flag = RT_DEVICE_OFLAG_CLOSE;
+    }
+    return RT_EOK;
+}
+
+rt_size_t rt_device_read(rt_device_t dev, rt_off_t pos, void *buffer, rt_size_t size)
+{
+    return dev->read ? dev->read(dev, pos, buffer, size) : 0;
+}
+
+rt_size_t rt_device_write(rt_device_t dev, rt_off_t pos, const void *buffer, rt_size_t size)
+{
+    return dev->write ? dev->write(dev, pos, buffer, size) : 0;
+}
+
+rt_err_t rt_device_control(rt_device_t dev, int cmd, void *arg)
+{
+    return dev->control ? dev->control(dev, cmd, arg) : -RT_ENOSYS;
+}
+
+rt_err_t rt_device_set_rx_indicate(rt_device_t dev, rt_err_t (*rx_ind)(rt_device_t dev, rt_size_t size))
+{
+    dev->rx_indicate = rx_ind;
+    return RT_EOK;
+}
+
+/* ---------------- PIN ---------------- */
+
+void rt_pin_mode(rt_base_t pin, rt_base_t mode)
+{
+    pins()[pin].mode = (rt_uint8_t)mode;
+}
+
+void rt_pin_write(rt_base_t pin, rt_base_t value)
+{
+    pin_state &p = pins()[pin];
+    int level = value ? PIN_HIGH : PIN_LOW;
+    if (p.out == level)
+        return;
+
+    sim_plant_sync();
+    p.out = level;
+    record(SIM_EDGE_PIN, std::to_string(pin), level);
+    sim_plant_changed();
+}
+
+int rt_pin_read(rt_base_t pin)
+{
+    pin_state &p = pins()[pin];
+    if (p.mode == PIN_MODE_OUTPUT || p.mode == PIN_MODE_OUTPUT_OD)
+        return p.out;
+    return input_level(p);
+}
+
+rt_err_t rt_pin_attach_irq(rt_int32_t pin, rt_uint32_t mode,
+                           void (*hdr)(void *args), void *args)
+{
+    pin_state &p = pins()[pin];
+    p.irq_mode = mode;
+    p.irq_hdr = hdr;
+    p.irq_args = args;
+    return RT_EOK;
+}
+
+rt_err_t rt_pin_detach_irq(rt_int32_t pin)
+{
+    pin_state &p = pins()[pin];
+    p.irq_hdr = nullptr;
+    p.irq_args = nullptr;
+    p.irq_enabled = false;
+    return RT_EOK;
+}
+
+rt_err_t rt_pin_irq_enable(rt_base_t pin, rt_uint32_t enabled)
+{
+    pin_state &p = pins()[pin];
+    if (enabled && p.irq_hdr == nullptr)
+        return -RT_ENOSYS;
+    p.irq_enabled = enabled == PIN_IRQ_ENABLE;
+    return RT_EOK;
+}
+
+void sim_pin_drive(rt_base_t pin, int level)
+{
+    pin_state &p = pins()[pin];
+    int before = input_level(p);
+    p.in = level;
+    if (before == level || !p.irq_enabled || p.irq_hdr == nullptr)
+        return;
+
+    bool fire = p.irq_mode == PIN_IRQ_MODE_RISING_FALLING ||
+                (p.irq_mode == PIN_IRQ_MODE_RISING && level == PIN_HIGH) ||
+                (p.irq_mode == PIN_IRQ_MODE_FALLING && level == PIN_LOW);
+    if (fire)
+        p.irq_hdr(p.irq_args);
+}
+
+int sim_pin_output(rt_base_t pin)
+{
+    return pins()[pin].out;
+}
+
+void sim_pin_input(rt_base_t pin, int level, rt_uint64_t at_ns)
+{
+    sim_at(at_ns, [pin, level] { sim_pin_drive(pin, level); });
+}
+
+const std::vector<sim_edge> &sim_edges(void)
+{
+    return edges;
+}
+
+/* ---------------- PWM ---------------- */
+
+rt_err_t rt_pwm_enable(struct rt_device_pwm *device, int channel)
+{
+    if (device == RT_NULL || channel < 1 || channel > SIM_PWM_CHANNELS)
+        return -RT_EIO;
+
+    sim_pwm *pwm = pwm_of(device);
+    if (pwm->enabled[channel])
+        return RT_EOK;
+    sim_plant_sync();
+    pwm->enabled[channel] = true;
+    record(SIM_EDGE_PWM_ENABLE, pwm_id(device, channel), tim_period_ns(pwm));
+    if (!pwm->counting)
+    {
+        /* HAL_TIM_PWM_Start 打开计数器，从当前计数值继续 */
+        pwm->counting = true;
+        tim_arm(pwm);
+    }
+    sim_plant_changed();
+    return RT_EOK;
+}
+
+rt_err_t rt_pwm_disable(struct rt_device_pwm *device, int channel)
+{
+    if (device == RT_NULL || channel < 1 || channel > SIM_PWM_CHANNELS)
+        return -RT_EIO;
+
+    sim_pwm *pwm = pwm_of(device);
+    if (!pwm->enabled[channel])
+        return RT_EOK;
+    sim_plant_sync();
+    pwm->enabled[channel] = false;
+    record(SIM_EDGE_PWM_DISABLE, pwm_id(device, channel), 0);
+    if (std::none_of(pwm->enabled + 1, pwm->enabled + SIM_PWM_CHANNELS + 1, [](bool on) { return on; }))
+    {
+        /* HAL_TIM_PWM_Stop 在所有通道都关闭后停掉计数器 */
+        pwm->counting = false;
+        sim_cancel(pwm->update_event);
+        pwm->update_event = 0;
+    }
+    sim_plant_changed();
+    return RT_EOK;
+}
+
+rt_err_t rt_pwm_set(struct rt_device_pwm *device, int channel, rt_uint32_t period, rt_uint32_t pulse)
+{
+    if (device == RT_NULL || channel < 1 || channel > SIM_PWM_CHANNELS)
+        return -RT_EIO;
+
+    /* 与 drv_pwm 相同：按周期选预分频，计数器清零并以 UG 装载，同时置 UIF */
+    sim_pwm *pwm = pwm_of(device);
+    rt_uint64_t ticks = (rt_uint64_t)period * SIM_TIM_CLOCK_MHZ / 1000;
+    rt_uint32_t psc = (rt_uint32_t)(ticks / SIM_PWM_MAX_PERIOD + 1);
+    ticks /= psc;
+    if (ticks < SIM_PWM_MIN_PERIOD)
+        ticks = SIM_PWM_MIN_PERIOD;
+    rt_uint64_t width = (rt_uint64_t)pulse * SIM_TIM_CLOCK_MHZ / psc / 1000;
+    if (width < SIM_PWM_MIN_PULSE)
+        width = SIM_PWM_MIN_PULSE;
+    else if (width > ticks)
+        width = ticks;
+
+    sim_plant_sync();
+    pwm->tim->PSC = psc - 1;
+    pwm->tim->ARR = (rt_uint32_t)ticks - 1;
+    *tim_ccr(pwm, channel) = (rt_uint32_t)width - 1;
+    pwm->tim->CNT = 0;
+    pwm->tim->SR |= TIM_SR_UIF;
+    if (pwm->counting)
+    {
+        sim_cancel(pwm->update_event);
+        tim_arm(pwm);
+    }
+    record(SIM_EDGE_PWM_SET, pwm_id(device, channel), period);
+    sim_at(sim_now_ns(), [pwm] { tim_irq(pwm); });
+    sim_plant_changed();
+    return RT_EOK;
+}
+
+struct rt_device_pwm *sim_pwm_find(const char *name)
+{
+    return reinterpret_cast<struct rt_device_pwm *>(rt_device_find(name));
+}
+
+rt_bool_t sim_pwm_enabled(struct rt_device_pwm *device, int channel)
+{
+    return pwm_of(device)->enabled[channel];
+}
+
+rt_uint64_t sim_pwm_pulses(struct rt_device_pwm *device, int channel)
+{
+    return pwm_of(device)->pulses[channel];
+}
+
+/* ---------------- 定时器寄存器与 NVIC ---------------- */
+
+sim_tim_regs sim_tim2;
+
+void NVIC_EnableIRQ(IRQn_Type irq)
+{
+    if (irq == TIM2_IRQn)
+        tim2_irq_enabled = true;
+}
+
+void NVIC_DisableIRQ(IRQn_Type irq)
+{
+    if (irq == TIM2_IRQn)
+        tim2_irq_enabled = false;
+}
+
+/* ---------------- MSH ---------------- */
+
+sim_msh_cmd::sim_msh_cmd(const char *name, const char *desc, sim_msh_func_t func)
+{
+    msh_table().push_back(msh_entry{ name, desc, func });
+}
+
+int sim_msh_exec(const char *cmdline)
+{
+    char line[128];
+    char *argv[16];
+    int argc = 0;
+
+    std::strncpy(line, cmdline, sizeof(line) - 1);
+    line[sizeof(line) - 1] = '\0';
+    for (char *tok = std::strtok(line, " "); tok && argc < 16; tok = std::strtok(nullptr, " "))
+        argv[argc++] = tok;
+    if (argc == 0)
+        return -1;
+
+    for (const msh_entry &e : msh_table())
+    {
+        if (std::strcmp(e.name, argv[0]) == 0)
+            return e.func(argc, argv);
+    }
+    rt_kprintf("%s: command not found.\n", argv[0]);
+    return -1;
+}
+
+/* ---------------- 串口 ---------------- */
+
+void sim_uart_input(const char *name, const void *data, size_t len, rt_uint64_t at_ns)
+{
+    sim_uart *uart = uart_of(rt_device_find(name));
+    const char *bytes = static_cast<const char *>(data);
+    rt_uint64_t t = std::max(at_ns, uart->line_free_ns);
+    rt_uint32_t half = uart->bufsz / 2 ? uart->bufsz / 2 : 1;
+    std::string chunk;
+
+    /* 每个字节在停止位结束时落进缓冲；DMA 写到半满或满时产生一次中断 */
+    for (size_t i = 0; i < len; i++)
+    {
+        t += uart_byte_ns(uart);
+        chunk.push_back(bytes[i]);
+        uart->dma_pos = (uart->dma_pos + 1) % uart->bufsz;
+        if (uart->dma_pos % half == 0)
+        {
+            sim_at(t, [uart, chunk] { uart_dma_event(uart, chunk); });
+            chunk.clear();
+        }
+    }
+
+    /* 线路空闲一帧时间后，剩下的字节由空闲中断交给上层 */
+    if (!chunk.empty())
+        sim_at(t + uart_byte_ns(uart), [uart, chunk] { uart_dma_event(uart, chunk); });
+    uart->line_free_ns = t;
+}
+
+rt_uint64_t sim_uart_overruns(const char *name)
+{
+    return uart_of(rt_device_find(name))->overruns;
+}
+
+std::string &sim_uart_output(const char *name)
+{
+    return uart_of(rt_device_find(name))->tx;
+}
+
+/* ---------------- ADC ---------------- */
+
+rt_err_t rt_adc_enable(rt_adc_device_t dev, rt_uint32_t channel)
+{
+    if (dev == RT_NULL || channel >= SIM_ADC_CHANNELS)
+        return -RT_ERROR;
+    adc_of(dev)->enabled[channel] = true;
+    return RT_EOK;
+}
+
+rt_err_t rt_adc_disable(rt_adc_device_t dev, rt_uint32_t channel)
+{
+    if (dev == RT_NULL || channel >= SIM_ADC_CHANNELS)
+        return -RT_ERROR;
+    adc_of(dev)->enabled[channel] = false;
+    return RT_EOK;
+}
+
+rt_uint32_t rt_adc_read(rt_adc_device_t dev, rt_uint32_t channel)
+{
+    if (dev == RT_NULL || channel >= SIM_ADC_CHANNELS || !adc_of(dev)->enabled[channel])
+        return 0;
+    sim_plant_sync();
+    return adc_of(dev)->value[channel];
+}
+
+void sim_adc_set(const char *name, int channel, rt_uint32_t value)
+{
+    rt_adc_device_t dev = reinterpret_cast<rt_adc_device_t>(rt_device_find(name));
+    if (dev != RT_NULL && channel >= 0 && channel < SIM_ADC_CHANNELS)
+        adc_of(dev)->value[channel] = value;
+}
+
+/* ---------------- DWT ---------------- */
+
+#define SIM_CORE_CLOCK      168000000   /* STM32F4 */
+
+rt_uint32_t SystemCoreClock = SIM_CORE_CLOCK;
+sim_dwt_regs sim_dwt;
+sim_core_debug_regs sim_core_debug;
+
+namespace
+{
+
+/* 计数器在 base_ns 时刻的值为 base_value，之后按内核时钟增长 */
+rt_uint64_t cyccnt_base_ns = 0;
+rt_uint32_t cyccnt_base_value = 0;
+
+bool cyccnt_enabled(void)
+{
+    return (sim_core_debug.DEMCR & CoreDebug_DEMCR_TRCENA_Msk) &&
+           (sim_dwt.CTRL & DWT_CTRL_CYCCNTENA_Msk);
+}
+
+} // namespace
+
+sim_cyccnt::operator rt_uint32_t() const
+{
+    rt_uint64_t now = sim_now_ns();
+
+    /* 没打开时停在原值，打开后从读到的这一刻接着数 */
+    if (!cyccnt_enabled())
+    {
+        cyccnt_base_ns = now;
+        return cyccnt_base_value;
+    }
+    return cyccnt_base_value +
+           (rt_uint32_t)((now - cyccnt_base_ns) * (SystemCoreClock / 1000000) / 1000);
+}
+
+sim_cyccnt &sim_cyccnt::operator=(rt_uint32_t value)
+{
+    cyccnt_base_ns = sim_now_ns();
+    cyccnt_base_value = value;
+    return *this;
+}
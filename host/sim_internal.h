@@ -0,0 +1,38 @@
+﻿#ifndef SIM_INTERNAL_H__
+#define SIM_INTERNAL_H__
+
+/* 仿真层各模块之间共享的内部接口，固件与基准程序不应包含 */
+
+#include "sim.h"
+#include <rtdevice.h>
+
+/* 调度：在线程上下文中唤醒了其他线程后调用，必要时让出 CPU */
+void sim_preempt_check(void);
+rt_bool_t sim_in_isr(void);
+
+/* IPC：挂起当前线程到等待链表（timeout 以节拍计），或唤醒等待者 */
+rt_err_t sim_suspend(rt_list_t *list, rt_uint8_t flag, rt_int32_t timeout);
+void sim_resume(rt_thread_t thread, rt_err_t result);
+rt_bool_t sim_resume_first(rt_list_t *list, rt_err_t result);
+void sim_resume_all(rt_list_t *list, rt_err_t result);
+
+/* 引脚：由机械模型或脚本驱动输入电平，并按配置触发中断 */
+void sim_pin_drive(rt_base_t pin, int level);
+int sim_pin_output(rt_base_t pin);
+
+/* PWM：机械模型读取通道状态和已发出的脉冲数 */
+struct rt_device_pwm *sim_pwm_find(const char *name);
+rt_bool_t sim_pwm_enabled(struct rt_device_pwm *pwm, int channel);
+rt_uint64_t sim_pwm_pulses(struct rt_device_pwm *pwm, int channel);
+
+/* 固件的 TIM2 更新中断服务函数，没有链接进来时为空 */
+extern "C" void TIM2_IRQHandler(void) __attribute__((weak));
+
+/* ADC：机械模型给出各通道的采样值 */
+void sim_adc_set(const char *name, int channel, rt_uint32_t value);
+
+/* 机械模型：状态改变前积分到当前时刻，改变后重新预测 */
+void sim_plant_sync(void);
+void sim_plant_changed(void);
+
+#endif
@@ -0,0 +1,437 @@
+﻿/*
+ * IPC 替身：信号量、事件、消息队列、邮箱。
+ *
+ * 等待者通过 rt_thread.tlist 挂在对象的 suspend_thread 链表上，超时由调度器
+ * 摘链，与内核的实现方式一致。
+ */
+
+#include "sim_internal.h"
+
+#include <cstring>
+
+namespace
+{
+
+void ipc_init(struct rt_ipc_object *ipc, const char *name, rt_uint8_t type, rt_uint8_t flag)
+{
+    std::strncpy(ipc->parent.name, name, RT_NAME_MAX);
+    ipc->parent.type = type;
+    ipc->parent.flag = flag;
+    rt_list_init(&ipc->suspend_thread);
+}
+
+} // namespace
+
+/* ---------------- 信号量 ---------------- */
+
+rt_err_t rt_sem_init(rt_sem_t sem, const char *name, rt_uint32_t value, rt_uint8_t flag)
+{
+    ipc_init(&sem->parent, name, RT_Object_Class_Semaphore | RT_Object_Class_Static, flag);
+    sem->value = (rt_uint16_t)value;
+    return RT_EOK;
+}
+
+rt_err_t rt_sem_detach(rt_sem_t sem)
+{
+    sim_resume_all(&sem->parent.suspend_thread, -RT_ERROR);
+    return RT_EOK;
+}
+
+rt_sem_t rt_sem_create(const char *name, rt_uint32_t value, rt_uint8_t flag)
+{
+    rt_sem_t sem = static_cast<rt_sem_t>(rt_calloc(1, sizeof(struct rt_semaphore)));
+    if (sem == RT_NULL)
+        return RT_NULL;
+    rt_sem_init(sem, name, value, flag);
+    sem->parent.parent.type = RT_Object_Class_Semaphore;
+    return sem;
+}
+
+rt_err_t rt_sem_delete(rt_sem_t sem)
+{
+    rt_sem_detach(sem);
+    rt_free(sem);
+    return RT_EOK;
+}
+
+rt_err_t rt_sem_take(rt_sem_t sem, rt_int32_t timeout)
+{
+    if (sem->value > 0)
+    {
+        sem->value--;
+        return RT_EOK;
+    }
+    /* 被 release 唤醒时计数已直接转交给本线程 */
+    return sim_suspend(&sem->parent.suspend_thread, sem->parent.parent.flag, timeout);
+}
+
+rt_err_t rt_sem_trytake(rt_sem_t sem)
+{
+    return rt_sem_take(sem, RT_WAITING_NO);
+}
+
+rt_err_t rt_sem_release(rt_sem_t sem)
+{
+    if (sim_resume_first(&sem->parent.suspend_thread, RT_EOK))
+    {
+        sim_preempt_check();
+        return RT_EOK;
+    }
+    if (sem->value == 0xFFFF)
+        return -RT_EFULL;
+    sem->value++;
+    return RT_EOK;
+}
+
+/* ---------------- 消息队列 ---------------- */
+
+namespace
+{
+
+rt_size_t mq_slot_size(rt_size_t msg_size)
+{
+    return RT_ALIGN(msg_size, RT_ALIGN_SIZE) + sizeof(void *);
+}
+
+rt_uint8_t *mq_slot(rt_mq_t mq, rt_uint16_t index)
+{
+    return static_cast<rt_uint8_t *>(mq->msg_pool) + index * mq_slot_size(mq->msg_size);
+}
+
+/* 入队：urgent 时放到队头；头部记录消息长度 */
+void mq_put(rt_mq_t mq, const void *buffer, rt_size_t size, bool urgent)
+{
+    rt_uint16_t index;
+    if (urgent)
+    {
+        mq->head = (rt_uint16_t)((mq->head + mq->max_msgs - 1) % mq->max_msgs);
+        index = mq->head;
+    }
+    else
+    {
+        index = mq->tail;
+        mq->tail = (rt_uint16_t)((mq->tail + 1) % mq->max_msgs);
+    }
+
+    rt_uint8_t *slot = mq_slot(mq, index);
+    *reinterpret_cast<rt_size_t *>(slot) = size;
+    std::memcpy(slot + sizeof(void *), buffer, size);
+    mq->entry++;
+}
+
+/* 剩余等待节拍：timeout 为 0 不等待，为负永久等待 */
+rt_int32_t remaining_ticks(rt_int32_t timeout, rt_tick_t start)
+{
+    if (timeout <= 0)
+        return timeout;
+    rt_int32_t left = timeout - (rt_int32_t)(rt_tick_get() - start);
+    return left > 0 ? left : 0;
+}
+
+rt_err_t mq_send(rt_mq_t mq, const void *buffer, rt_size_t size, rt_int32_t timeout, bool urgent)
+{
+    if (size > mq->msg_size)
+        return -RT_ERROR;
+
+    rt_tick_t start = rt_tick_get();
+    while (mq->entry >= mq->max_msgs)
+    {
+        rt_int32_t left = remaining_ticks(timeout, start);
+        if (left == 0 || sim_in_isr())
+            return -RT_EFULL;
+        rt_err_t result = sim_suspend(&mq->suspend_sender_thread, mq->parent.parent.flag, left);
+        if (result != RT_EOK)
+            return result == -RT_ETIMEOUT ? -RT_EFULL : result;
+    }
+
+    mq_put(mq, buffer, size, urgent);
+    if (sim_resume_first(&mq->parent.suspend_thread, RT_EOK))
+        sim_preempt_check();
+    return RT_EOK;
+}
+
+} // namespace
+
+rt_err_t rt_mq_init(rt_mq_t mq, const char *name, void *msgpool,
+                    rt_size_t msg_size, rt_size_t pool_size, rt_uint8_t flag)
+{
+    ipc_init(&mq->parent, name, RT_Object_Class_MessageQueue | RT_Object_Class_Static, flag);
+    mq->msg_pool = msgpool;
+    mq->msg_size = (rt_uint16_t)msg_size;
+    mq->max_msgs = (rt_uint16_t)(pool_size / mq_slot_size(msg_size));
+    mq->entry = 0;
+    mq->head = 0;
+    mq->tail = 0;
+    rt_list_init(&mq->suspend_sender_thread);
+    return mq->max_msgs > 0 ? RT_EOK : -RT_ERROR;
+}
+
+rt_err_t rt_mq_detach(rt_mq_t mq)
+{
+    sim_resume_all(&mq->parent.suspend_thread, -RT_ERROR);
+    sim_resume_all(&mq->suspend_sender_thread, -RT_ERROR);
+    return RT_EOK;
+}
+
+rt_mq_t rt_mq_create(const char *name, rt_size_t msg_size, rt_size_t max_msgs, rt_uint8_t flag)
+{
+    rt_mq_t mq = static_cast<rt_mq_t>(rt_calloc(1, sizeof(struct rt_messagequeue)));
+    if (mq == RT_NULL)
+        return RT_NULL;
+    rt_size_t pool_size = mq_slot_size(msg_size) * max_msgs;
+    void *pool = rt_malloc(pool_size);
+    if (pool == RT_NULL)
+    {
+        rt_free(mq);
+        return RT_NULL;
+    }
+    rt_mq_init(mq, name, pool, msg_size, pool_size, flag);
+    mq->parent.parent.type = RT_Object_Class_MessageQueue;
+    return mq;
+}
+
+rt_err_t rt_mq_delete(rt_mq_t mq)
+{
+    rt_mq_detach(mq);
+    rt_free(mq->msg_pool);
+    rt_free(mq);
+    return RT_EOK;
+}
+
+rt_err_t rt_mq_send(rt_mq_t mq, const void *buffer, rt_size_t size)
+{
+    return mq_send(mq, buffer, size, RT_WAITING_NO, false);
+}
+
+rt_err_t rt_mq_send_wait(rt_mq_t mq, const void *buffer, rt_size_t size, rt_int32_t timeout)
+{
+    return mq_send(mq, buffer, size, timeout, false);
+}
+
+rt_err_t rt_mq_urgent(rt_mq_t mq, const void *buffer, rt_size_t size)
+{
+    return mq_send(mq, buffer, size, RT_WAITING_NO, true);
+}
+
+rt_err_t rt_mq_recv(rt_mq_t mq, void *buffer, rt_size_t size, rt_int32_t timeout)
+{
+    rt_tick_t start = rt_tick_get();
+    while (mq->entry == 0)
+    {
+        rt_int32_t left = remaining_ticks(timeout, start);
+        if (left == 0)
+            return -RT_ETIMEOUT;
+        rt_err_t result = sim_suspend(&mq->parent.suspend_thread, mq->parent.parent.flag, left);
+        if (result != RT_EOK)
+            return result;
+    }
+
+    rt_uint8_t *slot = mq_slot(mq, mq->head);
+    rt_size_t length = *reinterpret_cast<rt_size_t *>(slot);
+    std::memcpy(buffer, slot + sizeof(void *), length < size ? length : size);
+    mq->head = (rt_uint16_t)((mq->head + 1) % mq->max_msgs);
+    mq->entry--;
+
+    if (sim_resume_first(&mq->suspend_sender_thread, RT_EOK))
+        sim_preempt_check();
+    return RT_EOK;
+}
+
+/* ---------------- 邮箱 ---------------- */
+
+rt_err_t rt_mb_init(rt_mailbox_t mb, const char *name, void *msgpool,
+                    rt_size_t size, rt_uint8_t flag)
+{
+    ipc_init(&mb->parent, name, RT_Object_Class_MailBox | RT_Object_Class_Static, flag);
+    mb->msg_pool = static_cast<rt_ubase_t *>(msgpool);
+    mb->size = (rt_uint16_t)size;
+    mb->entry = 0;
+    mb->in_offset = 0;
+    mb->out_offset = 0;
+    rt_list_init(&mb->suspend_sender_thread);
+    return RT_EOK;
+}
+
+rt_err_t rt_mb_detach(rt_mailbox_t mb)
+{
+    sim_resume_all(&mb->parent.suspend_thread, -RT_ERROR);
+    sim_resume_all(&mb->suspend_sender_thread, -RT_ERROR);
+    return RT_EOK;
+}
+
+rt_mailbox_t rt_mb_create(const char *name, rt_size_t size, rt_uint8_t flag)
+{
+    rt_mailbox_t mb = static_cast<rt_mailbox_t>(rt_calloc(1, sizeof(struct rt_mailbox)));
+    if (mb == RT_NULL)
+        return RT_NULL;
+    void *pool = rt_malloc(size * sizeof(rt_ubase_t));
+    if (pool == RT_NULL)
+    {
+        rt_free(mb);
+        return RT_NULL;
+    }
+    rt_mb_init(mb, name, pool, size, flag);
+    mb->parent.parent.type = RT_Object_Class_MailBox;
+    return mb;
+}
+
+rt_err_t rt_mb_delete(rt_mailbox_t mb)
+{
+    rt_mb_detach(mb);
+    rt_free(mb->msg_pool);
+    rt_free(mb);
+    return RT_EOK;
+}
+
+rt_err_t rt_mb_send_wait(rt_mailbox_t mb, rt_ubase_t value, rt_int32_t timeout)
+{
+    rt_tick_t start = rt_tick_get();
+    while (mb->entry >= mb->size)
+    {
+        rt_int32_t left = remaining_ticks(timeout, start);
+        if (left == 0 || sim_in_isr())
+            return -RT_EFULL;
+        rt_err_t result = sim_suspend(&mb->suspend_sender_thread, mb->parent.parent.flag, left);
+        if (result != RT_EOK)
+            return result == -RT_ETIMEOUT ? -RT_EFULL : result;
+    }
+
+    mb->msg_pool[mb->in_offset] = value;
+    mb->in_offset = (rt_uint16_t)((mb->in_offset + 1) % mb->size);
+    mb->entry++;
+    if (sim_resume_first(&mb->parent.suspend_thread, RT_EOK))
+        sim_preempt_check();
+    return RT_EOK;
+}
+
+rt_err_t rt_mb_send(rt_mailbox_t mb, rt_ubase_t value)
+{
+    return rt_mb_send_wait(mb, value, RT_WAITING_NO);
+}
+
+rt_err_t rt_mb_recv(rt_mailbox_t mb, rt_ubase_t *value, rt_int32_t timeout)
+{
+    rt_tick_t start = rt_tick_get();
+    while (mb->entry == 0)
+    {
+        rt_int32_t left = remaining_ticks(timeout, start);
+        if (left == 0)
+            return -RT_ETIMEOUT;
+        rt_err_t result = sim_suspend(&mb->parent.suspend_thread, mb->parent.parent.flag, left);
+        if (result != RT_EOK)
+            return result;
+    }
+
+    *value = mb->msg_pool[mb->out_offset];
+    mb->out_offset = (rt_uint16_t)((mb->out_offset + 1) % mb->size);
+    mb->entry--;
+
+    if (sim_resume_first(&mb->suspend_sender_thread, RT_EOK))
+        sim_preempt_check();
+    return RT_EOK;
+}
+
+/* ---------------- 事件 ---------------- */
+
+namespace
+{
+
+/* 按等待方式检查事件集合，满足时返回匹配到的位，否则返回 0 */
+rt_uint32_t event_match(rt_uint32_t set, rt_uint32_t wanted, rt_uint8_t opt)
+{
+    if (opt & RT_EVENT_FLAG_AND)
+        return (set & wanted) == wanted ? wanted : 0;
+    if (opt & RT_EVENT_FLAG_OR)
+        return set & wanted;
+    return 0;
+}
+
+} // namespace
+
+rt_err_t rt_event_init(rt_event_t event, const char *name, rt_uint8_t flag)
+{
+    ipc_init(&event->parent, name, RT_Object_Class_Event | RT_Object_Class_Static, flag);
+    event->set = 0;
+    return RT_EOK;
+}
+
+rt_err_t rt_event_detach(rt_event_t event)
+{
+    sim_resume_all(&event->parent.suspend_thread, -RT_ERROR);
+    return RT_EOK;
+}
+
+rt_event_t rt_event_create(const char *name, rt_uint8_t flag)
+{
+    rt_event_t event = static_cast<rt_event_t>(rt_calloc(1, sizeof(struct rt_event)));
+    if (event == RT_NULL)
+        return RT_NULL;
+    rt_event_init(event, name, flag);
+    event->parent.parent.type = RT_Object_Class_Event;
+    return event;
+}
+
+rt_err_t rt_event_delete(rt_event_t event)
+{
+    rt_event_detach(event);
+    rt_free(event);
+    return RT_EOK;
+}
+
+rt_err_t rt_event_send(rt_event_t event, rt_uint32_t set)
+{
+    rt_uint32_t clear = 0;
+    bool woke = false;
+
+    if (set == 0)
+        return -RT_ERROR;
+
+    event->set |= set;
+    rt_list_t *list = &event->parent.suspend_thread;
+    for (rt_list_t *pos = list->next; pos != list;)
+    {
+        rt_thread_t thread = rt_list_entry(pos, struct rt_thread, tlist);
+        pos = pos->next;
+
+        rt_uint32_t matched = event_match(event->set, thread->event_set, thread->event_info);
+        if (matched == 0)
+            continue;
+
+        /* 与内核一致：收到的位通过 event_set 带回给等待者 */
+        thread->event_set = matched;
+        if (thread->event_info & RT_EVENT_FLAG_CLEAR)
+            clear |= matched;
+        sim_resume(thread, RT_EOK);
+        woke = true;
+    }
+    event->set &= ~clear;
+
+    if (woke)
+        sim_preempt_check();
+    return RT_EOK;
+}
+
+rt_err_t rt_event_recv(rt_event_t event, rt_uint32_t set, rt_uint8_t opt,
+                       rt_int32_t timeout, rt_uint32_t *recved)
+{
+    if (set == 0)
+        return -RT_ERROR;
+
+    rt_uint32_t matched = event_match(event->set, set, opt);
+    if (matched != 0)
+    {
+        if (opt & RT_EVENT_FLAG_CLEAR)
+            event->set &= ~matched;
+        if (recved)
+            *recved = matched;
+        return RT_EOK;
+    }
+
+    rt_thread_t self = rt_thread_self();
+    self->event_set = set;
+    self->event_info = opt;
+    rt_err_t result = sim_suspend(&event->parent.suspend_thread, event->parent.parent.flag, timeout);
+    if (result == RT_EOK && recved)
+        *recved = self->event_set;
+    return result;
+}
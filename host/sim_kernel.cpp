@@ -0,0 +1,755 @@
+﻿/*
+ * RT-Thread 内核替身：线程、延时、时钟、临界区与控制台。
+ *
+ * 每个 rt_thread 对应一个宿主线程，但同一时刻只有持有全局锁的那一个在执行固件
+ * 代码；线程阻塞时由它自己挑选下一个就绪线程（优先级数值小者优先，同级先进先出），
+ * 没有就绪线程时把虚拟时钟推进到下一个事件并在“中断上下文”中执行到期回调。
+ *
+ * 固件栈只作记录：线程每次让出 CPU 时量一次宿主栈的深度，把固件栈顶这么深的
+ * 一段抹掉，固件按 '#' 扫描的栈水位由此得到。宿主的栈帧比目标板大，且只在调度
+ * 点采样，这个水位用来比较各线程、看趋势，不能代替板上的读数。
+ */
+
+#include "sim_internal.h"
+
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+
+struct sim_thread
+{
+    rt_thread_t tcb;
+    void (*entry)(void *parameter);
+    void *parameter;
+
+    std::condition_variable cv;
+    std::unique_lock<std::mutex> *lock = nullptr;
+    bool go = false;                /* 轮到本线程执行 */
+    bool ready = false;             /* 在就绪表中（不含正在运行的线程） */
+    bool blocked = false;
+    bool closed = false;
+    bool quiescent_wait = false;
+    rt_int64_t seq = 0;
+    rt_uint64_t wake_ns = SIM_NEVER;
+    rt_err_t result = RT_EOK;
+
+    bool host = false;                  /* sim_run 的 main：跑的是宿主程序，不记栈水位 */
+    const char *stack_top = nullptr;    /* 宿主线程入口处的栈位置 */
+    rt_uint32_t stack_peak = 0;         /* 已抹掉的固件栈字节数 */
+};
+
+std::mutex &big_lock(void)
+{
+    static std::mutex *m = new std::mutex;
+    return *m;
+}
+
+std::vector<sim_thread *> threads;
+sim_thread *current = nullptr;
+rt_uint64_t now_ns = 0;
+rt_int64_t seq_head = 0, seq_tail = 0;
+int isr_nest = 0;
+int critical_nest = 0;
+
+/* 硬件事件队列：按 (时间, 序号) 排序 */
+std::map<std::pair<rt_uint64_t, rt_uint64_t>, std::function<void()>> events;
+std::map<rt_uint64_t, rt_uint64_t> event_time;
+rt_uint64_t event_seq = 0;
+
+/* 主线程退出后冻结整个仿真 */
+bool stopped = false;
+std::condition_variable done_cv;
+
+std::string console;
+bool console_echo = false;
+
+void make_ready(sim_thread *t, bool front)
+{
+    t->ready = true;
+    t->blocked = false;
+    t->wake_ns = SIM_NEVER;
+    t->seq = front ? --seq_head : ++seq_tail;
+    t->tcb->stat = RT_THREAD_READY;
+}
+
+sim_thread *pick(void)
+{
+    sim_thread *best = nullptr;
+    for (sim_thread *t : threads)
+    {
+        if (!t->ready)
+            continue;
+        if (!best || t->tcb->current_priority < best->tcb->current_priority ||
+            (t->tcb->current_priority == best->tcb->current_priority && t->seq < best->seq))
+            best = t;
+    }
+    return best;
+}
+
+rt_uint64_t next_time(const sim_thread *exclude)
+{
+    rt_uint64_t t = events.empty() ? SIM_NEVER : events.begin()->first.first;
+    for (sim_thread *th : threads)
+    {
+        if (th != exclude && th->blocked && th->wake_ns < t)
+            t = th->wake_ns;
+    }
+    return t;
+}
+
+void fire_due(void)
+{
+    while (!events.empty() && events.begin()->first.first <= now_ns)
+    {
+        auto it = events.begin();
+        std::function<void()> fn = std::move(it->second);
+        event_time.erase(it->first.second);
+        events.erase(it);
+
+        isr_nest++;
+        fn();
+        isr_nest--;
+    }
+
+    for (sim_thread *t : threads)
+    {
+        if (t->blocked && t->wake_ns <= now_ns)
+        {
+            t->quiescent_wait = false;
+            rt_list_remove(&t->tcb->tlist);
+            make_ready(t, false);
+            t->result = -RT_ETIMEOUT;
+        }
+    }
+}
+
+void deadlock(void)
+{
+    std::fprintf(stderr, "sim: deadlock at %.3f ms, no runnable thread and no pending event\n",
+                 now_ns / 1e6);
+    for (sim_thread *t : threads)
+    {
+        if (!t->closed)
+            std::fprintf(stderr, "  %-8.*s prio %d %s\n", RT_NAME_MAX, t->tcb->name,
+                         t->tcb->current_priority, t->blocked ? "blocked" : "ready");
+    }
+    std::fflush(stderr);
+    std::_Exit(2);
+}
+
+/* 记下当前宿主栈深度，按同样深度抹掉固件栈顶的 '#' */
+void stack_sample(sim_thread *t)
+{
+    const char *sp = static_cast<const char *>(__builtin_frame_address(0));
+    if (t == nullptr || t->host || t->stack_top == nullptr || isr_nest)
+        return;
+
+    rt_uint32_t size = t->tcb->stack_size;
+    rt_size_t depth = (rt_size_t)(t->stack_top - sp);
+    if (depth > size)
+        depth = size;
+    if (depth <= t->stack_peak)
+        return;
+
+    char *stack = static_cast<char *>(t->tcb->stack_addr);
+    std::memset(stack + size - depth, 0, depth - t->stack_peak);
+    t->stack_peak = (rt_uint32_t)depth;
+}
+
+/* 切换到 next；若调用者未退出则等待自己再次被调度 */
+void dispatch(sim_thread *self, sim_thread *next)
+{
+    next->ready = false;
+    next->tcb->stat = RT_THREAD_RUNNING;
+    current = next;
+    if (next == self)
+        return;
+
+    next->go = true;
+    next->cv.notify_one();
+    if (self == nullptr || self->closed)
+        return;
+
+    self->cv.wait(*self->lock, [self] { return self->go; });
+    self->go = false;
+}
+
+/* self 已经阻塞、让出或退出：挑选下一个线程，必要时推进时间 */
+void schedule(sim_thread *self)
+{
+    if (self != nullptr && !self->closed)
+        stack_sample(self);
+
+    for (;;)
+    {
+        sim_thread *next = pick();
+        if (next)
+        {
+            dispatch(self, next);
+            return;
+        }
+
+        sim_thread *waiter = nullptr;
+        for (sim_thread *t : threads)
+        {
+            if (t->quiescent_wait)
+                waiter = t;
+        }
+
+        rt_uint64_t t = next_time(waiter);
+        if (waiter && t == SIM_NEVER)
+        {
+            waiter->quiescent_wait = false;
+            make_ready(waiter, false);
+            waiter->result = RT_EOK;
+            continue;
+        }
+        if (waiter && waiter->wake_ns < t)
+            t = waiter->wake_ns;
+        if (t == SIM_NEVER)
+            deadlock();
+
+        if (t > now_ns)
+            now_ns = t;
+        fire_due();
+    }
+}
+
+rt_err_t block_until(rt_uint64_t wake_ns)
+{
+    sim_thread *self = current;
+    self->blocked = true;
+    self->wake_ns = wake_ns;
+    self->result = RT_EOK;
+    self->tcb->stat = RT_THREAD_SUSPEND;
+    schedule(self);
+    return self->result;
+}
+
+rt_uint64_t deadline(rt_int32_t timeout)
+{
+    if (timeout == RT_WAITING_FOREVER)
+        return SIM_NEVER;
+    rt_uint64_t tick_ns = 1000000000ULL / RT_TICK_PER_SECOND;
+    return (now_ns / tick_ns + (rt_uint64_t)timeout) * tick_ns;
+}
+
+sim_thread *ctx_of(rt_thread_t thread)
+{
+    return static_cast<sim_thread *>(thread->sim);
+}
+
+void thread_body(sim_thread *t)
+{
+    std::unique_lock<std::mutex> lk(big_lock());
+    t->lock = &lk;
+    t->stack_top = static_cast<const char *>(__builtin_frame_address(0));
+    t->cv.wait(lk, [t] { return t->go; });
+    t->go = false;
+
+    t->entry(t->parameter);
+
+    t->closed = true;
+    rt_list_remove(&t->tcb->list);
+    t->ready = false;
+    t->blocked = false;
+    t->tcb->stat = RT_THREAD_CLOSE;
+    if (!stopped)
+        schedule(t);
+}
+
+struct main_args
+{
+    void (*entry)(void *parameter);
+    void *parameter;
+};
+
+void main_trampoline(void *parameter)
+{
+    main_args *args = static_cast<main_args *>(parameter);
+    args->entry(args->parameter);
+    stopped = true;
+    done_cv.notify_all();
+}
+
+} // namespace
+
+/* ---------------- 仿真接口 ---------------- */
+
+rt_uint64_t sim_now_ns(void)
+{
+    return now_ns;
+}
+
+int sim_run(void (*entry)(void *parameter), void *parameter)
+{
+    std::unique_lock<std::mutex> lk(big_lock());
+    main_args args = { entry, parameter };
+
+    rt_thread_t tid = rt_thread_create("main", main_trampoline, &args,
+                                       RT_MAIN_THREAD_STACK_SIZE, RT_MAIN_THREAD_PRIORITY, 20);
+    ctx_of(tid)->host = true;
+    rt_thread_startup(tid);
+    dispatch(nullptr, pick());
+    done_cv.wait(lk, [] { return stopped; });
+    return 0;
+}
+
+rt_bool_t sim_in_isr(void)
+{
+    return isr_nest > 0;
+}
+
+void sim_preempt_check(void)
+{
+    if (isr_nest || critical_nest || current == nullptr || stopped)
+        return;
+
+    sim_thread *next = pick();
+    if (next && next->tcb->current_priority < current->tcb->current_priority)
+    {
+        sim_thread *self = current;
+        make_ready(self, true);
+        schedule(self);
+    }
+}
+
+void sim_busy(rt_uint64_t ns)
+{
+    if (current == nullptr || isr_nest || stopped)
+        return;
+
+    stack_sample(current);
+
+    rt_uint64_t end = now_ns + ns;
+    for (;;)
+    {
+        rt_uint64_t t = next_time(nullptr);
+        if (t > end)
+        {
+            now_ns = end;
+            return;
+        }
+        if (t > now_ns)
+            now_ns = t;
+        fire_due();
+        sim_preempt_check();
+    }
+}
+
+rt_uint64_t sim_at(rt_uint64_t t_ns, std::function<void()> fn)
+{
+    if (t_ns < now_ns)
+        t_ns = now_ns;
+    rt_uint64_t id = ++event_seq;
+    events.emplace(std::make_pair(t_ns, id), std::move(fn));
+    event_time[id] = t_ns;
+    return id;
+}
+
+void sim_cancel(rt_uint64_t id)
+{
+    auto it = event_time.find(id);
+    if (it == event_time.end())
+        return;
+    events.erase(std::make_pair(it->second, id));
+    event_time.erase(it);
+}
+
+rt_err_t sim_suspend(rt_list_t *list, rt_uint8_t flag, rt_int32_t timeout)
+{
+    if (timeout == 0)
+        return -RT_ETIMEOUT;
+
+    rt_thread_t self = current->tcb;
+    rt_list_t *pos = list;
+    if (flag == RT_IPC_FLAG_PRIO)
+    {
+        /* 按优先级插入，同级排在后面 */
+        for (pos = list->next; pos != list; pos = pos->next)
+        {
+            rt_thread_t t = rt_list_entry(pos, struct rt_thread, tlist);
+            if (t->current_priority > self->current_priority)
+                break;
+        }
+    }
+    rt_list_insert_before(pos, &self->tlist);
+    return block_until(deadline(timeout));
+}
+
+void sim_resume(rt_thread_t thread, rt_err_t result)
+{
+    sim_thread *t = ctx_of(thread);
+    rt_list_remove(&thread->tlist);
+    make_ready(t, false);
+    t->result = result;
+}
+
+rt_bool_t sim_resume_first(rt_list_t *list, rt_err_t result)
+{
+    if (rt_list_isempty(list))
+        return RT_FALSE;
+
+    sim_resume(rt_list_entry(list->next, struct rt_thread, tlist), result);
+    return RT_TRUE;
+}
+
+void sim_resume_all(rt_list_t *list, rt_err_t result)
+{
+    while (sim_resume_first(list, result))
+        ;
+}
+
+rt_err_t sim_wait_quiescent(rt_uint64_t timeout_ns)
+{
+    current->quiescent_wait = true;
+    rt_err_t result = block_until(timeout_ns == SIM_NEVER ? SIM_NEVER : now_ns + timeout_ns);
+    current->quiescent_wait = false;
+    return result;
+}
+
+void sim_console_echo(bool on)
+{
+    console_echo = on;
+}
+
+std::string &sim_console(void)
+{
+    return console;
+}
+
+/* ---------------- 内核对象 ---------------- */
+
+/* 只维护线程一类：rt_thread_init 挂入，线程退出或删除时摘下 */
+static struct rt_object_information thread_objects = {
+    RT_Object_Class_Thread, { &thread_objects.object_list, &thread_objects.object_list },
+    sizeof(struct rt_thread)
+};
+
+struct rt_object_information *rt_object_get_information(enum rt_object_class_type type)
+{
+    return type == RT_Object_Class_Thread ? &thread_objects : RT_NULL;
+}
+
+/* ---------------- 线程 ---------------- */
+
+/* 静态线程：控制块和栈由调用者提供；仿真线程实际跑在宿主线程的栈上 */
+rt_err_t rt_thread_init(struct rt_thread *thread,
+                        const char *name,
+                        void (*entry)(void *parameter),
+                        void       *parameter,
+                        void       *stack_start,
+                        rt_uint32_t stack_size,
+                        rt_uint8_t  priority,
+                        rt_uint32_t tick)
+{
+    rt_memset(thread, 0, sizeof(struct rt_thread));
+    std::strncpy(thread->name, name, RT_NAME_MAX);
+    thread->type = RT_Object_Class_Thread | RT_Object_Class_Static;
+    thread->entry = reinterpret_cast<void *>(entry);
+    thread->parameter = parameter;
+    thread->stack_size = stack_size;
+    thread->stack_addr = stack_start;
+    rt_memset(thread->stack_addr, '#', stack_size);
+    rt_list_init(&thread->tlist);
+    rt_list_insert_after(&thread_objects.object_list, &thread->list);
+    thread->current_priority = priority;
+    thread->init_priority = priority;
+    thread->init_tick = tick;
+    thread->remaining_tick = tick;
+    thread->stat = RT_THREAD_INIT;
+
+    sim_thread *t = new sim_thread;
+    t->tcb = thread;
+    t->entry = entry;
+    t->parameter = parameter;
+    thread->sim = t;
+    return RT_EOK;
+}
+
+rt_thread_t rt_thread_create(const char *name,
+                             void (*entry)(void *parameter),
+                             void       *parameter,
+                             rt_uint32_t stack_size,
+                             rt_uint8_t  priority,
+                             rt_uint32_t tick)
+{
+    rt_thread_t thread = static_cast<rt_thread_t>(rt_calloc(1, sizeof(struct rt_thread)));
+    if (thread == RT_NULL)
+        return RT_NULL;
+
+    void *stack = rt_malloc(stack_size);
+    if (stack == RT_NULL)
+    {
+        rt_free(thread);
+        return RT_NULL;
+    }
+    rt_thread_init(thread, name, entry, parameter, stack, stack_size, priority, tick);
+    thread->type = RT_Object_Class_Thread;
+    return thread;
+}
+
+rt_err_t rt_thread_delete(rt_thread_t thread)
+{
+    sim_thread *t = ctx_of(thread);
+    if (thread->stat != RT_THREAD_INIT)
+        return -RT_EBUSY;
+    rt_list_remove(&thread->list);
+    delete t;
+    rt_free(thread->stack_addr);
+    rt_free(thread);
+    return RT_EOK;
+}
+
+rt_err_t rt_thread_startup(rt_thread_t thread)
+{
+    sim_thread *t = ctx_of(thread);
+    threads.push_back(t);
+    std::thread(thread_body, t).detach();
+    make_ready(t, false);
+    sim_preempt_check();
+    return RT_EOK;
+}
+
+rt_thread_t rt_thread_self(void)
+{
+    return current ? current->tcb : RT_NULL;
+}
+
+rt_thread_t rt_thread_find(char *name)
+{
+    for (sim_thread *t : threads)
+    {
+        if (!t->closed && std::strncmp(t->tcb->name, name, RT_NAME_MAX) == 0)
+            return t->tcb;
+    }
+    return RT_NULL;
+}
+
+rt_err_t rt_thread_yield(void)
+{
+    sim_thread *self = current;
+    make_ready(self, false);
+    schedule(self);
+    return RT_EOK;
+}
+
+rt_err_t rt_thread_delay(rt_tick_t tick)
+{
+    if (tick == 0)
+        return rt_thread_yield();
+
+    /* 与内核定时器一致：在第 (当前节拍 + tick) 个节拍边沿唤醒 */
+    block_until(deadline((rt_int32_t)tick));
+    return RT_EOK;
+}
+
+rt_err_t rt_thread_mdelay(rt_int32_t ms)
+{
+    return rt_thread_delay(rt_tick_from_millisecond(ms));
+}
+
+/* ---------------- 时钟 ---------------- */
+
+rt_tick_t rt_tick_get(void)
+{
+    return (rt_tick_t)(now_ns / (1000000000ULL / RT_TICK_PER_SECOND));
+}
+
+rt_tick_t rt_tick_from_millisecond(rt_int32_t ms)
+{
+    if (ms < 0)
+        return (rt_tick_t)RT_WAITING_FOREVER;
+    return (rt_tick_t)((rt_uint64_t)ms * RT_TICK_PER_SECOND / 1000);
+}
+
+/* ---------------- 中断与调度锁 ---------------- */
+
+rt_base_t rt_hw_interrupt_disable(void)
+{
+    return 0;
+}
+
+void rt_hw_interrupt_enable(rt_base_t level)
+{
+    RT_UNUSED(level);
+}
+
+void rt_enter_critical(void)
+{
+    critical_nest++;
+}
+
+void rt_exit_critical(void)
+{
+    if (--critical_nest == 0)
+        sim_preempt_check();
+}
+
+void rt_interrupt_enter(void)
+{
+    isr_nest++;
+}
+
+void rt_interrupt_leave(void)
+{
+    isr_nest--;
+}
+
+rt_uint8_t rt_interrupt_get_nest(void)
+{
+    return (rt_uint8_t)isr_nest;
+}
+
+/* ---------------- 内存 ---------------- */
+
+/*
+ * 堆按板上的大小记账：超出 SIM_HEAP_SIZE 的申请失败，用量和峰值与 rt_memory_info
+ * 一致。块放在宿主堆上，前面带一个记录大小的头；不模拟碎片。
+ */
+#define SIM_HEAP_SIZE       (64 * 1024)
+#define SIM_HEAP_ALIGN      16
+
+static rt_uint64_t heap_allocs;        // 累计申请次数，用来确认某段路径不碰堆
+static rt_size_t heap_used, heap_max_used;
+static void (*malloc_hook)(void *ptr, rt_size_t size);
+static void (*free_hook)(void *ptr);
+
+void *rt_malloc(rt_size_t size)
+{
+    heap_allocs++;
+    size = RT_ALIGN(size, RT_ALIGN_SIZE);
+    if (size > SIM_HEAP_SIZE - heap_used)
+        return RT_NULL;
+
+    char *block = static_cast<char *>(std::malloc(SIM_HEAP_ALIGN + size));
+    if (block == nullptr)
+        return RT_NULL;
+    *reinterpret_cast<rt_size_t *>(block) = size;
+    heap_used += size;
+    if (heap_used > heap_max_used)
+        heap_max_used = heap_used;
+
+    void *ptr = block + SIM_HEAP_ALIGN;
+    if (malloc_hook)
+        malloc_hook(ptr, size);
+    return ptr;
+}
+
+void rt_free(void *ptr)
+{
+    if (ptr == RT_NULL)
+        return;
+    if (free_hook)
+        free_hook(ptr);
+
+    char *block = static_cast<char *>(ptr) - SIM_HEAP_ALIGN;
+    heap_used -= *reinterpret_cast<rt_size_t *>(block);
+    std::free(block);
+}
+
+void *rt_calloc(rt_size_t count, rt_size_t size)
+{
+    void *ptr = rt_malloc(count * size);
+    if (ptr != RT_NULL)
+        std::memset(ptr, 0, count * size);
+    return ptr;
+}
+
+void rt_memory_info(rt_size_t *total, rt_size_t *used, rt_size_t *max_used)
+{
+    if (total)
+        *total = SIM_HEAP_SIZE;
+    if (used)
+        *used = heap_used;
+    if (max_used)
+        *max_used = heap_max_used;
+}
+
+void rt_malloc_sethook(void (*hook)(void *ptr, rt_size_t size))
+{
+    malloc_hook = hook;
+}
+
+void rt_free_sethook(void (*hook)(void *ptr))
+{
+    free_hook = hook;
+}
+
+rt_uint64_t sim_heap_allocs(void)
+{
+    return heap_allocs;
+}
+
+/* ---------------- 控制台与库函数 ---------------- */
+
+#define RT_CONSOLEBUF_SIZE      128
+#define CONSOLE_BAUD            115200
+
+void rt_kprintf(const char *fmt, ...)
+{
+    char buf[RT_CONSOLEBUF_SIZE];
+    va_list args;
+
+    va_start(args, fmt);
+    int length = std::vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    if (length < 0)
+        return;
+    if (length > RT_CONSOLEBUF_SIZE - 1)
+        length = RT_CONSOLEBUF_SIZE - 1;
+
+    /* 串口控制台以轮询方式发送，'\n' 会补一个 '\r' */
+    rt_size_t chars = length;
+    for (int i = 0; i < length; i++)
+    {
+        if (buf[i] == '\n')
+            chars++;
+    }
+    console.append(buf, length);
+    if (console_echo)
+        std::fwrite(buf, 1, length, stdout);
+
+    sim_busy(chars * 10 * 1000000000ULL / CONSOLE_BAUD);
+}
+
+int rt_snprintf(char *buf, rt_size_t size, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int n = std::vsnprintf(buf, size, format, args);
+    va_end(args);
+    return n;
+}
+
+void *rt_memset(void *s, int c, rt_ubase_t count)
+{
+    return std::memset(s, c, count);
+}
+
+void *rt_memcpy(void *dst, const void *src, rt_ubase_t count)
+{
+    return std::memcpy(dst, src, count);
+}
+
+rt_int32_t rt_strcmp(const char *cs, const char *ct)
+{
+    return std::strcmp(cs, ct);
+}
+
+char *rt_strncpy(char *dst, const char *src, rt_ubase_t n)
+{
+    return std::strncpy(dst, src, n);
+}
+
+rt_size_t rt_strlen(const char *src)
+{
+    return std::strlen(src);
+}
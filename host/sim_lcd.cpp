@@ -0,0 +1,279 @@
+﻿/*
+ * drv_lcd 替身：内存帧缓冲 + SPI 总线开销模型。
+ *
+ * 绘制行为仿照 BSP 中 ST7789 驱动：水平线一次窗口写出，其余直线逐点画；
+ * 字符先设窗口再整块发送。每次写显存按下列参数折算成调用线程的忙等时间。
+ */
+
+#include "sim_internal.h"
+#include <drv_lcd.h>
+
+#include <cstdio>
+#include <cstdlib>
+
+#define SPI_BYTE_NS         200         /* 40 MHz SPI */
+#define SPI_XFER_NS         1500        /* 每次 rt_spi_send 的固定开销 */
+#define RASTER_PIXEL_NS     20          /* 字模逐像素展开的 CPU 开销 */
+
+/*
+ * 字模：ASCII 32~126，按 BSP 字库的排列方式（每行高位在左）。BSP 中是
+ * drv_lcd_font.h 里的 const 数组，这里启动时生成，同样按 C 链接、同样的
+ * 维数导出供 lcd_render 直接读取。
+ */
+extern "C" {
+unsigned char asc2_1608[95][16];
+unsigned char asc2_2412[95][48];
+unsigned char asc2_3216[95][64];
+}
+
+namespace
+{
+
+rt_uint16_t framebuffer[LCD_W * LCD_H];
+rt_uint16_t fore_color = WHITE;
+rt_uint16_t back_color = BLACK;
+sim_lcd_stats stats;
+
+/* 窗口与写指针 */
+int win_x1, win_y1, win_x2, win_y2, win_x, win_y;
+
+void charge(rt_uint64_t xfers, rt_uint64_t bytes, rt_uint64_t raster_pixels)
+{
+    rt_uint64_t ns = xfers * SPI_XFER_NS + bytes * SPI_BYTE_NS + raster_pixels * RASTER_PIXEL_NS;
+    stats.bus_ns += ns;
+    stats.bytes += bytes;
+    sim_busy(ns);
+}
+
+void window(int x1, int y1, int x2, int y2)
+{
+    win_x1 = x1;
+    win_y1 = y1;
+    win_x2 = x2;
+    win_y2 = y2;
+    win_x = x1;
+    win_y = y1;
+    stats.windows++;
+    /* 3 条命令 + 8 字节坐标，各自一次传输 */
+    charge(11, 11, 0);
+}
+
+void push_pixel(rt_uint16_t color)
+{
+    if (win_y > win_y2)
+        return;
+    if (win_x >= 0 && win_x < LCD_W && win_y >= 0 && win_y < LCD_H)
+        framebuffer[win_y * LCD_W + win_x] = color;
+    if (++win_x > win_x2)
+    {
+        win_x = win_x1;
+        win_y++;
+    }
+}
+
+/* 生成一套确定性的点阵字模，笔画分布随字符变化，空格为空 */
+void build_font(unsigned char *table, int width, int height, int row_bytes)
+{
+    for (int c = 0; c < 95; c++)
+    {
+        unsigned char *glyph = table + c * height * row_bytes;
+        if (c == 0)
+            continue;
+        unsigned int seed = 2166136261u ^ (unsigned int)(c * 16777619u);
+        for (int row = height / 8; row < height - height / 8; row++)
+        {
+            for (int col = 1; col < width - 1; col++)
+            {
+                seed = seed * 1103515245u + 12345u;
+                bool edge = col == 1 || row == height / 8 || ((c + row) % 5 == 0);
+                if (edge ? (seed >> 16) % 3 != 0 : (seed >> 16) % 4 == 0)
+                    glyph[row * row_bytes + col / 8] |= 0x80 >> (col % 8);
+            }
+        }
+    }
+}
+
+struct font_init
+{
+    font_init()
+    {
+        build_font(asc2_1608[0], 8, 16, 1);
+        build_font(asc2_2412[0], 12, 24, 2);
+        build_font(asc2_3216[0], 16, 32, 2);
+    }
+} fonts;
+
+struct lcd_device
+{
+    struct rt_device parent;
+    lcd_device()
+    {
+        rt_device_register(&parent, "lcd", RT_DEVICE_FLAG_RDWR);
+    }
+} lcd;
+
+void show_char(int x, int y, char ch, int size)
+{
+    const unsigned char *glyph;
+    int row_bytes;
+
+    if (ch < ' ' || ch > '~')
+        ch = ' ';
+    switch (size)
+    {
+    case 16: glyph = asc2_1608[ch - ' ']; row_bytes = 1; break;
+    case 24: glyph = asc2_2412[ch - ' ']; row_bytes = 2; break;
+    case 32: glyph = asc2_3216[ch - ' ']; row_bytes = 2; break;
+    default: return;
+    }
+
+    int width = size / 2;
+    window(x, y, x + width - 1, y + size - 1);
+    for (int row = 0; row < size; row++)
+    {
+        for (int col = 0; col < width; col++)
+        {
+            bool on = glyph[row * row_bytes + col / 8] & (0x80 >> (col % 8));
+            push_pixel(on ? fore_color : back_color);
+        }
+    }
+    charge(1, width * size * 2, width * size);
+}
+
+} // namespace
+
+void lcd_clear(rt_uint16_t color)
+{
+    window(0, 0, LCD_W - 1, LCD_H - 1);
+    for (int i = 0; i < LCD_W * LCD_H; i++)
+        framebuffer[i] = color;
+    /* 驱动按 5760 字节一包分批发送 */
+    rt_uint64_t bytes = LCD_W * LCD_H * 2;
+    charge((bytes + 5759) / 5760, bytes, 0);
+}
+
+void lcd_address_set(rt_uint16_t x1, rt_uint16_t y1, rt_uint16_t x2, rt_uint16_t y2)
+{
+    window(x1, y1, x2, y2);
+}
+
+void lcd_set_color(rt_uint16_t fore, rt_uint16_t back)
+{
+    fore_color = fore;
+    back_color = back;
+}
+
+void lcd_draw_point(rt_uint16_t x, rt_uint16_t y)
+{
+    lcd_draw_point_color(x, y, fore_color);
+}
+
+void lcd_draw_point_color(rt_uint16_t x, rt_uint16_t y, rt_uint16_t color)
+{
+    window(x, y, x, y);
+    push_pixel(color);
+    charge(1, 2, 0);
+}
+
+void lcd_draw_line(rt_uint16_t x1, rt_uint16_t y1, rt_uint16_t x2, rt_uint16_t y2)
+{
+    if (y1 == y2)
+    {
+        /* 水平线快速路径：与驱动一致，不含终点 */
+        window(x1, y1, x2, y2);
+        for (int i = 0; i < x2 - x1; i++)
+            push_pixel(fore_color);
+        charge(1, (x2 - x1) * 2, 0);
+        return;
+    }
+
+    int dx = std::abs(x2 - x1), sx = x1 < x2 ? 1 : -1;
+    int dy = -std::abs(y2 - y1), sy = y1 < y2 ? 1 : -1;
+    int err = dx + dy;
+    int x = x1, y = y1;
+    for (;;)
+    {
+        lcd_draw_point(x, y);
+        if (x == x2 && y == y2)
+            break;
+        int e2 = 2 * err;
+        if (e2 >= dy)
+        {
+            err += dy;
+            x += sx;
+        }
+        if (e2 <= dx)
+        {
+            err += dx;
+            y += sy;
+        }
+    }
+}
+
+void lcd_draw_rectangle(rt_uint16_t x1, rt_uint16_t y1, rt_uint16_t x2, rt_uint16_t y2)
+{
+    lcd_draw_line(x1, y1, x2, y1);
+    lcd_draw_line(x1, y1, x1, y2);
+    lcd_draw_line(x1, y2, x2, y2);
+    lcd_draw_line(x2, y1, x2, y2);
+}
+
+void lcd_fill(rt_uint16_t x_start, rt_uint16_t y_start, rt_uint16_t x_end, rt_uint16_t y_end, rt_uint16_t color)
+{
+    window(x_start, y_start, x_end, y_end);
+    rt_uint64_t pixels = (rt_uint64_t)(x_end - x_start + 1) * (y_end - y_start + 1);
+    for (rt_uint64_t i = 0; i < pixels; i++)
+        push_pixel(color);
+    charge((pixels * 2 + 5759) / 5760, pixels * 2, 0);
+}
+
+void lcd_fill_array(rt_uint16_t x_start, rt_uint16_t y_start, rt_uint16_t x_end, rt_uint16_t y_end, void *pcolor)
+{
+    /* 驱动原样发送缓冲区字节，面板按高字节在前解释 */
+    const unsigned char *bytes = static_cast<const unsigned char *>(pcolor);
+    window(x_start, y_start, x_end, y_end);
+    rt_uint64_t pixels = (rt_uint64_t)(x_end - x_start + 1) * (y_end - y_start + 1);
+    for (rt_uint64_t i = 0; i < pixels; i++)
+        push_pixel((rt_uint16_t)(bytes[2 * i] << 8 | bytes[2 * i + 1]));
+    charge(1, pixels * 2, 0);
+}
+
+rt_err_t lcd_show_string(rt_uint16_t x, rt_uint16_t y, rt_uint32_t size, const char *fmt, ...)
+{
+    char buf[128];
+    va_list args;
+
+    if (size != 16 && size != 24 && size != 32)
+        return -RT_ERROR;
+
+    va_start(args, fmt);
+    std::vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+
+    for (const char *p = buf; *p != '\0'; p++)
+    {
+        if (x > LCD_W - size / 2)
+        {
+            x = 0;
+            y += size;
+        }
+        if (y > LCD_H - size)
+        {
+            y = x = 0;
+            lcd_clear(RED);
+        }
+        show_char(x, y, *p, size);
+        x += size / 2;
+    }
+    return RT_EOK;
+}
+
+const rt_uint16_t *sim_lcd_framebuffer(void)
+{
+    return framebuffer;
+}
+
+sim_lcd_stats &sim_lcd_stats_get(void)
+{
+    return stats;
+}
@@ -0,0 +1,293 @@
+﻿/*
+ * 机械模型：把 PWM/方向引脚换算成滑台位置，把推手引脚换算成推杆行程。
+ *
+ * 滑台按 PWM 通道实际发出的脉冲计步，到达两端机械限位后位置不再变化但电机
+ * 仍算作通电；推杆自带行程开关，走到端点即停转。每段运动都记入 sim_motion_log()。
+ *
+ * 滑台可选接零点开关（低有效），位置小于开关宽度时动作；每走一步都按新位置
+ * 更新开关电平。
+ *
+ * 推杆可选接两端的到位开关（低有效）和电流采样：运行中为 SIM_PUSHER_RUN_ADC，
+ * 顶在端点仍通电时为 SIM_PUSHER_STALL_ADC，断电为 0。
+ */
+
+#include "sim_internal.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#define SIM_PUSHER_RUN_ADC      600
+#define SIM_PUSHER_STALL_ADC    2600
+
+namespace
+{
+
+struct axis
+{
+    std::string name;
+    struct rt_device_pwm *pwm;
+    int channel;
+    rt_base_t dir_pin;
+    rt_int32_t travel;
+    rt_int32_t position = 0;
+    rt_uint64_t pulses = 0;             /* 已计入位置的脉冲数 */
+    int segment = -1;                   /* 当前运动段在日志中的下标 */
+
+    rt_base_t home_pin = -1;            /* 零点开关，-1 表示未接 */
+    rt_int32_t home_width = 0;
+    int home_level = PIN_HIGH;
+};
+
+struct pusher
+{
+    std::string name;
+    rt_base_t fwd_pin;
+    rt_base_t back_pin;
+    double stroke_ns;
+    double position = 0;                /* 0 为完全缩回 */
+    int drive = 0;                      /* 1 伸出，-1 缩回 */
+    rt_uint64_t last_ns = 0;
+    rt_uint64_t end_event = 0;
+    int segment = -1;
+    int strokes = 0;
+
+    rt_base_t fwd_limit = -1;           /* 到位开关，-1 表示未接 */
+    rt_base_t back_limit = -1;
+    int fwd_level = PIN_HIGH;
+    int back_level = PIN_HIGH;
+    std::string adc_name;
+    int adc_channel = -1;
+};
+
+std::vector<axis> axes;
+std::vector<pusher> pushers;
+std::vector<sim_motion> motions;
+
+int open_segment(const std::string &actor)
+{
+    motions.push_back(sim_motion{ actor, sim_now_ns(), SIM_NEVER });
+    return (int)motions.size() - 1;
+}
+
+void close_segment(int &segment, rt_uint64_t t_ns)
+{
+    if (segment >= 0)
+        motions[segment].end_ns = t_ns;
+    segment = -1;
+}
+
+/* 上次同步以来新发出的脉冲按当前方向计步 */
+void sync_axis(axis &a)
+{
+    rt_uint64_t pulses = sim_pwm_pulses(a.pwm, a.channel);
+    rt_int32_t steps = (rt_int32_t)(pulses - a.pulses);
+
+    a.pulses = pulses;
+    a.position += sim_pin_output(a.dir_pin) ? steps : -steps;
+    a.position = std::max<rt_int32_t>(0, std::min(a.travel, a.position));
+}
+
+/* 按位置更新零点开关 */
+void sense_axis(axis &a)
+{
+    if (a.home_pin < 0)
+        return;
+
+    int level = a.position < a.home_width ? PIN_LOW : PIN_HIGH;
+    if (level != a.home_level)
+        sim_pin_input(a.home_pin, level, sim_now_ns());
+    a.home_level = level;
+}
+
+void sync_pusher(pusher &p, rt_uint64_t now)
+{
+    if (p.drive != 0)
+    {
+        double before = p.position;
+        p.position += p.drive * (double)(now - p.last_ns);
+        p.position = std::fmax(0.0, std::fmin(p.stroke_ns, p.position));
+        if (p.position >= p.stroke_ns && before < p.stroke_ns)
+            p.strokes++;
+    }
+    p.last_ns = now;
+}
+
+/* 按当前位置和驱动方向更新到位开关与电流读数 */
+void sense_pusher(pusher &p)
+{
+    bool at_fwd = p.position >= p.stroke_ns && p.drive >= 0;
+    bool at_back = p.position <= 0 && p.drive <= 0;
+    int fwd_level = at_fwd ? PIN_LOW : PIN_HIGH;
+    int back_level = at_back ? PIN_LOW : PIN_HIGH;
+
+    /* 开关边沿放到事件里触发，避免在模型更新中重入中断处理 */
+    if (p.fwd_limit >= 0 && fwd_level != p.fwd_level)
+        sim_pin_input(p.fwd_limit, fwd_level, sim_now_ns());
+    if (p.back_limit >= 0 && back_level != p.back_level)
+        sim_pin_input(p.back_limit, back_level, sim_now_ns());
+    p.fwd_level = fwd_level;
+    p.back_level = back_level;
+
+    if (p.adc_channel >= 0)
+    {
+        rt_uint32_t current = 0;
+        if (p.drive != 0)
+            current = (at_fwd || at_back) ? SIM_PUSHER_STALL_ADC : SIM_PUSHER_RUN_ADC;
+        sim_adc_set(p.adc_name.c_str(), p.adc_channel, current);
+    }
+}
+
+void update_pusher(pusher &p)
+{
+    int fwd = sim_pin_output(p.fwd_pin);
+    int back = sim_pin_output(p.back_pin);
+    int drive = (fwd && !back) ? 1 : (!fwd && back) ? -1 : 0;
+
+    bool at_end = (drive > 0 && p.position >= p.stroke_ns) || (drive < 0 && p.position <= 0);
+    if (drive == p.drive && (p.segment >= 0) == (drive != 0 && !at_end))
+        return;
+
+    sim_cancel(p.end_event);
+    p.end_event = 0;
+    p.drive = drive;
+    sense_pusher(p);
+    if (drive == 0 || at_end)
+    {
+        close_segment(p.segment, sim_now_ns());
+        return;
+    }
+
+    if (p.segment < 0)
+        p.segment = open_segment(p.name);
+    double remain = drive > 0 ? p.stroke_ns - p.position : p.position;
+    p.end_event = sim_at(sim_now_ns() + (rt_uint64_t)std::ceil(remain), [] {
+        sim_plant_sync();
+        sim_plant_changed();
+    });
+}
+
+axis *find_axis(const char *name)
+{
+    for (axis &a : axes)
+    {
+        if (a.name == name)
+            return &a;
+    }
+    return nullptr;
+}
+
+pusher *find_pusher(const char *name)
+{
+    for (pusher &p : pushers)
+    {
+        if (p.name == name)
+            return &p;
+    }
+    return nullptr;
+}
+
+} // namespace
+
+void sim_plant_sync(void)
+{
+    rt_uint64_t now = sim_now_ns();
+    for (axis &a : axes)
+        sync_axis(a);
+    for (pusher &p : pushers)
+        sync_pusher(p, now);
+}
+
+void sim_plant_changed(void)
+{
+    for (axis &a : axes)
+    {
+        bool on = sim_pwm_enabled(a.pwm, a.channel);
+        if (on && a.segment < 0)
+            a.segment = open_segment(a.name);
+        else if (!on && a.segment >= 0)
+            close_segment(a.segment, sim_now_ns());
+        sense_axis(a);
+    }
+    for (pusher &p : pushers)
+        update_pusher(p);
+}
+
+void sim_axis_add(const char *name, const char *pwm_name, int channel,
+                  rt_base_t dir_pin, rt_int32_t travel_steps)
+{
+    axis a;
+    a.name = name;
+    a.pwm = sim_pwm_find(pwm_name);
+    a.channel = channel;
+    a.dir_pin = dir_pin;
+    a.travel = travel_steps;
+    a.pulses = sim_pwm_pulses(a.pwm, channel);
+    axes.push_back(a);
+}
+
+double sim_axis_position(const char *name)
+{
+    sim_plant_sync();
+    axis *a = find_axis(name);
+    return a ? a->position : 0;
+}
+
+void sim_axis_home(const char *name, rt_base_t pin, rt_int32_t width_steps)
+{
+    axis *a = find_axis(name);
+    if (a == nullptr)
+        return;
+
+    /* 上电时的开关状态直接给出，不触发中断 */
+    sim_plant_sync();
+    a->home_width = width_steps;
+    a->home_level = a->position < a->home_width ? PIN_LOW : PIN_HIGH;
+    a->home_pin = pin;
+    sim_pin_drive(pin, a->home_level);
+    sense_axis(*a);
+}
+
+void sim_pusher_add(const char *name, rt_base_t fwd_pin, rt_base_t back_pin,
+                    rt_uint32_t stroke_ms)
+{
+    pusher p;
+    p.name = name;
+    p.fwd_pin = fwd_pin;
+    p.back_pin = back_pin;
+    p.stroke_ns = (double)SIM_MS(stroke_ms);
+    p.last_ns = sim_now_ns();
+    pushers.push_back(p);
+}
+
+void sim_pusher_sense(const char *name, rt_base_t fwd_limit, rt_base_t back_limit,
+                      const char *adc_name, int adc_channel)
+{
+    pusher *p = find_pusher(name);
+    if (p == nullptr)
+        return;
+
+    p->adc_name = adc_name ? adc_name : "";
+    p->adc_channel = adc_name ? adc_channel : -1;
+    sense_pusher(*p);
+
+    /* 上电时的开关状态直接给出，不触发中断 */
+    p->fwd_limit = fwd_limit;
+    p->back_limit = back_limit;
+    if (fwd_limit >= 0)
+        sim_pin_drive(fwd_limit, p->fwd_level);
+    if (back_limit >= 0)
+        sim_pin_drive(back_limit, p->back_level);
+}
+
+int sim_pusher_strokes(const char *name)
+{
+    sim_plant_sync();
+    pusher *p = find_pusher(name);
+    return p ? p->strokes : 0;
+}
+
+const std::vector<sim_motion> &sim_motion_log(void)
+{
+    return motions;
+}
@@ -0,0 +1,129 @@
+﻿/*
+ * 定时器替身。
+ *
+ * 超时函数在仿真中断上下文中执行；软定时器与硬定时器不区分，二者只是执行
+ * 上下文不同，对时序的影响在节拍精度以内。
+ */
+
+#include "sim_internal.h"
+
+#include <cstring>
+#include <map>
+
+namespace
+{
+
+std::map<rt_timer_t, rt_uint64_t> armed;   /* 定时器 -> 事件号 */
+
+rt_uint64_t tick_ns(void)
+{
+    return 1000000000ULL / RT_TICK_PER_SECOND;
+}
+
+void arm(rt_timer_t timer)
+{
+    rt_uint64_t at = (sim_now_ns() / tick_ns() + timer->init_tick) * tick_ns();
+    timer->timeout_tick = (rt_tick_t)(at / tick_ns());
+    armed[timer] = sim_at(at, [timer] {
+        armed.erase(timer);
+        if (timer->parent.flag & RT_TIMER_FLAG_PERIODIC)
+            arm(timer);
+        else
+            timer->parent.flag &= ~RT_TIMER_FLAG_ACTIVATED;
+        timer->timeout_func(timer->parameter);
+    });
+    timer->parent.flag |= RT_TIMER_FLAG_ACTIVATED;
+}
+
+void disarm(rt_timer_t timer)
+{
+    auto it = armed.find(timer);
+    if (it != armed.end())
+    {
+        sim_cancel(it->second);
+        armed.erase(it);
+    }
+    timer->parent.flag &= ~RT_TIMER_FLAG_ACTIVATED;
+}
+
+} // namespace
+
+void rt_timer_init(rt_timer_t timer, const char *name,
+                   void (*timeout)(void *parameter), void *parameter,
+                   rt_tick_t time, rt_uint8_t flag)
+{
+    std::strncpy(timer->parent.name, name, RT_NAME_MAX);
+    timer->parent.type = RT_Object_Class_Timer | RT_Object_Class_Static;
+    timer->parent.flag = flag & ~RT_TIMER_FLAG_ACTIVATED;
+    rt_list_init(&timer->row[0]);
+    timer->timeout_func = timeout;
+    timer->parameter = parameter;
+    timer->init_tick = time;
+    timer->timeout_tick = 0;
+}
+
+rt_err_t rt_timer_detach(rt_timer_t timer)
+{
+    disarm(timer);
+    return RT_EOK;
+}
+
+rt_timer_t rt_timer_create(const char *name,
+                           void (*timeout)(void *parameter), void *parameter,
+                           rt_tick_t time, rt_uint8_t flag)
+{
+    rt_timer_t timer = static_cast<rt_timer_t>(rt_calloc(1, sizeof(struct rt_timer)));
+    if (timer == RT_NULL)
+        return RT_NULL;
+    rt_timer_init(timer, name, timeout, parameter, time, flag);
+    timer->parent.type = RT_Object_Class_Timer;
+    return timer;
+}
+
+rt_err_t rt_timer_delete(rt_timer_t timer)
+{
+    disarm(timer);
+    rt_free(timer);
+    return RT_EOK;
+}
+
+rt_err_t rt_timer_start(rt_timer_t timer)
+{
+    disarm(timer);
+    arm(timer);
+    return RT_EOK;
+}
+
+rt_err_t rt_timer_stop(rt_timer_t timer)
+{
+    if (!(timer->parent.flag & RT_TIMER_FLAG_ACTIVATED))
+        return -RT_ERROR;
+    disarm(timer);
+    return RT_EOK;
+}
+
+rt_err_t rt_timer_control(rt_timer_t timer, int cmd, void *arg)
+{
+    switch (cmd)
+    {
+    case RT_TIMER_CTRL_SET_TIME:
+        timer->init_tick = *static_cast<rt_tick_t *>(arg);
+        break;
+    case RT_TIMER_CTRL_GET_TIME:
+        *static_cast<rt_tick_t *>(arg) = timer->init_tick;
+        break;
+    case RT_TIMER_CTRL_SET_ONESHOT:
+        timer->parent.flag &= ~RT_TIMER_FLAG_PERIODIC;
+        break;
+    case RT_TIMER_CTRL_SET_PERIODIC:
+        timer->parent.flag |= RT_TIMER_FLAG_PERIODIC;
+        break;
+    case RT_TIMER_CTRL_GET_STATE:
+        *static_cast<rt_uint32_t *>(arg) = (timer->parent.flag & RT_TIMER_FLAG_ACTIVATED) ?
+                                           RT_TIMER_FLAG_ACTIVATED : RT_TIMER_FLAG_DEACTIVATED;
+        break;
+    default:
+        return -RT_ERROR;
+    }
+    return RT_EOK;
+}
@@ -0,0 +1,476 @@
+﻿/*
+ * 端到端出货耗时基准。
+ *
+ * 直接把 RTT.cpp 编进本文件（main 改名为 rtt_main），在虚拟时钟上逐条执行
+ * text_lines 对应的命令，统计：
+ *   vend  从 execute_selected_command 调用到最后一个电机停下
+ *   ui    execute_selected_command 阻塞界面的时间
+ *   first 调用到第一个电机起动的延迟
+ *   motor 滑台与推手通电运动时间之和
+ *   idle  出货期间没有任何电机运动的时间
+ * 每条之前先用 ENDPOINT 回零（不计时）。运行 vend_bench -v 可查看控制台输出。
+ */
+
+#define main rtt_main
+#include "../RTT.cpp"
+#undef main
+
+#include "sim.h"
+#include "batch_proto.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#define SLIDE_TRAVEL_STEPS      48000   /* 滑台全行程 */
+#define PUSHER_STROKE_MS        3400    /* 推杆单程 */
+#define BATCH_BURST_RECORDS     400     /* 补货时一批记录的条数 */
+#define LCD_REPAINTS            200     /* 量整屏重画耗时的次数 */
+
+namespace
+{
+
+struct vend_result
+{
+    rt_uint64_t vend_ns;
+    rt_uint64_t ui_ns;
+    rt_uint64_t first_ns;
+    rt_uint64_t motor_ns;
+    rt_uint64_t idle_ns;
+    int pushes;
+    int rejected;
+    double position1;
+    double position2;
+};
+
+int count(const std::string &haystack, const char *needle)
+{
+    int n = 0;
+    for (size_t pos = haystack.find(needle); pos != std::string::npos;
+         pos = haystack.find(needle, pos + 1))
+        n++;
+    return n;
+}
+
+/* 统计 [t0, 结束] 内的运动段 */
+void summarize(vend_result &r, rt_uint64_t t0, size_t first_motion, rt_uint64_t t_ui)
+{
+    const std::vector<sim_motion> &log = sim_motion_log();
+    std::vector<std::pair<rt_uint64_t, rt_uint64_t>> spans;
+    rt_uint64_t end = t_ui;
+
+    r.motor_ns = 0;
+    for (size_t i = first_motion; i < log.size(); i++)
+    {
+        rt_uint64_t stop = log[i].end_ns == SIM_NEVER ? sim_now_ns() : log[i].end_ns;
+        spans.push_back(std::make_pair(log[i].start_ns, stop));
+        r.motor_ns += stop - log[i].start_ns;
+        end = std::max(end, stop);
+    }
+    std::sort(spans.begin(), spans.end());
+
+    rt_uint64_t busy = 0, cursor = t0;
+    for (const auto &s : spans)
+    {
+        rt_uint64_t from = std::max(cursor, s.first);
+        if (s.second > from)
+        {
+            busy += s.second - from;
+            cursor = s.second;
+        }
+    }
+
+    r.vend_ns = end - t0;
+    r.ui_ns = t_ui - t0;
+    r.first_ns = spans.empty() ? 0 : spans.front().first - t0;
+    r.idle_ns = r.vend_ns - busy;
+}
+
+void home(int group)
+{
+    sim_msh_exec(group == 1 ? "ENDPOINT_1" : "ENDPOINT_2");
+    sim_wait_quiescent(SIM_NEVER);
+}
+
+/* 依次选择若干行并执行，每单 quantity 件，返回整段的统计 */
+vend_result run(const int *lines, int n, int quantity = 1)
+{
+    vend_result r;
+    int strokes = sim_pusher_strokes("pusher1") + sim_pusher_strokes("pusher2");
+    size_t first_motion = sim_motion_log().size();
+    rt_uint64_t t0 = sim_now_ns(), t_ui = t0;
+
+    sim_console().clear();
+    for (int i = 0; i < n; i++)
+    {
+        rt_uint64_t t_call = sim_now_ns();
+        cursor_idx = lines[i];
+        execute_selected_command(quantity);
+        t_ui += sim_now_ns() - t_call;
+    }
+    sim_wait_quiescent(SIM_NEVER);
+
+    summarize(r, t0, first_motion, t_ui);
+    r.pushes = sim_pusher_strokes("pusher1") + sim_pusher_strokes("pusher2") - strokes;
+    r.rejected = count(sim_console(), "in progress") + count(sim_console(), "still running");
+    r.position1 = sim_axis_position("slide1");
+    r.position2 = sim_axis_position("slide2");
+    return r;
+}
+
+/* 执行一条 MSH 命令并统计到全部电机停下 */
+vend_result run_msh(const char *cmd)
+{
+    vend_result r;
+    int strokes = sim_pusher_strokes("pusher1") + sim_pusher_strokes("pusher2");
+    size_t first_motion = sim_motion_log().size();
+    rt_uint64_t t0 = sim_now_ns();
+
+    sim_console().clear();
+    sim_msh_exec(cmd);
+    rt_uint64_t t_ui = sim_now_ns();
+    sim_wait_quiescent(SIM_NEVER);
+
+    summarize(r, t0, first_motion, t_ui);
+    r.pushes = sim_pusher_strokes("pusher1") + sim_pusher_strokes("pusher2") - strokes;
+    r.rejected = count(sim_console(), "in progress") + count(sim_console(), "still running");
+    r.position1 = sim_axis_position("slide1");
+    r.position2 = sim_axis_position("slide2");
+    return r;
+}
+
+void print_header(void)
+{
+    std::printf("%-24s %9s %9s %8s %9s %9s %5s %4s %9s %9s\n",
+                "scenario", "vend(ms)", "ui(ms)", "first", "motor", "idle",
+                "push", "rej", "pos1", "pos2");
+}
+
+void print_row(const char *name, const vend_result &r)
+{
+    std::printf("%-24s %9.1f %9.1f %8.1f %9.1f %9.1f %5d %4d %9.0f %9.0f\n",
+                name, r.vend_ns / 1e6, r.ui_ns / 1e6, r.first_ns / 1e6,
+                r.motor_ns / 1e6, r.idle_ns / 1e6, r.pushes, r.rejected,
+                r.position1, r.position2);
+}
+
+/* 按住一个键 hold_ms，返回从按下到光标第一次移动的时间，moved 为移动的行数 */
+rt_uint64_t press_key(rt_base_t pin, rt_uint32_t hold_ms, int *moved)
+{
+    int before = cursor_idx;
+    rt_uint64_t t0 = sim_now_ns(), latency;
+
+    sim_pin_input(pin, PIN_LOW, t0);
+    sim_pin_input(pin, PIN_HIGH, t0 + SIM_MS(hold_ms));
+    while (cursor_idx == before && sim_now_ns() < t0 + SIM_MS(hold_ms))
+        rt_thread_mdelay(1);
+    latency = sim_now_ns() - t0;
+    sim_wait_quiescent(SIM_NEVER);
+
+    *moved = cursor_idx > before ? cursor_idx - before : before - cursor_idx;
+    return latency;
+}
+
+/* 重绘回调的主机耗时：不含条带填背景和面板传输，只有界面本身的绘制 */
+std::chrono::duration<double, std::micro> paint_time;
+
+void timed_paint(void)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    ui_paint();
+    paint_time += std::chrono::steady_clock::now() - t0;
+}
+
+/* 整屏重画 LCD_REPAINTS 次，返回每次重画中绘制界面的耗时（us），并取回画出的帧 */
+double repaint_us(bool cached, std::vector<rt_uint16_t> *frame)
+{
+    lcd_render_init(BLACK, timed_paint);
+    lcd_render_set_glyph_cache(cached ? RT_TRUE : RT_FALSE);
+    paint_time = paint_time.zero();
+    for (int i = 0; i < LCD_REPAINTS; i++)
+    {
+        lcd_render_invalidate_all();
+        lcd_render_flush();
+    }
+    frame->assign(sim_lcd_framebuffer(), sim_lcd_framebuffer() + LCD_W * LCD_H);
+    return paint_time.count() / LCD_REPAINTS;
+}
+
+void ui_entry(void *parameter)
+{
+    RT_UNUSED(parameter);
+    rtt_main();
+}
+
+void bench_entry(void *parameter)
+{
+    RT_UNUSED(parameter);
+    rt_uint64_t total_vend = 0, total_motor = 0, total_idle = 0;
+
+    /* 界面线程照常运行固件的 main，空闲时阻塞在按键队列上 */
+    rt_thread_t ui = rt_thread_create("ui", ui_entry, RT_NULL, RT_MAIN_THREAD_STACK_SIZE,
+                                      RT_MAIN_THREAD_PRIORITY, 20);
+    rt_thread_startup(ui);
+    sim_wait_quiescent(SIM_NEVER);
+    rt_uint64_t cold_boot_ns = sim_now_ns();
+
+    rt_uint64_t heap_before = sim_heap_allocs();
+    print_header();
+    for (int i = 0; i < (int)LINE_COUNT; i++)
+    {
+        char name[32];
+        home(text_lines[i].device_group);
+        vend_result r = run(&i, 1);
+        rt_snprintf(name, sizeof(name), "%s_%d", lane_cmd_names[text_lines[i].command],
+                    text_lines[i].device_group);
+        print_row(name, r);
+        total_vend += r.vend_ns;
+        total_motor += r.motor_ns;
+        total_idle += r.idle_ns;
+    }
+    std::printf("%-24s %9.1f %9s %8s %9.1f %9.1f\n", "total", total_vend / 1e6, "", "",
+                total_motor / 1e6, total_idle / 1e6);
+
+    /* 先看展示位再购买：只统计购买这一单 */
+    home(1);
+    cursor_idx = 0;
+    execute_selected_command(1);
+    sim_wait_quiescent(SIM_NEVER);
+    const int buy = 1;
+    print_row("OUT1_1 after EXHIBIT_1", run(&buy, 1));
+
+    /* 两条通道同时有顾客 */
+    home(1);
+    home(2);
+    const int both_lanes[] = { 1, 4 };
+    print_row("OUT1_1 + OUT1_2", run(both_lanes, 2));
+    rt_uint64_t heap_vend = sim_heap_allocs() - heap_before;
+
+    /* 午间高峰：同一组一口气下六单，先按到达顺序做，再按扫描顺序做 */
+    const int rush[] = { 1, 2, 0, 1, 0, 2 };
+    home(1);
+    lane_order_bypass = 0;
+    print_row("rush x6 lane 1 (FIFO)", run(rush, 6));
+    home(1);
+    lane_order_bypass = LANE_ORDER_BYPASS;
+    print_row("rush x6 lane 1 (SCAN)", run(rush, 6));
+
+    /* 同一件买三份：三单各走一趟，与一单三件只走一趟 */
+    const int three[] = { 1, 1, 1 };
+    home(1);
+    print_row("OUT1_1 as 3 orders", run(three, 3));
+    home(1);
+    print_row("OUT1_1 x3", run(three, 1, 3));
+
+    /* 从最远位置回零 */
+    print_row("ENDPOINT_1 (homing)", run_msh("ENDPOINT_1"));
+
+    /* 推手单独往返一次 */
+    print_row("PUSH_CTRL_1 (round trip)", run_msh("PUSH_CTRL_1"));
+
+    /* 按键：单击响应时间，以及从第一行按住下键 1.5 s */
+    int tap_moved, hold_moved;
+    cursor_idx = 0;
+    init_display();
+    rt_uint64_t lcd_before = sim_lcd_stats_get().bus_ns;
+    rt_uint64_t tap = press_key(KEY_DOWN_PIN, 100, &tap_moved);
+    rt_uint64_t lcd_tap = sim_lcd_stats_get().bus_ns - lcd_before;
+    press_key(KEY_UP_PIN, 100, &tap_moved);
+    press_key(KEY_DOWN_PIN, 1500, &hold_moved);
+    std::printf("keys: tap -> cursor %.1f ms (lcd %.2f ms), hold 1.5 s moved %d rows\n",
+                tap / 1e6, lcd_tap / 1e6, hold_moved);
+
+    /* 字形缓存：整屏重画的主机耗时，缓存开关前后画出的帧应相同；不计入后面的总线统计 */
+    sim_lcd_stats lcd_saved = sim_lcd_stats_get();
+    std::vector<rt_uint16_t> frame_plain, frame_cached;
+    double plain_us = repaint_us(false, &frame_plain);
+    double cached_us = repaint_us(true, &frame_cached);
+    LcdGlyphStats glyphs;
+    lcd_render_get_glyph_stats(&glyphs);
+    lcd_render_init(BLACK, ui_paint);
+    sim_lcd_stats_get() = lcd_saved;
+    std::printf("glyph cache: ui_paint %.1f -> %.1f us per full repaint on host, %u glyphs in %u bytes, "
+                "%u hits, %u misses, %u uncached, frames %s\n",
+                plain_us, cached_us, (unsigned)glyphs.glyphs, (unsigned)glyphs.bytes,
+                (unsigned)glyphs.hits, (unsigned)glyphs.misses, (unsigned)glyphs.uncached,
+                frame_plain == frame_cached ? "match" : "DIFFER");
+
+    /* 出货进行中界面照常响应 */
+    cursor_idx = 1;
+    init_display();
+    execute_selected_command(1);
+    rt_thread_mdelay(500);
+    rt_uint64_t busy_tap = press_key(KEY_DOWN_PIN, 100, &tap_moved);
+    std::printf("keys during OUT1_1: tap -> cursor %.1f ms\n", busy_tap / 1e6);
+
+    std::printf("lcd: %.1f ms bus time, %llu bytes, %llu windows\n",
+                sim_lcd_stats_get().bus_ns / 1e6,
+                (unsigned long long)sim_lcd_stats_get().bytes,
+                (unsigned long long)sim_lcd_stats_get().windows);
+    std::printf("heap: %llu allocations during vends\n", (unsigned long long)heap_vend);
+
+    /* 补货：出货进行中上位机一口气发来一批记录 */
+    std::string burst;
+    for (int i = 0; i < BATCH_BURST_RECORDS; i++)
+    {
+        char record[32];
+        rt_snprintf(record, sizeof(record), "TYPE%d-202506%02d\n", i % 2 + 1, i / 50 + 1);
+        burst += record;
+    }
+    BatchRxStats before, after;
+    batch_rx_get_stats(&before);
+    home(1);
+    cursor_idx = 1;
+    rt_uint64_t t_burst = sim_now_ns();
+    sim_uart_input(BATCH_UART_NAME, burst.data(), burst.size(), t_burst);
+    vend_result busy = run(&cursor_idx, 1);
+    batch_rx_get_stats(&after);
+    std::printf("batch: %d/%d records (%u bytes, %.1f ms on the line), %d errors, %llu overruns, "
+                "OUT1_1 meanwhile %.1f ms\n",
+                (int)(after.records - before.records), BATCH_BURST_RECORDS, (unsigned)burst.size(),
+                burst.size() * 10 * 1e3 / BATCH_RX_BAUD, (int)(after.errors - before.errors),
+                (unsigned long long)sim_uart_overruns(BATCH_UART_NAME), busy.vend_ns / 1e6);
+
+    /* 同样 400 件按批次帧发：同类型同日期合成一条记录，等 ACK 再发下一窗 */
+    std::vector<bp_record> lots;
+    for (int i = 0; i < BATCH_BURST_RECORDS; i++)
+    {
+        bp_record r = { (uint8_t)(i % 2 + 1), (uint32_t)(20250600 + i / 50 + 1), 1 };
+        auto same = std::find_if(lots.begin(), lots.end(), [&](const bp_record &l) {
+            return l.type == r.type && l.date == r.date;
+        });
+        if (same == lots.end())
+            lots.push_back(r);
+        else
+            same->count++;
+    }
+    bp_sender sender;
+    bp_decoder acks;
+    bp_sender_init(&sender, 0x5A5A, BP_TIMEOUT_MS);
+    bp_decoder_init(&acks);
+    sim_uart_output(BATCH_UART_NAME).clear();
+    batch_rx_get_stats(&before);
+    rt_uint64_t t_frames = sim_now_ns();
+    size_t line_bytes = 0, pushed = 0;
+    while (pushed < lots.size() || !bp_sender_idle(&sender))
+    {
+        uint8_t out[BP_WINDOW * BP_FRAME_MAX];
+        pushed += bp_sender_push(&sender, lots.data() + pushed, lots.size() - pushed);
+        size_t n = bp_sender_poll(&sender, (uint32_t)(sim_now_ns() / 1000000), out, sizeof(out));
+        if (n > 0)
+            sim_uart_input(BATCH_UART_NAME, out, n, sim_now_ns());
+        line_bytes += n;
+        rt_thread_mdelay(5);
+
+        std::string &tx = sim_uart_output(BATCH_UART_NAME);
+        for (char c : tx)
+        {
+            bp_frame frame;
+            if (bp_decoder_put(&acks, (uint8_t)c, &frame))
+                bp_sender_on_frame(&sender, &frame);
+        }
+        tx.clear();
+    }
+    batch_rx_get_stats(&after);
+    std::printf("batch frames: %d units in %d records, %u bytes, %.1f ms to last ack, %u retransmits\n",
+                BATCH_BURST_RECORDS, (int)(after.records - before.records), (unsigned)line_bytes,
+                (sim_now_ns() - t_frames) / 1e6, (unsigned)sender.retransmits);
+
+    /* 校准：第 2 组回零后逐个点动确认，保存后重新加载应得到同一张表 */
+    rt_int32_t cal_expect[LANE_POS_COUNT], cal_loaded[LANE_POS_COUNT];
+    const int cal_jogs[LANE_POS_COUNT] = { 0, 40, -25, 0, 120 };
+    rt_uint64_t t_cal = sim_now_ns();
+    sim_msh_exec("SLIDE_CAL 2");
+    sim_wait_quiescent(SIM_NEVER);
+    for (int c = LANE_CMD_EXHIBIT; c < LANE_POS_COUNT; c++)
+    {
+        char cmd[32];
+        cal_expect[c] = lanes[1].positions[c] + cal_jogs[c];
+        if (cal_jogs[c] != 0)
+        {
+            std::snprintf(cmd, sizeof(cmd), "SLIDE_CAL jog %d", cal_jogs[c]);
+            sim_msh_exec(cmd);
+            sim_wait_quiescent(SIM_NEVER);
+        }
+        sim_msh_exec("SLIDE_CAL ok");
+        sim_wait_quiescent(SIM_NEVER);
+    }
+    rt_uint64_t cal_ns = sim_now_ns() - t_cal;
+    SlideCalInfo cal_info;
+    slide_cal_init(SLIDE_CAL_PARTITION);
+    slide_cal_get_info(&cal_info);
+    bool cal_same = slide_cal_get(2, cal_loaded, LANE_POS_COUNT) && lanes[1].state == GROUP_IDLE;
+    for (int c = LANE_CMD_EXHIBIT; c < LANE_POS_COUNT; c++)
+        cal_same = cal_same && cal_loaded[c] == cal_expect[c] && lanes[1].positions[c] == cal_expect[c];
+    std::printf("slide cal: lane 2 %.1f ms, table gen %u lanes 0x%x, reload %s\n",
+                cal_ns / 1e6, (unsigned)cal_info.generation, (unsigned)cal_info.lanes,
+                cal_same ? "matches" : "DIFFERS");
+
+    /* 库存：掉电重启后从闪存日志重建的索引应与运行中的一致 */
+    InventoryBatch oldest_before, oldest_after;
+    rt_uint32_t stock_before = inventory_stock(1) + inventory_stock(2);
+    inventory_oldest(1, &oldest_before);
+    rt_uint64_t t_boot = sim_now_ns();
+    inventory_init(INVENTORY_PARTITION, LANE_COUNT);
+    rt_uint64_t boot_ns = sim_now_ns() - t_boot;
+    inventory_oldest(1, &oldest_after);
+    InventoryInfo info;
+    inventory_get_info(&info);
+    std::printf("inventory: %u in stock, %u after reboot (oldest lane 1 %08u/%08u), "
+                "boot %.1f ms, log gen %u, erases",
+                (unsigned)stock_before, (unsigned)(inventory_stock(1) + inventory_stock(2)),
+                (unsigned)oldest_before.date, (unsigned)oldest_after.date, boot_ns / 1e6,
+                (unsigned)info.generation);
+    for (rt_uint32_t n : sim_flash_erase_counts(INVENTORY_PARTITION))
+        std::printf(" %u", (unsigned)n);
+    std::printf("\n");
+
+    /* 滑台：冷启动（闪存为空）要回零；重启后从位置日志取回停稳时的位置 */
+    rt_int32_t saved1 = -1, saved2 = -1;
+    SlidePosInfo pos_info;
+    slide_pos_init(SLIDE_POS_PARTITION);
+    slide_pos_saved(1, &saved1);
+    slide_pos_saved(2, &saved2);
+    slide_pos_get_info(&pos_info);
+    std::printf("slide pos: cold boot ready %.1f ms, saved %d/%d and %d/%d after reboot, "
+                "log gen %u, %u/%u records\n",
+                cold_boot_ns / 1e6, (int)saved1, (int)lanes[0].pos, (int)saved2, (int)lanes[1].pos,
+                (unsigned)pos_info.generation, (unsigned)pos_info.used, (unsigned)pos_info.capacity);
+
+    /* 以上全部场景的各阶段耗时，与现场 vendstat 的输出相同 */
+    sim_console().clear();
+    sim_msh_exec("vendstat");
+    std::printf("%s", sim_console().c_str());
+
+    /* 内存预算：栈水位按宿主栈深度记录，只用来比较各线程；main 是基准程序本身，
+       不记栈水位，固件的 main 在 ui 线程里 */
+    sim_console().clear();
+    sim_msh_exec("membudget");
+    std::printf("%s", sim_console().c_str());
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "-v") == 0)
+            sim_console_echo(true);
+    }
+
+    sim_axis_add("slide1", PWM_DEV_NAME_1, PWM_DEV_CHANNEL_1, DIR_PIN_1, SLIDE_TRAVEL_STEPS);
+    sim_axis_add("slide2", PWM_DEV_NAME_2, PWM_DEV_CHANNEL_2, DIR_PIN_2, SLIDE_TRAVEL_STEPS);
+    sim_axis_home("slide1", SLIDE_HOME_PIN_1, SLIDE_HOME_OFFSET);
+    sim_axis_home("slide2", SLIDE_HOME_PIN_2, SLIDE_HOME_OFFSET);
+    sim_pusher_add("pusher1", PUSH_IN1_PIN_1, PUSH_IN2_PIN_1, PUSHER_STROKE_MS);
+    sim_pusher_add("pusher2", PUSH_IN3_PIN_2, PUSH_IN4_PIN_2, PUSHER_STROKE_MS);
+    sim_pusher_sense("pusher1", PUSH_FWD_LIMIT_PIN_1, PUSH_BACK_LIMIT_PIN_1,
+                     PUSH_ADC_DEV_NAME, PUSH_ADC_CHANNEL_1);
+    sim_pusher_sense("pusher2", PUSH_FWD_LIMIT_PIN_2, PUSH_BACK_LIMIT_PIN_2,
+                     PUSH_ADC_DEV_NAME, PUSH_ADC_CHANNEL_2);
+
+    return sim_run(bench_entry, RT_NULL);
+}
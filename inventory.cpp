@@ -0,0 +1,394 @@
+﻿#include "inventory.h"
+#include "flash_log.h"
+#include <string.h>
+
+/*
+ * 闪存中的库存日志，块的轮换见 flash_log.h。
+ *
+ * 每块块头之后是整份库存的快照，以 SNAP_END 结束，其后逐条追加变更：
+ * LOAD 上货、VEND 出货一件。
+ *
+ * 启动时取代数最大、快照完整的块重放到内存
+ * 索引，遇到空白记录或 CRC 不对（写到一半断电）即停；有残缺记录时换一
+ * 块重写快照。之后所有查询只读内存索引：每组的批次按生产日期排序，最老
+ * 的就是第一个；每种商品最老的批次在变更时重算，查询都是 O(1)。
+ */
+
+#define INV_MAGIC           0x31564E49  // "INV1"
+
+/* 记录类型 */
+#define INV_REC_BLANK       0xFF        // 未写过
+#define INV_REC_HEADER      FLASH_LOG_HEADER    // 块头：date 为代数，count 为魔数
+#define INV_REC_SNAP        0x02        // 快照中的一个批次
+#define INV_REC_SNAP_END    0x03        // 快照结束
+#define INV_REC_LOAD        0x04        // 上货：批次加 count 件
+#define INV_REC_VEND        0x05        // 出货：本组最老的批次减一件
+
+/* flash_log 的一条记录，FLASH_LOG_RECORD_SIZE 字节 */
+typedef struct {
+    rt_uint8_t kind;
+    rt_uint8_t lane;
+    rt_uint8_t type;
+    rt_uint8_t reserved;
+    rt_uint32_t date;
+    rt_uint32_t count;
+    rt_uint16_t reserved2;
+    rt_uint16_t crc;                    // 前 14 字节的 CRC-16/CCITT
+} InvRecord;
+
+/* 每组的批次，按生产日期从老到新 */
+typedef struct {
+    InventoryBatch batches[INV_BATCH_MAX];
+    int count;
+    rt_uint32_t stock;
+} InvLane;
+
+static FlashLog inv_log;
+static rt_bool_t inv_snapshot_end;      // 重放时见到了 SNAP_END
+
+static InvLane inv_lanes[INV_LANE_MAX];
+static int inv_lane_count = INV_LANE_MAX;
+static const InventoryBatch *inv_type_oldest[INV_TYPE_MAX];
+static rt_uint8_t inv_type_lane[INV_TYPE_MAX];
+
+static struct rt_semaphore inv_lock;
+
+/* ---------------- 内存索引 ---------------- */
+
+/* 重算每种商品最老的批次：各组第一个该类型的批次里取日期最早的 */
+static void index_update_types(void)
+{
+    for (int t = 0; t < INV_TYPE_MAX; t++)
+        inv_type_oldest[t] = RT_NULL;
+
+    for (int l = 0; l < INV_LANE_MAX; l++)
+    {
+        rt_bool_t seen[INV_TYPE_MAX] = { RT_FALSE };
+
+        for (int i = 0; i < inv_lanes[l].count; i++)
+        {
+            const InventoryBatch *batch = &inv_lanes[l].batches[i];
+            int t = batch->type - 1;
+
+            if (seen[t])
+                continue;
+            seen[t] = RT_TRUE;
+            if (inv_type_oldest[t] == RT_NULL || batch->date < inv_type_oldest[t]->date)
+            {
+                inv_type_oldest[t] = batch;
+                inv_type_lane[t] = (rt_uint8_t)(l + 1);
+            }
+        }
+    }
+}
+
+/* 找同类型同日期的批次，没有时返回新批次应插入的位置（取反） */
+static int index_find(const InvLane *lane, rt_uint8_t type, rt_uint32_t date)
+{
+    int i;
+
+    for (i = 0; i < lane->count && lane->batches[i].date <= date; i++)
+    {
+        if (lane->batches[i].date == date && lane->batches[i].type == type)
+            return i;
+    }
+    return ~i;
+}
+
+static rt_err_t index_check_load(int lane, rt_uint8_t type, rt_uint32_t date, rt_uint32_t count)
+{
+    const InvLane *l;
+    rt_uint32_t stored = 0;
+    int i;
+
+    if (lane < 1 || lane > inv_lane_count || type < 1 || type > INV_TYPE_MAX)
+        return -RT_EINVAL;
+
+    l = &inv_lanes[lane - 1];
+    i = index_find(l, type, date);
+    if (i < 0 && l->count >= INV_BATCH_MAX)
+        return -RT_EFULL;
+    if (i >= 0)
+        stored = l->batches[i].count;
+    /* 批次件数是 16 位的，加上去不能溢出 */
+    if (count > 0xFFFF - stored)
+        return -RT_EFULL;
+    return RT_EOK;
+}
+
+static rt_err_t index_load(int lane, rt_uint8_t type, rt_uint32_t date, rt_uint32_t count)
+{
+    InvLane *l;
+    int i;
+
+    if (index_check_load(lane, type, date, count) != RT_EOK)
+        return -RT_ERROR;
+
+    l = &inv_lanes[lane - 1];
+    i = index_find(l, type, date);
+    if (i < 0)
+    {
+        i = ~i;
+        memmove(&l->batches[i + 1], &l->batches[i], (l->count - i) * sizeof(InventoryBatch));
+        l->batches[i].type = type;
+        l->batches[i].date = date;
+        l->batches[i].count = 0;
+        l->count++;
+    }
+    l->batches[i].count = (rt_uint16_t)(l->batches[i].count + count);
+    l->stock += count;
+    return RT_EOK;
+}
+
+static rt_err_t index_vend(int lane)
+{
+    InvLane *l;
+
+    if (lane < 1 || lane > INV_LANE_MAX || inv_lanes[lane - 1].count == 0)
+        return -RT_EEMPTY;
+
+    l = &inv_lanes[lane - 1];
+    l->stock--;
+    if (--l->batches[0].count == 0)
+    {
+        l->count--;
+        memmove(&l->batches[0], &l->batches[1], l->count * sizeof(InventoryBatch));
+    }
+    return RT_EOK;
+}
+
+/* ---------------- 闪存日志 ---------------- */
+
+static void log_record(InvRecord *rec, rt_uint8_t kind, int lane, rt_uint8_t type,
+                       rt_uint32_t date, rt_uint32_t count)
+{
+    memset(rec, 0, sizeof(*rec));
+    rec->kind = kind;
+    rec->lane = (rt_uint8_t)lane;
+    rec->type = type;
+    rec->date = date;
+    rec->count = count;
+}
+
+/* 快照：各组的批次依次排下来，以 SNAP_END 结束 */
+static rt_bool_t log_snapshot(rt_uint32_t index, void *rec)
+{
+    for (int l = 0; l < INV_LANE_MAX; l++)
+    {
+        if (index < (rt_uint32_t)inv_lanes[l].count)
+        {
+            const InventoryBatch *batch = &inv_lanes[l].batches[index];
+
+            log_record((InvRecord *)rec, INV_REC_SNAP, l + 1, batch->type, batch->date, batch->count);
+            return RT_TRUE;
+        }
+        index -= inv_lanes[l].count;
+    }
+    if (index > 0)
+        return RT_FALSE;
+    log_record((InvRecord *)rec, INV_REC_SNAP_END, 0, 0, 0, 0);
+    return RT_TRUE;
+}
+
+static rt_err_t log_append(InvRecord *rec)
+{
+    return flash_log_append(&inv_log, rec, 0, log_snapshot);
+}
+
+static void log_apply(const void *data)
+{
+    const InvRecord *rec = (const InvRecord *)data;
+
+    switch (rec->kind)
+    {
+    case INV_REC_SNAP:
+    case INV_REC_LOAD:
+        index_load(rec->lane, rec->type, rec->date, rec->count);
+        break;
+    case INV_REC_SNAP_END:
+        inv_snapshot_end = RT_TRUE;
+        break;
+    case INV_REC_VEND:
+        index_vend(rec->lane);
+        break;
+    default:
+        break;
+    }
+}
+
+/* 重放一块：快照不完整返回 -RT_ERROR；遇到残缺记录时 *torn 置位 */
+static rt_err_t log_replay(int block, rt_bool_t *torn)
+{
+    rt_uint32_t slot;
+
+    memset(inv_lanes, 0, sizeof(inv_lanes));
+    inv_snapshot_end = RT_FALSE;
+    slot = flash_log_replay(&inv_log, block, log_apply, torn);
+    if (!inv_snapshot_end)
+        return -RT_ERROR;
+    inv_log.block = block;
+    inv_log.slot = slot;
+    return RT_EOK;
+}
+
+/* ---------------- 接口 ---------------- */
+
+/* 挂载分区并从日志重建内存索引；分区为空时格式化 */
+rt_err_t inventory_init(const char *partition, int lanes)
+{
+    rt_uint32_t generation = 0;
+    int block = -1;
+    rt_bool_t torn = RT_FALSE;
+    rt_err_t result = -RT_ERROR;
+
+    inv_lane_count = lanes < INV_LANE_MAX ? lanes : INV_LANE_MAX;
+    if (flash_log_open(&inv_log, partition, INV_MAGIC) != RT_EOK)
+        return -RT_ERROR;
+
+    rt_sem_init(&inv_lock, "inv", 1, RT_IPC_FLAG_FIFO);
+
+    /* 按代数从新到旧尝试，取第一个快照完整的块 */
+    while (result != RT_EOK && flash_log_older(&inv_log, &block, &generation))
+    {
+        inv_log.generation = generation;
+        result = log_replay(block, &torn);
+    }
+
+    if (result != RT_EOK)
+    {
+        /* 没有可用的块：从空库存开始，写到第 0 块 */
+        rt_kprintf("Inventory log empty, formatting %s\n", partition);
+        memset(inv_lanes, 0, sizeof(inv_lanes));
+        inv_log.block = inv_log.blocks - 1;
+        inv_log.generation = 0;
+        torn = RT_TRUE;
+    }
+
+    /* 残缺记录之后不能再写，换一块重写快照 */
+    if (torn && flash_log_compact(&inv_log, log_snapshot) != RT_EOK)
+    {
+        rt_kprintf("Inventory log write failed\n");
+        return -RT_EIO;
+    }
+    index_update_types();
+    return RT_EOK;
+}
+
+/* 上货：先写日志再改索引，本组批次已满时拒绝 */
+rt_err_t inventory_load(int lane, rt_uint8_t type, rt_uint32_t date, rt_uint16_t count)
+{
+    InvRecord rec;
+    rt_err_t result;
+
+    if (inv_log.part == RT_NULL)
+        return -RT_ERROR;
+
+    rt_sem_take(&inv_lock, RT_WAITING_FOREVER);
+    result = index_check_load(lane, type, date, count);
+    if (result == RT_EOK)
+    {
+        log_record(&rec, INV_REC_LOAD, lane, type, date, count);
+        result = log_append(&rec);
+    }
+    if (result == RT_EOK)
+    {
+        index_load(lane, type, date, count);
+        index_update_types();
+    }
+    rt_sem_release(&inv_lock);
+    return result;
+}
+
+/* 出货一件：记在本组最老的批次上 */
+rt_err_t inventory_vend(int lane)
+{
+    InvRecord rec;
+    rt_err_t result = RT_EOK;
+
+    if (inv_log.part == RT_NULL)
+        return -RT_ERROR;
+
+    rt_sem_take(&inv_lock, RT_WAITING_FOREVER);
+    if (lane < 1 || lane > INV_LANE_MAX || inv_lanes[lane - 1].count == 0)
+        result = -RT_EEMPTY;
+    if (result == RT_EOK)
+    {
+        log_record(&rec, INV_REC_VEND, lane, inv_lanes[lane - 1].batches[0].type,
+                   inv_lanes[lane - 1].batches[0].date, 1);
+        result = log_append(&rec);
+    }
+    if (result == RT_EOK)
+    {
+        index_vend(lane);
+        index_update_types();
+    }
+    rt_sem_release(&inv_lock);
+    return result;
+}
+
+rt_bool_t inventory_oldest(int lane, InventoryBatch *batch)
+{
+    rt_bool_t found = RT_FALSE;
+
+    if (inv_log.part == RT_NULL || lane < 1 || lane > INV_LANE_MAX)
+        return RT_FALSE;
+
+    rt_sem_take(&inv_lock, RT_WAITING_FOREVER);
+    if (inv_lanes[lane - 1].count > 0)
+    {
+        *batch = inv_lanes[lane - 1].batches[0];
+        found = RT_TRUE;
+    }
+    rt_sem_release(&inv_lock);
+    return found;
+}
+
+rt_bool_t inventory_oldest_type(rt_uint8_t type, InventoryBatch *batch, int *lane)
+{
+    rt_bool_t found = RT_FALSE;
+
+    if (inv_log.part == RT_NULL || type < 1 || type > INV_TYPE_MAX)
+        return RT_FALSE;
+
+    rt_sem_take(&inv_lock, RT_WAITING_FOREVER);
+    if (inv_type_oldest[type - 1] != RT_NULL)
+    {
+        *batch = *inv_type_oldest[type - 1];
+        if (lane != RT_NULL)
+            *lane = inv_type_lane[type - 1];
+        found = RT_TRUE;
+    }
+    rt_sem_release(&inv_lock);
+    return found;
+}
+
+rt_uint32_t inventory_stock(int lane)
+{
+    if (lane < 1 || lane > INV_LANE_MAX)
+        return 0;
+    return inv_lanes[lane - 1].stock;
+}
+
+/* 复制本组的批次（从老到新），返回个数 */
+int inventory_batches(int lane, InventoryBatch *batches, int max)
+{
+    int n;
+
+    if (inv_log.part == RT_NULL || lane < 1 || lane > INV_LANE_MAX)
+        return 0;
+
+    rt_sem_take(&inv_lock, RT_WAITING_FOREVER);
+    n = inv_lanes[lane - 1].count < max ? inv_lanes[lane - 1].count : max;
+    memcpy(batches, inv_lanes[lane - 1].batches, n * sizeof(InventoryBatch));
+    rt_sem_release(&inv_lock);
+    return n;
+}
+
+void inventory_get_info(InventoryInfo *info)
+{
+    info->generation = inv_log.generation;
+    info->block = inv_log.block;
+    info->blocks = inv_log.blocks;
+    info->used = inv_log.slot;
+    info->capacity = inv_log.part != RT_NULL ? flash_log_slots(&inv_log) : 0;
+}
@@ -0,0 +1,40 @@
+﻿#ifndef __INVENTORY_H__
+#define __INVENTORY_H__
+
+#include <rtthread.h>
+
+#define INVENTORY_PARTITION   "inventory"
+#define INV_LANE_MAX          4     // 最多几组
+#define INV_BATCH_MAX         16    // 每组最多同时存放几个批次
+#define INV_TYPE_MAX          8     // 商品类型编号 1~INV_TYPE_MAX
+
+/* 一个批次：同一类型、同一生产日期的货 */
+typedef struct {
+    rt_uint8_t type;
+    rt_uint16_t count;              // 剩余件数
+    rt_uint32_t date;               // 生产日期，十进制 yyyyMMdd
+} InventoryBatch;
+
+/* 日志占用情况 */
+typedef struct {
+    rt_uint32_t generation;         // 当前块的代数，每换一块加一
+    int block;                      // 当前写入的块
+    int blocks;                     // 分区的块数
+    rt_uint32_t used;               // 当前块已用的记录数
+    rt_uint32_t capacity;           // 每块可存的记录数
+} InventoryInfo;
+
+/* lanes 为机器实际的组数（不超过 INV_LANE_MAX），编号更大的组不能上货 */
+rt_err_t inventory_init(const char *partition, int lanes);
+/* 本组批次已满返回 -RT_EFULL，批次件数超过 65535 也返回 -RT_EFULL */
+rt_err_t inventory_load(int lane, rt_uint8_t type, rt_uint32_t date, rt_uint16_t count);
+rt_err_t inventory_vend(int lane);
+
+/* 查询只读内存索引，不访问闪存 */
+rt_bool_t inventory_oldest(int lane, InventoryBatch *batch);
+rt_bool_t inventory_oldest_type(rt_uint8_t type, InventoryBatch *batch, int *lane);
+rt_uint32_t inventory_stock(int lane);
+int inventory_batches(int lane, InventoryBatch *batches, int max);
+void inventory_get_info(InventoryInfo *info);
+
+#endif
@@ -0,0 +1,123 @@
+﻿#include "key_input.h"
+#include "vend_trace.h"
+
+/*
+ * 中断驱动的按键输入。
+ *
+ * 按键为低有效，双边沿中断只负责重启该键的消抖定时器；定时器到期时电平
+ * 已稳定，再与上次状态比较得出按下或松开。按下后另一个定时器计时长按，
+ * 允许连发的键随后按 KEY_REPEAT_MS 周期发 REPEAT。事件在定时器上下文中
+ * 交给 key_input_init 注册的处理函数，由它转给界面线程。
+ */
+
+typedef struct {
+    rt_uint8_t key;
+    rt_base_t pin;
+    rt_bool_t repeat;
+    rt_bool_t pressed;
+    rt_bool_t held;                 // 本次按下已发过 LONG
+    struct rt_timer debounce;
+    struct rt_timer hold;
+} KeyInput;
+
+static KeyInput key_inputs[KEY_INPUT_MAX];
+static int key_input_count = 0;
+
+static key_handler_t key_handler = RT_NULL;
+
+static void key_post(KeyInput *input, rt_uint8_t type)
+{
+    KeyEvent event;
+
+    event.key = input->key;
+    event.type = type;
+    vend_trace(TRACE_KEY, input->key, type);
+    if (key_handler != RT_NULL)
+        key_handler(&event);
+}
+
+static void key_irq(void *args)
+{
+    KeyInput *input = (KeyInput *)args;
+
+    rt_timer_start(&input->debounce);
+}
+
+static void key_debounce_timeout(void *parameter)
+{
+    KeyInput *input = (KeyInput *)parameter;
+    rt_bool_t down = rt_pin_read(input->pin) == PIN_LOW;
+    rt_tick_t ticks = rt_tick_from_millisecond(KEY_LONG_MS);
+
+    if (down == input->pressed)
+        return;
+
+    input->pressed = down;
+    if (down)
+    {
+        input->held = RT_FALSE;
+        rt_timer_control(&input->hold, RT_TIMER_CTRL_SET_TIME, &ticks);
+        rt_timer_start(&input->hold);
+        key_post(input, KEY_EVENT_PRESS);
+    }
+    else
+    {
+        rt_timer_stop(&input->hold);
+        key_post(input, KEY_EVENT_RELEASE);
+    }
+}
+
+static void key_hold_timeout(void *parameter)
+{
+    KeyInput *input = (KeyInput *)parameter;
+    rt_tick_t ticks = rt_tick_from_millisecond(KEY_REPEAT_MS);
+
+    if (!input->pressed)
+        return;
+
+    if (!input->held)
+    {
+        input->held = RT_TRUE;
+        key_post(input, KEY_EVENT_LONG);
+        if (!input->repeat)
+            return;
+        rt_timer_control(&input->hold, RT_TIMER_CTRL_SET_TIME, &ticks);
+    }
+    else
+    {
+        key_post(input, KEY_EVENT_REPEAT);
+    }
+    rt_timer_start(&input->hold);
+}
+
+/* 注册事件处理函数，须在 key_input_add 之前调用 */
+void key_input_init(key_handler_t handler)
+{
+    key_handler = handler;
+}
+
+/* 注册一个低有效按键，repeat 为真时长按后自动连发 */
+rt_err_t key_input_add(rt_uint8_t key, rt_base_t pin, rt_bool_t repeat)
+{
+    KeyInput *input;
+
+    if (key_input_count >= KEY_INPUT_MAX)
+        return -RT_EFULL;
+
+    input = &key_inputs[key_input_count++];
+    input->key = key;
+    input->pin = pin;
+    input->repeat = repeat;
+    input->pressed = RT_FALSE;
+    input->held = RT_FALSE;
+
+    rt_timer_init(&input->debounce, "key_db", key_debounce_timeout, input,
+                  rt_tick_from_millisecond(KEY_DEBOUNCE_MS), RT_TIMER_FLAG_ONE_SHOT);
+    rt_timer_init(&input->hold, "key_hold", key_hold_timeout, input,
+                  rt_tick_from_millisecond(KEY_LONG_MS), RT_TIMER_FLAG_ONE_SHOT);
+
+    rt_pin_mode(pin, PIN_MODE_INPUT_PULLUP);
+    rt_pin_attach_irq(pin, PIN_IRQ_MODE_RISING_FALLING, key_irq, input);
+    rt_pin_irq_enable(pin, PIN_IRQ_ENABLE);
+    return RT_EOK;
+}
@@ -0,0 +1,30 @@
+﻿#ifndef __KEY_INPUT_H__
+#define __KEY_INPUT_H__
+
+#include <rtthread.h>
+#include <rtdevice.h>
+
+#define KEY_INPUT_MAX         4
+
+#define KEY_DEBOUNCE_MS       20    // 最后一个边沿之后稳定这么久才算数
+#define KEY_LONG_MS           800   // 按住超过这么久算长按
+#define KEY_REPEAT_MS         150   // 长按之后的自动连发间隔
+
+/* 按键事件类型 */
+#define KEY_EVENT_PRESS       1     // 按下
+#define KEY_EVENT_LONG        2     // 长按，每次按下只发一次
+#define KEY_EVENT_REPEAT      3     // 长按后的自动连发
+#define KEY_EVENT_RELEASE     4     // 松开
+
+typedef struct {
+    rt_uint8_t key;                 // key_input_add 时给的编号
+    rt_uint8_t type;                // KEY_EVENT_*
+} KeyEvent;
+
+/* 事件处理函数，在定时器上下文中调用，不能阻塞 */
+typedef void (*key_handler_t)(const KeyEvent *event);
+
+void key_input_init(key_handler_t handler);
+rt_err_t key_input_add(rt_uint8_t key, rt_base_t pin, rt_bool_t repeat);
+
+#endif
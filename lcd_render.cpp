@@ -0,0 +1,379 @@
+﻿#include "lcd_render.h"
+#include "vend_trace.h"
+
+/*
+ * 脏区域渲染。
+ *
+ * 界面改动时只登记受影响的矩形，刷新时把每个矩形按行缓冲大小切成若干
+ * 条带：条带先填背景色，再调用重绘回调把整个界面画进去（落在条带外的
+ * 部分直接裁掉），最后用一次 lcd_fill_array 整块发出，驱动为 SPI 配了
+ * DMA 时就是一次 DMA 传输。这样光标移动只重写新旧两行，状态变化只重写
+ * 状态栏，也不会有先清后画的闪烁。
+ *
+ * 文字是条带里最费时的部分，16、24 号字按字号和颜色缓存画好的整格像素：
+ * 每个字符第一次用到时按字模画进缓存池，之后每行一次 memcpy。背景取
+ * lcd_render_init 给的背景色，换背景时缓存作废；缓存池或组合用完后，
+ * 其余的字照旧逐点画，画出的像素相同。
+ *
+ * 渲染层不加锁，只应由界面线程调用。
+ */
+
+/* 面板按高字节在前接收，缓冲区里直接存成这个字节序 */
+#define LCD_RENDER_PIXEL(c)     ((rt_uint16_t)(((c) << 8) | ((c) >> 8)))
+
+#define GLYPH_CHARS             ('~' - ' ' + 1)
+
+/*
+ * 字库在 BSP 的 drv_lcd_font.h 中定义：ASCII 32~126，每行高位在左。BSP 的
+ * 头文件没有声明它们，这里按 drv_lcd_font.h 的维数声明，lcd_render_init
+ * 再核对排列，对不上时不画文字。只用 16、24 号字。
+ */
+extern "C" {
+extern const unsigned char asc2_1608[GLYPH_CHARS][16];
+extern const unsigned char asc2_2412[GLYPH_CHARS][48];
+}
+#define GLYPH_NONE              0xFFFF      // 还没画进缓存
+#define GLYPH_POOL_PIXELS       (LCD_GLYPH_CACHE_BYTES / sizeof(rt_uint16_t))
+
+/* 一种字号与颜色的字形：各字符在缓存池中的起点（像素） */
+typedef struct {
+    rt_uint8_t size;                // 0 为空位
+    rt_uint16_t color;
+    rt_uint16_t cell[GLYPH_CHARS];
+} GlyphFace;
+
+typedef struct {
+    int x1, y1, x2, y2;
+} LcdRect;
+
+static rt_uint16_t render_buf[LCD_RENDER_BUF_PIXELS];
+static rt_uint16_t render_background = BLACK;
+static lcd_paint_t render_paint = RT_NULL;
+
+static LcdRect render_dirty[LCD_RENDER_DIRTY_MAX];
+static int render_dirty_count = 0;
+
+static LcdRect render_band;    // 当前条带，重绘回调的裁剪区
+static int render_stride;      // 条带宽度（像素）
+
+static rt_uint16_t glyph_pool[GLYPH_POOL_PIXELS];
+static rt_uint32_t glyph_pool_used = 0;    // 已用的像素数
+static GlyphFace glyph_faces[LCD_GLYPH_FACES];
+static rt_bool_t glyph_enabled = RT_TRUE;
+static rt_bool_t font_valid = RT_FALSE;
+static LcdGlyphStats glyph_stats;
+
+static void glyph_reset(void)
+{
+    rt_memset(glyph_faces, 0, sizeof(glyph_faces));
+    rt_memset(&glyph_stats, 0, sizeof(glyph_stats));
+    glyph_pool_used = 0;
+}
+
+/* 找到或占一个组合；不缓存的字号、缓存关闭或组合用完时返回 RT_NULL */
+static GlyphFace *glyph_face(int size, rt_uint16_t color)
+{
+    GlyphFace *empty = RT_NULL;
+
+    if (!glyph_enabled || (size != 16 && size != 24))
+        return RT_NULL;
+
+    for (int i = 0; i < LCD_GLYPH_FACES; i++)
+    {
+        GlyphFace *face = &glyph_faces[i];
+
+        if (face->size == size && face->color == color)
+            return face;
+        if (face->size == 0 && empty == RT_NULL)
+            empty = face;
+    }
+    if (empty != RT_NULL)
+    {
+        empty->size = (rt_uint8_t)size;
+        empty->color = color;
+        rt_memset(empty->cell, 0xFF, sizeof(empty->cell));
+    }
+    return empty;
+}
+
+/* 某字符画好的整格，每行 width 个像素；没缓存过时现画，缓存池满时返回 RT_NULL */
+static const rt_uint16_t *glyph_cell(GlyphFace *face, int ch, const unsigned char *glyph,
+                                     int width, int row_bytes)
+{
+    rt_uint16_t fg, bg, *cell;
+    int pixels = width * face->size;
+
+    if (face->cell[ch - ' '] != GLYPH_NONE)
+    {
+        glyph_stats.hits++;
+        return glyph_pool + face->cell[ch - ' '];
+    }
+    if (glyph_pool_used + pixels > GLYPH_POOL_PIXELS)
+        return RT_NULL;
+
+    fg = LCD_RENDER_PIXEL(face->color);
+    bg = LCD_RENDER_PIXEL(render_background);
+    cell = glyph_pool + glyph_pool_used;
+    for (int row = 0; row < face->size; row++)
+    {
+        const unsigned char *bits = glyph + row * row_bytes;
+
+        for (int col = 0; col < width; col++)
+            cell[row * width + col] = bits[col >> 3] & (0x80 >> (col & 7)) ? fg : bg;
+    }
+
+    face->cell[ch - ' '] = (rt_uint16_t)glyph_pool_used;
+    glyph_pool_used += pixels;
+    glyph_stats.misses++;
+    glyph_stats.glyphs++;
+    glyph_stats.bytes = glyph_pool_used * sizeof(rt_uint16_t);
+    return cell;
+}
+
+static rt_bool_t rect_touch(const LcdRect *a, const LcdRect *b)
+{
+    return a->x1 <= b->x2 + 1 && b->x1 <= a->x2 + 1 &&
+           a->y1 <= b->y2 + 1 && b->y1 <= a->y2 + 1;
+}
+
+static void rect_union(LcdRect *a, const LcdRect *b)
+{
+    if (b->x1 < a->x1) a->x1 = b->x1;
+    if (b->y1 < a->y1) a->y1 = b->y1;
+    if (b->x2 > a->x2) a->x2 = b->x2;
+    if (b->y2 > a->y2) a->y2 = b->y2;
+}
+
+static int rect_area(const LcdRect *r)
+{
+    return (r->x2 - r->x1 + 1) * (r->y2 - r->y1 + 1);
+}
+
+/* 空格整格为空，其余字符格里都有笔画；每字字节数或字符数不对时通不过 */
+static rt_bool_t font_check(const unsigned char *table, int glyph_bytes)
+{
+    int ch, i;
+
+    for (ch = 0; ch < GLYPH_CHARS; ch++)
+    {
+        rt_bool_t ink = RT_FALSE;
+
+        for (i = 0; i < glyph_bytes; i++)
+            ink = ink || table[ch * glyph_bytes + i] != 0;
+        if (ink != (ch != 0))
+            return RT_FALSE;
+    }
+    return RT_TRUE;
+}
+
+void lcd_render_init(rt_uint16_t background, lcd_paint_t paint)
+{
+    font_valid = font_check(asc2_1608[0], sizeof(asc2_1608[0])) &&
+                 font_check(asc2_2412[0], sizeof(asc2_2412[0]));
+    if (!font_valid)
+        rt_kprintf("LCD font tables do not match drv_lcd_font.h, text disabled\n");
+
+    render_background = background;
+    render_paint = paint;
+    render_dirty_count = 0;
+    glyph_reset();
+}
+
+void lcd_render_set_glyph_cache(rt_bool_t enable)
+{
+    glyph_enabled = enable;
+    glyph_reset();
+}
+
+void lcd_render_get_glyph_stats(LcdGlyphStats *stats)
+{
+    *stats = glyph_stats;
+}
+
+/* 登记需要重画的矩形；与已有矩形相交或相邻就合并，表满时并入增量最小的一个 */
+void lcd_render_invalidate(int x1, int y1, int x2, int y2)
+{
+    LcdRect r;
+    int i, best = 0, best_growth = 0x7FFFFFFF;
+
+    if (x1 < 0) x1 = 0;
+    if (y1 < 0) y1 = 0;
+    if (x2 > LCD_W - 1) x2 = LCD_W - 1;
+    if (y2 > LCD_H - 1) y2 = LCD_H - 1;
+    if (x1 > x2 || y1 > y2)
+        return;
+    r.x1 = x1;
+    r.y1 = y1;
+    r.x2 = x2;
+    r.y2 = y2;
+
+    /* 合并后可能又碰到别的矩形，从头再查 */
+    for (i = 0; i < render_dirty_count; i++)
+    {
+        if (rect_touch(&render_dirty[i], &r))
+        {
+            rect_union(&r, &render_dirty[i]);
+            render_dirty[i] = render_dirty[--render_dirty_count];
+            i = -1;
+        }
+    }
+
+    if (render_dirty_count < LCD_RENDER_DIRTY_MAX)
+    {
+        render_dirty[render_dirty_count++] = r;
+        return;
+    }
+
+    for (i = 0; i < render_dirty_count; i++)
+    {
+        LcdRect u = render_dirty[i];
+        int growth;
+
+        rect_union(&u, &r);
+        growth = rect_area(&u) - rect_area(&render_dirty[i]);
+        if (growth < best_growth)
+        {
+            best = i;
+            best_growth = growth;
+        }
+    }
+    rect_union(&render_dirty[best], &r);
+}
+
+void lcd_render_invalidate_all(void)
+{
+    render_dirty_count = 0;
+    lcd_render_invalidate(0, 0, LCD_W - 1, LCD_H - 1);
+}
+
+/* 把所有脏矩形逐条带重画并发出 */
+void lcd_render_flush(void)
+{
+    int i, y, rows, bands = 0;
+
+    if (render_paint == RT_NULL || render_dirty_count == 0)
+        return;
+    vend_trace(TRACE_LCD_BEGIN, 0, (rt_uint16_t)render_dirty_count);
+
+    for (i = 0; i < render_dirty_count; i++)
+    {
+        const LcdRect *r = &render_dirty[i];
+
+        render_stride = r->x2 - r->x1 + 1;
+        rows = LCD_RENDER_BUF_PIXELS / render_stride;
+        for (y = r->y1; y <= r->y2; y += rows)
+        {
+            int n, pixels;
+            rt_uint16_t bg = LCD_RENDER_PIXEL(render_background);
+
+            render_band.x1 = r->x1;
+            render_band.x2 = r->x2;
+            render_band.y1 = y;
+            render_band.y2 = y + rows - 1 < r->y2 ? y + rows - 1 : r->y2;
+
+            pixels = render_stride * (render_band.y2 - y + 1);
+            for (n = 0; n < pixels; n++)
+                render_buf[n] = bg;
+            render_paint();
+            lcd_fill_array(render_band.x1, render_band.y1, render_band.x2, render_band.y2,
+                           render_buf);
+            bands++;
+        }
+    }
+    render_dirty_count = 0;
+    vend_trace(TRACE_LCD_END, 0, (rt_uint16_t)bands);
+}
+
+void lcd_render_fill(int x1, int y1, int x2, int y2, rt_uint16_t color)
+{
+    rt_uint16_t c = LCD_RENDER_PIXEL(color);
+    int x, y;
+
+    if (x1 < render_band.x1) x1 = render_band.x1;
+    if (y1 < render_band.y1) y1 = render_band.y1;
+    if (x2 > render_band.x2) x2 = render_band.x2;
+    if (y2 > render_band.y2) y2 = render_band.y2;
+
+    for (y = y1; y <= y2; y++)
+    {
+        rt_uint16_t *row = render_buf + (y - render_band.y1) * render_stride - render_band.x1;
+        for (x = x1; x <= x2; x++)
+            row[x] = c;
+    }
+}
+
+void lcd_render_rect(int x1, int y1, int x2, int y2, rt_uint16_t color)
+{
+    lcd_render_fill(x1, y1, x2, y1, color);
+    lcd_render_fill(x1, y2, x2, y2, color);
+    lcd_render_fill(x1, y1, x1, y2, color);
+    lcd_render_fill(x2, y1, x2, y2, color);
+}
+
+/* 按字符格连背景画出，有缓存时整格逐行复制；折行规则与 lcd_show_string 一致 */
+void lcd_render_text(int x, int y, int size, rt_uint16_t color, const char *text)
+{
+    const unsigned char *font;
+    rt_uint16_t c = LCD_RENDER_PIXEL(color);
+    rt_uint16_t bg = LCD_RENDER_PIXEL(render_background);
+    int width = size / 2;
+    int row_bytes = (width + 7) / 8;
+    GlyphFace *face;
+
+    if (!font_valid)
+        return;
+    switch (size)
+    {
+    case 16: font = asc2_1608[0]; break;
+    case 24: font = asc2_2412[0]; break;
+    default: return;
+    }
+    face = glyph_face(size, color);
+
+    for (; *text != '\0'; text++, x += width)
+    {
+        const unsigned char *glyph;
+        const rt_uint16_t *cell = RT_NULL;
+        char ch = *text;
+        int row, col, row_first, row_last, col_first, col_last;
+
+        if (x > LCD_W - width)
+        {
+            x = 0;
+            y += size;
+        }
+        if (y > LCD_H - size || y > render_band.y2)
+            break;
+        if (y + size - 1 < render_band.y1 || x > render_band.x2 || x + width - 1 < render_band.x1)
+            continue;
+
+        if (ch < ' ' || ch > '~')
+            ch = ' ';
+        glyph = font + (ch - ' ') * size * row_bytes;
+        if (face != RT_NULL)
+            cell = glyph_cell(face, ch, glyph, width, row_bytes);
+        if (cell == RT_NULL)
+            glyph_stats.uncached++;
+
+        row_first = render_band.y1 > y ? render_band.y1 - y : 0;
+        row_last = render_band.y2 < y + size - 1 ? render_band.y2 - y : size - 1;
+        col_first = render_band.x1 > x ? render_band.x1 - x : 0;
+        col_last = render_band.x2 < x + width - 1 ? render_band.x2 - x : width - 1;
+
+        for (row = row_first; row <= row_last; row++)
+        {
+            const unsigned char *bits = glyph + row * row_bytes;
+            rt_uint16_t *dst = render_buf + (y + row - render_band.y1) * render_stride +
+                               (x - render_band.x1);
+
+            if (cell != RT_NULL)
+            {
+                rt_memcpy(dst + col_first, cell + row * width + col_first,
+                          (col_last - col_first + 1) * sizeof(rt_uint16_t));
+                continue;
+            }
+            for (col = col_first; col <= col_last; col++)
+                dst[col] = bits[col >> 3] & (0x80 >> (col & 7)) ? c : bg;
+        }
+    }
+}
@@ -0,0 +1,39 @@
+﻿#ifndef __LCD_RENDER_H__
+#define __LCD_RENDER_H__
+
+#include <rtthread.h>
+#include <drv_lcd.h>
+
+#define LCD_RENDER_BUF_PIXELS   (LCD_W * 24)    // 行缓冲大小（像素），整屏宽时一次 24 行
+#define LCD_RENDER_DIRTY_MAX    8               // 同时记录的脏矩形数，再多就合并
+#define LCD_GLYPH_CACHE_BYTES   (20 * 1024)     // 字形缓存：16、24 号字画好的整格像素
+#define LCD_GLYPH_FACES         4               // 同时缓存的字号与颜色组合数
+
+/* 字形缓存的命中情况 */
+typedef struct {
+    rt_uint32_t hits;               // 整格复制的字符
+    rt_uint32_t misses;             // 第一次用到、画进缓存的字符
+    rt_uint32_t uncached;           // 不缓存的字号或缓存已满，逐点画的字符
+    rt_uint32_t glyphs;             // 已缓存的字形数
+    rt_uint32_t bytes;              // 已用的缓存字节数
+} LcdGlyphStats;
+
+/* 重绘回调：按当前脏区域画出整个界面，超出部分由渲染层裁掉 */
+typedef void (*lcd_paint_t)(void);
+
+void lcd_render_init(rt_uint16_t background, lcd_paint_t paint);
+void lcd_render_invalidate(int x1, int y1, int x2, int y2);
+void lcd_render_invalidate_all(void);
+void lcd_render_flush(void);
+
+/* 打开或关闭字形缓存，两种情况画出的像素相同；切换时清空缓存和统计 */
+void lcd_render_set_glyph_cache(rt_bool_t enable);
+void lcd_render_get_glyph_stats(LcdGlyphStats *stats);
+
+/* 以下只能在重绘回调中调用，坐标含端点 */
+void lcd_render_fill(int x1, int y1, int x2, int y2, rt_uint16_t color);
+void lcd_render_rect(int x1, int y1, int x2, int y2, rt_uint16_t color);
+/* 文字按字符格连背景色整格画出，会盖住格内先画的内容；size 只能是 16 或 24 */
+void lcd_render_text(int x, int y, int size, rt_uint16_t color, const char *text);
+
+#endif
@@ -0,0 +1,96 @@
+﻿#include "mem_budget.h"
+#include <string.h>
+
+/*
+ * 内存预算：线程栈水位和堆用量。
+ *
+ * 内核在 rt_thread_init 时把整个栈填成 '#'，栈从高地址往低长，从栈底往上
+ * 数还是 '#' 的字节就是从没用到过的部分，其余即峰值。堆的用量和峰值取自
+ * rt_memory_info，申请和释放次数由内存钩子计数。查看时不申请内存，不扰动
+ * 正在用堆的线程。
+ */
+
+static volatile rt_uint32_t heap_allocs = 0;
+static volatile rt_uint32_t heap_frees = 0;
+
+#ifdef RT_USING_HOOK
+static void heap_malloc_hook(void *ptr, rt_size_t size)
+{
+    RT_UNUSED(size);
+    if (ptr != RT_NULL)
+        heap_allocs++;
+}
+
+static void heap_free_hook(void *ptr)
+{
+    if (ptr != RT_NULL)
+        heap_frees++;
+}
+#endif
+
+rt_err_t mem_budget_init(void)
+{
+#ifdef RT_USING_HOOK
+    rt_malloc_sethook(heap_malloc_hook);
+    rt_free_sethook(heap_free_hook);
+    return RT_EOK;
+#else
+    return -RT_ENOSYS;
+#endif
+}
+
+rt_uint32_t mem_budget_stack_peak(rt_thread_t thread)
+{
+    const rt_uint8_t *stack = (const rt_uint8_t *)thread->stack_addr;
+    rt_uint32_t untouched = 0;
+
+#ifdef ARCH_CPU_STACK_GROWS_UPWARD
+    while (untouched < thread->stack_size && stack[thread->stack_size - 1 - untouched] == '#')
+        untouched++;
+#else
+    while (untouched < thread->stack_size && stack[untouched] == '#')
+        untouched++;
+#endif
+    return thread->stack_size - untouched;
+}
+
+int mem_budget_threads(MemThreadUsage *usage, int max)
+{
+    struct rt_object_information *info = rt_object_get_information(RT_Object_Class_Thread);
+    rt_list_t *node;
+    int count = 0;
+
+    if (info == RT_NULL)
+        return 0;
+
+    /*
+     * 整个扫描都锁住调度：线程只在线程上下文里创建和删除，锁住后线程表和
+     * 各线程的栈都不会被释放。中断照常响应，逐字节扫描栈不影响实时性。
+     */
+    rt_enter_critical();
+    rt_list_for_each(node, &info->object_list)
+    {
+        rt_thread_t thread = (rt_thread_t)rt_list_entry(node, struct rt_object, list);
+
+        if (count >= max)
+            break;
+        memcpy(usage[count].name, thread->name, RT_NAME_MAX);
+        usage[count].name[RT_NAME_MAX] = '\0';
+        usage[count].priority = thread->current_priority;
+        usage[count].stack_size = thread->stack_size;
+        usage[count].stack_peak = mem_budget_stack_peak(thread);
+        count++;
+    }
+    rt_exit_critical();
+    return count;
+}
+
+void mem_budget_heap(MemHeapUsage *usage)
+{
+    memset(usage, 0, sizeof(*usage));
+#ifdef RT_USING_HEAP
+    rt_memory_info(&usage->total, &usage->used, &usage->max_used);
+#endif
+    usage->allocs = heap_allocs;
+    usage->frees = heap_frees;
+}
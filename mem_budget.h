@@ -0,0 +1,35 @@
+﻿#ifndef __MEM_BUDGET_H__
+#define __MEM_BUDGET_H__
+
+#include <rtthread.h>
+
+#define MEM_BUDGET_THREADS      16      // 报告中最多列出的线程数
+#define MEM_BUDGET_WARN_PCT     80      // 栈峰值达到栈大小的这个百分比时标出
+
+/* 一个线程的栈水位 */
+typedef struct {
+    char name[RT_NAME_MAX + 1];
+    rt_uint8_t priority;
+    rt_uint32_t stack_size;
+    rt_uint32_t stack_peak;         // 从栈顶算起被写过的字节数
+} MemThreadUsage;
+
+/* 堆的用量与申请次数 */
+typedef struct {
+    rt_size_t total;
+    rt_size_t used;
+    rt_size_t max_used;             // 开机以来的峰值
+    rt_uint32_t allocs;             // mem_budget_init 以来的申请次数
+    rt_uint32_t frees;
+} MemHeapUsage;
+
+rt_err_t mem_budget_init(void);
+
+/* 各线程的栈水位，按内核线程表的顺序；返回个数 */
+int mem_budget_threads(MemThreadUsage *usage, int max);
+rt_uint32_t mem_budget_stack_peak(rt_thread_t thread);
+
+/* 堆统计 */
+void mem_budget_heap(MemHeapUsage *usage);
+
+#endif
@@ -0,0 +1,153 @@
+﻿#include "pusher.h"
+#include "vend_trace.h"
+#include "vend_log.h"
+
+/*
+ * 推手单程控制。
+ *
+ * 起动后等待到位开关中断或电流采样判定堵转，任一发生即在中断上下文里
+ * 立刻断开 H 桥，再通过事件通知等待的线程；原先的固定时长只作超时兜底。
+ * 电流由软定时器周期采样，起动冲击期间不做判定。
+ */
+
+static rt_uint8_t pusher_count = 0;
+
+/* 断开 H 桥，中断与线程上下文均可调用 */
+static void pusher_halt(Pusher *pusher)
+{
+    if (pusher->drive != 0)
+        vend_trace(TRACE_PUSH_HALT, pusher->trace_id, 0);
+    pusher->drive = 0;
+    rt_pin_write(pusher->cfg.in1_pin, PIN_LOW);
+    rt_pin_write(pusher->cfg.in2_pin, PIN_LOW);
+}
+
+static void pusher_limit_isr(void *args)
+{
+    Pusher *pusher = (Pusher *)args;
+    rt_base_t limit;
+
+    if (pusher->drive == 0)
+        return;
+
+    limit = pusher->drive > 0 ? pusher->cfg.fwd_limit_pin : pusher->cfg.back_limit_pin;
+    if (limit == PUSHER_PIN_NONE || rt_pin_read(limit) != PIN_LOW)
+        return;
+
+    pusher_halt(pusher);
+    rt_event_send(&pusher->event, PUSHER_EVENT_END);
+}
+
+static void pusher_sample_timeout(void *parameter)
+{
+    Pusher *pusher = (Pusher *)parameter;
+
+    if (pusher->drive == 0)
+        return;
+    if (rt_tick_get() - pusher->start_tick < rt_tick_from_millisecond(PUSHER_INRUSH_MS))
+        return;
+
+    if (rt_adc_read(pusher->adc, pusher->cfg.adc_channel) >= pusher->cfg.stall_threshold)
+    {
+        pusher_halt(pusher);
+        rt_event_send(&pusher->event, PUSHER_EVENT_STALL);
+    }
+}
+
+static void pusher_limit_init(Pusher *pusher, rt_base_t pin)
+{
+    if (pin == PUSHER_PIN_NONE)
+        return;
+
+    rt_pin_mode(pin, PIN_MODE_INPUT_PULLUP);
+    rt_pin_attach_irq(pin, PIN_IRQ_MODE_FALLING, pusher_limit_isr, pusher);
+    rt_pin_irq_enable(pin, PIN_IRQ_ENABLE);
+}
+
+rt_err_t pusher_init(Pusher *pusher, const char *name, const PusherConfig *cfg)
+{
+    pusher->name = name;
+    pusher->cfg = *cfg;
+    pusher->adc = RT_NULL;
+    pusher->drive = 0;
+    pusher->trace_id = pusher_count++;
+
+    rt_pin_mode(cfg->in1_pin, PIN_MODE_OUTPUT);
+    rt_pin_mode(cfg->in2_pin, PIN_MODE_OUTPUT);
+    pusher_halt(pusher);
+
+    rt_event_init(&pusher->event, name, RT_IPC_FLAG_FIFO);
+    pusher_limit_init(pusher, cfg->fwd_limit_pin);
+    pusher_limit_init(pusher, cfg->back_limit_pin);
+
+    if (cfg->adc_name != RT_NULL)
+    {
+        pusher->adc = (rt_adc_device_t)rt_device_find(cfg->adc_name);
+        if (pusher->adc == RT_NULL)
+        {
+            rt_kprintf("ADC device %s not found!\n", cfg->adc_name);
+        }
+        else
+        {
+            rt_adc_enable(pusher->adc, cfg->adc_channel);
+            rt_timer_init(&pusher->sample, name, pusher_sample_timeout, pusher,
+                          rt_tick_from_millisecond(PUSHER_SAMPLE_MS),
+                          RT_TIMER_FLAG_PERIODIC | RT_TIMER_FLAG_SOFT_TIMER);
+        }
+    }
+    return RT_EOK;
+}
+
+/*
+ * 走一个单程：到位开关动作返回 RT_EOK。堵转时，这一方向接了到位开关就是
+ * 中途卡住，返回 -RT_EBUSY；没接开关时堵转即顶到端点，返回 RT_EOK。
+ * 超时返回 -RT_ETIMEOUT。起步前到位开关就已闭合时（开关卡死、短路，或上
+ * 一程没走回来）分不清这一程走没走，不动作，返回 -RT_EIO。
+ */
+rt_err_t pusher_stroke(Pusher *pusher, int direction)
+{
+    rt_base_t limit = direction == PUSHER_FORWARD ? pusher->cfg.fwd_limit_pin : pusher->cfg.back_limit_pin;
+    rt_base_t level;
+    rt_uint32_t set = 0;
+    rt_err_t result;
+
+    /* 丢弃上一程残留的事件 */
+    rt_event_recv(&pusher->event, PUSHER_EVENT_END | PUSHER_EVENT_STALL,
+                  RT_EVENT_FLAG_OR | RT_EVENT_FLAG_CLEAR, RT_WAITING_NO, RT_NULL);
+
+    if (limit != PUSHER_PIN_NONE && rt_pin_read(limit) == PIN_LOW)
+    {
+        VLOG_W("Pusher %s limit switch closed before the stroke\n", pusher->name);
+        return -RT_EIO;
+    }
+
+    level = rt_hw_interrupt_disable();
+    pusher->drive = direction == PUSHER_FORWARD ? 1 : -1;
+    pusher->start_tick = rt_tick_get();
+    rt_pin_write(pusher->cfg.in1_pin, direction == PUSHER_FORWARD ? PIN_HIGH : PIN_LOW);
+    rt_pin_write(pusher->cfg.in2_pin, direction == PUSHER_FORWARD ? PIN_LOW : PIN_HIGH);
+    rt_hw_interrupt_enable(level);
+    vend_trace(TRACE_PUSH_DRIVE, pusher->trace_id, direction == PUSHER_FORWARD ? 1 : 2);
+
+    if (pusher->adc != RT_NULL)
+        rt_timer_start(&pusher->sample);
+
+    result = rt_event_recv(&pusher->event, PUSHER_EVENT_END | PUSHER_EVENT_STALL,
+                           RT_EVENT_FLAG_OR | RT_EVENT_FLAG_CLEAR,
+                           rt_tick_from_millisecond(pusher->cfg.timeout_ms), &set);
+
+    if (pusher->adc != RT_NULL)
+        rt_timer_stop(&pusher->sample);
+    pusher_halt(pusher);
+
+    if (result != RT_EOK)
+    {
+        VLOG_W("Pusher %s stroke timeout\n", pusher->name);
+    }
+    else if (!(set & PUSHER_EVENT_END) && limit != PUSHER_PIN_NONE)
+    {
+        VLOG_W("Pusher %s stalled before the limit switch\n", pusher->name);
+        result = -RT_EBUSY;
+    }
+    return result;
+}
@@ -0,0 +1,46 @@
+﻿#ifndef __PUSHER_H__
+#define __PUSHER_H__
+
+#include <rtthread.h>
+#include <rtdevice.h>
+
+#define PUSHER_PIN_NONE       (-1)
+
+#define PUSHER_BACKWARD       0
+#define PUSHER_FORWARD        1
+
+#define PUSHER_EVENT_END      (1 << 0)  // 到位开关动作
+#define PUSHER_EVENT_STALL    (1 << 1)  // 电流超过堵转阈值
+
+#define PUSHER_SAMPLE_MS      10        // 电流采样间隔
+#define PUSHER_INRUSH_MS      100       // 起动冲击电流期间不做堵转判定
+
+/* 推手配置：引脚与阈值按组给出 */
+typedef struct {
+    rt_base_t in1_pin;            // H 桥输入，IN1 高 IN2 低为伸出
+    rt_base_t in2_pin;
+    rt_base_t fwd_limit_pin;      // 伸出到位开关（低有效），PUSHER_PIN_NONE 表示未接
+    rt_base_t back_limit_pin;     // 缩回到位开关
+    const char *adc_name;         // 电机电流采样，RT_NULL 表示不用
+    rt_uint32_t adc_channel;
+    rt_uint32_t stall_threshold;  // 堵转阈值，ADC 原始值
+    rt_uint32_t timeout_ms;       // 单程超时，传感器失效时兜底
+} PusherConfig;
+
+typedef struct {
+    const char *name;
+    PusherConfig cfg;
+
+    /* 以下由 pusher 维护 */
+    rt_adc_device_t adc;
+    rt_uint8_t trace_id;          // 跟踪点里的推手号，按初始化顺序从 0 起
+    volatile rt_int8_t drive;     // 1 伸出，-1 缩回，0 停
+    rt_tick_t start_tick;
+    struct rt_event event;
+    struct rt_timer sample;
+} Pusher;
+
+rt_err_t pusher_init(Pusher *pusher, const char *name, const PusherConfig *cfg);
+rt_err_t pusher_stroke(Pusher *pusher, int direction);
+
+#endif
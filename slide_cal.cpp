@@ -0,0 +1,167 @@
+﻿#include "slide_cal.h"
+#include <fal.h>
+#include <string.h>
+
+/*
+ * 闪存中的滑台位置校准表。
+ *
+ * 整张表（各组的位置，以步计）连同版本号、代数和 CRC 存成一条，分区的
+ * 前两块轮流写：每次保存擦除代数较老的那块再写新表，写到一半断电时另
+ * 一块仍是完整的旧表。启动时取两块中 CRC 正确、代数较大的一份；版本号
+ * 与固件不符的表不采用，各组回到固件里的默认位置。
+ */
+
+#define CAL_MAGIC           0x314C4143  // "CAL1"
+
+typedef struct {
+    rt_uint32_t magic;
+    rt_uint16_t version;
+    rt_uint16_t points;                 // 每组的位置数
+    rt_uint32_t generation;
+    rt_uint16_t lanes;                  // 有校准值的组（按组号的位图）
+    rt_uint16_t counts[SLIDE_CAL_LANES];    // 各组校准时的位置数
+    rt_uint16_t reserved;
+    rt_int32_t positions[SLIDE_CAL_LANES][SLIDE_CAL_POINTS];
+    rt_uint32_t crc;                    // 前面各字段的 CRC-32
+} CalTable;
+
+static const struct fal_partition *cal_part = RT_NULL;
+static rt_uint32_t cal_block_size;
+static int cal_block = -1;              // 当前表所在的块，-1 为没有
+static CalTable cal_table;
+static struct rt_semaphore cal_lock;
+
+static rt_uint32_t cal_crc32(const rt_uint8_t *data, rt_size_t len)
+{
+    rt_uint32_t crc = 0xFFFFFFFF;
+
+    while (len--)
+    {
+        crc ^= *data++;
+        for (int i = 0; i < 8; i++)
+            crc = crc & 1 ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+    }
+    return ~crc;
+}
+
+/* 读一块里的表：不完整或 CRC 不对返回 -RT_ERROR */
+static rt_err_t cal_read(int block, CalTable *table)
+{
+    if (fal_partition_read(cal_part, block * cal_block_size, (rt_uint8_t *)table,
+                           sizeof(*table)) != sizeof(*table))
+        return -RT_EIO;
+    if (table->magic != CAL_MAGIC ||
+        table->crc != cal_crc32((const rt_uint8_t *)table, offsetof(CalTable, crc)))
+        return -RT_ERROR;
+    return RT_EOK;
+}
+
+/* 挂载分区，取两块中较新的完整表 */
+rt_err_t slide_cal_init(const char *partition)
+{
+    const struct fal_flash_dev *flash;
+    CalTable table;
+
+    cal_part = fal_partition_find(partition);
+    if (cal_part == RT_NULL)
+    {
+        rt_kprintf("Partition %s not found!\n", partition);
+        return -RT_ERROR;
+    }
+    flash = fal_flash_device_find(cal_part->flash_name);
+    if (flash == RT_NULL)
+        return -RT_ERROR;
+    cal_block_size = flash->blk_size;
+    if (cal_part->len < 2 * cal_block_size || sizeof(CalTable) > cal_block_size)
+    {
+        rt_kprintf("Partition %s needs at least 2 blocks\n", partition);
+        return -RT_ERROR;
+    }
+
+    rt_sem_init(&cal_lock, "slidecal", 1, RT_IPC_FLAG_FIFO);
+
+    memset(&cal_table, 0, sizeof(cal_table));
+    cal_block = -1;
+    for (int b = 0; b < 2; b++)
+    {
+        if (cal_read(b, &table) != RT_EOK)
+            continue;
+        if (cal_block < 0 || table.generation > cal_table.generation)
+        {
+            cal_table = table;
+            cal_block = b;
+        }
+    }
+
+    if (cal_block >= 0 && cal_table.version != SLIDE_CAL_VERSION)
+    {
+        rt_kprintf("Slide calibration v%d ignored, firmware expects v%d\n",
+                   cal_table.version, SLIDE_CAL_VERSION);
+        cal_table.lanes = 0;
+    }
+    return RT_EOK;
+}
+
+rt_bool_t slide_cal_get(int lane, rt_int32_t *positions, int count)
+{
+    rt_bool_t found = RT_FALSE;
+
+    if (cal_part == RT_NULL || lane < 1 || lane > SLIDE_CAL_LANES || count > SLIDE_CAL_POINTS)
+        return RT_FALSE;
+
+    rt_sem_take(&cal_lock, RT_WAITING_FOREVER);
+    if ((cal_table.lanes & (1u << (lane - 1))) && cal_table.counts[lane - 1] == count)
+    {
+        memcpy(positions, cal_table.positions[lane - 1], count * sizeof(rt_int32_t));
+        found = RT_TRUE;
+    }
+    rt_sem_release(&cal_lock);
+    return found;
+}
+
+rt_err_t slide_cal_save(int lane, const rt_int32_t *positions, int count)
+{
+    CalTable table;
+    int next;
+    rt_err_t result = RT_EOK;
+
+    if (cal_part == RT_NULL || lane < 1 || lane > SLIDE_CAL_LANES ||
+        count < 1 || count > SLIDE_CAL_POINTS)
+        return -RT_EINVAL;
+
+    rt_sem_take(&cal_lock, RT_WAITING_FOREVER);
+    table = cal_table;
+    table.magic = CAL_MAGIC;
+    table.version = SLIDE_CAL_VERSION;
+    table.points = SLIDE_CAL_POINTS;
+    table.generation++;
+    table.lanes |= 1u << (lane - 1);
+    table.counts[lane - 1] = (rt_uint16_t)count;
+    table.reserved = 0;
+    memset(table.positions[lane - 1], 0, sizeof(table.positions[lane - 1]));
+    memcpy(table.positions[lane - 1], positions, count * sizeof(rt_int32_t));
+    table.crc = cal_crc32((const rt_uint8_t *)&table, offsetof(CalTable, crc));
+
+    /* 写到当前表之外的那块，写完之前断电仍用旧表 */
+    next = cal_block == 0 ? 1 : 0;
+    if (fal_partition_erase(cal_part, next * cal_block_size, cal_block_size) < 0 ||
+        fal_partition_write(cal_part, next * cal_block_size, (const rt_uint8_t *)&table,
+                            sizeof(table)) != sizeof(table))
+    {
+        result = -RT_EIO;
+    }
+    else
+    {
+        cal_table = table;
+        cal_block = next;
+    }
+    rt_sem_release(&cal_lock);
+    return result;
+}
+
+void slide_cal_get_info(SlideCalInfo *info)
+{
+    info->generation = cal_table.generation;
+    info->version = cal_table.version;
+    info->lanes = cal_table.lanes;
+}
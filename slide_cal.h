@@ -0,0 +1,26 @@
+﻿#ifndef __SLIDE_CAL_H__
+#define __SLIDE_CAL_H__
+
+#include <rtthread.h>
+
+#define SLIDE_CAL_PARTITION   "slidecal"
+#define SLIDE_CAL_VERSION     1     // 表结构改动时加一，旧版本的表不再采用
+#define SLIDE_CAL_LANES       4     // 最多几组，编号从 1 开始
+#define SLIDE_CAL_POINTS      8     // 每组最多几个位置
+
+typedef struct {
+    rt_uint32_t generation;         // 已保存的次数，0 为从未保存
+    rt_uint16_t version;            // 闪存里表的版本
+    rt_uint16_t lanes;              // 有校准值的组（按组号的位图）
+} SlideCalInfo;
+
+rt_err_t slide_cal_init(const char *partition);
+
+/* 本组的校准值；没有校准过或位置数不同时返回 RT_FALSE */
+rt_bool_t slide_cal_get(int lane, rt_int32_t *positions, int count);
+/* 换下本组的校准值，写成新的一份表 */
+rt_err_t slide_cal_save(int lane, const rt_int32_t *positions, int count);
+
+void slide_cal_get_info(SlideCalInfo *info);
+
+#endif
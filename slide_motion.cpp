@@ -0,0 +1,339 @@
+﻿#include "slide_motion.h"
+#include "vend_trace.h"
+
+/*
+ * 滑台梯形加减速与定步数运动。
+ *
+ * 各通道设为 PWM 模式 2，高电平在周期后半段，TIM2 的更新事件正好是一个脉冲
+ * 的结束。更新中断里给运行中的轴各记一步，计的就是 TIM2 实际发出的脉冲；走满
+ * 指定步数就在下一个脉冲之前关掉通道，因此停止位置只取决于步数，与线程调度
+ * 无关。随后按 v² = v0² + 2a·s 逐步算出下一步的速度，直接改写 ARR 和 CCRx：
+ * 不开预装载，写入对刚开始的这个周期生效；短行程自然退化为三角形曲线。
+ *
+ * rt_pwm_set 会重新选预分频并产生更新事件，只在初始化时调用一次，按各轴最低
+ * 的起停速度定下 PSC，再由驱动算出的 ARR 折算出计数时钟。
+ *
+ * 同一 PWM 设备（同一个 TIM）的各通道共用一个周期寄存器，所有运行中的轴
+ * 共用一条速度曲线，取各轴限速的最小值；新加入的轴先把速度降到自己的起停
+ * 速度以下，再在脉冲边界上开通道，避免失步。
+ *
+ * 运动中可以随时请求停止（如回零开关的中断）：把剩余步数缩短到当前速度
+ * 下的刹车距离，照常减速停下，不失步，停下的位置仍可按步数推算。
+ */
+
+#define SLIDE_IDLE      0
+#define SLIDE_PENDING   1   // 已下发，等待速度降到起停速度后开通道
+#define SLIDE_RUNNING   2
+
+static rt_bool_t slide_tim_running = RT_FALSE;
+static rt_uint32_t slide_count_hz = 0;    // TIM2 预分频后的计数时钟
+static rt_uint32_t slide_min_speed = 0;   // 选预分频时用的最低起停速度
+static rt_uint64_t slide_speed2 = 0;      // 当前速度的平方，逐步累加以免取整卡住
+static rt_uint32_t slide_period = 0;      // 当前脉冲周期，计数值（ARR + 1）
+static SlideAxis *slide_axes[SLIDE_AXIS_MAX];
+static int slide_axis_count = 0;
+
+static rt_uint32_t slide_isqrt(rt_uint64_t x)
+{
+    rt_uint64_t r = 0, bit = (rt_uint64_t)1 << 62;
+
+    while (bit > x)
+        bit >>= 2;
+    while (bit)
+    {
+        if (x >= r + bit)
+        {
+            x -= r + bit;
+            r = (r >> 1) + bit;
+        }
+        else
+        {
+            r >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (rt_uint32_t)r;
+}
+
+static volatile rt_uint32_t *slide_ccr(int channel)
+{
+    return &SLIDE_PWM_TIM->CCR1 + (channel - 1);
+}
+
+/* 按剩余步数允许的最高速度（平方）：以 accel 减速，最后一步正好回到 start_speed */
+static rt_uint64_t slide_brake_speed2(const SlideAxis *axis)
+{
+    rt_uint64_t v0 = axis->profile.start_speed;
+
+    return v0 * v0 + 2 * (rt_uint64_t)axis->profile.accel * (axis->remaining - 1);
+}
+
+/* 排下一个脉冲：pulsed 表示刚过去的周期里各运行中的通道都发出了一个脉冲 */
+static void slide_schedule(rt_bool_t pulsed)
+{
+    rt_uint64_t target2 = (rt_uint64_t)-1;
+    rt_uint32_t join = 0xFFFFFFFF;
+    rt_uint32_t accel = 0xFFFFFFFF;
+    rt_uint64_t speed2;
+    rt_uint32_t speed, period;
+    rt_bool_t running = RT_FALSE, pending = RT_FALSE;
+    int i;
+
+    for (i = 0; i < slide_axis_count; i++)
+    {
+        SlideAxis *axis = slide_axes[i];
+
+        if (axis->state == SLIDE_RUNNING)
+        {
+            if (pulsed)
+                axis->moved++;
+            if (pulsed && --axis->remaining == 0)
+            {
+                rt_pwm_disable(axis->pwm, axis->channel);
+                vend_trace(TRACE_PWM_OFF, (rt_uint8_t)i, 0);
+                axis->state = SLIDE_IDLE;
+                rt_event_send(&axis->done, SLIDE_EVENT_DONE);
+                continue;
+            }
+
+            running = RT_TRUE;
+            if ((rt_uint64_t)axis->speed_limit * axis->speed_limit < target2)
+                target2 = (rt_uint64_t)axis->speed_limit * axis->speed_limit;
+            if (slide_brake_speed2(axis) < target2)
+                target2 = slide_brake_speed2(axis);
+            if (axis->profile.accel < accel)
+                accel = axis->profile.accel;
+        }
+        else if (axis->state == SLIDE_PENDING)
+        {
+            pending = RT_TRUE;
+            if (axis->profile.start_speed < join)
+                join = axis->profile.start_speed;
+        }
+    }
+
+    if (!running && !pending)
+    {
+        /* 通道全部关闭后驱动停掉计数器，不再有更新中断 */
+        slide_speed2 = 0;
+        slide_period = 0;
+        slide_tim_running = RT_FALSE;
+        return;
+    }
+
+    if (!running)
+    {
+        /* 设备静止，直接以起停速度起步 */
+        speed2 = (rt_uint64_t)join * join;
+    }
+    else
+    {
+        /* 每走一步 v² 最多增加 2a；刹车曲线本身已按 accel 收敛，直接跟随 */
+        rt_uint64_t dv2 = 2 * (rt_uint64_t)accel;
+
+        speed2 = slide_speed2 + dv2;
+        if (target2 < speed2)
+            speed2 = target2;
+
+        /* 有轴等待加入时平缓降到其起停速度 */
+        if (pending)
+        {
+            rt_uint64_t join2 = (rt_uint64_t)join * join;
+            rt_uint64_t floor2 = slide_speed2 > join2 + dv2 ? slide_speed2 - dv2 : join2;
+            if (floor2 < speed2)
+                speed2 = floor2;
+        }
+    }
+
+    speed = slide_isqrt(speed2);
+    period = (slide_count_hz + speed / 2) / speed;
+    if (period > 0x10000)
+        period = 0x10000;
+    slide_speed2 = speed2;
+
+    /* 计数器停着时从 0 起步，第一个脉冲也是整周期 */
+    if (!slide_tim_running)
+        SLIDE_PWM_TIM->CNT = 0;
+    if (period != slide_period)
+        SLIDE_PWM_TIM->ARR = period - 1;
+
+    for (i = 0; i < slide_axis_count; i++)
+    {
+        SlideAxis *axis = slide_axes[i];
+
+        if (axis->state == SLIDE_IDLE)
+            continue;
+        if (axis->state == SLIDE_PENDING && speed > axis->profile.start_speed)
+            continue;
+        if (axis->state == SLIDE_RUNNING && period == slide_period)
+            continue;
+
+        *slide_ccr(axis->channel) = period / 2;
+        if (axis->state == SLIDE_PENDING)
+        {
+            rt_uint32_t period_us = (rt_uint32_t)((rt_uint64_t)period * 1000000 / slide_count_hz);
+
+            rt_pwm_enable(axis->pwm, axis->channel);
+            vend_trace(TRACE_PWM_ON, (rt_uint8_t)i, period_us > 0xFFFF ? 0xFFFF : (rt_uint16_t)period_us);
+            axis->state = SLIDE_RUNNING;
+        }
+    }
+    slide_period = period;
+    slide_tim_running = RT_TRUE;
+}
+
+/* TIM2 更新中断：刚结束的周期里各运行中的通道都发完了一个脉冲 */
+extern "C" void SLIDE_PWM_IRQHandler(void)
+{
+    rt_interrupt_enter();
+    if (SLIDE_PWM_TIM->SR & TIM_SR_UIF)
+    {
+        SLIDE_PWM_TIM->SR &= ~TIM_SR_UIF;
+        slide_schedule(RT_TRUE);
+    }
+    rt_interrupt_leave();
+}
+
+rt_err_t slide_motion_init(void)
+{
+    rt_base_t level;
+
+    if (rt_device_find(SLIDE_PWM_NAME) == RT_NULL)
+    {
+        rt_kprintf("PWM device %s not found!\n", SLIDE_PWM_NAME);
+        return -RT_ENOSYS;
+    }
+
+    /* ARR 不预装载，中断里改写的周期立即生效 */
+    level = rt_hw_interrupt_disable();
+    SLIDE_PWM_TIM->CR1 &= ~TIM_CR1_ARPE;
+    SLIDE_PWM_TIM->SR &= ~TIM_SR_UIF;
+    SLIDE_PWM_TIM->DIER |= TIM_DIER_UIE;
+    rt_hw_interrupt_enable(level);
+    NVIC_EnableIRQ(SLIDE_PWM_IRQn);
+    return RT_EOK;
+}
+
+/* 所有轴须是 SLIDE_PWM_NAME 的通道，由它的更新中断同步 */
+rt_err_t slide_axis_init(SlideAxis *axis, const char *pwm_name, int channel,
+                         const SlideProfile *profile)
+{
+    struct rt_device_pwm *pwm;
+    volatile rt_uint32_t *ccmr;
+    rt_uint32_t shift;
+    rt_base_t level;
+
+    if (slide_axis_count >= SLIDE_AXIS_MAX)
+        return -RT_EFULL;
+    if (channel < 1 || channel > 4 || profile->start_speed == 0)
+        return -RT_EINVAL;
+
+    pwm = (struct rt_device_pwm *)rt_device_find(pwm_name);
+    if (pwm == RT_NULL)
+    {
+        rt_kprintf("PWM device %s not found!\n", pwm_name);
+        return -RT_ENOSYS;
+    }
+    if (rt_strcmp(pwm_name, SLIDE_PWM_NAME) != 0)
+    {
+        rt_kprintf("Slide axes must be channels of %s\n", SLIDE_PWM_NAME);
+        return -RT_EINVAL;
+    }
+
+    level = rt_hw_interrupt_disable();
+    if (slide_count_hz == 0 || profile->start_speed < slide_min_speed)
+    {
+        /* 让驱动按最慢的周期选预分频，再由 ARR 折回以 MHz 为单位的定时器时钟 */
+        rt_uint32_t period_ns = 1000000000UL / profile->start_speed;
+        rt_uint32_t psc, clock_mhz;
+
+        rt_pwm_set(pwm, channel, period_ns, period_ns / 2);
+        SLIDE_PWM_TIM->SR &= ~TIM_SR_UIF;
+        psc = SLIDE_PWM_TIM->PSC + 1;
+        clock_mhz = (rt_uint32_t)(((rt_uint64_t)(SLIDE_PWM_TIM->ARR + 1) * psc * 1000 + period_ns / 2) / period_ns);
+        slide_count_hz = clock_mhz * 1000000UL / psc;
+        slide_min_speed = profile->start_speed;
+    }
+
+    /* PWM 模式 2，关闭 CCRx 预装载 */
+    ccmr = channel <= 2 ? &SLIDE_PWM_TIM->CCMR1 : &SLIDE_PWM_TIM->CCMR2;
+    shift = (channel - 1) % 2 * 8;
+    *ccmr = (*ccmr & ~((TIM_CCMR1_OC1M | TIM_CCMR1_OC1PE) << shift)) | (TIM_CCMR1_OC1M << shift);
+    rt_hw_interrupt_enable(level);
+
+    axis->pwm = pwm;
+    axis->pwm_name = pwm_name;
+    axis->channel = channel;
+    axis->profile = *profile;
+    axis->state = SLIDE_IDLE;
+    axis->remaining = 0;
+    axis->moved = 0;
+    axis->stopped_at = -1;
+    rt_event_init(&axis->done, "slide", RT_IPC_FLAG_FIFO);
+
+    slide_axes[slide_axis_count++] = axis;
+    return RT_EOK;
+}
+
+/* 走 steps 步并等待结束，返回实际走的步数；max_speed 为 0 时用曲线的巡航速度 */
+rt_int32_t slide_axis_move(SlideAxis *axis, rt_int32_t steps, rt_uint32_t max_speed)
+{
+    rt_base_t level;
+
+    if (steps <= 0 || slide_count_hz == 0)
+    {
+        /* 没有走，不能留着上一次运动的停止点 */
+        axis->moved = 0;
+        axis->stopped_at = -1;
+        return 0;
+    }
+
+    if (max_speed == 0 || max_speed > axis->profile.max_speed)
+        max_speed = axis->profile.max_speed;
+    if (max_speed < axis->profile.start_speed)
+        max_speed = axis->profile.start_speed;
+
+    level = rt_hw_interrupt_disable();
+    axis->remaining = steps;
+    axis->moved = 0;
+    axis->stopped_at = -1;
+    axis->speed_limit = max_speed;
+    axis->state = SLIDE_PENDING;
+    /* 计数器停着时立即起步，否则在下一个脉冲边界加入 */
+    if (!slide_tim_running)
+        slide_schedule(RT_FALSE);
+    rt_hw_interrupt_enable(level);
+
+    rt_event_recv(&axis->done, SLIDE_EVENT_DONE, RT_EVENT_FLAG_OR | RT_EVENT_FLAG_CLEAR,
+                  RT_WAITING_FOREVER, RT_NULL);
+    return axis->moved;
+}
+
+/*
+ * 请求停止：按当前速度减速到起停速度后停下，已在起停速度时下一步即停。
+ * 可在中断中调用；尚未开通道的轴直接结束，轴空闲时不做任何事。
+ */
+void slide_axis_stop(SlideAxis *axis)
+{
+    rt_base_t level = rt_hw_interrupt_disable();
+
+    if (axis->state == SLIDE_RUNNING && axis->stopped_at < 0)
+    {
+        rt_uint64_t v0 = axis->profile.start_speed;
+        rt_int32_t brake = 1;
+
+        if (slide_speed2 > v0 * v0)
+            brake += (rt_int32_t)((slide_speed2 - v0 * v0) / (2 * (rt_uint64_t)axis->profile.accel));
+        if (brake < axis->remaining)
+            axis->remaining = brake;
+        axis->stopped_at = axis->moved;
+    }
+    else if (axis->state == SLIDE_PENDING)
+    {
+        axis->state = SLIDE_IDLE;
+        axis->remaining = 0;
+        axis->stopped_at = 0;
+        rt_event_send(&axis->done, SLIDE_EVENT_DONE);
+    }
+    rt_hw_interrupt_enable(level);
+}
@@ -0,0 +1,47 @@
+﻿#ifndef __SLIDE_MOTION_H__
+#define __SLIDE_MOTION_H__
+
+#include <rtthread.h>
+#include <rtdevice.h>
+#include <board.h>
+
+/* 步进脉冲：各轴是 pwm2（TIM2）的通道，TIM2 的更新中断即一个脉冲结束 */
+#define SLIDE_PWM_NAME        "pwm2"
+#define SLIDE_PWM_TIM         TIM2
+#define SLIDE_PWM_IRQn        TIM2_IRQn
+#define SLIDE_PWM_IRQHandler  TIM2_IRQHandler
+
+#define SLIDE_EVENT_DONE      (1 << 0)  // 走完指定步数
+
+#define SLIDE_AXIS_MAX        4
+
+/* 滑台速度曲线参数（梯形加减速） */
+typedef struct {
+    rt_uint32_t start_speed;  // 起停速度，步/s：不超过它可直接启停而不失步
+    rt_uint32_t max_speed;    // 巡航速度上限，步/s
+    rt_uint32_t accel;        // 加速度与减速度，步/s²
+} SlideProfile;
+
+/* 单个滑台轴：PWM 通道输出步进脉冲，方向脚由调用者设置 */
+typedef struct {
+    const char *pwm_name;
+    int channel;
+    SlideProfile profile;
+
+    /* 以下由 slide_motion 维护 */
+    struct rt_device_pwm *pwm;
+    volatile rt_uint8_t state;
+    rt_int32_t remaining;     // 还要发出的脉冲数
+    rt_int32_t moved;         // 本次运动已发出的脉冲数
+    rt_int32_t stopped_at;    // 请求停止时已发出的脉冲数，未请求为 -1
+    rt_uint32_t speed_limit;  // 本次运动的速度上限，步/s
+    struct rt_event done;
+} SlideAxis;
+
+rt_err_t slide_motion_init(void);
+rt_err_t slide_axis_init(SlideAxis *axis, const char *pwm_name, int channel,
+                         const SlideProfile *profile);
+rt_int32_t slide_axis_move(SlideAxis *axis, rt_int32_t steps, rt_uint32_t max_speed);
+void slide_axis_stop(SlideAxis *axis);
+
+#endif
@@ -0,0 +1,209 @@
+﻿#include "slide_pos.h"
+#include "flash_log.h"
+#include <string.h>
+
+/*
+ * 闪存中的滑台位置日志，上电时据此跳过回零。
+ *
+ * 每次运动前先追加一条 MOVING，停稳后追加一条 STOP（带位置）。启动时
+ * 重放日志，某轴最后一条是 STOP 才信任其位置；运动中断电、复位时最后
+ * 一条是 MOVING，该轴须回零。两条记录各一次页编程，不擦除。
+ *
+ * 与库存日志共用 flash_log 的块轮换：每块块头之后是各轴当前状态的快照，
+ * 以 SNAP_END 结束，其后逐条追加。启动时按代数从新到旧取第一个快照完整
+ * 的块。擦除只在 STOP 时做，并给各轴的 MOVING 留出空位，运动开始前不会
+ * 碰上擦除。
+ */
+
+#define POS_MAGIC           0x32534F50  // "POS2"，POS1 的块没有 SNAP_END
+
+/* 记录类型 */
+#define POS_REC_HEADER      FLASH_LOG_HEADER    // 块头：value 为代数，pos 为魔数
+#define POS_REC_MOVING      0x02        // 开始运动，之前的位置作废
+#define POS_REC_STOP        0x03        // 停稳，pos 为位置（步）
+#define POS_REC_SNAP_END    0x04        // 快照结束
+
+/* flash_log 的一条记录，FLASH_LOG_RECORD_SIZE 字节 */
+typedef struct {
+    rt_uint8_t kind;
+    rt_uint8_t axis;
+    rt_uint16_t reserved;
+    rt_uint32_t value;
+    rt_int32_t pos;
+    rt_uint16_t reserved2;
+    rt_uint16_t crc;                    // 前 14 字节的 CRC-16/CCITT
+} PosRecord;
+
+/* 每轴最后一条记录 */
+typedef struct {
+    rt_uint8_t kind;                    // 0 为从未记过
+    rt_int32_t pos;
+} PosAxis;
+
+static FlashLog pos_log;
+static rt_bool_t pos_snapshot_end;      // 重放时见到了 SNAP_END
+
+static PosAxis pos_axes[SLIDE_POS_AXES];
+static struct rt_semaphore pos_lock;
+
+static void log_record(PosRecord *rec, rt_uint8_t kind, int axis, rt_int32_t pos)
+{
+    memset(rec, 0, sizeof(*rec));
+    rec->kind = kind;
+    rec->axis = (rt_uint8_t)axis;
+    rec->pos = pos;
+}
+
+/* 快照：记过的各轴依次排下来，以 SNAP_END 结束 */
+static rt_bool_t log_snapshot(rt_uint32_t index, void *rec)
+{
+    for (int a = 0; a < SLIDE_POS_AXES; a++)
+    {
+        if (pos_axes[a].kind == 0)
+            continue;
+        if (index-- == 0)
+        {
+            log_record((PosRecord *)rec, pos_axes[a].kind, a + 1, pos_axes[a].pos);
+            return RT_TRUE;
+        }
+    }
+    if (index > 0)
+        return RT_FALSE;
+    log_record((PosRecord *)rec, POS_REC_SNAP_END, 0, 0);
+    return RT_TRUE;
+}
+
+/* 追加一条，当前块剩余不足 reserve 条时先换块 */
+static rt_err_t log_append(PosRecord *rec, rt_uint32_t reserve)
+{
+    return flash_log_append(&pos_log, rec, reserve, log_snapshot);
+}
+
+static void log_apply(const void *data)
+{
+    const PosRecord *rec = (const PosRecord *)data;
+
+    if (rec->kind == POS_REC_SNAP_END)
+    {
+        pos_snapshot_end = RT_TRUE;
+        return;
+    }
+    if (rec->axis < 1 || rec->axis > SLIDE_POS_AXES ||
+        (rec->kind != POS_REC_MOVING && rec->kind != POS_REC_STOP))
+        return;
+    pos_axes[rec->axis - 1].kind = rec->kind;
+    pos_axes[rec->axis - 1].pos = rec->pos;
+}
+
+/* 重放一块：快照不完整返回 -RT_ERROR；遇到残缺记录时 *torn 置位 */
+static rt_err_t log_replay(int block, rt_bool_t *torn)
+{
+    rt_uint32_t slot;
+
+    memset(pos_axes, 0, sizeof(pos_axes));
+    pos_snapshot_end = RT_FALSE;
+    slot = flash_log_replay(&pos_log, block, log_apply, torn);
+    if (!pos_snapshot_end)
+        return -RT_ERROR;
+    pos_log.block = block;
+    pos_log.slot = slot;
+    return RT_EOK;
+}
+
+/* 挂载分区并重放日志；没有可用的块时格式化，各轴都须回零 */
+rt_err_t slide_pos_init(const char *partition)
+{
+    rt_uint32_t generation = 0;
+    int block = -1;
+    rt_bool_t torn = RT_FALSE;
+    rt_err_t result = -RT_ERROR;
+
+    if (flash_log_open(&pos_log, partition, POS_MAGIC) != RT_EOK)
+        return -RT_ERROR;
+
+    rt_sem_init(&pos_lock, "slidepos", 1, RT_IPC_FLAG_FIFO);
+
+    /* 按代数从新到旧尝试，取第一个快照完整的块 */
+    while (result != RT_EOK && flash_log_older(&pos_log, &block, &generation))
+    {
+        pos_log.generation = generation;
+        result = log_replay(block, &torn);
+    }
+
+    if (result != RT_EOK)
+    {
+        memset(pos_axes, 0, sizeof(pos_axes));
+        pos_log.block = pos_log.blocks - 1;
+        pos_log.generation = 0;
+        torn = RT_TRUE;
+    }
+
+    /* 残缺记录之后不能再写，换一块重写各轴状态 */
+    if (torn && flash_log_compact(&pos_log, log_snapshot) != RT_EOK)
+    {
+        rt_kprintf("Slide position log write failed\n");
+        return -RT_EIO;
+    }
+    return RT_EOK;
+}
+
+rt_bool_t slide_pos_saved(int axis, rt_int32_t *pos)
+{
+    if (pos_log.part == RT_NULL || axis < 1 || axis > SLIDE_POS_AXES ||
+        pos_axes[axis - 1].kind != POS_REC_STOP)
+        return RT_FALSE;
+    *pos = pos_axes[axis - 1].pos;
+    return RT_TRUE;
+}
+
+rt_err_t slide_pos_begin(int axis)
+{
+    PosRecord rec;
+    rt_err_t result = RT_EOK;
+
+    if (axis < 1 || axis > SLIDE_POS_AXES)
+        return -RT_ERROR;
+    /* 没有日志分区：没有存着的位置要作废，启动时总是回零 */
+    if (pos_log.part == RT_NULL)
+        return RT_EOK;
+
+    rt_sem_take(&pos_lock, RT_WAITING_FOREVER);
+    if (pos_axes[axis - 1].kind != POS_REC_MOVING)
+    {
+        log_record(&rec, POS_REC_MOVING, axis, 0);
+        result = log_append(&rec, 0);
+        if (result == RT_EOK)
+            pos_axes[axis - 1].kind = POS_REC_MOVING;
+    }
+    rt_sem_release(&pos_lock);
+    return result;
+}
+
+rt_err_t slide_pos_commit(int axis, rt_int32_t pos)
+{
+    PosRecord rec;
+    rt_err_t result;
+
+    if (pos_log.part == RT_NULL || axis < 1 || axis > SLIDE_POS_AXES)
+        return -RT_ERROR;
+
+    rt_sem_take(&pos_lock, RT_WAITING_FOREVER);
+    log_record(&rec, POS_REC_STOP, axis, pos);
+    /* 给各轴下一次的 MOVING 留位置 */
+    result = log_append(&rec, SLIDE_POS_AXES);
+    if (result == RT_EOK)
+    {
+        pos_axes[axis - 1].kind = POS_REC_STOP;
+        pos_axes[axis - 1].pos = pos;
+    }
+    rt_sem_release(&pos_lock);
+    return result;
+}
+
+void slide_pos_get_info(SlidePosInfo *info)
+{
+    info->generation = pos_log.generation;
+    info->block = pos_log.block;
+    info->used = pos_log.slot;
+    info->capacity = pos_log.part != RT_NULL ? flash_log_slots(&pos_log) : 0;
+}
@@ -0,0 +1,29 @@
+﻿#ifndef __SLIDE_POS_H__
+#define __SLIDE_POS_H__
+
+#include <rtthread.h>
+
+#define SLIDE_POS_PARTITION   "slidepos"
+#define SLIDE_POS_AXES        4     // 最多几个滑台轴，编号从 1 开始
+
+/* 日志占用情况 */
+typedef struct {
+    rt_uint32_t generation;         // 当前块的代数，每换一块加一
+    int block;                      // 当前写入的块
+    rt_uint32_t used;               // 当前块已用的记录数
+    rt_uint32_t capacity;           // 每块可存的记录数
+} SlidePosInfo;
+
+rt_err_t slide_pos_init(const char *partition);
+
+/* 上次停稳时记下的位置；之后动过而没有停稳记录（运动中断电）时返回 RT_FALSE */
+rt_bool_t slide_pos_saved(int axis, rt_int32_t *pos);
+
+/* 运动前调用：先作废已存的位置，再开始运动；失败时不能运动 */
+rt_err_t slide_pos_begin(int axis);
+/* 停稳后调用：记下新位置 */
+rt_err_t slide_pos_commit(int axis, rt_int32_t pos);
+
+void slide_pos_get_info(SlidePosInfo *info);
+
+#endif
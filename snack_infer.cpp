@@ -0,0 +1,958 @@
+﻿#include "snack_infer.h"
+
+#include <math.h>
+#include <string.h>
+
+/*
+ * 初始化时做三件事：
+ *   1. 按 tflite 的 flatbuffer 格式解析出张量和算子表，常量张量直接指向模型
+ *      数据，不拷贝；
+ *   2. 卷积后面紧跟一个只被它用到的最大池化时把两者融合：卷积每算出池化
+ *      窗口那么高的几行就地池化掉，卷积的整张输出（本模型第一层为 565 KB）
+ *      不再需要存放；RESHAPE 的输出与输入共用一块；
+ *   3. 按每块缓冲的生存区间（从产生它的算子到最后一个用它的算子）贪心分配
+ *      arena 偏移：先放大的，每块放在与它生存期重叠的各块之间最低的空位。
+ * 运行时只按算子表依次执行，所有缓冲都在 arena 里。
+ */
+
+/* tflite 内置算子编号 */
+#define TFL_CONV_2D             3
+#define TFL_FULLY_CONNECTED     9
+#define TFL_MAX_POOL_2D         17
+#define TFL_RESHAPE             22
+#define TFL_SOFTMAX             25
+
+/* tflite 张量类型 */
+#define TFL_FLOAT32             0
+#define TFL_INT32               2
+#define TFL_INT8                9
+
+#define TFL_PADDING_VALID       1
+#define TFL_ACT_NONE            0
+#define TFL_ACT_RELU            1
+
+#define ARENA_ALIGN             16
+#define ALIGNED_ARENA           __attribute__((aligned(ARENA_ALIGN)))
+#define PLAN_MAX                (SNACK_TENSORS_MAX + SNACK_OPS_MAX)
+
+static ALIGNED_ARENA uint8_t arena[SNACK_ARENA_SIZE];
+
+static SnackTensor tensors[SNACK_TENSORS_MAX];
+static SnackOp ops[SNACK_OPS_MAX];
+static int tensor_count = 0;
+static int op_count = 0;
+static int input_tensor = -1;
+static int output_tensor = -1;
+static int alias_of[SNACK_TENSORS_MAX];     // RESHAPE 的输出与哪个张量共用缓冲
+static SnackInfo info;
+static int ready = 0;
+
+/* ---------------------------------------------------------------- flatbuffer */
+
+static const uint8_t *fb_base;
+static size_t fb_size;
+static int fb_ok;
+
+static uint32_t fb_read(size_t off, int bytes)
+{
+    uint32_t v = 0;
+    int i;
+
+    if (off + bytes > fb_size)
+    {
+        fb_ok = 0;
+        return 0;
+    }
+    for (i = bytes - 1; i >= 0; i--)
+        v = (v << 8) | fb_base[off + i];
+    return v;
+}
+
+/* 表中第 field 个字段的绝对偏移，字段不存在时返回 0 */
+static size_t fb_field(size_t table, int field)
+{
+    size_t vtable;
+    uint16_t vsize, slot;
+
+    if (table == 0)
+        return 0;
+    vtable = table - (int32_t)fb_read(table, 4);
+    vsize = (uint16_t)fb_read(vtable, 2);
+    if (4 + 2 * field >= vsize)
+        return 0;
+    slot = (uint16_t)fb_read(vtable + 4 + 2 * field, 2);
+    return slot ? table + slot : 0;
+}
+
+static size_t fb_deref(size_t off)
+{
+    return off ? off + fb_read(off, 4) : 0;
+}
+
+static size_t fb_subtable(size_t table, int field)
+{
+    return fb_deref(fb_field(table, field));
+}
+
+/* 向量字段：返回元素个数，*data 为首元素的偏移 */
+static uint32_t fb_vector(size_t table, int field, size_t *data)
+{
+    size_t vec = fb_subtable(table, field);
+    uint32_t n;
+
+    *data = 0;
+    if (vec == 0)
+        return 0;
+    n = fb_read(vec, 4);
+    *data = vec + 4;
+    return n;
+}
+
+static int32_t fb_scalar(size_t table, int field, int bytes, int32_t def)
+{
+    size_t off = fb_field(table, field);
+    uint32_t v;
+
+    if (off == 0)
+        return def;
+    v = fb_read(off, bytes);
+    if (bytes == 1)
+        return (int8_t)v;
+    return (int32_t)v;
+}
+
+static float fb_float(size_t table, int field, float def)
+{
+    size_t off = fb_field(table, field);
+    uint32_t v;
+    float f;
+
+    if (off == 0)
+        return def;
+    v = fb_read(off, 4);
+    memcpy(&f, &v, sizeof(f));
+    return f;
+}
+
+/* 第 i 个 int32 元素 */
+static int32_t fb_index(size_t data, uint32_t i)
+{
+    return (int32_t)fb_read(data + 4 * i, 4);
+}
+
+/* ---------------------------------------------------------------- 解析 */
+
+static int parse_tensor(size_t table, size_t buffers, uint32_t buffer_count, SnackTensor *t)
+{
+    size_t shape, quant, data;
+    uint32_t dims, buffer, i, elems = 1, n;
+    int type = fb_scalar(table, 1, 1, TFL_FLOAT32);
+
+    memset(t, 0, sizeof(*t));
+    t->offset = -1;
+
+    switch (type)
+    {
+    case TFL_FLOAT32: t->type = SNACK_F32; break;
+    case TFL_INT32:   t->type = SNACK_I32; break;
+    case TFL_INT8:    t->type = SNACK_I8; break;
+    default:          return SNACK_EUNSUPPORTED;
+    }
+
+    dims = fb_vector(table, 0, &shape);
+    if (dims > SNACK_DIMS_MAX)
+        return SNACK_EUNSUPPORTED;
+    t->dims = (int)dims;
+    for (i = 0; i < dims; i++)
+    {
+        t->shape[i] = fb_index(shape, i);
+        if (t->shape[i] <= 0 || (uint32_t)t->shape[i] > 0x0FFFFFFFu / elems)
+            return SNACK_EUNSUPPORTED;
+        elems *= (uint32_t)t->shape[i];
+    }
+    t->bytes = elems * (t->type == SNACK_I8 ? 1 : 4);
+
+    /* 0 号缓冲约定为空，有数据的就是常量 */
+    buffer = (uint32_t)fb_scalar(table, 2, 4, 0);
+    if (buffer >= buffer_count)
+        return SNACK_EFORMAT;
+    n = fb_vector(fb_deref(buffers + 4 * buffer), 0, &data);
+    if (n > 0)
+    {
+        if (n != t->bytes || (data & 3) != 0)
+            return SNACK_EFORMAT;
+        t->data = fb_base + data;
+    }
+
+    quant = fb_subtable(table, 4);
+    if (t->type == SNACK_I8)
+    {
+        size_t scales, zero_points;
+        uint32_t count = fb_vector(quant, 2, &scales);
+
+        /* 只支持对称量化的常量权重，按第 0 维（输出通道）或整张量给尺度 */
+        if (t->data == NULL || count == 0 || (scales & 3) != 0 ||
+            fb_scalar(quant, 6, 4, 0) != 0 ||
+            (count != 1 && count != (uint32_t)t->shape[0]))
+            return SNACK_EUNSUPPORTED;
+        n = fb_vector(quant, 3, &zero_points);
+        for (i = 0; i < n; i++)
+        {
+            if (fb_read(zero_points + 8 * i, 4) != 0 || fb_read(zero_points + 8 * i + 4, 4) != 0)
+                return SNACK_EUNSUPPORTED;
+        }
+        t->scales = (const float *)(fb_base + scales);
+        t->scale_count = (int)count;
+    }
+    return fb_ok ? SNACK_EOK : SNACK_EFORMAT;
+}
+
+static int tensor_index(size_t vec, uint32_t count, uint32_t i)
+{
+    int32_t index = i < count ? fb_index(vec, i) : -1;
+    return index >= 0 && index < tensor_count ? index : -1;
+}
+
+static uint32_t tensor_elems(const SnackTensor *t)
+{
+    return t->bytes / (t->type == SNACK_I8 ? 1 : 4);
+}
+
+/* 检查并记下一个算子的参数 */
+static int parse_op(size_t table, const int32_t *codes, uint32_t code_count, SnackOp *op)
+{
+    size_t inputs, outputs, options = fb_subtable(table, 4);
+    uint32_t nin = fb_vector(table, 1, &inputs);
+    uint32_t nout = fb_vector(table, 2, &outputs);
+    uint32_t code_index = (uint32_t)fb_scalar(table, 0, 4, 0);
+    const SnackTensor *in, *out, *w;
+    int act;
+
+    if (code_index >= code_count || nout != 1)
+        return SNACK_EFORMAT;
+
+    memset(op, 0, sizeof(*op));
+    op->input = (int8_t)tensor_index(inputs, nin, 0);
+    op->weights = (int8_t)tensor_index(inputs, nin, 1);
+    op->bias = (int8_t)tensor_index(inputs, nin, 2);
+    op->output = (int8_t)tensor_index(outputs, nout, 0);
+    op->pool = -1;
+    op->scratch = -1;
+    op->sums = -1;
+    if (op->input < 0 || op->output < 0)
+        return SNACK_EFORMAT;
+    in = &tensors[op->input];
+    out = &tensors[op->output];
+    if (in->type != SNACK_F32 || out->type != SNACK_F32 || in->data != NULL || out->data != NULL)
+        return SNACK_EUNSUPPORTED;
+
+    switch (codes[code_index])
+    {
+    case TFL_CONV_2D:
+        op->kind = SNACK_OP_CONV;
+        if (op->weights < 0 || op->bias < 0)
+            return SNACK_EFORMAT;
+        w = &tensors[op->weights];
+        act = fb_scalar(options, 3, 1, TFL_ACT_NONE);
+        op->stride_w = (int16_t)fb_scalar(options, 1, 4, 1);
+        op->stride_h = (int16_t)fb_scalar(options, 2, 4, 1);
+        if (fb_scalar(options, 0, 1, 0) != TFL_PADDING_VALID ||
+            fb_scalar(options, 4, 4, 1) != 1 || fb_scalar(options, 5, 4, 1) != 1 ||
+            op->stride_w < 1 || op->stride_h < 1 || (act != TFL_ACT_NONE && act != TFL_ACT_RELU))
+            return SNACK_EUNSUPPORTED;
+        if (in->dims != 4 || out->dims != 4 || w->dims != 4 || in->shape[0] != 1 ||
+            w->data == NULL || w->shape[3] != in->shape[3] || w->shape[0] != out->shape[3] ||
+            tensors[op->bias].type != SNACK_F32 || tensors[op->bias].data == NULL ||
+            tensor_elems(&tensors[op->bias]) != (uint32_t)out->shape[3] ||
+            out->shape[1] != (in->shape[1] - w->shape[1]) / op->stride_h + 1 ||
+            out->shape[2] != (in->shape[2] - w->shape[2]) / op->stride_w + 1)
+            return SNACK_EUNSUPPORTED;
+        op->relu = act == TFL_ACT_RELU;
+        break;
+
+    case TFL_MAX_POOL_2D:
+        op->kind = SNACK_OP_MAX_POOL;
+        act = fb_scalar(options, 5, 1, TFL_ACT_NONE);
+        op->stride_w = (int16_t)fb_scalar(options, 1, 4, 0);
+        op->stride_h = (int16_t)fb_scalar(options, 2, 4, 0);
+        op->filter_w = (int16_t)fb_scalar(options, 3, 4, 0);
+        op->filter_h = (int16_t)fb_scalar(options, 4, 4, 0);
+        if (fb_scalar(options, 0, 1, 0) != TFL_PADDING_VALID || op->stride_w < 1 ||
+            op->stride_h < 1 || op->filter_w < 1 || op->filter_h < 1 ||
+            (act != TFL_ACT_NONE && act != TFL_ACT_RELU))
+            return SNACK_EUNSUPPORTED;
+        if (in->dims != 4 || out->dims != 4 || out->shape[3] != in->shape[3] ||
+            out->shape[1] != (in->shape[1] - op->filter_h) / op->stride_h + 1 ||
+            out->shape[2] != (in->shape[2] - op->filter_w) / op->stride_w + 1)
+            return SNACK_EUNSUPPORTED;
+        op->relu = act == TFL_ACT_RELU;
+        op->weights = op->bias = -1;
+        break;
+
+    case TFL_RESHAPE:
+        op->kind = SNACK_OP_RESHAPE;
+        if (in->bytes != out->bytes)
+            return SNACK_EUNSUPPORTED;
+        op->weights = op->bias = -1;
+        break;
+
+    case TFL_FULLY_CONNECTED:
+        op->kind = SNACK_OP_FC;
+        if (op->weights < 0)
+            return SNACK_EFORMAT;
+        w = &tensors[op->weights];
+        act = fb_scalar(options, 0, 1, TFL_ACT_NONE);
+        if (fb_scalar(options, 1, 1, 0) != 0 || (act != TFL_ACT_NONE && act != TFL_ACT_RELU))
+            return SNACK_EUNSUPPORTED;
+        if (w->dims != 2 || w->data == NULL || tensor_elems(in) != (uint32_t)w->shape[1] ||
+            tensor_elems(out) != (uint32_t)w->shape[0] ||
+            (op->bias >= 0 && (tensors[op->bias].type != SNACK_F32 || tensors[op->bias].data == NULL ||
+                               tensor_elems(&tensors[op->bias]) != (uint32_t)w->shape[0])))
+            return SNACK_EUNSUPPORTED;
+        op->relu = act == TFL_ACT_RELU;
+        op->asymmetric = fb_scalar(options, 3, 1, 0) != 0;
+        break;
+
+    case TFL_SOFTMAX:
+        op->kind = SNACK_OP_SOFTMAX;
+        op->beta = fb_float(options, 0, 1.0f);
+        if (in->bytes != out->bytes)
+            return SNACK_EUNSUPPORTED;
+        op->weights = op->bias = -1;
+        break;
+
+    default:
+        return SNACK_EUNSUPPORTED;
+    }
+    return fb_ok ? SNACK_EOK : SNACK_EFORMAT;
+}
+
+/* ---------------------------------------------------------------- 规划 */
+
+typedef struct {
+    uint32_t bytes;
+    int first, last;                // 生存的算子区间，含端点
+    int32_t *offset;
+} PlanItem;
+
+static PlanItem plan[PLAN_MAX];
+static int plan_count;
+
+static int alias_root(int t)
+{
+    while (alias_of[t] >= 0)
+        t = alias_of[t];
+    return t;
+}
+
+static void plan_add(uint32_t bytes, int first, int last, int32_t *offset)
+{
+    PlanItem *item = &plan[plan_count++];
+
+    item->bytes = (bytes + ARENA_ALIGN - 1) & ~(uint32_t)(ARENA_ALIGN - 1);
+    item->first = first;
+    item->last = last;
+    item->offset = offset;
+    *offset = -1;
+}
+
+/* 贪心：按大小降序，每块放在与它生存期重叠的已放置块之间最低的空位 */
+static uint32_t plan_place(uint32_t base)
+{
+    int order[PLAN_MAX];
+    uint32_t peak = base;
+    int i, j, k;
+
+    for (i = 0; i < plan_count; i++)
+    {
+        order[i] = i;
+        for (j = i; j > 0 && plan[order[j]].bytes > plan[order[j - 1]].bytes; j--)
+        {
+            int tmp = order[j];
+            order[j] = order[j - 1];
+            order[j - 1] = tmp;
+        }
+    }
+
+    for (i = 0; i < plan_count; i++)
+    {
+        PlanItem *item = &plan[order[i]];
+        uint32_t offset = base;
+        int moved = 1;
+
+        /* 与某个已放置的块冲突就挪到它后面，再从头检查 */
+        while (moved)
+        {
+            moved = 0;
+            for (k = 0; k < i; k++)
+            {
+                const PlanItem *other = &plan[order[k]];
+                uint32_t start = (uint32_t)*other->offset;
+
+                if (other->last < item->first || item->last < other->first)
+                    continue;
+                if (offset < start + other->bytes && start < offset + item->bytes)
+                {
+                    offset = start + other->bytes;
+                    moved = 1;
+                }
+            }
+        }
+        *item->offset = (int32_t)offset;
+        if (offset + item->bytes > peak)
+            peak = offset + item->bytes;
+    }
+    return peak;
+}
+
+/* 融合卷积 + 池化，确定各缓冲的生存区间并分配 arena */
+static int plan_arena(void)
+{
+    int first[SNACK_TENSORS_MAX], last[SNACK_TENSORS_MAX];
+    int32_t alias_offset[SNACK_TENSORS_MAX];
+    uint32_t persistent = 0, used;
+    int i, j, step;
+
+    for (i = 0; i < tensor_count; i++)
+    {
+        alias_of[i] = -1;
+        first[i] = -1;
+        last[i] = -1;
+    }
+
+    /* 被多个算子使用的卷积输出不能融合 */
+    for (i = 0; i + 1 < op_count; i++)
+    {
+        SnackOp *conv = &ops[i], *pool = &ops[i + 1];
+        int users = 0;
+
+        if (conv->kind != SNACK_OP_CONV || pool->kind != SNACK_OP_MAX_POOL ||
+            pool->input != conv->output || conv->output == output_tensor)
+            continue;
+        for (j = 0; j < op_count; j++)
+        {
+            if (ops[j].input == conv->output || ops[j].weights == conv->output ||
+                ops[j].bias == conv->output)
+                users++;
+        }
+        if (users == 1)
+        {
+            conv->pool = (int8_t)(i + 1);
+            info.fused++;
+        }
+    }
+
+    for (i = 0; i < op_count; i++)
+    {
+        if (ops[i].kind == SNACK_OP_RESHAPE)
+            alias_of[ops[i].output] = ops[i].input;
+    }
+
+    /* 常驻：int8 权重每个输出通道的权重和，放在 arena 最前面 */
+    for (i = 0; i < op_count; i++)
+    {
+        SnackOp *op = &ops[i];
+
+        if ((op->kind == SNACK_OP_CONV || op->kind == SNACK_OP_FC) &&
+            tensors[op->weights].type == SNACK_I8)
+        {
+            op->sums = (int32_t)persistent;
+            persistent += ((uint32_t)tensors[op->weights].shape[0] * 4 + ARENA_ALIGN - 1) &
+                          ~(uint32_t)(ARENA_ALIGN - 1);
+        }
+    }
+
+    /* 生存区间按执行步计，融合掉的池化不占步 */
+    plan_count = 0;
+    first[input_tensor] = 0;
+    for (i = 0, step = 0; i < op_count; i++)
+    {
+        const SnackOp *op = &ops[i];
+        int out = op->pool >= 0 ? ops[op->pool].output : op->output;
+        int in = alias_root(op->input);
+
+        if (op->kind == SNACK_OP_MAX_POOL && i > 0 && ops[i - 1].pool == i)
+            continue;
+        if (first[in] < 0)
+            return SNACK_EUNSUPPORTED;  // 用到了没有产生过的激活
+        last[in] = step;
+        if (op->kind != SNACK_OP_RESHAPE)
+        {
+            first[out] = step;
+            last[out] = step;
+        }
+
+        /* 临时缓冲：量化后的输入，融合时再加池化窗口高的几行卷积输出 */
+        {
+            SnackOp *w = &ops[i];
+            uint32_t scratch = 0;
+
+            if (op->weights >= 0 && tensors[op->weights].type == SNACK_I8)
+                scratch += (tensors[op->input].bytes / 4 + ARENA_ALIGN - 1) & ~(uint32_t)(ARENA_ALIGN - 1);
+            if (op->pool >= 0)
+                scratch += (uint32_t)ops[op->pool].filter_h * tensors[op->output].shape[2] *
+                           tensors[op->output].shape[3] * 4;
+            w->scratch_bytes = scratch;
+            if (scratch > 0)
+                plan_add(scratch, step, step, &w->scratch);
+        }
+        step++;
+    }
+    last[output_tensor] = step;
+
+    for (i = 0; i < tensor_count; i++)
+    {
+        if (alias_of[i] >= 0 || first[i] < 0 || tensors[i].data != NULL)
+            continue;
+        plan_add(tensors[i].bytes, first[i], last[i] < first[i] ? first[i] : last[i],
+                 &tensors[i].offset);
+    }
+
+    used = plan_place(persistent);
+    for (i = 0; i < tensor_count; i++)
+    {
+        alias_offset[i] = tensors[alias_root(i)].offset;
+    }
+    for (i = 0; i < tensor_count; i++)
+    {
+        if (alias_of[i] >= 0)
+            tensors[i].offset = alias_offset[i];
+    }
+
+    info.arena_used = used;
+    info.arena_persistent = persistent;
+    if (used > SNACK_ARENA_SIZE)
+        return SNACK_EARENA;
+    return SNACK_EOK;
+}
+
+/* ---------------------------------------------------------------- 算子 */
+
+static float *arena_f32(int32_t offset)
+{
+    return (float *)(arena + offset);
+}
+
+static float *tensor_f32(int t)
+{
+    return arena_f32(tensors[t].offset);
+}
+
+/* int8 点积，按 16 个一块累加，块长固定便于编译器向量化 */
+static int32_t dot_i8(const int8_t *a, const int8_t *b, int n)
+{
+    int32_t acc = 0;
+    int i = 0, k;
+
+    for (; i + 16 <= n; i += 16)
+    {
+        int32_t block = 0;
+        for (k = 0; k < 16; k++)
+            block += a[i + k] * b[i + k];
+        acc += block;
+    }
+    for (; i < n; i++)
+        acc += a[i] * b[i];
+    return acc;
+}
+
+/*
+ * 浮点数组按整张量量化成 int8，与 TFLite 混合量化的做法相同：非对称时
+ * 取 [min(0, lo), max(0, hi)] 映射到 [-128, 127]，对称时取 ±max|x|。
+ */
+static void quantize(const float *x, int n, int asymmetric, int8_t *q, float *scale, int32_t *zero_point)
+{
+    float lo = 0, hi = 0;
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        if (x[i] < lo) lo = x[i];
+        if (x[i] > hi) hi = x[i];
+    }
+
+    if (!asymmetric)
+    {
+        float range = hi > -lo ? hi : -lo;
+        *zero_point = 0;
+        *scale = range > 0 ? range / 127.0f : 1.0f;
+    }
+    else if (hi == lo)
+    {
+        *zero_point = 0;
+        *scale = 1.0f;
+    }
+    else
+    {
+        float zp;
+        *scale = (hi - lo) / 255.0f;
+        zp = -128.0f - lo / *scale;
+        *zero_point = (int32_t)(zp < -128.0f ? -128 : (zp > 127.0f ? 127 : floorf(zp + 0.5f)));
+    }
+
+    for (i = 0; i < n; i++)
+    {
+        int32_t v = (int32_t)floorf(x[i] / *scale + 0.5f) + *zero_point;
+        q[i] = (int8_t)(v < -128 ? -128 : (v > 127 ? 127 : v));
+    }
+}
+
+/* 算卷积输出的第 row0 行起的 rows 行，写进 out（按 NHWC，行连续） */
+static void conv_rows(const SnackOp *op, const void *input, float in_scale, int32_t zero_point,
+                      int row0, int rows, float *out)
+{
+    const SnackTensor *in = &tensors[op->input];
+    const SnackTensor *w = &tensors[op->weights];
+    const SnackTensor *o = &tensors[op->output];
+    const float *bias = (const float *)tensors[op->bias].data;
+    const int32_t *sums = op->sums >= 0 ? (const int32_t *)(arena + op->sums) : NULL;
+    int iw = in->shape[2], ic = in->shape[3];
+    int kh = w->shape[1], kw = w->shape[2];
+    int ow = o->shape[2], oc = o->shape[3];
+    int span = kw * ic;             // 一个核的一行在输入里是连续的
+    int y, x, c, ky;
+
+    for (y = row0; y < row0 + rows; y++)
+    {
+        for (x = 0; x < ow; x++)
+        {
+            float *dst = out + ((y - row0) * ow + x) * oc;
+            int base = (y * op->stride_h * iw + x * op->stride_w) * ic;
+
+            for (c = 0; c < oc; c++)
+            {
+                float v;
+
+                if (w->type == SNACK_I8)
+                {
+                    const int8_t *q = (const int8_t *)input + base;
+                    const int8_t *k = (const int8_t *)w->data + c * kh * span;
+                    int32_t acc = 0;
+
+                    for (ky = 0; ky < kh; ky++)
+                        acc += dot_i8(q + ky * iw * ic, k + ky * span, span);
+                    acc -= zero_point * sums[c];
+                    v = acc * in_scale * w->scales[w->scale_count > 1 ? c : 0];
+                }
+                else
+                {
+                    const float *s = (const float *)input + base;
+                    const float *k = (const float *)w->data + c * kh * span;
+                    int i;
+
+                    v = 0;
+                    for (ky = 0; ky < kh; ky++)
+                    {
+                        for (i = 0; i < span; i++)
+                            v += s[ky * iw * ic + i] * k[ky * span + i];
+                    }
+                }
+
+                v += bias[c];
+                dst[c] = op->relu && v < 0 ? 0 : v;
+            }
+        }
+    }
+}
+
+/* 对 rows 行高的输入条带做一行池化输出 */
+static void pool_row(const SnackOp *pool, const float *band, int width, int channels, float *out)
+{
+    int ow = tensors[pool->output].shape[2];
+    int x, c, ky, kx;
+
+    for (x = 0; x < ow; x++)
+    {
+        for (c = 0; c < channels; c++)
+        {
+            float m = band[(x * pool->stride_w) * channels + c];
+
+            for (ky = 0; ky < pool->filter_h; ky++)
+            {
+                for (kx = 0; kx < pool->filter_w; kx++)
+                {
+                    float v = band[(ky * width + x * pool->stride_w + kx) * channels + c];
+                    if (v > m)
+                        m = v;
+                }
+            }
+            out[x * channels + c] = pool->relu && m < 0 ? 0 : m;
+        }
+    }
+}
+
+static void run_conv(const SnackOp *op)
+{
+    const SnackTensor *in = &tensors[op->input];
+    const SnackTensor *o = &tensors[op->output];
+    const void *input = tensor_f32(op->input);
+    float *band = NULL, scale = 1.0f;
+    int32_t zero_point = 0;
+    int row;
+
+    if (tensors[op->weights].type == SNACK_I8)
+    {
+        int8_t *q = (int8_t *)(arena + op->scratch);
+        quantize(tensor_f32(op->input), (int)(in->bytes / 4), 1, q, &scale, &zero_point);
+        input = q;
+        band = (float *)(arena + op->scratch + ((in->bytes / 4 + ARENA_ALIGN - 1) & ~(uint32_t)(ARENA_ALIGN - 1)));
+    }
+    else if (op->scratch >= 0)
+    {
+        band = arena_f32(op->scratch);
+    }
+
+    if (op->pool < 0)
+    {
+        conv_rows(op, input, scale, zero_point, 0, o->shape[1], tensor_f32(op->output));
+        return;
+    }
+
+    /* 融合：每次算出一个池化窗口高的卷积行，池化成一行输出 */
+    {
+        const SnackOp *pool = &ops[op->pool];
+        const SnackTensor *po = &tensors[pool->output];
+        int row_floats = po->shape[2] * po->shape[3];
+
+        for (row = 0; row < po->shape[1]; row++)
+        {
+            conv_rows(op, input, scale, zero_point, row * pool->stride_h, pool->filter_h, band);
+            pool_row(pool, band, o->shape[2], o->shape[3], tensor_f32(pool->output) + row * row_floats);
+        }
+    }
+}
+
+static void run_pool(const SnackOp *op)
+{
+    const SnackTensor *in = &tensors[op->input];
+    const SnackTensor *o = &tensors[op->output];
+    int row_in = in->shape[2] * in->shape[3];
+    int row_out = o->shape[2] * o->shape[3];
+    int row;
+
+    for (row = 0; row < o->shape[1]; row++)
+        pool_row(op, tensor_f32(op->input) + row * op->stride_h * row_in, in->shape[2], in->shape[3],
+                 tensor_f32(op->output) + row * row_out);
+}
+
+static void run_fc(const SnackOp *op)
+{
+    const SnackTensor *w = &tensors[op->weights];
+    const float *x = tensor_f32(op->input);
+    const float *bias = op->bias >= 0 ? (const float *)tensors[op->bias].data : NULL;
+    float *y = tensor_f32(op->output);
+    int n = w->shape[1], outputs = w->shape[0], o, i;
+
+    if (w->type == SNACK_I8)
+    {
+        int8_t *q = (int8_t *)(arena + op->scratch);
+        const int32_t *sums = (const int32_t *)(arena + op->sums);
+        float scale;
+        int32_t zero_point;
+
+        quantize(x, n, op->asymmetric, q, &scale, &zero_point);
+        for (o = 0; o < outputs; o++)
+        {
+            int32_t acc = dot_i8(q, (const int8_t *)w->data + o * n, n) - zero_point * sums[o];
+            float v = acc * scale * w->scales[w->scale_count > 1 ? o : 0] + (bias ? bias[o] : 0);
+            y[o] = op->relu && v < 0 ? 0 : v;
+        }
+        return;
+    }
+
+    for (o = 0; o < outputs; o++)
+    {
+        const float *k = (const float *)w->data + o * n;
+        float v = bias ? bias[o] : 0;
+
+        for (i = 0; i < n; i++)
+            v += x[i] * k[i];
+        y[o] = op->relu && v < 0 ? 0 : v;
+    }
+}
+
+static void run_softmax(const SnackOp *op)
+{
+    const float *x = tensor_f32(op->input);
+    float *y = tensor_f32(op->output);
+    int n = (int)(tensors[op->input].bytes / 4), i;
+    float max = x[0], sum = 0;
+
+    for (i = 1; i < n; i++)
+    {
+        if (x[i] > max)
+            max = x[i];
+    }
+    for (i = 0; i < n; i++)
+    {
+        y[i] = expf((x[i] - max) * op->beta);
+        sum += y[i];
+    }
+    for (i = 0; i < n; i++)
+        y[i] /= sum;
+}
+
+/* ---------------------------------------------------------------- 接口 */
+
+int snack_infer_init(const uint8_t *model, size_t size)
+{
+    size_t root, subgraph, vec, tensor_vec, buffers, op_vec, inputs, outputs;
+    int32_t codes[SNACK_OPS_MAX];
+    uint32_t n, code_count, buffer_count, i;
+    int result;
+
+    ready = 0;
+    memset(&info, 0, sizeof(info));
+    tensor_count = op_count = 0;
+
+    if (((uintptr_t)model & 3) != 0 || size < 8 || memcmp(model + 4, "TFL3", 4) != 0)
+        return SNACK_EFORMAT;
+    fb_base = model;
+    fb_size = size;
+    fb_ok = 1;
+
+    root = fb_read(0, 4);
+    code_count = fb_vector(root, 1, &vec);
+    if (code_count > SNACK_OPS_MAX)
+        return SNACK_EUNSUPPORTED;
+    for (i = 0; i < code_count; i++)
+    {
+        size_t code = fb_deref(vec + 4 * i);
+        int32_t deprecated = fb_scalar(code, 0, 1, 0);
+        int32_t builtin = fb_scalar(code, 3, 4, 0);
+        codes[i] = builtin > deprecated ? builtin : deprecated;
+    }
+
+    if (fb_vector(root, 2, &vec) != 1)
+        return fb_ok ? SNACK_EUNSUPPORTED : SNACK_EFORMAT;
+    subgraph = fb_deref(vec);
+    buffer_count = fb_vector(root, 4, &buffers);
+
+    n = fb_vector(subgraph, 0, &tensor_vec);
+    if (n > SNACK_TENSORS_MAX)
+        return SNACK_EUNSUPPORTED;
+    for (i = 0; i < n; i++)
+    {
+        result = parse_tensor(fb_deref(tensor_vec + 4 * i), buffers, buffer_count, &tensors[i]);
+        if (result != SNACK_EOK)
+            return result;
+        tensor_count++;
+    }
+
+    if (fb_vector(subgraph, 1, &inputs) != 1 || fb_vector(subgraph, 2, &outputs) != 1)
+        return fb_ok ? SNACK_EUNSUPPORTED : SNACK_EFORMAT;
+    input_tensor = tensor_index(inputs, 1, 0);
+    output_tensor = tensor_index(outputs, 1, 0);
+    if (input_tensor < 0 || output_tensor < 0)
+        return SNACK_EFORMAT;
+    if (tensors[input_tensor].bytes != SNACK_INPUT_H * SNACK_INPUT_W * SNACK_INPUT_C * 4 ||
+        tensors[output_tensor].bytes != SNACK_CLASSES * 4)
+        return SNACK_EUNSUPPORTED;
+
+    n = fb_vector(subgraph, 3, &op_vec);
+    if (n == 0 || n > SNACK_OPS_MAX)
+        return fb_ok ? SNACK_EUNSUPPORTED : SNACK_EFORMAT;
+    for (i = 0; i < n; i++)
+    {
+        result = parse_op(fb_deref(op_vec + 4 * i), codes, code_count, &ops[i]);
+        if (result != SNACK_EOK)
+            return result;
+        op_count++;
+    }
+
+    result = plan_arena();
+    if (result != SNACK_EOK)
+        return result;
+
+    /* 权重和只与模型有关，初始化时算好 */
+    for (i = 0; i < (uint32_t)op_count; i++)
+    {
+        const SnackOp *op = &ops[i];
+        int32_t *sums;
+        int o, k, per;
+
+        if (op->sums < 0)
+            continue;
+        sums = (int32_t *)(arena + op->sums);
+        per = (int)(tensors[op->weights].bytes / tensors[op->weights].shape[0]);
+        for (o = 0; o < tensors[op->weights].shape[0]; o++)
+        {
+            const int8_t *w = (const int8_t *)tensors[op->weights].data + o * per;
+            sums[o] = 0;
+            for (k = 0; k < per; k++)
+                sums[o] += w[k];
+        }
+    }
+
+    for (i = 0; i < (uint32_t)tensor_count; i++)
+    {
+        if (tensors[i].data != NULL)
+            info.weight_bytes += tensors[i].bytes;
+    }
+    info.tensors = tensor_count;
+    info.ops = op_count;
+    ready = 1;
+    return SNACK_EOK;
+}
+
+/* 按 NHWC 写入 96x96x3 个浮点 */
+float *snack_infer_input(void)
+{
+    return ready ? tensor_f32(input_tensor) : NULL;
+}
+
+int snack_infer_run(float *probs)
+{
+    int i;
+
+    if (!ready)
+        return SNACK_ESTATE;
+
+    for (i = 0; i < op_count; i++)
+    {
+        const SnackOp *op = &ops[i];
+
+        switch (op->kind)
+        {
+        case SNACK_OP_CONV:
+            run_conv(op);
+            if (op->pool >= 0)
+                i = op->pool;
+            break;
+        case SNACK_OP_MAX_POOL:
+            run_pool(op);
+            break;
+        case SNACK_OP_RESHAPE:
+            break;
+        case SNACK_OP_FC:
+            run_fc(op);
+            break;
+        case SNACK_OP_SOFTMAX:
+            run_softmax(op);
+            break;
+        }
+    }
+
+    memcpy(probs, tensor_f32(output_tensor), SNACK_CLASSES * sizeof(float));
+    return SNACK_EOK;
+}
+
+void snack_infer_get_info(SnackInfo *out)
+{
+    *out = info;
+}
+
+int snack_infer_op_count(void)
+{
+    return op_count;
+}
+
+const SnackOp *snack_infer_op(int index)
+{
+    return index >= 0 && index < op_count ? &ops[index] : NULL;
+}
+
+const SnackTensor *snack_infer_tensor(int index)
+{
+    return index >= 0 && index < tensor_count ? &tensors[index] : NULL;
+}
@@ -0,0 +1,98 @@
+﻿#ifndef __SNACK_INFER_H__
+#define __SNACK_INFER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * snack_model.tflite 的推理，不依赖操作系统，运行时不申请内存。
+ *
+ * 模型直接从闪存或映射进内存的文件里读，权重零拷贝；所有激活和临时缓冲
+ * 在初始化时规划进一块静态 arena。只支持这个模型用到的算子：CONV_2D、
+ * MAX_POOL_2D、RESHAPE、FULLY_CONNECTED、SOFTMAX，batch 为 1，NHWC，
+ * 卷积与池化只支持 VALID 填充。int8 权重的卷积和全连接按 TFLite 的混合
+ * 量化执行：输入激活按张量动态量化成 int8，int8 乘加累加到 int32，再乘
+ * 两边的尺度还原成浮点。
+ *
+ * 模型数据按小端解析，起始地址须 4 字节对齐。
+ */
+
+#define SNACK_ARENA_SIZE        (260 * 1024)    // 静态 arena 字节数
+#define SNACK_TENSORS_MAX       32
+#define SNACK_OPS_MAX           16
+#define SNACK_DIMS_MAX          4
+
+#define SNACK_INPUT_H           96
+#define SNACK_INPUT_W           96
+#define SNACK_INPUT_C           3
+#define SNACK_CLASSES           2
+#define SNACK_CLASS_PINK        0   // 类别顺序按合成托盘帧上的输出推定，尚未用实拍验证
+#define SNACK_CLASS_BROWN       1
+
+/* 错误码 */
+#define SNACK_EOK               0
+#define SNACK_EFORMAT           (-1)    // 不是合法的 tflite 或越界
+#define SNACK_EUNSUPPORTED      (-2)    // 用了不支持的算子、类型或参数
+#define SNACK_EARENA            (-3)    // arena 放不下
+#define SNACK_ESTATE            (-4)    // 尚未初始化
+
+typedef enum {
+    SNACK_F32 = 0,
+    SNACK_I32,
+    SNACK_I8,
+} SnackType;
+
+typedef enum {
+    SNACK_OP_CONV = 0,
+    SNACK_OP_MAX_POOL,
+    SNACK_OP_RESHAPE,
+    SNACK_OP_FC,
+    SNACK_OP_SOFTMAX,
+} SnackOpKind;
+
+typedef struct {
+    SnackType type;
+    int dims;
+    int32_t shape[SNACK_DIMS_MAX];
+    uint32_t bytes;
+    const void *data;               // 常量张量指向模型里的数据，激活为 NULL
+    const float *scales;            // int8 权重的尺度，按输出通道或整张量
+    int scale_count;
+    int32_t offset;                 // 在 arena 中的偏移，常量为 -1
+} SnackTensor;
+
+typedef struct {
+    SnackOpKind kind;
+    int8_t input, weights, bias, output;
+    uint8_t relu;                   // 融合的 ReLU
+    uint8_t asymmetric;             // 全连接的输入按非对称量化
+    int8_t pool;                    // 融合进来的池化算子下标，-1 为无
+    int16_t stride_h, stride_w;
+    int16_t filter_h, filter_w;     // 池化窗口
+    float beta;                     // softmax
+    int32_t scratch;                // 临时缓冲在 arena 中的偏移，-1 为无
+    uint32_t scratch_bytes;
+    int32_t sums;                   // int8 权重每个输出通道的权重和（常驻 arena）
+} SnackOp;
+
+typedef struct {
+    uint32_t arena_used;            // 规划出的 arena 峰值
+    uint32_t arena_persistent;      // 其中常驻部分
+    uint32_t weight_bytes;          // 从模型里直接读的常量字节数
+    int tensors;
+    int ops;
+    int fused;                      // 融合掉的池化个数
+} SnackInfo;
+
+int snack_infer_init(const uint8_t *model, size_t size);
+/* 输入缓冲在 arena 里，运行时会被后面的算子复用，每次 run 之前都要重新写入 */
+float *snack_infer_input(void);
+int snack_infer_run(float *probs);
+void snack_infer_get_info(SnackInfo *info);
+
+/* 解析结果，供对照实现和诊断使用 */
+int snack_infer_op_count(void);
+const SnackOp *snack_infer_op(int index);
+const SnackTensor *snack_infer_tensor(int index);
+
+#endif
@@ -0,0 +1,231 @@
+﻿#include "vend_log.h"
+
+/*
+ * 延后格式化的日志。
+ *
+ * 运动控制线程原来在驱动 PWM 和推手前后直接调 rt_kprintf，格式化加上
+ * 115200 波特率的串口输出要几毫秒，都算进了动作的时序。这里调用处只把
+ * 格式串指针（相当于格式编号）和最多 4 个参数拷进本线程的环形缓冲，几
+ * 十个周期就返回；输出线程优先级最低，空闲时再逐条格式化打印。
+ *
+ * 每个线程第一次写日志时领一个私有缓冲，之后只有它自己写、输出线程读，
+ * 不需要加锁。中断上下文、以及缓冲领完之后的线程写共用缓冲，共用缓冲
+ * 关中断写入。各条记录带全局序号，输出线程每次取序号最小的一条，多个
+ * 缓冲合起来仍按写入的先后输出。缓冲满时丢弃新记录并计数，输出时补一
+ * 行提示。
+ *
+ * 输出线程把所有缓冲读空后挂起在信号量上，写入方只在它挂起时释放一次
+ * 信号量；输出线程优先级最低，释放不会引起写入方被抢占。
+ */
+
+#define LOG_MASK            (VEND_LOG_DEPTH - 1)
+#define LOG_SHARED          VEND_LOG_RINGS  // 共用缓冲的下标
+
+typedef struct {
+    const char *fmt;
+    rt_ubase_t args[VEND_LOG_ARGS];
+    rt_uint32_t seq;                // 全局写入序号
+} LogRecord;
+
+typedef struct {
+    rt_thread_t owner;              // 私有缓冲的主人，RT_NULL 为未领用
+    volatile rt_uint32_t head;      // 写指针，只增不减，取模后为下标
+    volatile rt_uint32_t tail;      // 读指针，只由输出线程修改
+    LogRecord records[VEND_LOG_DEPTH];
+} LogRing;
+
+static LogRing log_rings[VEND_LOG_RINGS + 1];
+static rt_uint32_t log_seq = 0;
+static volatile rt_uint8_t log_level = VEND_LOG_INFO;
+static volatile rt_uint8_t log_waiting = 0;         // 输出线程已挂起，等信号量
+static VendLogStats log_stats;
+static rt_uint32_t log_dropped_shown = 0;           // 已提示过的丢弃条数
+
+static struct rt_semaphore log_sem;
+static struct rt_thread log_thread;
+static ALIGN(RT_ALIGN_SIZE) rt_uint8_t log_thread_stack[VEND_LOG_STACK];
+
+static const char *const log_level_names[] = { "error", "warn", "info", "debug" };
+
+/* 当前线程的私有缓冲；中断里或没有空缓冲时返回 RT_NULL */
+static LogRing *log_ring_of_self(void)
+{
+    rt_thread_t self;
+    int i;
+
+    if (rt_interrupt_get_nest() > 0)
+        return RT_NULL;
+    self = rt_thread_self();
+    for (i = 0; i < VEND_LOG_RINGS; i++)
+    {
+        rt_thread_t owner = __atomic_load_n(&log_rings[i].owner, __ATOMIC_RELAXED);
+
+        if (owner == self)
+            return &log_rings[i];
+        if (owner == RT_NULL)
+        {
+            rt_thread_t expected = RT_NULL;
+
+            if (__atomic_compare_exchange_n(&log_rings[i].owner, &expected, self, RT_FALSE,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                return &log_rings[i];
+            if (expected == self)
+                return &log_rings[i];
+        }
+    }
+    return RT_NULL;
+}
+
+static rt_bool_t log_put(LogRing *ring, const char *fmt, rt_ubase_t a0, rt_ubase_t a1,
+                         rt_ubase_t a2, rt_ubase_t a3)
+{
+    rt_uint32_t head = ring->head;
+    LogRecord *record;
+
+    if (head - ring->tail >= VEND_LOG_DEPTH)
+        return RT_FALSE;
+
+    record = &ring->records[head & LOG_MASK];
+    record->fmt = fmt;
+    record->args[0] = a0;
+    record->args[1] = a1;
+    record->args[2] = a2;
+    record->args[3] = a3;
+    record->seq = __atomic_fetch_add(&log_seq, 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+    return RT_TRUE;
+}
+
+void vend_log_write(rt_uint8_t level, const char *fmt, rt_ubase_t a0, rt_ubase_t a1,
+                    rt_ubase_t a2, rt_ubase_t a3)
+{
+    LogRing *ring;
+    rt_bool_t ok;
+
+    if (level > log_level)
+    {
+        __atomic_fetch_add(&log_stats.filtered, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    ring = log_ring_of_self();
+    if (ring != RT_NULL)
+    {
+        ok = log_put(ring, fmt, a0, a1, a2, a3);
+    }
+    else
+    {
+        rt_base_t level_irq = rt_hw_interrupt_disable();
+
+        ok = log_put(&log_rings[LOG_SHARED], fmt, a0, a1, a2, a3);
+        if (ok)
+            log_stats.shared++;
+        rt_hw_interrupt_enable(level_irq);
+    }
+
+    if (!ok)
+    {
+        __atomic_fetch_add(&log_stats.dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    __atomic_fetch_add(&log_stats.written, 1, __ATOMIC_RELAXED);
+    if (__atomic_exchange_n(&log_waiting, 0, __ATOMIC_ACQ_REL))
+        rt_sem_release(&log_sem);
+}
+
+/* 各缓冲里序号最小的一条所在的缓冲；全空时返回 RT_NULL */
+static LogRing *log_oldest(void)
+{
+    LogRing *oldest = RT_NULL;
+    rt_uint32_t oldest_seq = 0;
+    int i;
+
+    for (i = 0; i <= VEND_LOG_RINGS; i++)
+    {
+        LogRing *ring = &log_rings[i];
+        rt_uint32_t seq;
+
+        if (ring->tail == __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE))
+            continue;
+        seq = ring->records[ring->tail & LOG_MASK].seq;
+        if (oldest == RT_NULL || (rt_int32_t)(seq - oldest_seq) < 0)
+        {
+            oldest = ring;
+            oldest_seq = seq;
+        }
+    }
+    return oldest;
+}
+
+static void log_emit(LogRing *ring)
+{
+    const LogRecord *record = &ring->records[ring->tail & LOG_MASK];
+    rt_uint32_t dropped = __atomic_load_n(&log_stats.dropped, __ATOMIC_RELAXED);
+
+    rt_kprintf(record->fmt, record->args[0], record->args[1], record->args[2], record->args[3]);
+    __atomic_store_n(&ring->tail, ring->tail + 1, __ATOMIC_RELEASE);
+
+    if (dropped != log_dropped_shown)
+    {
+        rt_kprintf("(%d log records dropped)\n", (int)(dropped - log_dropped_shown));
+        log_dropped_shown = dropped;
+    }
+}
+
+static void vend_log_thread(void *parameter)
+{
+    LogRing *ring;
+
+    while (1)
+    {
+        ring = log_oldest();
+        if (ring != RT_NULL)
+        {
+            log_emit(ring);
+            continue;
+        }
+
+        /* 先声明要挂起再查一遍，挂起前刚写进来的记录不会漏掉 */
+        __atomic_store_n(&log_waiting, 1, __ATOMIC_SEQ_CST);
+        if (log_oldest() != RT_NULL)
+        {
+            if (__atomic_exchange_n(&log_waiting, 0, __ATOMIC_ACQ_REL))
+                continue;
+        }
+        rt_sem_take(&log_sem, RT_WAITING_FOREVER);
+    }
+}
+
+rt_err_t vend_log_init(void)
+{
+    rt_sem_init(&log_sem, "vend_log", 0, RT_IPC_FLAG_FIFO);
+    if (rt_thread_init(&log_thread, "vend_log", vend_log_thread, RT_NULL,
+                       log_thread_stack, sizeof(log_thread_stack),
+                       VEND_LOG_THREAD_PRIO, 10) != RT_EOK)
+    {
+        rt_kprintf("Failed to start vend_log thread.\n");
+        return -RT_ERROR;
+    }
+    rt_thread_startup(&log_thread);
+    return RT_EOK;
+}
+
+void vend_log_set_level(rt_uint8_t level)
+{
+    log_level = level > VEND_LOG_DEBUG ? VEND_LOG_DEBUG : level;
+}
+
+rt_uint8_t vend_log_get_level(void)
+{
+    return log_level;
+}
+
+void vend_log_get_stats(VendLogStats *stats)
+{
+    *stats = log_stats;
+}
+
+const char *vend_log_level_name(int level)
+{
+    return level >= 0 && level <= VEND_LOG_DEBUG ? log_level_names[level] : "?";
+}
@@ -0,0 +1,54 @@
+﻿#ifndef __VEND_LOG_H__
+#define __VEND_LOG_H__
+
+#include <rtthread.h>
+
+#define VEND_LOG_RINGS          6       // 线程私有缓冲的个数，用完后的线程与中断共用一个
+#define VEND_LOG_DEPTH          16      // 每个缓冲的记录数，须为 2 的幂
+#define VEND_LOG_ARGS           4       // 每条记录最多带的参数个数
+#define VEND_LOG_THREAD_PRIO    28      // 低于所有工作线程和接收线程
+#define VEND_LOG_STACK          1024
+
+/* 日志级别，数值越小越重要 */
+#define VEND_LOG_ERROR          0
+#define VEND_LOG_WARN           1
+#define VEND_LOG_INFO           2
+#define VEND_LOG_DEBUG          3
+
+/*
+ * 延后格式化的日志：调用处只记下格式串指针和原始参数，由低优先级线程
+ * 稍后交给 rt_kprintf。格式串和 %s 参数都必须是常量或一直有效的字符串，
+ * 参数按 rt_ubase_t 保存，不支持浮点和 64 位整数。
+ */
+#define VLOG_E(...)             VLOG(VEND_LOG_ERROR, __VA_ARGS__)
+#define VLOG_W(...)             VLOG(VEND_LOG_WARN, __VA_ARGS__)
+#define VLOG_I(...)             VLOG(VEND_LOG_INFO, __VA_ARGS__)
+#define VLOG_D(...)             VLOG(VEND_LOG_DEBUG, __VA_ARGS__)
+
+#define VLOG(level, ...)        VLOG_PICK(__VA_ARGS__, VLOG_4, VLOG_3, VLOG_2, VLOG_1, VLOG_0, 0)(level, __VA_ARGS__)
+#define VLOG_PICK(_0, _1, _2, _3, _4, name, ...) name
+#define VLOG_ARG(x)             ((rt_ubase_t)(x))
+#define VLOG_0(l, f)                vend_log_write(l, f, 0, 0, 0, 0)
+#define VLOG_1(l, f, a)             vend_log_write(l, f, VLOG_ARG(a), 0, 0, 0)
+#define VLOG_2(l, f, a, b)          vend_log_write(l, f, VLOG_ARG(a), VLOG_ARG(b), 0, 0)
+#define VLOG_3(l, f, a, b, c)       vend_log_write(l, f, VLOG_ARG(a), VLOG_ARG(b), VLOG_ARG(c), 0)
+#define VLOG_4(l, f, a, b, c, d)    vend_log_write(l, f, VLOG_ARG(a), VLOG_ARG(b), VLOG_ARG(c), VLOG_ARG(d))
+
+typedef struct {
+    rt_uint32_t written;            // 记下的条数
+    rt_uint32_t filtered;           // 级别不够、没记的条数
+    rt_uint32_t dropped;            // 缓冲满丢掉的条数
+    rt_uint32_t shared;             // 其中写进共用缓冲的条数
+} VendLogStats;
+
+rt_err_t vend_log_init(void);
+/* 线程、定时器和中断里都可以调用，不阻塞，也不关中断（共用缓冲除外） */
+void vend_log_write(rt_uint8_t level, const char *fmt, rt_ubase_t a0, rt_ubase_t a1,
+                    rt_ubase_t a2, rt_ubase_t a3);
+
+void vend_log_set_level(rt_uint8_t level);
+rt_uint8_t vend_log_get_level(void);
+void vend_log_get_stats(VendLogStats *stats);
+const char *vend_log_level_name(int level);
+
+#endif
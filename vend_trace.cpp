@@ -0,0 +1,270 @@
+﻿#include "vend_trace.h"
+
+#include <board.h>
+#include <string.h>
+
+/*
+ * 出货路径的时间跟踪。
+ *
+ * 跟踪点在中断、定时器和各线程里都会调用，不能关中断也不能等锁：写入方
+ * 用原子加领一个序号，按序号落到环形缓冲里对应的格子，先把格子标成“写入
+ * 中”，填好内容再写回序号（Cortex-M3/M4 上是 LDREX/STREX，不关中断）。
+ * 缓冲写满就覆盖最老的事件，读出时序号对不上的格子说明已被覆盖或正在写，
+ * 直接跳过。时间戳取 DWT 周期计数器，读一次只要一条指令。
+ *
+ * 成对的跟踪点（见 VendTracePhase）在结束的一端直接把耗时记进直方图：
+ * 每个 2 倍区间再等分成 2^VEND_TRACE_STEP_BITS 格，计数都用原子加。超过
+ * 周期计数器回绕一半的长动作（如回零）改用系统节拍计时。
+ */
+
+#define TRACE_MASK          (VEND_TRACE_DEPTH - 1)
+#define TRACE_SLOT_BUSY     0xFFFFFFFFu     // 格子正在写入
+#define TRACE_STEPS         (1 << VEND_TRACE_STEP_BITS)
+#define TRACE_MAX_US        ((1u << VEND_TRACE_OCTAVES) - 1)
+
+/* 每个跟踪点开始和结束的阶段，-1 表示无 */
+typedef struct {
+    rt_int8_t begin;
+    rt_int8_t end;
+} TraceRole;
+
+static const TraceRole trace_roles[TRACE_EVENT_COUNT] = {
+    { TRACE_PHASE_KEY,     -1 },                    // TRACE_KEY
+    { -1,                  TRACE_PHASE_KEY },       // TRACE_UI_KEY
+    { TRACE_PHASE_QUEUE,   -1 },                    // TRACE_DISPATCH
+    { TRACE_PHASE_COMMAND, TRACE_PHASE_QUEUE },     // TRACE_THREAD
+    { -1,                  TRACE_PHASE_COMMAND },   // TRACE_DONE
+    { TRACE_PHASE_SLIDE,   -1 },                    // TRACE_PWM_ON
+    { -1,                  TRACE_PHASE_SLIDE },     // TRACE_PWM_OFF
+    { TRACE_PHASE_PUSH,    -1 },                    // TRACE_PUSH_DRIVE
+    { -1,                  TRACE_PHASE_PUSH },      // TRACE_PUSH_HALT
+    { TRACE_PHASE_LCD,     -1 },                    // TRACE_LCD_BEGIN
+    { -1,                  TRACE_PHASE_LCD },       // TRACE_LCD_END
+};
+
+static const char *const trace_event_names[TRACE_EVENT_COUNT] = {
+    "key", "ui_key", "dispatch", "thread", "done", "pwm_on", "pwm_off",
+    "push", "halt", "lcd", "lcd_end",
+};
+
+static const char *const trace_phase_names[TRACE_PHASE_COUNT] = {
+    "key", "queue", "command", "slide", "push", "lcd",
+};
+
+/* 进行中的阶段：开始时刻 */
+typedef struct {
+    volatile rt_uint8_t open;
+    rt_uint32_t cycles;
+    rt_tick_t tick;
+} TraceStart;
+
+typedef struct {
+    rt_uint32_t count;
+    rt_uint32_t min_us;
+    rt_uint32_t max_us;
+    rt_uint32_t sum_lo;             // 总耗时（us）的低 32 位，进位记在 sum_hi
+    rt_uint32_t sum_hi;
+    rt_uint32_t buckets[VEND_TRACE_BUCKETS];
+} TraceHist;
+
+static VendTraceRecord trace_ring[VEND_TRACE_DEPTH];
+static rt_uint32_t trace_head = 0;          // 下一个要领的序号
+static TraceStart trace_starts[TRACE_PHASE_COUNT][VEND_TRACE_IDS];
+static TraceHist trace_hists[TRACE_PHASE_COUNT];
+
+void vend_trace_init(void)
+{
+    /* 打开跟踪单元和周期计数器 */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    vend_trace_reset();
+}
+
+rt_uint32_t vend_trace_cycles_to_us(rt_uint32_t cycles)
+{
+    return cycles / (SystemCoreClock / 1000000);
+}
+
+/* 耗时所在的格子：小于 TRACE_STEPS us 的每 us 一格，其余按 2 的幂分段再等分 */
+static int trace_bucket(rt_uint32_t us)
+{
+    int octave = 31 - __builtin_clz(us | 1);
+
+    if (us < TRACE_STEPS)
+        return (int)us;
+    return ((octave - VEND_TRACE_STEP_BITS + 1) << VEND_TRACE_STEP_BITS) +
+           (int)((us >> (octave - VEND_TRACE_STEP_BITS)) & (TRACE_STEPS - 1));
+}
+
+/* 格子的上沿（us） */
+static rt_uint32_t trace_bucket_top(int bucket)
+{
+    int octave = (bucket >> VEND_TRACE_STEP_BITS) + VEND_TRACE_STEP_BITS - 1;
+    rt_uint32_t step = (rt_uint32_t)(bucket & (TRACE_STEPS - 1));
+
+    if (bucket < TRACE_STEPS)
+        return (rt_uint32_t)bucket;
+    return ((TRACE_STEPS + step + 1) << (octave - VEND_TRACE_STEP_BITS)) - 1;
+}
+
+static void trace_record_us(TraceHist *hist, rt_uint32_t us)
+{
+    rt_uint32_t old;
+
+    if (us > TRACE_MAX_US)
+        us = TRACE_MAX_US;
+
+    __atomic_fetch_add(&hist->buckets[trace_bucket(us)], 1, __ATOMIC_RELAXED);
+    old = __atomic_fetch_add(&hist->sum_lo, us, __ATOMIC_RELAXED);
+    if (old + us < old)
+        __atomic_fetch_add(&hist->sum_hi, 1, __ATOMIC_RELAXED);
+
+    old = __atomic_load_n(&hist->min_us, __ATOMIC_RELAXED);
+    while (us < old && !__atomic_compare_exchange_n(&hist->min_us, &old, us, RT_TRUE,
+                                                     __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+    old = __atomic_load_n(&hist->max_us, __ATOMIC_RELAXED);
+    while (us > old && !__atomic_compare_exchange_n(&hist->max_us, &old, us, RT_TRUE,
+                                                     __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+    /* 计数最后加，读出时不会看到计数有而格子里没有 */
+    __atomic_fetch_add(&hist->count, 1, __ATOMIC_RELEASE);
+}
+
+/* 结束一个阶段：没有对应的开始（上电后第一次、或重复结束）时不记 */
+static void trace_phase_end(int phase, rt_uint8_t id, rt_uint32_t cycles, rt_tick_t tick)
+{
+    TraceStart *start = &trace_starts[phase][id];
+    rt_uint32_t ms, us;
+
+    if (!start->open)
+        return;
+    start->open = 0;
+
+    ms = (tick - start->tick) * 1000 / RT_TICK_PER_SECOND;
+    if ((rt_uint64_t)ms * (SystemCoreClock / 1000) >= 0x80000000u)
+        us = ms * 1000;
+    else
+        us = vend_trace_cycles_to_us(cycles - start->cycles);
+    trace_record_us(&trace_hists[phase], us);
+}
+
+void vend_trace(VendTraceEvent event, rt_uint8_t id, rt_uint16_t arg)
+{
+    rt_uint32_t cycles = DWT->CYCCNT;
+    rt_uint32_t seq = __atomic_fetch_add(&trace_head, 1, __ATOMIC_RELAXED);
+    VendTraceRecord *record = &trace_ring[seq & TRACE_MASK];
+    const TraceRole *role = &trace_roles[event];
+
+    __atomic_store_n(&record->seq, TRACE_SLOT_BUSY, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    record->cycles = cycles;
+    record->event = (rt_uint8_t)event;
+    record->id = id;
+    record->arg = arg;
+    __atomic_store_n(&record->seq, seq, __ATOMIC_RELEASE);
+
+    if (id >= VEND_TRACE_IDS)
+        return;
+    if (role->end >= 0)
+        trace_phase_end(role->end, id, cycles, rt_tick_get());
+    if (role->begin >= 0)
+    {
+        TraceStart *start = &trace_starts[role->begin][id];
+
+        start->cycles = cycles;
+        start->tick = rt_tick_get();
+        start->open = 1;
+    }
+}
+
+int vend_trace_snapshot(VendTraceRecord *records, int max)
+{
+    rt_uint32_t head = __atomic_load_n(&trace_head, __ATOMIC_ACQUIRE);
+    rt_uint32_t first = head > VEND_TRACE_DEPTH ? head - VEND_TRACE_DEPTH : 0;
+    rt_uint32_t seq;
+    int n = 0;
+
+    if (max <= 0)
+        return 0;
+    if (head - first > (rt_uint32_t)max)
+        first = head - max;
+
+    for (seq = first; seq != head; seq++)
+    {
+        const VendTraceRecord *slot = &trace_ring[seq & TRACE_MASK];
+        VendTraceRecord copy;
+
+        if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != seq)
+            continue;
+        copy.cycles = slot->cycles;
+        copy.event = slot->event;
+        copy.id = slot->id;
+        copy.arg = slot->arg;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != seq)
+            continue;   // 读的过程中被覆盖了
+        copy.seq = seq;
+        records[n++] = copy;
+    }
+    return n;
+}
+
+void vend_trace_get_stat(VendTracePhase phase, VendTraceStat *stat)
+{
+    const TraceHist *hist = &trace_hists[phase];
+    rt_uint32_t count = __atomic_load_n(&hist->count, __ATOMIC_ACQUIRE);
+    rt_uint32_t p50 = (count + 1) / 2, p99 = count - count / 100, seen = 0;
+    rt_uint64_t sum = ((rt_uint64_t)hist->sum_hi << 32) | hist->sum_lo;
+    rt_bool_t median = RT_FALSE;
+    int i;
+
+    memset(stat, 0, sizeof(*stat));
+    if (count == 0)
+        return;
+
+    stat->count = count;
+    stat->min_us = hist->min_us;
+    stat->max_us = hist->max_us;
+    stat->avg_us = (rt_uint32_t)(sum / count);
+    for (i = 0; i < VEND_TRACE_BUCKETS; i++)
+    {
+        seen += hist->buckets[i];
+        if (!median && seen >= p50)
+        {
+            stat->p50_us = trace_bucket_top(i);
+            median = RT_TRUE;
+        }
+        if (seen >= p99)
+        {
+            stat->p99_us = trace_bucket_top(i);
+            break;
+        }
+    }
+    /* 分位数不超过实测最大值 */
+    if (stat->p50_us > stat->max_us)
+        stat->p50_us = stat->max_us;
+    if (stat->p99_us > stat->max_us)
+        stat->p99_us = stat->max_us;
+}
+
+/* 清空直方图；环形缓冲保留，进行中的阶段照常结束 */
+void vend_trace_reset(void)
+{
+    int i;
+
+    memset(trace_hists, 0, sizeof(trace_hists));
+    for (i = 0; i < TRACE_PHASE_COUNT; i++)
+        trace_hists[i].min_us = 0xFFFFFFFF;
+}
+
+const char *vend_trace_event_name(int event)
+{
+    return event >= 0 && event < TRACE_EVENT_COUNT ? trace_event_names[event] : "?";
+}
+
+const char *vend_trace_phase_name(int phase)
+{
+    return phase >= 0 && phase < TRACE_PHASE_COUNT ? trace_phase_names[phase] : "?";
+}
@@ -0,0 +1,68 @@
+﻿#ifndef __VEND_TRACE_H__
+#define __VEND_TRACE_H__
+
+#include <rtthread.h>
+
+#define VEND_TRACE_DEPTH        256     // 环形缓冲的事件数，须为 2 的幂
+#define VEND_TRACE_IDS          4       // 每个阶段同时进行的实例数（组号、轴号、按键编号）
+#define VEND_TRACE_OCTAVES      28      // 直方图覆盖 1 us ~ 2^28 us
+#define VEND_TRACE_STEP_BITS    2       // 每个 2 倍区间再等分 4 格，分位数误差不超过 1/4
+#define VEND_TRACE_BUCKETS      (VEND_TRACE_OCTAVES << VEND_TRACE_STEP_BITS)
+
+/* 跟踪点：id 与 arg 的含义见各项说明 */
+typedef enum {
+    TRACE_KEY = 0,          // 按键事件发出（定时器上下文），id 为按键编号，arg 为 KEY_EVENT_*
+    TRACE_UI_KEY,           // 界面线程取到按键事件，id、arg 同上
+    TRACE_DISPATCH,         // 命令投给工作线程，id 为组号，arg 为命令
+    TRACE_THREAD,           // 工作线程开始执行命令，id、arg 同上
+    TRACE_DONE,             // 工作线程执行完一条命令，id、arg 同上
+    TRACE_PWM_ON,           // 滑台通道开，id 为轴号（按 slide_axis_init 顺序从 0 起），arg 为脉冲周期（us）
+    TRACE_PWM_OFF,          // 滑台通道关，id 为轴号
+    TRACE_PUSH_DRIVE,       // 推手通电，id 为推手号（按 pusher_init 顺序从 0 起），arg 为 1 伸出、2 缩回
+    TRACE_PUSH_HALT,        // 推手断电，id 为推手号
+    TRACE_LCD_BEGIN,        // 开始重画，arg 为脏矩形数
+    TRACE_LCD_END,          // 重画结束，arg 为整块发出的条带数
+    TRACE_EVENT_COUNT
+} VendTraceEvent;
+
+/* 由成对的跟踪点得出的阶段 */
+typedef enum {
+    TRACE_PHASE_KEY = 0,    // TRACE_KEY -> TRACE_UI_KEY：按键到界面线程
+    TRACE_PHASE_QUEUE,      // TRACE_DISPATCH -> TRACE_THREAD：邮箱排队
+    TRACE_PHASE_COMMAND,    // TRACE_THREAD -> TRACE_DONE：一条命令
+    TRACE_PHASE_SLIDE,      // TRACE_PWM_ON -> TRACE_PWM_OFF：滑台运动
+    TRACE_PHASE_PUSH,       // TRACE_PUSH_DRIVE -> TRACE_PUSH_HALT：推手单程
+    TRACE_PHASE_LCD,        // TRACE_LCD_BEGIN -> TRACE_LCD_END：一次重画
+    TRACE_PHASE_COUNT
+} VendTracePhase;
+
+typedef struct {
+    rt_uint32_t seq;                // 写入序号，读出时据此判断该格是否已被覆盖
+    rt_uint32_t cycles;             // DWT 周期计数
+    rt_uint8_t event;               // TRACE_*
+    rt_uint8_t id;
+    rt_uint16_t arg;
+} VendTraceRecord;
+
+typedef struct {
+    rt_uint32_t count;
+    rt_uint32_t min_us;
+    rt_uint32_t max_us;
+    rt_uint32_t avg_us;
+    rt_uint32_t p50_us;             // 分位数取所在格的上沿
+    rt_uint32_t p99_us;
+} VendTraceStat;
+
+void vend_trace_init(void);
+void vend_trace(VendTraceEvent event, rt_uint8_t id, rt_uint16_t arg);
+
+/* 最近的至多 max 条事件，按先后顺序；返回条数 */
+int vend_trace_snapshot(VendTraceRecord *records, int max);
+void vend_trace_get_stat(VendTracePhase phase, VendTraceStat *stat);
+void vend_trace_reset(void);
+
+rt_uint32_t vend_trace_cycles_to_us(rt_uint32_t cycles);
+const char *vend_trace_event_name(int event);
+const char *vend_trace_phase_name(int phase);
+
+#endif